@@ -36,6 +36,7 @@
 #include <paludis/util/fs_iterator.hh>
 #include <paludis/util/fs_error.hh>
 #include <paludis/util/join.hh>
+#include <paludis/util/task_scheduler.hh>
 
 #include <paludis/contents.hh>
 #include <paludis/environment.hh>
@@ -50,7 +51,9 @@
 #include <functional>
 #include <algorithm>
 #include <iterator>
+#include <list>
 #include <map>
+#include <memory>
 #include <set>
 #include <vector>
 #include <mutex>
@@ -75,12 +78,18 @@ namespace paludis
 
         std::mutex mutex;
 
+        std::unique_ptr<TaskScheduler> scheduler;
+        std::list<std::shared_ptr<Task> > tasks;
+
         bool has_files;
         Files files;
 
         Breakage breakage;
         PackageBreakage orphan_breakage;
 
+        void spawn(const std::function<void ()> &);
+        void wait_for_tasks();
+
         void search_directory(const FSPath &);
 
         void walk_directory(const FSPath &);
@@ -93,6 +102,7 @@ namespace paludis
             env(the_env),
             config(the_env->preferred_root_key()->parse_value()),
             libraries(the_libraries),
+            scheduler(new TaskScheduler),
             has_files(false)
         {
         }
@@ -171,8 +181,9 @@ BrokenLinkageFinder::BrokenLinkageFinder(const Environment * env, const std::sha
                    std::inserter(_imp->extra_lib_dirs, _imp->extra_lib_dirs.begin()),
                    std::bind(realpath_with_current_and_root, _1, FSPath("/"), env->preferred_root_key()->parse_value()));
 
-    std::for_each(search_dirs_pruned.begin(), search_dirs_pruned.end(),
-                      std::bind(&Imp<BrokenLinkageFinder>::search_directory, _imp.get(), _1));
+    for (auto it(search_dirs_pruned.begin()), it_end(search_dirs_pruned.end()) ; it != it_end ; ++it)
+        _imp->spawn(std::bind(&Imp<BrokenLinkageFinder>::search_directory, _imp.get(), *it));
+    _imp->wait_for_tasks();
 
     for (std::set<FSPath>::const_iterator it(_imp->extra_lib_dirs.begin()),
              it_end(_imp->extra_lib_dirs.end()); it_end != it; ++it)
@@ -189,12 +200,42 @@ BrokenLinkageFinder::BrokenLinkageFinder(const Environment * env, const std::sha
             std::bind(&LinkageChecker::need_breakage_added, _1, callback));
 
     _imp->checkers.clear();
+    _imp->scheduler.reset();
 }
 
 BrokenLinkageFinder::~BrokenLinkageFinder()
 {
 }
 
+void
+Imp<BrokenLinkageFinder>::spawn(const std::function<void ()> & f)
+{
+    std::shared_ptr<Task> task(scheduler->spawn(f));
+
+    std::unique_lock<std::mutex> l(mutex);
+    tasks.push_back(task);
+}
+
+void
+Imp<BrokenLinkageFinder>::wait_for_tasks()
+{
+    /* tasks may spawn more tasks, but always before they finish, so once
+     * we've waited for everything on the list, there's nothing left */
+    while (true)
+    {
+        std::shared_ptr<Task> task;
+        {
+            std::unique_lock<std::mutex> l(mutex);
+            if (tasks.empty())
+                break;
+            task = tasks.front();
+            tasks.pop_front();
+        }
+
+        task->wait();
+    }
+}
+
 void
 Imp<BrokenLinkageFinder>::search_directory(const FSPath & directory)
 {
@@ -272,7 +313,7 @@ Imp<BrokenLinkageFinder>::check_file(const FSPath & file)
         }
 
         else if (file_stat.is_directory())
-            walk_directory(file);
+            spawn(std::bind(&Imp<BrokenLinkageFinder>::walk_directory, this, file));
 
         else if (file_stat.is_regular_file())
         {
@@ -308,8 +349,9 @@ Imp<BrokenLinkageFinder>::add_breakage(const FSPath & file, const std::string &
         std::shared_ptr<const PackageIDSequence> pkgs((*env)[selection::AllVersionsUnsorted(
                     generator::All() | filter::InstalledAtRoot(env->preferred_root_key()->parse_value()))]);
 
-        std::for_each(pkgs->begin(), pkgs->end(),
-                std::bind(&Imp<BrokenLinkageFinder>::gather_package, this, _1));
+        for (auto it(pkgs->begin()), it_end(pkgs->end()) ; it != it_end ; ++it)
+            spawn(std::bind(&Imp<BrokenLinkageFinder>::gather_package, this, *it));
+        wait_for_tasks();
     }
 
     FSPath without_root(file.strip_leading(env->preferred_root_key()->parse_value()));
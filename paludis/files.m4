@@ -91,11 +91,11 @@ add(`repository_factory',                          `hh', `fwd', `cc')
 add(`repository_name_cache',                       `hh', `cc', `gtest', `testscript')
 add(`selection',                                   `hh', `cc', `fwd', `gtest')
 add(`selection_handler',                           `hh', `cc', `fwd')
-add(`serialise',                                   `hh', `cc', `fwd', `impl')
+add(`serialise',                                   `hh', `cc', `fwd', `gtest', `impl', `se')
 add(`set_file',                                    `hh', `cc', `se', `gtest', `testscript')
 add(`slot',                                        `hh', `fwd', `cc')
 add(`slot_requirement',                            `hh', `fwd', `cc')
-add(`spec_tree',                                   `hh', `fwd', `cc')
+add(`spec_tree',                                   `hh', `fwd', `cc', `gtest')
 add(`standard_output_manager',                     `hh', `cc', `fwd')
 add(`stripper',                                    `hh', `cc', `fwd', `gtest', `testscript')
 add(`syncer',                                      `hh', `cc')
@@ -32,6 +32,7 @@
 #include <paludis/util/fs_stat.hh>
 #include <paludis/util/fs_iterator.hh>
 #include <paludis/util/fs_error.hh>
+#include <paludis/util/digest_registry.hh>
 #include <paludis/selinux/security_context.hh>
 #include <paludis/environment.hh>
 #include <paludis/hook.hh>
@@ -46,6 +47,8 @@
 #include <list>
 #include <set>
 #include <unordered_map>
+#include <memory>
+#include <algorithm>
 
 #include "config.h"
 
@@ -57,12 +60,183 @@
 #  include <linux/falloc.h>
 #endif
 
+#ifdef HAVE_SENDFILE
+#  include <sys/sendfile.h>
+#endif
+
+#ifdef HAVE_FICLONE
+#  include <sys/ioctl.h>
+#  include <linux/fs.h>
+#endif
+
 using namespace paludis;
 
 #include <paludis/fs_merger-se.cc>
 
 typedef std::unordered_map<std::pair<dev_t, ino_t>, std::string, Hash<std::pair<dev_t, ino_t> > > MergedMap;
 
+namespace
+{
+    enum CopyMethod
+    {
+        cm_copy_file_range,
+        cm_sendfile,
+        cm_read_write
+    };
+
+    bool copy_method_unsupported(int e)
+    {
+        return EXDEV == e || ENOSYS == e || EINVAL == e || EOPNOTSUPP == e || EBADF == e;
+    }
+
+    /* copy length bytes starting at offset, using the cheapest method that
+     * the kernel and filesystems let us, and remembering which methods didn't
+     * work so we don't keep trying them. some filesystems make copy_file_range
+     * and sendfile report end of file when there's more to come, so we only
+     * believe that from read. */
+    void copy_range(int input_fd, int output_fd, off_t offset, off_t length, CopyMethod & method,
+            std::unique_ptr<char[]> & buf, const std::size_t buf_size)
+    {
+        off_t end(offset + length);
+
+#ifdef HAVE_COPY_FILE_RANGE
+        while (cm_copy_file_range == method && offset < end)
+        {
+            loff_t in_offset(offset), out_offset(offset);
+            ssize_t count(::copy_file_range(input_fd, &in_offset, output_fd, &out_offset, end - offset, 0));
+            if (0 == count)
+                method = cm_sendfile;
+            else if (-1 == count)
+            {
+                if (! copy_method_unsupported(errno))
+                    throw FSMergerError("copy_file_range failed: " + stringify(::strerror(errno)));
+                method = cm_sendfile;
+            }
+            else
+                offset += count;
+        }
+#else
+        if (cm_copy_file_range == method)
+            method = cm_sendfile;
+#endif
+
+#ifdef HAVE_SENDFILE
+        if (cm_sendfile == method && offset < end)
+        {
+            if (-1 == ::lseek(output_fd, offset, SEEK_SET))
+                throw FSMergerError("lseek failed: " + stringify(::strerror(errno)));
+
+            while (cm_sendfile == method && offset < end)
+            {
+                off_t in_offset(offset);
+                ssize_t count(::sendfile(output_fd, input_fd, &in_offset, end - offset));
+                if (0 == count)
+                    method = cm_read_write;
+                else if (-1 == count)
+                {
+                    if (! copy_method_unsupported(errno))
+                        throw FSMergerError("sendfile failed: " + stringify(::strerror(errno)));
+                    method = cm_read_write;
+                }
+                else
+                    offset += count;
+            }
+        }
+#endif
+
+        method = cm_read_write;
+        if (offset < end && ! buf)
+            buf.reset(new char[buf_size]);
+
+        while (offset < end)
+        {
+            ssize_t count(::pread(input_fd, buf.get(), std::min<off_t>(buf_size, end - offset), offset));
+            if (0 == count)
+                throw FSMergerError("read failed: file shrank whilst we were copying it");
+            else if (-1 == count)
+                throw FSMergerError("read failed: " + stringify(::strerror(errno)));
+
+            for (ssize_t done(0) ; done < count ; )
+            {
+                ssize_t written(::pwrite(output_fd, buf.get() + done, count - done, offset + done));
+                if (-1 == written)
+                    throw FSMergerError("write failed: " + stringify(::strerror(errno)));
+                done += written;
+            }
+
+            offset += count;
+        }
+    }
+
+    /* share extents with the image, if the filesystem supports reflinks */
+    bool try_to_clone(int input_fd, int output_fd)
+    {
+#ifdef HAVE_FICLONE
+        return 0 == ::ioctl(output_fd, FICLONE, input_fd);
+#else
+        return false;
+#endif
+    }
+
+    void digest_file_contents(int input_fd, Digester * const digester)
+    {
+        const std::size_t buf_size(1 << 20);
+        std::unique_ptr<char[]> buf(new char[buf_size]);
+
+        for (off_t offset(0) ; ; )
+        {
+            ssize_t count(::pread(input_fd, buf.get(), buf_size, offset));
+            if (0 == count)
+                break;
+            else if (-1 == count)
+                throw FSMergerError("read failed: " + stringify(::strerror(errno)));
+
+            digester->update(buf.get(), count);
+            offset += count;
+        }
+    }
+
+    /* copy a regular file's contents, leaving holes in sparse files as holes */
+    void copy_file_contents(int input_fd, int output_fd, off_t size, bool sparse)
+    {
+        CopyMethod method(cm_copy_file_range);
+        std::unique_ptr<char[]> buf;
+        const std::size_t buf_size(1 << 20);
+
+        off_t offset(0);
+        while (offset < size)
+        {
+            off_t data_start(offset), data_end(size);
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+            if (sparse)
+            {
+                data_start = ::lseek(input_fd, offset, SEEK_DATA);
+                if (-1 == data_start && ENXIO == errno)
+                    break;
+                else if (-1 == data_start)
+                {
+                    data_start = offset;
+                    sparse = false;
+                }
+                else
+                {
+                    data_end = ::lseek(input_fd, data_start, SEEK_HOLE);
+                    if (-1 == data_end)
+                        data_end = size;
+                }
+            }
+#endif
+
+            copy_range(input_fd, output_fd, data_start, data_end - data_start, method, buf, buf_size);
+            offset = data_end;
+        }
+
+        /* in case the file ends in a hole */
+        if (sparse && 0 != ::ftruncate(output_fd, size))
+            throw FSMergerError("ftruncate failed: " + stringify(::strerror(errno)));
+    }
+}
+
 namespace paludis
 {
     template <>
@@ -72,6 +246,9 @@ namespace paludis
         FSMergerParams params;
         std::set<FSPath, FSPathComparator> elided_paths;
 
+        std::string last_installed_file, last_installed_file_digest;
+        struct ::stat last_installed_file_stat;
+
         Imp(const FSMergerParams & p) :
             params(p)
         {
@@ -334,6 +511,9 @@ FSMerger::install_file(const FSPath & src, const FSPath & dst_dir, const std::st
 
     FSPath dst_real(dst_dir / dst_name);
 
+    _imp->last_installed_file.clear();
+    _imp->last_installed_file_digest.clear();
+
     if (_imp->params.should_merge() &&
             ! _imp->params.should_merge()(dst_real.strip_leading(_imp->params.root().realpath())))
         return { msi_unselected_part };
@@ -406,22 +586,35 @@ FSMerger::install_file(const FSPath & src, const FSPath & dst_dir, const std::st
     if (do_copy)
     {
         Log::get_instance()->message("merger.file.will_copy", ll_debug, lc_context) <<
-            "rename/link failed: " << ::strerror(errno) << ". Falling back to regular read/write copy";
+            "rename/link failed: " << ::strerror(errno) << ". Falling back to copying";
 
         FDHolder input_fd(::open(stringify(src).c_str(), O_RDONLY), false);
         if (-1 == input_fd)
             throw FSMergerError("Cannot read '" + stringify(src) + "': " + stringify(::strerror(errno)));
 
-        FDHolder output_fd(::open(stringify(dst).c_str(), O_WRONLY | O_CREAT, src_perms), false);
+        FDHolder output_fd(::open(stringify(dst).c_str(), O_WRONLY | O_CREAT | O_TRUNC, src_perms), false);
         if (-1 == output_fd)
             throw FSMergerError("Cannot write '" + stringify(dst) + "': " + stringify(::strerror(errno)));
 
+        struct ::stat input_stat;
+        if (-1 == ::fstat(input_fd, &input_stat))
+            throw FSMergerError("Cannot fstat '" + stringify(src) + "': " + stringify(::strerror(errno)));
+        bool sparse(input_stat.st_blocks * 512 < input_stat.st_size);
+
+#ifdef POSIX_FADV_SEQUENTIAL
+        ::posix_fadvise(input_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
         if (! _imp->params.no_chown())
             if (0 != ::fchown(output_fd, src_stat.owner(), src_stat.group()))
                 throw FSMergerError("Cannot fchown '" + stringify(dst) + "': " + stringify(::strerror(errno)));
 
+        /* before fallocate and fchmod, since cloning counts as a write */
+        bool cloned(try_to_clone(input_fd, output_fd));
+
 #ifdef HAVE_FALLOCATE
-        if (0 != ::fallocate(output_fd, FALLOC_FL_KEEP_SIZE, 0, src_stat.file_size()))
+        /* preallocating would fill in any holes */
+        if ((! cloned) && (! sparse) && 0 != ::fallocate(output_fd, FALLOC_FL_KEEP_SIZE, 0, src_stat.file_size()))
             switch (errno)
             {
                 case EOPNOTSUPP:
@@ -443,13 +636,24 @@ FSMerger::install_file(const FSPath & src, const FSPath & dst_dir, const std::st
             throw FSMergerError("Cannot fchmod '" + stringify(dst) + "': " + stringify(::strerror(errno)));
         try_to_copy_xattrs(src, output_fd, result);
 
-        char buf[4096];
-        ssize_t count;
-        while ((count = read(input_fd, buf, 4096)) > 0)
-            if (-1 == write(output_fd, buf, count))
-                throw FSMergerError("write failed: " + stringify(::strerror(errno)));
-        if (-1 == count)
-            throw FSMergerError("read failed: " + stringify(::strerror(errno)));
+        std::shared_ptr<Digester> digester;
+        if (! install_file_digest_algorithm().empty())
+            digester = DigestRegistry::get_instance()->make_digester(install_file_digest_algorithm());
+
+        if (! cloned)
+            copy_file_contents(input_fd, output_fd, input_stat.st_size, sparse);
+
+        /* hash the image rather than making the copy come through userspace,
+         * so that we still get to use copy_file_range and sendfile. the
+         * copy has just read it, so it should still be in the page cache */
+        if (digester)
+            digest_file_contents(input_fd, digester.get());
+
+#ifdef POSIX_FADV_DONTNEED
+        /* we're done with the image copy, so don't let it push things that
+         * are still wanted out of the page cache */
+        ::posix_fadvise(input_fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
 
         /* might need to copy mtime */
         if (_imp->params.options()[mo_preserve_mtimes])
@@ -461,6 +665,13 @@ FSMerger::install_file(const FSPath & src, const FSPath & dst_dir, const std::st
                 throw FSMergerError("Cannot futimens '" + stringify(dst) + "': " + stringify(::strerror(errno)));
         }
 
+        /* remember what we installed, so we can tell if a post hook changes it */
+        if (digester && 0 == ::fstat(output_fd, &_imp->last_installed_file_stat))
+        {
+            _imp->last_installed_file = stringify(dst_real);
+            _imp->last_installed_file_digest = digester->finish();
+        }
+
         if (0 != std::rename(stringify(dst).c_str(), stringify(dst_real).c_str()))
             throw FSMergerError(
                     "rename(" + stringify(dst) + ", " + stringify(dst_real) + ") failed: " + stringify(::strerror(errno)));
@@ -891,6 +1102,28 @@ FSMerger::try_to_copy_xattrs(const FSPath &, int, FSMergerStatusFlags &)
 
 #endif
 
+std::string
+FSMerger::install_file_digest_algorithm() const
+{
+    return "";
+}
+
+std::string
+FSMerger::installed_file_digest(const FSPath & f) const
+{
+    if (stringify(f) != _imp->last_installed_file)
+        return "";
+
+    struct ::stat now;
+    const struct ::stat & then(_imp->last_installed_file_stat);
+    if (0 != ::stat(stringify(f).c_str(), &now) || now.st_dev != then.st_dev || now.st_ino != then.st_ino
+            || now.st_size != then.st_size || now.st_mtim.tv_sec != then.st_mtim.tv_sec
+            || now.st_mtim.tv_nsec != then.st_mtim.tv_nsec)
+        return "";
+
+    return _imp->last_installed_file_digest;
+}
+
 void
 FSMerger::track_install_file(const FSPath & src, const FSPath & dst_dir, const std::string & dst_name, const FSMergerStatusFlags & flags)
 {
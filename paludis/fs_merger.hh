@@ -192,6 +192,23 @@ namespace paludis
             virtual void unlink_file(FSPath);
             virtual void record_install_file(const FSPath &, const FSPath &, const std::string &, const FSMergerStatusFlags &) = 0;
 
+            /**
+             * If not empty, the digest to calculate for each file whilst it
+             * is being copied, for use by record_install_file.
+             *
+             * \since 2.2.0
+             */
+            virtual std::string install_file_digest_algorithm() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            /**
+             * The digest calculated whilst installing a file, or an empty
+             * string if the file was renamed or linked into place rather than
+             * copied, or has changed since.
+             *
+             * \since 2.2.0
+             */
+            std::string installed_file_digest(const FSPath &) const PALUDIS_ATTRIBUTE((warn_unused_result));
+
             virtual void on_enter_dir(bool is_check, const FSPath);
 
             virtual void on_dir_main(bool is_check, const FSPath & src, const FSPath & dst);
@@ -26,6 +26,7 @@
 #include <paludis/util/wrapped_forward_iterator.hh>
 #include <paludis/util/make_named_values.hh>
 #include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/md5.hh>
 #include <paludis/util/set.hh>
 #include <paludis/util/timestamp.hh>
 #include <paludis/util/fs_stat.hh>
@@ -38,6 +39,7 @@
 #include <functional>
 #include <iterator>
 #include <list>
+#include <map>
 
 #include <gtest/gtest.h>
 
@@ -51,6 +53,13 @@ namespace
         return std::make_pair(-1, -1);
     }
 
+    std::string
+    contents_of(const FSPath & f)
+    {
+        SafeIFStream s(f);
+        return std::string((std::istreambuf_iterator<char>(s)), std::istreambuf_iterator<char>());
+    }
+
     bool
     timestamps_nearly_equal(const Timestamp & i_set, const Timestamp & reference)
     {
@@ -102,13 +111,22 @@ namespace
     struct TestMerger :
         FSMerger
     {
+        std::string digest_algorithm;
+        std::map<std::string, std::string> digests;
+
         TestMerger(const FSMergerParams & p) :
             FSMerger(p)
         {
         }
 
-        void record_install_file(const FSPath &, const FSPath &, const std::string &, const FSMergerStatusFlags &)
+        std::string install_file_digest_algorithm() const
+        {
+            return digest_algorithm;
+        }
+
+        void record_install_file(const FSPath &, const FSPath & dst_dir, const std::string & dst_name, const FSMergerStatusFlags &)
         {
+            digests[stringify(dst_dir / dst_name)] = installed_file_digest(dst_dir / dst_name);
         }
 
         void record_install_dir(const FSPath &, const FSPath &, const FSMergerStatusFlags &)
@@ -514,3 +532,33 @@ TEST(Merger, MtimesFixes)
     ASSERT_TRUE(timestamps_nearly_equal((data->root_dir / "dir" / "dodgy_file").stat().mtim(), FSPath("fs_merger_TEST_dir/reference").stat().mtim()));
 }
 
+TEST(Merger, Copied)
+{
+    auto data(make_merger("copied", { mo_nondestructive, mo_allow_empty_dirs }));
+
+    ASSERT_TRUE(data->merger.check());
+    data->merger.merge();
+
+    for (auto f : { "empty", "small", "big", "sparse" })
+    {
+        ASSERT_TRUE((data->image_dir / f).stat().is_regular_file()) << f;
+        ASSERT_TRUE((data->root_dir / f).stat().is_regular_file()) << f;
+        EXPECT_EQ((data->image_dir / f).stat().file_size(), (data->root_dir / f).stat().file_size()) << f;
+        EXPECT_TRUE(contents_of(data->image_dir / f) == contents_of(data->root_dir / f)) << f;
+    }
+}
+
+TEST(Merger, CopiedWithDigest)
+{
+    auto data(make_merger("copied_digest", { mo_nondestructive, mo_allow_empty_dirs }));
+    data->merger.digest_algorithm = "MD5";
+
+    ASSERT_TRUE(data->merger.check());
+    data->merger.merge();
+
+    for (auto f : { "empty", "small", "big", "sparse" })
+    {
+        SafeIFStream s(data->image_dir / f);
+        EXPECT_EQ(MD5(s).hexsum(), data->merger.digests[stringify(data->root_dir.realpath() / f)]) << f;
+    }
+}
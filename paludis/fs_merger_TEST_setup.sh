@@ -110,6 +110,15 @@ touch -d '3 years ago' mtimes_fix/image/dodgy_file
 touch -d '3 years ago' mtimes_fix/image/dir/dodgy_file
 > mtimes_fix/root/existing_file
 
+mkdir -p copied/{image,root}
+> copied/image/empty
+echo "small contents" > copied/image/small
+head -c 3000000 /dev/urandom > copied/image/big
+truncate -s 8M copied/image/sparse
+head -c 5000 /dev/urandom | dd of=copied/image/sparse bs=4096 seek=512 conv=notrunc 2>/dev/null
+head -c 5000 /dev/urandom | dd of=copied/image/sparse bs=4096 seek=1500 conv=notrunc 2>/dev/null
+cp -a copied copied_digest
+
 mkdir hooks
 cd hooks
 mkdir \
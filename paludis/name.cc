@@ -30,9 +30,88 @@
 #include <paludis/util/wrapped_value-impl.hh>
 #include <ostream>
 #include <utility>
+#include <mutex>
+#include <unordered_set>
 
 using namespace paludis;
 
+namespace
+{
+    template <typename Tag_>
+    struct InternTable
+    {
+        std::mutex mutex;
+        std::unordered_set<std::string, Hash<std::string> > values;
+
+        static InternTable & get()
+        {
+            /* never destroyed, since names are used by other static objects */
+            static InternTable * const table(new InternTable);
+            return *table;
+        }
+
+        /* interned values live for ever, so we can hand out pointers
+         * to them with nothing to count references */
+        static const std::shared_ptr<const std::string> pointer_to(const std::string & s)
+        {
+            return std::shared_ptr<const std::string>(std::shared_ptr<const std::string>(), &s);
+        }
+
+        static const std::shared_ptr<const std::string> find(const std::string & s)
+        {
+            InternTable & table(get());
+            std::unique_lock<std::mutex> lock(table.mutex);
+            auto i(table.values.find(s));
+            if (table.values.end() == i)
+                return nullptr;
+            return pointer_to(*i);
+        }
+
+        static const std::shared_ptr<const std::string> insert(const std::string & s)
+        {
+            InternTable & table(get());
+            std::unique_lock<std::mutex> lock(table.mutex);
+            return pointer_to(*table.values.insert(s).first);
+        }
+    };
+}
+
+const std::shared_ptr<const std::string>
+WrappedValueInterning<RepositoryNameTag>::find(const std::string & s)
+{
+    return InternTable<RepositoryNameTag>::find(s);
+}
+
+const std::shared_ptr<const std::string>
+WrappedValueInterning<RepositoryNameTag>::insert(const std::string & s)
+{
+    return InternTable<RepositoryNameTag>::insert(s);
+}
+
+const std::shared_ptr<const std::string>
+WrappedValueInterning<CategoryNamePartTag>::find(const std::string & s)
+{
+    return InternTable<CategoryNamePartTag>::find(s);
+}
+
+const std::shared_ptr<const std::string>
+WrappedValueInterning<CategoryNamePartTag>::insert(const std::string & s)
+{
+    return InternTable<CategoryNamePartTag>::insert(s);
+}
+
+const std::shared_ptr<const std::string>
+WrappedValueInterning<PackageNamePartTag>::find(const std::string & s)
+{
+    return InternTable<PackageNamePartTag>::find(s);
+}
+
+const std::shared_ptr<const std::string>
+WrappedValueInterning<PackageNamePartTag>::insert(const std::string & s)
+{
+    return InternTable<PackageNamePartTag>::insert(s);
+}
+
 namespace paludis
 {
     template class WrappedValue<RepositoryNameTag>;
@@ -280,18 +359,16 @@ QualifiedPackageName::QualifiedPackageName(const CategoryNamePart & c, const Pac
 bool
 QualifiedPackageName::operator< (const QualifiedPackageName & other) const
 {
-    if (category() < other.category())
-        return true;
-    if (category() > other.category())
-        return false;
+    if (_cat == other._cat)
+        return _pkg < other._pkg;
 
-    return package() < other.package();
+    return _cat < other._cat;
 }
 
 bool
 QualifiedPackageName::operator== (const QualifiedPackageName & other) const
 {
-    return category() == other.category() && package() == other.package();
+    return _cat == other._cat && _pkg == other._pkg;
 }
 
 bool
@@ -358,6 +435,6 @@ WrappedValueTraits<PartNameTag>::validate(const std::string & name)
 std::size_t
 QualifiedPackageName::hash() const
 {
-    return Hash<std::string>()(stringify(*this));
+    return (Hash<CategoryNamePart>()(_cat) << 8) ^ Hash<PackageNamePart>()(_pkg);
 }
 
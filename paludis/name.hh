@@ -70,6 +70,15 @@ namespace paludis
         static bool validate(const std::string &) PALUDIS_ATTRIBUTE((warn_unused_result));
     };
 
+    template <>
+    struct PALUDIS_VISIBLE WrappedValueInterning<PackageNamePartTag>
+    {
+        static const bool enabled = true;
+
+        static const std::shared_ptr<const std::string> find(const std::string &) PALUDIS_ATTRIBUTE((warn_unused_result));
+        static const std::shared_ptr<const std::string> insert(const std::string &);
+    };
+
     extern template class PALUDIS_VISIBLE WrappedValue<PackageNamePartTag>;
 
     /**
@@ -99,6 +108,15 @@ namespace paludis
         static bool validate(const std::string &) PALUDIS_ATTRIBUTE((warn_unused_result));
     };
 
+    template <>
+    struct PALUDIS_VISIBLE WrappedValueInterning<CategoryNamePartTag>
+    {
+        static const bool enabled = true;
+
+        static const std::shared_ptr<const std::string> find(const std::string &) PALUDIS_ATTRIBUTE((warn_unused_result));
+        static const std::shared_ptr<const std::string> insert(const std::string &);
+    };
+
     extern template class PALUDIS_VISIBLE WrappedValue<CategoryNamePartTag>;
 
     /**
@@ -192,6 +210,15 @@ namespace paludis
         static bool validate(const std::string &) PALUDIS_ATTRIBUTE((warn_unused_result));
     };
 
+    template <>
+    struct PALUDIS_VISIBLE WrappedValueInterning<RepositoryNameTag>
+    {
+        static const bool enabled = true;
+
+        static const std::shared_ptr<const std::string> find(const std::string &) PALUDIS_ATTRIBUTE((warn_unused_result));
+        static const std::shared_ptr<const std::string> insert(const std::string &);
+    };
+
     /**
      * A KeywordNameError is thrown if an invalid value is assigned to
      * a KeywordName.
@@ -59,6 +59,31 @@ TEST(QualifiedPackageName, Compare)
     EXPECT_TRUE( (foo2_bar1 >  foo1_bar2));
 }
 
+TEST(QualifiedPackageName, Interned)
+{
+    QualifiedPackageName a("foo/bar"), b(CategoryNamePart("foo") + PackageNamePart("bar")), c("foo/baz");
+
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(&a.category().value(), &b.category().value());
+    EXPECT_EQ(&a.package().value(), &b.package().value());
+    EXPECT_EQ(a.hash(), b.hash());
+    EXPECT_NE(a, c);
+    EXPECT_EQ(&a.category().value(), &c.category().value());
+    EXPECT_NE(&a.package().value(), &c.package().value());
+}
+
+TEST(QualifiedPackageName, CompareLexicographically)
+{
+    /* interning must not change the order, whichever we see first */
+    QualifiedPackageName zzz("zzz-interned/zzz"), aaa("aaa-interned/aaa"), aab("aaa-interned/aab");
+
+    EXPECT_TRUE(aaa < aab);
+    EXPECT_TRUE(aab < zzz);
+    EXPECT_TRUE(aaa < zzz);
+    EXPECT_FALSE(zzz < aaa);
+    EXPECT_FALSE(aaa < aaa);
+}
+
 TEST(CategoryNamePart, Create)
 {
     CategoryNamePart p("foo");
@@ -128,6 +153,14 @@ TEST(RepositoryName, Validation)
     EXPECT_THROW(r = RepositoryName("fo$o"), NameError);
 }
 
+TEST(RepositoryName, Interned)
+{
+    RepositoryName r("repo0_-");
+    EXPECT_THROW(r = RepositoryName("fo$o"), NameError);
+    EXPECT_THROW(r = RepositoryName("fo$o"), NameError);
+    EXPECT_EQ(&RepositoryName("repo0_-").value(), &r.value());
+}
+
 TEST(SlotName, Creation)
 {
     SlotName s("foo");
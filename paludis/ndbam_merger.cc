@@ -157,6 +157,12 @@ namespace
     }
 }
 
+std::string
+NDBAMMerger::install_file_digest_algorithm() const
+{
+    return "MD5";
+}
+
 void
 NDBAMMerger::record_install_file(const FSPath & src, const FSPath & dst_dir, const std::string & dst_name, const FSMergerStatusFlags & flags)
 {
@@ -170,11 +176,16 @@ NDBAMMerger::record_install_file(const FSPath & src, const FSPath & dst_dir, con
 
     time_t timestamp(dst_dir_name_stat.mtim().seconds());
 
-    SafeIFStream infile(renamed_file);
-    if (! infile)
-        throw FSMergerError("Cannot read '" + stringify(renamed_file) + "'");
+    /* if we copied the file, we already know its md5 */
+    std::string md5(installed_file_digest(renamed_file));
+    if (md5.empty())
+    {
+        SafeIFStream infile(renamed_file);
+        if (! infile)
+            throw FSMergerError("Cannot read '" + stringify(renamed_file) + "'");
 
-    MD5 md5(infile);
+        md5 = MD5(infile).hexsum();
+    }
 
     display_merge(et_file, file, flags,
                   src.basename() == dst_name ? "" : dst_name);
@@ -185,7 +196,7 @@ NDBAMMerger::record_install_file(const FSPath & src, const FSPath & dst_dir, con
 
     *_imp->contents_file << "type=file";
     *_imp->contents_file << " path=" << escape(tidy_real);
-    *_imp->contents_file << " md5=" << md5.hexsum();
+    *_imp->contents_file << " md5=" << md5;
     *_imp->contents_file << " mtime=" << timestamp;
     if (!part.empty())
         *_imp->contents_file << " part=" << part;
@@ -57,6 +57,17 @@ NotifierCallbackLinkageStepEvent::location() const
     return _location;
 }
 
+NotifierCallbackRepositoryInvalidatedEvent::NotifierCallbackRepositoryInvalidatedEvent(const RepositoryName & r) :
+    _repo(r)
+{
+}
+
+const RepositoryName
+NotifierCallbackRepositoryInvalidatedEvent::repository() const
+{
+    return _repo;
+}
+
 namespace paludis
 {
     template <>
@@ -35,7 +35,8 @@ namespace paludis
             NotifierCallbackGeneratingMetadataEvent,
             NotifierCallbackResolverStepEvent,
             NotifierCallbackResolverStageEvent,
-            NotifierCallbackLinkageStepEvent>::Type>
+            NotifierCallbackLinkageStepEvent,
+            NotifierCallbackRepositoryInvalidatedEvent>::Type>
     {
     };
 
@@ -84,6 +85,26 @@ namespace paludis
             const FSPath location() const PALUDIS_ATTRIBUTE((warn_unused_result));
     };
 
+    /**
+     * Triggered after a repository has been invalidated, for example because
+     * something has been installed to it, so that anything remembering its
+     * contents can forget them.
+     *
+     * \since 2.2.0
+     */
+    class PALUDIS_VISIBLE NotifierCallbackRepositoryInvalidatedEvent :
+        public NotifierCallbackEvent,
+        public ImplementAcceptMethods<NotifierCallbackEvent, NotifierCallbackRepositoryInvalidatedEvent>
+    {
+        private:
+            const RepositoryName _repo;
+
+        public:
+            NotifierCallbackRepositoryInvalidatedEvent(const RepositoryName &);
+
+            const RepositoryName repository() const PALUDIS_ATTRIBUTE((warn_unused_result));
+    };
+
     class PALUDIS_VISIBLE ScopedNotifierCallback
     {
         private:
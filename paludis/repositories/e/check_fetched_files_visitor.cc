@@ -47,6 +47,8 @@
 #include <algorithm>
 #include <list>
 #include <set>
+#include <map>
+#include <vector>
 
 using namespace paludis;
 using namespace paludis::erepository;
@@ -245,8 +247,7 @@ CheckFetchedFilesVisitor::check_distfile_manifest(const FSPath & distfile)
         {
             SafeIFStream file_stream(distfile);
 
-            MemoisedHashes * hashes = MemoisedHashes::get_instance();
-
+            std::vector<std::string> algos;
             for (Map<std::string, std::string>::ConstIterator it(m->hashes()->begin()),
                      it_end(m->hashes()->end()); it_end != it; ++it)
             {
@@ -257,7 +258,20 @@ CheckFetchedFilesVisitor::check_distfile_manifest(const FSPath & distfile)
                     continue;
                 }
 
-                std::string hexsum(hashes->get(it->first, distfile, file_stream));
+                algos.push_back(it->first);
+            }
+
+            /* calculate every hash in one go, so we only read the file once */
+            const std::map<std::string, std::string> hexsums(MemoisedHashes::get_instance()->get_all(algos, distfile, file_stream, true));
+
+            for (Map<std::string, std::string>::ConstIterator it(m->hashes()->begin()),
+                     it_end(m->hashes()->end()); it_end != it; ++it)
+            {
+                auto h(hexsums.find(it->first));
+                if (hexsums.end() == h)
+                    continue;
+
+                const std::string & hexsum(h->second);
 
                 if (hexsum != it->second)
                 {
@@ -24,6 +24,7 @@
 #include <paludis/repositories/e/eapi_phase.hh>
 #include <paludis/repositories/e/ebuild.hh>
 #include <paludis/repositories/e/e_repository.hh>
+#include <paludis/repositories/e/owners_index.hh>
 
 #include <paludis/util/visitor_cast.hh>
 #include <paludis/util/pimp-impl.hh>
@@ -56,9 +57,21 @@
 #include <paludis/common_sets.hh>
 #include <paludis/output_manager.hh>
 
+#include <algorithm>
+#include <map>
+#include <mutex>
+
 using namespace paludis;
 using namespace paludis::erepository;
 
+namespace
+{
+    FSPath owners_index_location(const FSPath & repository_location)
+    {
+        return repository_location / ".cache" / "owners.bincache";
+    }
+}
+
 namespace paludis
 {
     template <>
@@ -66,6 +79,9 @@ namespace paludis
     {
         EInstalledRepositoryParams params;
 
+        mutable std::mutex owners_index_mutex;
+        mutable std::shared_ptr<const OwnersIndex> owners_index;
+
         Imp(const EInstalledRepositoryParams & p) :
             params(p)
         {
@@ -387,3 +403,70 @@ EInstalledRepository::maybe_expand_licence_nonrecursively(const std::string &) c
     return nullptr;
 }
 
+std::shared_ptr<const PackageIDSequence>
+EInstalledRepository::ids_owning_path(const std::string & q, const OwnerQueryType t) const
+{
+    std::map<std::string, std::string> owners;
+    {
+        std::unique_lock<std::mutex> lock(_imp->owners_index_mutex);
+        if (! _imp->owners_index)
+            _imp->owners_index = std::make_shared<OwnersIndex>(owners_index_location(location_key()->parse_value()));
+
+        if (! _imp->owners_index->find(q, t, owners))
+            return nullptr;
+    }
+
+    std::shared_ptr<PackageIDSequence> result(std::make_shared<PackageIDSequence>());
+    for (auto o(owners.begin()), o_end(owners.end()) ;
+            o != o_end ; ++o)
+    {
+        auto ids(package_ids(QualifiedPackageName(o->second), { }));
+        auto i(std::find_if(ids->begin(), ids->end(), [&] (const std::shared_ptr<const PackageID> & id) {
+                    return id->fs_location_key() && stringify(id->fs_location_key()->parse_value()) == o->first;
+                    }));
+
+        /* something has changed without the index noticing, so let the
+         * caller work it out the slow way */
+        if (ids->end() == i)
+            return nullptr;
+
+        result->push_back(*i);
+    }
+
+    return result;
+}
+
+void
+EInstalledRepository::update_owners_index() const
+{
+    const FSPath location(location_key()->parse_value());
+    Context context("When updating owners index for '" + stringify(location) + "':");
+
+    try
+    {
+        std::shared_ptr<PackageIDSequence> ids(std::make_shared<PackageIDSequence>());
+        auto cats(category_names({ }));
+        for (auto c(cats->begin()), c_end(cats->end()) ;
+                c != c_end ; ++c)
+        {
+            auto pkgs(package_names(*c, { }));
+            for (auto p(pkgs->begin()), p_end(pkgs->end()) ;
+                    p != p_end ; ++p)
+            {
+                auto pids(package_ids(*p, { }));
+                std::copy(pids->begin(), pids->end(), ids->back_inserter());
+            }
+        }
+
+        OwnersIndex::update(owners_index_location(location), location, ids);
+    }
+    catch (const Exception & e)
+    {
+        Log::get_instance()->message("e.owners_index.update_failed", ll_warning, lc_context)
+            << "Could not update owners index for '" << location << "' due to exception '"
+            << e.message() << "' (" << e.what() << ")";
+    }
+
+    std::unique_lock<std::mutex> lock(_imp->owners_index_mutex);
+    _imp->owners_index.reset();
+}
@@ -58,6 +58,11 @@ namespace paludis
                         const std::string & var) const
                     PALUDIS_ATTRIBUTE((warn_unused_result));
 
+                /**
+                 * Rewrite our owners index, after our contents have changed.
+                 */
+                void update_owners_index() const;
+
             public:
                 /* RepositoryEnvironmentVariableInterface */
 
@@ -98,6 +103,10 @@ namespace paludis
                 virtual const std::shared_ptr<const Set<std::string> > maybe_expand_licence_nonrecursively(
                         const std::string &) const;
 
+                virtual std::shared_ptr<const PackageIDSequence> ids_owning_path(
+                        const std::string &, const OwnerQueryType) const
+                    PALUDIS_ATTRIBUTE((warn_unused_result));
+
                 ///\name For use by EInstalledRepositoryID
                 ///\{
 
@@ -29,6 +29,8 @@ namespace paludis
 {
     namespace erepository
     {
+        class VDBIndexEntry;
+
         class EInstalledRepositoryID :
             public ERepositoryID,
             public std::enable_shared_from_this<EInstalledRepositoryID>
@@ -36,10 +38,18 @@ namespace paludis
             private:
                 Pimp<EInstalledRepositoryID> _imp;
 
+                void need_index_entry() const;
+
             protected:
                 virtual void need_keys_added() const;
                 virtual void need_masks_added() const;
 
+                /**
+                 * If our directory's files have already been read in to an
+                 * index, return them, to save reading them individually.
+                 */
+                virtual const std::shared_ptr<const VDBIndexEntry> index_entry() const;
+
                 EInstalledRepositoryID(const QualifiedPackageName &, const VersionSpec &,
                         const Environment * const,
                         const RepositoryName &,
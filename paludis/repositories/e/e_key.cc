@@ -51,11 +51,63 @@
 #include <paludis/call_pretty_printer.hh>
 
 #include <algorithm>
+#include <atomic>
 #include <functional>
+#include <mutex>
 
 using namespace paludis;
 using namespace paludis::erepository;
 
+namespace
+{
+    /* Parsed trees are a lot bigger than the strings they come from, so we
+     * keep a count of how much we're holding on to, and stop remembering new
+     * trees once it gets silly. We know how big a tree's nodes are, but the
+     * specs they hold are only a (very rough) guess. */
+    const std::size_t memoised_tree_spec_cost_per_char(32);
+    const std::size_t memoised_tree_cost_limit(std::size_t(512) << 20);
+    std::atomic<std::size_t> memoised_tree_total_cost(0);
+
+    template <typename T_>
+    struct MemoisedTree
+    {
+        std::mutex mutex;
+        std::shared_ptr<const T_> value;
+        std::size_t cost;
+
+        MemoisedTree() :
+            cost(0)
+        {
+        }
+
+        ~MemoisedTree()
+        {
+            memoised_tree_total_cost -= cost;
+        }
+
+        template <typename F_>
+        const std::shared_ptr<const T_> fetch(const std::string & s, const F_ & parse)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (value)
+                return value;
+
+            std::shared_ptr<const T_> result(parse());
+
+            std::size_t c(sizeof(T_) + result->arena_size() + s.length() * memoised_tree_spec_cost_per_char);
+            if (memoised_tree_total_cost.fetch_add(c) + c <= memoised_tree_cost_limit)
+            {
+                value = result;
+                cost = c;
+            }
+            else
+                memoised_tree_total_cost -= c;
+
+            return result;
+        }
+    };
+}
+
 namespace paludis
 {
     template <>
@@ -64,6 +116,7 @@ namespace paludis
         const Environment * const env;
         const std::shared_ptr<const ERepositoryID> id;
         const std::string string_value;
+        mutable MemoisedTree<DependencySpecTree> value;
         const std::shared_ptr<const DependenciesLabelSequence> labels;
 
         const std::string raw_name;
@@ -103,8 +156,10 @@ EDependenciesKey::~EDependenciesKey()
 const std::shared_ptr<const DependencySpecTree>
 EDependenciesKey::parse_value() const
 {
-    Context context("When parsing metadata key '" + raw_name() + "' from '" + stringify(*_imp->id) + "':");
-    return parse_depend(_imp->string_value, _imp->env, *_imp->id->eapi(), _imp->id->is_installed());
+    return _imp->value.fetch(_imp->string_value, [&] () {
+            Context context("When parsing metadata key '" + raw_name() + "' from '" + stringify(*_imp->id) + "':");
+            return parse_depend(_imp->string_value, _imp->env, *_imp->id->eapi(), _imp->id->is_installed());
+        });
 }
 
 const std::shared_ptr<const DependenciesLabelSequence>
@@ -148,6 +203,7 @@ namespace paludis
     {
         const Environment * const env;
         const std::string string_value;
+        mutable MemoisedTree<LicenseSpecTree> value;
 
         const std::shared_ptr<const EAPIMetadataVariable> variable;
         const std::shared_ptr<const EAPI> eapi;
@@ -188,8 +244,10 @@ ELicenseKey::~ELicenseKey()
 const std::shared_ptr<const LicenseSpecTree>
 ELicenseKey::parse_value() const
 {
-    Context context("When parsing metadata key '" + raw_name() + "':");
-    return parse_license(_imp->string_value, _imp->env, *_imp->eapi, _imp->is_installed);
+    return _imp->value.fetch(_imp->string_value, [&] () {
+            Context context("When parsing metadata key '" + raw_name() + "':");
+            return parse_license(_imp->string_value, _imp->env, *_imp->eapi, _imp->is_installed);
+        });
 }
 
 const std::string
@@ -229,6 +287,7 @@ namespace paludis
         const std::shared_ptr<const ERepositoryID> id;
         const std::shared_ptr<const EAPIMetadataVariable> variable;
         const std::string string_value;
+        mutable MemoisedTree<FetchableURISpecTree> value;
         const MetadataKeyType type;
 
         Imp(const Environment * const e, const std::shared_ptr<const ERepositoryID> & i,
@@ -258,8 +317,10 @@ EFetchableURIKey::~EFetchableURIKey()
 const std::shared_ptr<const FetchableURISpecTree>
 EFetchableURIKey::parse_value() const
 {
-    Context context("When parsing metadata key '" + raw_name() + "' from '" + stringify(*_imp->id) + "':");
-    return parse_fetchable_uri(_imp->string_value, _imp->env, *_imp->id->eapi(), _imp->id->is_installed());
+    return _imp->value.fetch(_imp->string_value, [&] () {
+            Context context("When parsing metadata key '" + raw_name() + "' from '" + stringify(*_imp->id) + "':");
+            return parse_fetchable_uri(_imp->string_value, _imp->env, *_imp->id->eapi(), _imp->id->is_installed());
+        });
 }
 
 const std::string
@@ -331,6 +392,7 @@ namespace paludis
     {
         const Environment * const env;
         const std::string string_value;
+        mutable MemoisedTree<SimpleURISpecTree> value;
 
         const std::shared_ptr<const EAPIMetadataVariable> variable;
         const std::shared_ptr<const EAPI> eapi;
@@ -368,7 +430,9 @@ ESimpleURIKey::~ESimpleURIKey()
 const std::shared_ptr<const SimpleURISpecTree>
 ESimpleURIKey::parse_value() const
 {
-    return parse_simple_uri(_imp->string_value, _imp->env, *_imp->eapi, _imp->is_installed);
+    return _imp->value.fetch(_imp->string_value, [&] () {
+            return parse_simple_uri(_imp->string_value, _imp->env, *_imp->eapi, _imp->is_installed);
+        });
 }
 
 const std::string
@@ -406,6 +470,7 @@ namespace paludis
     {
         const Environment * const env;
         const std::string string_value;
+        mutable MemoisedTree<PlainTextSpecTree> value;
 
         const std::shared_ptr<const EAPIMetadataVariable> variable;
         const std::shared_ptr<const EAPI> eapi;
@@ -442,8 +507,10 @@ EPlainTextSpecKey::~EPlainTextSpecKey()
 const std::shared_ptr<const PlainTextSpecTree>
 EPlainTextSpecKey::parse_value() const
 {
-    Context context("When parsing metadata key '" + raw_name() + "':");
-    return parse_plain_text(_imp->string_value, _imp->env, *_imp->eapi, _imp->is_installed);
+    return _imp->value.fetch(_imp->string_value, [&] () {
+            Context context("When parsing metadata key '" + raw_name() + "':");
+            return parse_plain_text(_imp->string_value, _imp->env, *_imp->eapi, _imp->is_installed);
+        });
 }
 
 const std::string
@@ -481,6 +548,7 @@ namespace paludis
     {
         const Environment * const env;
         const std::string string_value;
+        mutable MemoisedTree<PlainTextSpecTree> value;
 
         const std::shared_ptr<const EAPIMetadataVariable> variable;
         const std::shared_ptr<const EAPI> eapi;
@@ -520,8 +588,10 @@ EMyOptionsKey::~EMyOptionsKey()
 const std::shared_ptr<const PlainTextSpecTree>
 EMyOptionsKey::parse_value() const
 {
-    Context context("When parsing metadata key '" + raw_name() + "':");
-    return parse_myoptions(_imp->string_value, _imp->env, *_imp->eapi, _imp->is_installed);
+    return _imp->value.fetch(_imp->string_value, [&] () {
+            Context context("When parsing metadata key '" + raw_name() + "':");
+            return parse_myoptions(_imp->string_value, _imp->env, *_imp->eapi, _imp->is_installed);
+        });
 }
 
 const std::string
@@ -559,6 +629,7 @@ namespace paludis
     {
         const Environment * const env;
         const std::string string_value;
+        mutable MemoisedTree<RequiredUseSpecTree> value;
 
         const std::shared_ptr<const EAPIMetadataVariable> variable;
         const std::shared_ptr<const EAPI> eapi;
@@ -599,8 +670,10 @@ ERequiredUseKey::~ERequiredUseKey()
 const std::shared_ptr<const RequiredUseSpecTree>
 ERequiredUseKey::parse_value() const
 {
-    Context context("When parsing metadata key '" + raw_name() + "':");
-    return parse_required_use(_imp->string_value, _imp->env, *_imp->eapi, _imp->is_installed);
+    return _imp->value.fetch(_imp->string_value, [&] () {
+            Context context("When parsing metadata key '" + raw_name() + "':");
+            return parse_required_use(_imp->string_value, _imp->env, *_imp->eapi, _imp->is_installed);
+        });
 }
 
 const std::string
@@ -34,6 +34,10 @@
 #include <paludis/repositories/e/extra_distribution_data.hh>
 #include <paludis/repositories/e/memoised_hashes.hh>
 #include <paludis/repositories/e/ebuild_id.hh>
+#include <paludis/repositories/e/ebuild_flat_metadata_cache.hh>
+#include <paludis/repositories/e/ebuild_binary_metadata_cache.hh>
+#include <paludis/repositories/e/metadata_validation_snapshot.hh>
+#include <paludis/repositories/e/metadata_worker_pool.hh>
 #include <paludis/repositories/e/eapi_phase.hh>
 #include <paludis/repositories/e/can_skip_phase.hh>
 #include <paludis/repositories/e/ebuild.hh>
@@ -203,6 +207,8 @@ namespace paludis
             std::mutex profile_ptr_mutex;
             std::mutex news_ptr_mutex;
             std::mutex eapi_for_file_mutex;
+            std::mutex binary_metadata_cache_mutex;
+            std::mutex metadata_validation_snapshot_mutex;
         };
 
         ERepository * const repo;
@@ -230,11 +236,19 @@ namespace paludis
 
         mutable EAPIForFileMap eapi_for_file_map;
 
+        mutable bool has_binary_metadata_cache;
+        mutable std::shared_ptr<const EbuildBinaryMetadataCache> binary_metadata_cache;
+
+        mutable bool has_metadata_validation_snapshot;
+        mutable std::shared_ptr<MetadataValidationSnapshot> metadata_validation_snapshot;
+
         Imp(ERepository * const, const ERepositoryParams &, std::shared_ptr<Mutexes> = std::make_shared<Mutexes>());
         ~Imp();
 
         void need_profiles() const;
 
+        FSPath metadata_validation_snapshot_location() const;
+
         std::shared_ptr<const MetadataValueKey<std::string> > format_key;
         std::shared_ptr<const MetadataValueKey<std::string> > layout_key;
         std::shared_ptr<const MetadataValueKey<std::string> > profile_layout_key;
@@ -289,6 +303,8 @@ namespace paludis
         sets_ptr(std::make_shared<ERepositorySets>(params.environment(), r, p)),
         layout(LayoutFactory::get_instance()->create(params.layout(), params.environment(), r, params.location(), get_master_locations(
                         params.master_repositories()))),
+        has_binary_metadata_cache(false),
+        has_metadata_validation_snapshot(false),
         format_key(std::make_shared<LiteralMetadataValueKey<std::string> >("format", "format",
                     mkt_significant, params.entry_format())),
         layout_key(std::make_shared<LiteralMetadataValueKey<std::string> >("layout", "layout",
@@ -415,6 +431,15 @@ namespace paludis
     {
     }
 
+    FSPath
+    Imp<ERepository>::metadata_validation_snapshot_location() const
+    {
+        FSPath result(params.write_cache());
+        if (params.append_repository_name_to_write_cache())
+            result /= stringify(repo->name());
+        return result / "_VALIDATED_";
+    }
+
     void
     Imp<ERepository>::need_profiles() const
     {
@@ -776,6 +801,13 @@ ERepository::sync(
     if (! ok)
         throw SyncFailedError(stringify(_imp->params.location()), sync_uri);
 
+    {
+        std::unique_lock<std::mutex> lock(_imp->mutexes->metadata_validation_snapshot_mutex);
+        MetadataValidationSnapshot::invalidate(_imp->metadata_validation_snapshot_location());
+        _imp->has_metadata_validation_snapshot = false;
+        _imp->metadata_validation_snapshot.reset();
+    }
+
     return true;
 }
 
@@ -893,10 +925,138 @@ ERepository::environment_updated_profile_variable(const std::string & var) const
     return join(values.begin(), last, " ");
 }
 
+void
+ERepository::stop_idle_workers() const
+{
+    MetadataWorkerPool::get_instance()->stop_idle_workers();
+}
+
 void
 ERepository::regenerate_cache() const
 {
     _imp->names_cache->regenerate_cache();
+
+    const bool binary(EbuildBinaryMetadataCache::is_binary_cache_location(_imp->params.cache()));
+    auto snapshot(metadata_validation_snapshot());
+    if ((! binary) && (! snapshot))
+        return;
+
+    Context context("When regenerating metadata caches for '" + stringify(name()) + "':");
+
+    std::unique_ptr<EbuildBinaryMetadataCacheWriter> writer;
+    if (binary)
+        writer.reset(new EbuildBinaryMetadataCacheWriter(_imp->params.cache()));
+
+    /* loading every ID's metadata also validates its cache entry, and
+     * records it in the snapshot */
+    auto cats(category_names({ }));
+    for (auto c(cats->begin()), c_end(cats->end()) ;
+            c != c_end ; ++c)
+    {
+        auto pkgs(package_names(*c, { }));
+        for (auto p(pkgs->begin()), p_end(pkgs->end()) ;
+                p != p_end ; ++p)
+        {
+            auto ids(package_ids(*p, { }));
+            for (auto i(ids->begin()), i_end(ids->end()) ;
+                    i != i_end ; ++i)
+            {
+                auto id(std::dynamic_pointer_cast<const EbuildID>(*i));
+                if ((! id) || (! id->eapi()->supported()))
+                    continue;
+
+                if (! writer)
+                {
+                    /* just make sure the metadata has been loaded */
+                    id->slot_key();
+                    continue;
+                }
+
+                EbuildFlatMetadataCache metadata_cache(_imp->params.environment(), nullptr, _imp->params.cache(),
+                        stringify(id->name()) + "-" + stringify(id->version()), id->fs_location_key()->parse_value(),
+                        _imp->master_mtime, _imp->eclass_mtimes, true);
+                metadata_cache.save(id, *writer);
+            }
+        }
+    }
+
+    if (writer)
+    {
+        try
+        {
+            writer->write();
+        }
+        catch (const Exception & e)
+        {
+            Log::get_instance()->message("e.cache.binary.write_failed", ll_warning, lc_context)
+                << "Cannot write to '" << _imp->params.cache() << "': '" << e.message() << "' (" << e.what() << ")";
+        }
+
+        std::unique_lock<std::mutex> lock(_imp->mutexes->binary_metadata_cache_mutex);
+        _imp->has_binary_metadata_cache = false;
+        _imp->binary_metadata_cache.reset();
+    }
+
+    if (snapshot)
+    {
+        try
+        {
+            snapshot->write();
+        }
+        catch (const Exception & e)
+        {
+            Log::get_instance()->message("e.validation_snapshot.write_failed", ll_warning, lc_context)
+                << "Cannot write metadata validation snapshot: '" << e.message() << "' (" << e.what() << ")";
+        }
+    }
+}
+
+const std::shared_ptr<const EbuildBinaryMetadataCache>
+ERepository::binary_metadata_cache() const
+{
+    std::unique_lock<std::mutex> lock(_imp->mutexes->binary_metadata_cache_mutex);
+
+    if (! _imp->has_binary_metadata_cache)
+    {
+        _imp->has_binary_metadata_cache = true;
+        if (EbuildBinaryMetadataCache::is_binary_cache_location(_imp->params.cache()))
+        {
+            auto cache(std::make_shared<EbuildBinaryMetadataCache>(_imp->params.cache()));
+            if (cache->usable())
+                _imp->binary_metadata_cache = cache;
+        }
+    }
+
+    return _imp->binary_metadata_cache;
+}
+
+const std::shared_ptr<MetadataValidationSnapshot>
+ERepository::metadata_validation_snapshot() const
+{
+    std::unique_lock<std::mutex> lock(_imp->mutexes->metadata_validation_snapshot_mutex);
+
+    if (! _imp->has_metadata_validation_snapshot)
+    {
+        _imp->has_metadata_validation_snapshot = true;
+        if (_imp->params.write_cache().basename() != "empty" && ! _imp->params.sync()->empty())
+        {
+            /* anything that isn't done by a sync has to change one of these
+             * for us to notice */
+            std::string state(stringify(_imp->master_mtime));
+            for (auto d(_imp->params.eclassdirs()->begin()), d_end(_imp->params.eclassdirs()->end()) ;
+                    d != d_end ; ++d)
+            {
+                FSStat d_stat(*d);
+                state.append(" " + stringify(*d) + ":" + (d_stat.exists() ?
+                            stringify(d_stat.mtim().seconds()) + "." + stringify(d_stat.mtim().nanoseconds()) : "none"));
+            }
+
+            _imp->metadata_validation_snapshot = std::make_shared<MetadataValidationSnapshot>(
+                    _imp->metadata_validation_snapshot_location(), state);
+        }
+    }
+
+    return _imp->metadata_validation_snapshot;
 }
 
 std::shared_ptr<const CategoryNamePartSet>
@@ -1056,13 +1216,18 @@ ERepository::make_manifest(const QualifiedPackageName & qpn)
 
             SafeIFStream file_stream(f);
 
-            MemoisedHashes * hashes = MemoisedHashes::get_instance();
+            const std::vector<std::string> algos(_imp->params.manifest_hashes()->begin(), _imp->params.manifest_hashes()->end());
+            const std::map<std::string, std::string> hexsums(MemoisedHashes::get_instance()->get_all(algos, f, file_stream, false));
 
             std::string line("DIST " + f.basename() + " " + stringify(f_stat.file_size()));
 
-            for (Set<std::string>::ConstIterator it(_imp->params.manifest_hashes()->begin()),
-                     it_end(_imp->params.manifest_hashes()->end()); it_end != it; ++it)
-                line += " " + *it + " " + hashes->get(*it, f, file_stream);
+            for (auto it(algos.begin()), it_end(algos.end()); it_end != it; ++it)
+            {
+                auto h(hexsums.find(*it));
+                if (hexsums.end() == h)
+                    throw ERepositoryConfigurationError("Manifest hash function '" + *it + "' is not supported");
+                line += " " + *it + " " + h->second;
+            }
 
             lines.push_back(std::make_pair(std::make_pair("DIST", f.basename()), line));
         }
@@ -1788,6 +1953,13 @@ ERepository::merge(const MergeParams & m)
 
     merger.merge();
 
+    {
+        std::unique_lock<std::mutex> lock(_imp->mutexes->metadata_validation_snapshot_mutex);
+        MetadataValidationSnapshot::invalidate(_imp->metadata_validation_snapshot_location());
+        _imp->has_metadata_validation_snapshot = false;
+        _imp->metadata_validation_snapshot.reset();
+    }
+
     Process compress_process(ProcessCommand({"bzip2", stringify(_imp->params.binary_distdir() / (bin_dist_base + pbin_tar_extension)) }));
     if (0 != compress_process.run().wait())
         throw ActionFailedError("Compressing tarball failed");
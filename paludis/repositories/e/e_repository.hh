@@ -41,6 +41,12 @@ namespace paludis
 {
     class ERepositoryNews;
 
+    namespace erepository
+    {
+        class EbuildBinaryMetadataCache;
+        class MetadataValidationSnapshot;
+    }
+
     /**
      * A ERepository is a Repository that handles the layout used by
      * Portage for the main Gentoo tree.
@@ -80,6 +86,8 @@ namespace paludis
 
             virtual void purge_invalid_cache() const;
 
+            virtual void stop_idle_workers() const;
+
             /* RepositoryDestinationInterface */
 
             virtual bool is_suitable_destination_for(const std::shared_ptr<const PackageID> &) const
@@ -157,6 +165,19 @@ namespace paludis
 
             void regenerate_cache() const;
 
+            /**
+             * Our binary metadata cache, or null if our cache is not a
+             * binary cache or cannot be used.
+             */
+            const std::shared_ptr<const erepository::EbuildBinaryMetadataCache> binary_metadata_cache() const;
+
+            /**
+             * Our metadata validation snapshot, or null if we do not use one.
+             * We only use a snapshot for repositories that are synced, and
+             * which have a write cache.
+             */
+            const std::shared_ptr<erepository::MetadataValidationSnapshot> metadata_validation_snapshot() const;
+
             /* Keys */
 
             virtual const std::shared_ptr<const MetadataValueKey<std::string> > format_key() const;
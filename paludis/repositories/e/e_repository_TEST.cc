@@ -419,6 +419,7 @@ TEST(ERepository, MetadataUncached)
             ASSERT_TRUE(bool(id1->build_dependencies_key()));
             id1->build_dependencies_key()->parse_value()->top()->accept(pd);
             EXPECT_EQ("foo/bar", stringify(pd));
+            EXPECT_EQ(id1->build_dependencies_key()->parse_value(), id1->build_dependencies_key()->parse_value());
             erepository::SpecTreePrettyPrinter pr(ff, { });
             ASSERT_TRUE(bool(id1->run_dependencies_key()));
             id1->run_dependencies_key()->parse_value()->top()->accept(pr);
@@ -23,6 +23,7 @@
 #include <paludis/repositories/e/eapi.hh>
 #include <paludis/repositories/e/dep_parser.hh>
 #include <paludis/repositories/e/pipe_command_handler.hh>
+#include <paludis/repositories/e/metadata_worker_pool.hh>
 
 #include <paludis/util/system.hh>
 #include <paludis/util/process.hh>
@@ -40,6 +41,7 @@
 #include <paludis/util/indirect_iterator-impl.hh>
 #include <paludis/util/set.hh>
 #include <paludis/util/env_var_names.hh>
+#include <paludis/util/make_named_values.hh>
 
 #include <paludis/about.hh>
 #include <paludis/environment.hh>
@@ -117,12 +119,24 @@ EbuildCommand::operator() ()
 {
     Context context("When running an ebuild command on '" + stringify(*params.package_id()) + "':");
 
-    Process process(ProcessCommand(getenv_with_default(env_vars::ebuild_dir, LIBEXECDIR "/paludis") + "/ebuild.bash '"
-                + ebuild_file() + "' " + commands()));
+    std::unique_ptr<Process> process(make_process());
 
+    if (do_run_command(*process))
+        return success();
+    else
+        return failure();
+}
+
+std::unique_ptr<Process>
+EbuildCommand::make_process()
+{
     if (! params.package_id()->eapi()->supported())
         throw InternalError(PALUDIS_HERE, "Tried to run EbuildCommand on an unsupported EAPI");
 
+    std::unique_ptr<Process> process_ptr(new Process(ProcessCommand(getenv_with_default(env_vars::ebuild_dir, LIBEXECDIR "/paludis")
+                    + "/ebuild.bash '" + ebuild_file() + "' " + commands())));
+    Process & process(*process_ptr);
+
     if (params.clearenv())
         process.clearenv();
 
@@ -349,10 +363,7 @@ EbuildCommand::operator() ()
             .capture_stdout(params.maybe_output_manager()->stdout_stream())
             .use_ptys();
 
-    if (do_run_command(process))
-        return success();
-    else
-        return failure();
+    return process_ptr;
 }
 
 std::string
@@ -426,6 +437,28 @@ EbuildMetadataCommand::in_metadata_generation() const
     return true;
 }
 
+namespace
+{
+    /* everything except these must match for us to reuse a metadata worker */
+    std::string metadata_worker_key(const EbuildCommandParams & params, const Map<std::string, std::string> & setenvs)
+    {
+        const EAPIEbuildEnvironmentVariables & v(*params.package_id()->eapi()->supported()->ebuild_environment_variables());
+
+        std::set<std::string> per_package_variables({ "PV", "PR", "PN", "PVR", "CATEGORY", "REPOSITORY",
+                "PALUDIS_PACKAGE_BUILDDIR", "PORTAGE_BUILDDIR", "ECLASSDIR", "ECLASSDIRS", "EXLIBSDIRS",
+                v.env_p(), v.env_pf(), v.env_filesdir(), v.env_portdir(), v.env_distdir(), v.env_jobs(),
+                params.package_id()->eapi()->supported()->ebuild_metadata_variables()->iuse_effective()->name() });
+
+        std::string result(stringify(params.sandbox()) + stringify(params.clearenv()) + stringify(params.userpriv()) + "\n");
+        for (auto m(setenvs.begin()), m_end(setenvs.end()) ;
+                m != m_end ; ++m)
+            if (per_package_variables.end() == per_package_variables.find(m->first))
+                result.append(m->first + "=" + m->second + "\n");
+
+        return result;
+    }
+}
+
 bool
 EbuildMetadataCommand::do_run_command(Process & process)
 {
@@ -437,12 +470,38 @@ EbuildMetadataCommand::do_run_command(Process & process)
         Context context("When running ebuild command to generate metadata for '" + stringify(*params.package_id()) + "':");
 
         std::stringstream prog, prog_err, metadata;
-        process
-            .capture_stdout(prog)
-            .capture_stderr(prog_err)
-            .capture_output_to_fd(metadata, -1, "PALUDIS_METADATA_FD");
+        int exit_status(-1);
 
-        int exit_status(process.run().wait());
+        /* sydbox's exec locking doesn't survive a long-lived process */
+        if ((! params.sydbox()) && getenv_with_default(env_vars::no_metadata_workers, "").empty())
+        {
+            using namespace std::placeholders;
+
+            auto setenvs(process.setenvs());
+            exit_status = MetadataWorkerPool::get_instance()->run(make_named_values<MetadataWorkerRequest>(
+                        n::captured_stderr() = &prog_err,
+                        n::captured_stdout() = &prog,
+                        n::commands() = commands(),
+                        n::ebuild_file() = ebuild_file(),
+                        n::make_process() = std::bind(&EbuildMetadataCommand::make_process, this),
+                        n::metadata() = &metadata,
+                        n::pipe_command_handler() = std::bind(&pipe_command_handler,
+                            params.environment(), params.package_id(), params.permitted_directories(), params.parts(),
+                            params.volatile_files(), in_metadata_generation(), _1, params.maybe_output_manager()),
+                        n::setenvs() = setenvs,
+                        n::worker_key() = metadata_worker_key(params, *setenvs)
+                        ));
+        }
+
+        if (-1 == exit_status)
+        {
+            process
+                .capture_stdout(prog)
+                .capture_stderr(prog_err)
+                .capture_output_to_fd(metadata, -1, "PALUDIS_METADATA_FD");
+
+            exit_status = process.run().wait();
+        }
 
         KeyValueConfigFile f(metadata, { kvcfo_disallow_continuations, kvcfo_disallow_comments , kvcfo_disallow_space_around_equals,
                 kvcfo_disallow_unquoted_values, kvcfo_disallow_source , kvcfo_disallow_variables, kvcfo_preserve_whitespace },
@@ -418,6 +418,12 @@ namespace paludis
                  */
                 virtual bool in_metadata_generation() const;
 
+                /**
+                 * Create, but do not run, a process for our command, with its
+                 * environment and options set up.
+                 */
+                std::unique_ptr<Process> make_process();
+
             public:
                 /**
                  * Destructor.
@@ -114,7 +114,8 @@ EBUILD_MODULES_DIRS="${EBUILD_MODULES_DIRS} ${EBUILD_MODULES_DIR}"
 export PALUDIS_EBUILD_MODULES_DIR="${EBUILD_MODULES_DIR}"
 
 export EBUILD_KILL_PID=$$
-declare -r EBUILD_KILL_PID
+# metadata workers set this separately for each request
+[[ -n "${PALUDIS_EBUILD_SERVE_METADATA}" ]] || declare -r EBUILD_KILL_PID
 
 ebuild_load_module()
 {
@@ -688,5 +689,44 @@ ebuild_main()
     fi
 }
 
-ebuild_main "$@"
+ebuild_serve_metadata()
+{
+    local paludis_worker_dir paludis_request paludis_status
+
+    paludis_worker_dir=$(mktemp -d "${PALUDIS_TMPDIR%/}/metadata-worker-XXXXXX" ) \
+        || die "Couldn't create a directory for the metadata worker"
+
+    while true ; do
+        paludis_request=$(paludis_pipe_command METADATA_WORKER_NEXT "${paludis_worker_dir}" )
+        [[ -z "${paludis_request}" ]] && break
+
+        (
+            exec >"${paludis_worker_dir}"/stdout 2>"${paludis_worker_dir}"/stderr
+            exec {PALUDIS_METADATA_FD}>"${paludis_worker_dir}"/metadata
+            export PALUDIS_METADATA_FD
+
+            eval "${paludis_request}"
+            unset -v paludis_request
+
+            export EBUILD_KILL_PID=${BASHPID}
+            declare -r EBUILD_KILL_PID
+            trap 'echo "die trap: exiting with error." 1>&2 ; exit 250' SIGUSR1
+
+            ebuild_cleanup_slashes ROOT
+            ebuild_main "${paludis_request_ebuild}" ${paludis_request_commands}
+        )
+        paludis_status=${?}
+
+        paludis_pipe_command METADATA_WORKER_DONE "${paludis_status}" >/dev/null
+    done
+
+    rm -f "${paludis_worker_dir}"/{stdout,stderr,metadata}
+    rmdir "${paludis_worker_dir}"
+}
+
+if [[ -n "${PALUDIS_EBUILD_SERVE_METADATA}" ]] ; then
+    ebuild_serve_metadata
+else
+    ebuild_main "$@"
+fi
 
@@ -0,0 +1,301 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/repositories/e/ebuild_binary_metadata_cache.hh>
+#include <paludis/repositories/e/mapped_index_file.hh>
+
+#include <paludis/util/pimp-impl.hh>
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/log.hh>
+#include <paludis/util/exception.hh>
+#include <paludis/util/stringify.hh>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using namespace paludis;
+using namespace paludis::erepository;
+
+/*
+ * File layout, all integers in native byte order and all offsets from the
+ * start of the file:
+ *
+ *     Header
+ *     Entry[header.entry_count], sorted by name
+ *     Pair[header.pair_count]
+ *     string data, with each distinct string stored once
+ */
+
+namespace
+{
+    const char magic[8] = { 'P', 'A', 'L', 'B', 'M', 'C', '0', '1' };
+
+    struct Header
+    {
+        MappedIndexFileHeader prefix;
+        uint32_t entry_count;
+        uint32_t pair_count;
+        uint32_t reserved;
+    };
+
+    struct Entry
+    {
+        uint32_t name_offset, name_length;
+        uint32_t first_pair, pair_count;
+    };
+
+    struct Pair
+    {
+        uint32_t key_offset, key_length;
+        uint32_t value_offset, value_length;
+    };
+}
+
+namespace paludis
+{
+    template <>
+    struct Imp<EbuildBinaryMetadataCache>
+    {
+        const FSPath location;
+        const MappedIndexFile file;
+
+        const char * data;
+        std::size_t size;
+
+        const Header * header;
+        const Entry * entries;
+        const Pair * pairs;
+
+        Imp(const FSPath & l) :
+            location(l),
+            file(l, magic, sizeof(Header), "binary metadata cache"),
+            data(file.data()),
+            size(file.size()),
+            header(nullptr),
+            entries(nullptr),
+            pairs(nullptr)
+        {
+        }
+
+        bool in_bounds(uint32_t offset, uint32_t length) const
+        {
+            return offset <= size && length <= size - offset;
+        }
+
+        std::string string_at(uint32_t offset, uint32_t length) const
+        {
+            return std::string(data + offset, length);
+        }
+    };
+
+    template <>
+    struct Imp<EbuildBinaryMetadataCacheWriter>
+    {
+        const FSPath location;
+
+        std::map<std::string, std::vector<std::pair<std::string, std::string> > > entries;
+
+        Imp(const FSPath & l) :
+            location(l)
+        {
+        }
+    };
+}
+
+EbuildBinaryMetadataCache::EbuildBinaryMetadataCache(const FSPath & l) :
+    _imp(l)
+{
+    Context context("When opening binary metadata cache '" + stringify(l) + "':");
+
+    if (! _imp->data)
+        return;
+
+    const Header * header(reinterpret_cast<const Header *>(_imp->data));
+    if (! _imp->file.check_size(sizeof(Header) + uint64_t(header->entry_count) * sizeof(Entry) +
+                uint64_t(header->pair_count) * sizeof(Pair)))
+        return;
+
+    _imp->header = header;
+    _imp->entries = reinterpret_cast<const Entry *>(_imp->data + sizeof(Header));
+    _imp->pairs = reinterpret_cast<const Pair *>(_imp->data + sizeof(Header) + header->entry_count * sizeof(Entry));
+}
+
+EbuildBinaryMetadataCache::~EbuildBinaryMetadataCache()
+{
+}
+
+bool
+EbuildBinaryMetadataCache::is_binary_cache_location(const FSPath & f)
+{
+    const std::string suffix(".bincache"), basename(f.basename());
+    return basename.length() > suffix.length() &&
+        0 == basename.compare(basename.length() - suffix.length(), suffix.length(), suffix);
+}
+
+bool
+EbuildBinaryMetadataCache::usable() const
+{
+    return bool(_imp->header);
+}
+
+bool
+EbuildBinaryMetadataCache::find(const std::string & entry_name, std::map<std::string, std::string> & keys) const
+{
+    if (! _imp->header)
+        return false;
+
+    const Entry * const entries_end(_imp->entries + _imp->header->entry_count);
+    const Entry * entry(std::lower_bound(_imp->entries, entries_end, entry_name,
+                [&] (const Entry & e, const std::string & n) -> bool {
+                    if (! _imp->in_bounds(e.name_offset, e.name_length))
+                        return false;
+                    int c(std::memcmp(_imp->data + e.name_offset, n.data(), std::min<std::size_t>(e.name_length, n.length())));
+                    return c < 0 || (0 == c && e.name_length < n.length());
+                }));
+
+    if (entries_end == entry || entry->name_length != entry_name.length() ||
+            (! _imp->in_bounds(entry->name_offset, entry->name_length)) ||
+            0 != std::memcmp(_imp->data + entry->name_offset, entry_name.data(), entry_name.length()))
+        return false;
+
+    if (entry->first_pair > _imp->header->pair_count || entry->pair_count > _imp->header->pair_count - entry->first_pair)
+    {
+        Log::get_instance()->message("e.cache.binary.corrupt", ll_warning, lc_context)
+            << "Entry '" << entry_name << "' in binary metadata cache '" << _imp->location << "' is corrupt";
+        return false;
+    }
+
+    for (const Pair * p(_imp->pairs + entry->first_pair), * p_end(p + entry->pair_count) ;
+            p != p_end ; ++p)
+    {
+        if ((! _imp->in_bounds(p->key_offset, p->key_length)) || (! _imp->in_bounds(p->value_offset, p->value_length)))
+        {
+            Log::get_instance()->message("e.cache.binary.corrupt", ll_warning, lc_context)
+                << "Entry '" << entry_name << "' in binary metadata cache '" << _imp->location << "' is corrupt";
+            return false;
+        }
+
+        keys.insert(std::make_pair(_imp->string_at(p->key_offset, p->key_length), _imp->string_at(p->value_offset, p->value_length)));
+    }
+
+    return true;
+}
+
+EbuildBinaryMetadataCacheWriter::EbuildBinaryMetadataCacheWriter(const FSPath & l) :
+    _imp(l)
+{
+}
+
+EbuildBinaryMetadataCacheWriter::~EbuildBinaryMetadataCacheWriter()
+{
+}
+
+void
+EbuildBinaryMetadataCacheWriter::add(const std::string & entry_name, const std::string & flat_hash)
+{
+    std::vector<std::pair<std::string, std::string> > & pairs(_imp->entries[entry_name]);
+    pairs.clear();
+
+    std::string::size_type pos(0);
+    while (pos < flat_hash.length())
+    {
+        std::string::size_type eol(flat_hash.find('\n', pos));
+        if (std::string::npos == eol)
+            eol = flat_hash.length();
+
+        std::string::size_type equals(flat_hash.find('=', pos));
+        if (std::string::npos != equals && equals < eol)
+            pairs.push_back(std::make_pair(flat_hash.substr(pos, equals - pos), flat_hash.substr(equals + 1, eol - equals - 1)));
+
+        pos = eol + 1;
+    }
+}
+
+void
+EbuildBinaryMetadataCacheWriter::add(const std::string & entry_name, const std::map<std::string, std::string> & keys)
+{
+    std::vector<std::pair<std::string, std::string> > & pairs(_imp->entries[entry_name]);
+    pairs.assign(keys.begin(), keys.end());
+}
+
+void
+EbuildBinaryMetadataCacheWriter::write()
+{
+    Context context("When writing binary metadata cache '" + stringify(_imp->location) + "':");
+
+    std::size_t pair_count(0);
+    for (auto e(_imp->entries.begin()), e_end(_imp->entries.end()) ;
+            e != e_end ; ++e)
+        pair_count += e->second.size();
+
+    std::string strings;
+    std::map<std::string, uint32_t> string_offsets;
+    const std::size_t strings_start(sizeof(Header) + _imp->entries.size() * sizeof(Entry) + pair_count * sizeof(Pair));
+
+    auto intern([&] (const std::string & s) -> uint32_t {
+            auto i(string_offsets.find(s));
+            if (string_offsets.end() == i)
+            {
+                i = string_offsets.insert(std::make_pair(s, uint32_t(strings_start + strings.length()))).first;
+                strings.append(s);
+            }
+            return i->second;
+        });
+
+    std::vector<Entry> entries;
+    std::vector<Pair> pairs;
+    entries.reserve(_imp->entries.size());
+    pairs.reserve(pair_count);
+
+    /* std::map keeps entries sorted, which is what lookups need */
+    for (auto e(_imp->entries.begin()), e_end(_imp->entries.end()) ;
+            e != e_end ; ++e)
+    {
+        entries.push_back(Entry{ intern(e->first), uint32_t(e->first.length()), uint32_t(pairs.size()), uint32_t(e->second.size()) });
+        for (auto p(e->second.begin()), p_end(e->second.end()) ;
+                p != p_end ; ++p)
+            pairs.push_back(Pair{ intern(p->first), uint32_t(p->first.length()), intern(p->second), uint32_t(p->second.length()) });
+    }
+
+    if (strings_start + strings.length() > UINT32_MAX)
+        throw InternalError(PALUDIS_HERE, "binary metadata cache would be too large");
+
+    Header header;
+    MappedIndexFile::fill_header(header.prefix, magic);
+    header.entry_count = entries.size();
+    header.pair_count = pairs.size();
+    header.reserved = 0;
+
+    std::string data;
+    data.reserve(strings_start + strings.length());
+    data.append(reinterpret_cast<const char *>(&header), sizeof(Header));
+    data.append(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(Entry));
+    data.append(reinterpret_cast<const char *>(pairs.data()), pairs.size() * sizeof(Pair));
+    data.append(strings);
+
+    MappedIndexFile::write(_imp->location, data);
+}
+
+namespace paludis
+{
+    template class Pimp<EbuildBinaryMetadataCache>;
+    template class Pimp<EbuildBinaryMetadataCacheWriter>;
+}
@@ -0,0 +1,129 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_REPOSITORIES_E_EBUILD_BINARY_METADATA_CACHE_HH
+#define PALUDIS_GUARD_PALUDIS_REPOSITORIES_E_EBUILD_BINARY_METADATA_CACHE_HH 1
+
+#include <paludis/util/pimp.hh>
+#include <paludis/util/fs_path-fwd.hh>
+#include <paludis/util/attributes.hh>
+#include <map>
+#include <string>
+
+namespace paludis
+{
+    namespace erepository
+    {
+        /**
+         * A read-only, memory mapped metadata cache holding every entry for
+         * a repository in a single file.
+         *
+         * Entries hold the same keys as a flat_hash cache file, already split
+         * into key / value pairs, and are looked up by 'cat/pkg-ver'. Validity
+         * checking is left to EbuildFlatMetadataCache.
+         *
+         * \see EbuildBinaryMetadataCacheWriter
+         * \ingroup grperepository
+         * \nosubgrouping
+         */
+        class PALUDIS_VISIBLE EbuildBinaryMetadataCache
+        {
+            private:
+                Pimp<EbuildBinaryMetadataCache> _imp;
+
+            public:
+                ///\name Basic operations
+                ///\{
+
+                explicit EbuildBinaryMetadataCache(const FSPath &);
+                ~EbuildBinaryMetadataCache();
+
+                EbuildBinaryMetadataCache(const EbuildBinaryMetadataCache &) = delete;
+                EbuildBinaryMetadataCache & operator= (const EbuildBinaryMetadataCache &) = delete;
+
+                ///\}
+
+                /**
+                 * Should a cache location be treated as a binary cache file,
+                 * rather than as a flat cache directory?
+                 */
+                static bool is_binary_cache_location(const FSPath &) PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * False if the file does not exist or is not a cache file we
+                 * understand.
+                 */
+                bool usable() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Fill in keys for the named entry, returning false if there
+                 * is no such entry.
+                 */
+                bool find(const std::string & entry_name, std::map<std::string, std::string> & keys) const
+                    PALUDIS_ATTRIBUTE((warn_unused_result));
+        };
+
+        /**
+         * Builds an EbuildBinaryMetadataCache file.
+         *
+         * \see EbuildBinaryMetadataCache
+         * \ingroup grperepository
+         * \nosubgrouping
+         */
+        class PALUDIS_VISIBLE EbuildBinaryMetadataCacheWriter
+        {
+            private:
+                Pimp<EbuildBinaryMetadataCacheWriter> _imp;
+
+            public:
+                ///\name Basic operations
+                ///\{
+
+                explicit EbuildBinaryMetadataCacheWriter(const FSPath &);
+                ~EbuildBinaryMetadataCacheWriter();
+
+                EbuildBinaryMetadataCacheWriter(const EbuildBinaryMetadataCacheWriter &) = delete;
+                EbuildBinaryMetadataCacheWriter & operator= (const EbuildBinaryMetadataCacheWriter &) = delete;
+
+                ///\}
+
+                /**
+                 * Add an entry, given as the contents of a flat_hash cache
+                 * file.
+                 */
+                void add(const std::string & entry_name, const std::string & flat_hash);
+
+                /**
+                 * Add an entry, given as key / value pairs.
+                 */
+                void add(const std::string & entry_name, const std::map<std::string, std::string> & keys);
+
+                /**
+                 * Write out the cache. The file is replaced atomically, so
+                 * anyone still using an older version is not affected.
+                 */
+                void write();
+        };
+    }
+
+    extern template class Pimp<erepository::EbuildBinaryMetadataCache>;
+    extern template class Pimp<erepository::EbuildBinaryMetadataCacheWriter>;
+}
+
+#endif
@@ -45,6 +45,7 @@
 #include <set>
 #include <map>
 #include <list>
+#include <memory>
 #include <vector>
 #include <functional>
 #include <algorithm>
@@ -65,22 +66,36 @@ namespace paludis
         const FSPath filename;
         const FSStat filename_stat;
         const FSPath ebuild;
-        const FSStat ebuild_stat;
+        std::unique_ptr<const FSStat> ebuild_stat_ptr;
         std::time_t master_mtime;
         std::shared_ptr<const EclassMtimes> eclass_mtimes;
         bool silent;
 
+        const std::shared_ptr<const EbuildBinaryMetadataCache> binary_cache;
+        const std::string binary_entry_name;
+
         Imp(const Environment * const e, const FSPath & f, const FSPath & eb,
-                std::time_t m, const std::shared_ptr<const EclassMtimes> em, bool s) :
+                std::time_t m, const std::shared_ptr<const EclassMtimes> em, bool s,
+                const std::shared_ptr<const EbuildBinaryMetadataCache> & b = nullptr, const std::string & n = "") :
             env(e),
             filename(f),
             filename_stat(filename.stat()),
             ebuild(eb),
-            ebuild_stat(ebuild.stat()),
             master_mtime(m),
             eclass_mtimes(em),
-            silent(s)
+            silent(s),
+            binary_cache(b),
+            binary_entry_name(n)
+        {
+        }
+
+        /* only stat the ebuild if we have to, since we usually don't need
+         * to when the cache is known to be valid */
+        const FSStat & ebuild_stat()
         {
+            if (! ebuild_stat_ptr)
+                ebuild_stat_ptr.reset(new FSStat(ebuild));
+            return *ebuild_stat_ptr;
         }
     };
 }
@@ -88,7 +103,8 @@ namespace paludis
 namespace
 {
     bool load_flat_list(
-        const std::shared_ptr<const EbuildID> & id, const std::vector<std::string> & lines, Imp<EbuildFlatMetadataCache> * _imp)
+        const std::shared_ptr<const EbuildID> & id, const std::vector<std::string> & lines, Imp<EbuildFlatMetadataCache> * _imp,
+        const bool known_valid)
     {
         Context ctx("When loading flat_list format cache file:");
 
@@ -118,12 +134,13 @@ namespace
                 return false;
             }
 
+            if (! known_valid)
             {
                 std::time_t cache_time(std::max(_imp->master_mtime, _imp->filename.stat().mtim().seconds()));
-                bool ok(_imp->ebuild_stat.mtim().seconds() <= cache_time);
+                bool ok(_imp->ebuild_stat().mtim().seconds() <= cache_time);
                 if (! ok)
                     Log::get_instance()->message("e.cache.flat_list.mtime", ll_debug, lc_context)
-                        << "ebuild has mtime " << _imp->ebuild_stat.mtim().seconds() << ", but expected at most " << cache_time;
+                        << "ebuild has mtime " << _imp->ebuild_stat().mtim().seconds() << ", but expected at most " << cache_time;
 
                 if (ok && "0" != id->guessed_eapi_name())
                 {
@@ -310,35 +327,58 @@ EbuildFlatMetadataCache::EbuildFlatMetadataCache(const Environment * const v, co
 {
 }
 
+EbuildFlatMetadataCache::EbuildFlatMetadataCache(const Environment * const v, const std::shared_ptr<const EbuildBinaryMetadataCache> & b,
+        const FSPath & f, const std::string & n, const FSPath & e, std::time_t t, const std::shared_ptr<const EclassMtimes> & m, bool s) :
+    _imp(v, f, e, t, m, s, b, n)
+{
+}
+
 EbuildFlatMetadataCache::~EbuildFlatMetadataCache()
 {
 }
 
 bool
-EbuildFlatMetadataCache::load(const std::shared_ptr<const EbuildID> & id, const bool silent_on_stale)
+EbuildFlatMetadataCache::load(const std::shared_ptr<const EbuildID> & id, const bool silent_on_stale, const bool known_valid)
 {
     using namespace std::placeholders;
 
-    Context context("When loading version metadata from '" + stringify(_imp->filename) + "':");
+    Context context("When loading version metadata from '" + stringify(_imp->filename) + "'" +
+            (_imp->binary_cache ? " entry '" + _imp->binary_entry_name + "'" : "") + ":");
 
-    if (! _imp->filename_stat.exists())
+    std::vector<std::string> lines;
+    if (! _imp->binary_cache)
     {
-        Log::get_instance()->message("e.cache.failure", _imp->silent ? ll_debug : ll_warning, lc_no_context)
-                << "Couldn't use the cache file at '" << _imp->filename << "': " << std::strerror(errno);
-        return false;
-    }
+        if (! _imp->filename_stat.exists())
+        {
+            Log::get_instance()->message("e.cache.failure", _imp->silent ? ll_debug : ll_warning, lc_no_context)
+                    << "Couldn't use the cache file at '" << _imp->filename << "': " << std::strerror(errno);
+            return false;
+        }
 
-    SafeIFStream cache(_imp->filename);
+        SafeIFStream cache(_imp->filename);
 
-    std::vector<std::string> lines;
-    std::string line;
-    while (std::getline(cache, line))
-        lines.push_back(line);
+        std::string line;
+        while (std::getline(cache, line))
+            lines.push_back(line);
+    }
 
     try
     {
         std::map<std::string, std::string> keys;
         std::string duplicate;
+
+        /* binary cache entries are already split up, and can't contain
+         * duplicates */
+        if (_imp->binary_cache)
+        {
+            if (! _imp->binary_cache->find(_imp->binary_entry_name, keys))
+            {
+                Log::get_instance()->message("e.cache.failure", _imp->silent ? ll_debug : ll_warning, lc_no_context)
+                        << "No entry for '" << _imp->binary_entry_name << "' in the cache file at '" << _imp->filename << "'";
+                return false;
+            }
+        }
+
         for (std::vector<std::string>::const_iterator it(lines.begin()),
                  it_end(lines.end()); it_end != it; ++it)
         {
@@ -347,7 +387,7 @@ EbuildFlatMetadataCache::load(const std::shared_ptr<const EbuildID> & id, const
             {
                 Log::get_instance()->message("e.cache.flat_hash.not", ll_debug, lc_context)
                     << "cache file lacks = on line " << ((it - lines.begin()) + 1) << ", assuming flat_list";
-                return load_flat_list(id, lines, _imp.get());
+                return load_flat_list(id, lines, _imp.get(), known_valid);
             }
 
             if (! keys.insert(std::make_pair(it->substr(0, equals), it->substr(equals + 1))).second)
@@ -379,8 +419,10 @@ EbuildFlatMetadataCache::load(const std::shared_ptr<const EbuildID> & id, const
 
                 std::map<std::string, std::string>::const_iterator md5_it(keys.find("_md5_"));
                 if (keys.end() != md5_it)
-                {
                     is_md5 = true;
+
+                if (is_md5 && ! known_valid)
+                {
                     SafeIFStream s(_imp->ebuild);
                     MD5 md5(s);
                     if (md5.hexsum() != md5_it->second)
@@ -391,14 +433,14 @@ EbuildFlatMetadataCache::load(const std::shared_ptr<const EbuildID> & id, const
                     }
                 }
 
-                else
+                else if (! known_valid)
                 {
                     std::map<std::string, std::string>::const_iterator mtime_it(keys.find("_mtime_"));
                     std::time_t cache_time(keys.end() == mtime_it ? _imp->filename_stat.mtim().seconds() : destringify<std::time_t>(mtime_it->second));
-                    if (_imp->ebuild_stat.mtim().seconds() != cache_time)
+                    if (_imp->ebuild_stat().mtim().seconds() != cache_time)
                     {
                         Log::get_instance()->message("e.cache.flat_hash.mtime", ll_debug, lc_context)
-                            << "ebuild has mtime " << _imp->ebuild_stat.mtim().seconds() << ", but expected " << cache_time;
+                            << "ebuild has mtime " << _imp->ebuild_stat().mtim().seconds() << ", but expected " << cache_time;
                         ok = false;
                     }
                 }
@@ -421,7 +463,7 @@ EbuildFlatMetadataCache::load(const std::shared_ptr<const EbuildID> & id, const
                     std::vector<std::string> eclasses;
                     tokenise<delim_kind::AnyOfTag, delim_mode::DelimiterTag>(keys["_eclasses_"], "\t", "", std::back_inserter(eclasses));
                     auto repo(_imp->env->fetch_repository(id->repository_name()));
-                    FSPath eclassdir((repo->location_key()->parse_value() / "eclass").realpath_if_exists());
+                    FSPath eclassdir(known_valid ? FSPath("/") : (repo->location_key()->parse_value() / "eclass").realpath_if_exists());
                     for (std::vector<std::string>::const_iterator it(eclasses.begin()),
                              it_end(eclasses.end()); it_end != it; ++it)
                     {
@@ -434,6 +476,19 @@ EbuildFlatMetadataCache::load(const std::shared_ptr<const EbuildID> & id, const
                             return false;
                         }
 
+                        /* we only need the names, but we still have to skip
+                         * over the optional directory */
+                        if (known_valid)
+                        {
+                            if ((! is_md5) && std::string::npos != it->find('/') && eclasses.end() == ++it)
+                            {
+                                Log::get_instance()->message("e.cache.flat_hash.eclass.truncated", ll_warning, lc_context)
+                                    << "_eclasses_ entry is incomplete";
+                                return false;
+                            }
+                            continue;
+                        }
+
                         auto eclass(_imp->eclass_mtimes->eclass(eclass_name));
                         if (eclass)
                             Log::get_instance()->message("e.cache.flat_hash.eclass.path", ll_debug, lc_context)
@@ -522,6 +577,8 @@ EbuildFlatMetadataCache::load(const std::shared_ptr<const EbuildID> & id, const
                             return false;
                         }
                         std::time_t exlib_mtime(destringify<std::time_t>(*it));
+                        if (known_valid)
+                            continue;
 
                         auto exlib(_imp->eclass_mtimes->exlib(exlib_name, id->name()));
                         if (exlib)
@@ -735,47 +792,17 @@ namespace
     }
 }
 
-void
-EbuildFlatMetadataCache::save(const std::shared_ptr<const EbuildID> & id)
+bool
+EbuildFlatMetadataCache::write_flat_hash(const std::shared_ptr<const EbuildID> & id, std::ostream & cache)
 {
-    Context context("When saving version metadata to '" + stringify(_imp->filename) + "':");
-
-    try
-    {
-        FSPath cat_dir(_imp->filename.dirname());
-        FSPath repo_dir(cat_dir.dirname());
-        FSPath main_dir(repo_dir.dirname());
-        FSStat main_dir_stat(main_dir);
-
-        if (! main_dir_stat.exists())
-        {
-            Log::get_instance()->message("e.cache.save.no_dir", ll_warning, lc_no_context) << "Directory '"
-                << main_dir << "' does not exist, so cannot save cache file '" << _imp->filename << "' "
-                << "(see the faq for why this directory will not be created automatically)";
-            return;
-        }
-
-        if (repo_dir.mkdir(main_dir_stat.permissions(), { fspmkdo_ok_if_exists }))
-            repo_dir.chmod(main_dir_stat.permissions());
-
-        if (cat_dir.mkdir(main_dir_stat.permissions(), { fspmkdo_ok_if_exists }))
-            cat_dir.chmod(main_dir_stat.permissions());
-    }
-    catch (const FSError & e)
-    {
-        Log::get_instance()->message("e.cache.save.failure", ll_warning, lc_no_context) << "Couldn't create cache directory: " << e.message();
-        return;
-    }
-
     if (! id->eapi()->supported())
     {
         Log::get_instance()->message("e.cache.save.eapi_unsupoprted", ll_warning, lc_no_context) << "Not writing cache file to '"
             << _imp->filename << "' because EAPI '" << id->eapi()->name() << "' is not supported";
-        return;
+        return false;
     }
 
-    std::ostringstream cache;
-    write_kv(cache, "_mtime_", _imp->ebuild_stat.mtim().seconds());
+    write_kv(cache, "_mtime_", _imp->ebuild_stat().mtim().seconds());
     write_kv(cache, "_guessed_eapi_", id->guessed_eapi_name());
 
     if (id->eapi()->supported()->ebuild_options()->support_eclasses() && id->inherited_key())
@@ -939,16 +966,55 @@ EbuildFlatMetadataCache::save(const std::shared_ptr<const EbuildID> & id)
     {
         Log::get_instance()->message("e.cache.save.failure", ll_warning, lc_no_context) << "Not writing cache file to '"
             << _imp->filename << "' due to exception '" << e.message() << "' (" << e.what() << ")";
+        return false;
+    }
+
+    return true;
+}
+
+void
+EbuildFlatMetadataCache::save(const std::shared_ptr<const EbuildID> & id)
+{
+    Context context("When saving version metadata to '" + stringify(_imp->filename) + "':");
+
+    try
+    {
+        FSPath cat_dir(_imp->filename.dirname());
+        FSPath repo_dir(cat_dir.dirname());
+        FSPath main_dir(repo_dir.dirname());
+        FSStat main_dir_stat(main_dir);
+
+        if (! main_dir_stat.exists())
+        {
+            Log::get_instance()->message("e.cache.save.no_dir", ll_warning, lc_no_context) << "Directory '"
+                << main_dir << "' does not exist, so cannot save cache file '" << _imp->filename << "' "
+                << "(see the faq for why this directory will not be created automatically)";
+            return;
+        }
+
+        if (repo_dir.mkdir(main_dir_stat.permissions(), { fspmkdo_ok_if_exists }))
+            repo_dir.chmod(main_dir_stat.permissions());
+
+        if (cat_dir.mkdir(main_dir_stat.permissions(), { fspmkdo_ok_if_exists }))
+            cat_dir.chmod(main_dir_stat.permissions());
+    }
+    catch (const FSError & e)
+    {
+        Log::get_instance()->message("e.cache.save.failure", ll_warning, lc_no_context) << "Couldn't create cache directory: " << e.message();
         return;
     }
 
+    std::ostringstream cache;
+    if (! write_flat_hash(id, cache))
+        return;
+
     try
     {
         {
             SafeOFStream cache_file(_imp->filename, -1, true);
             cache_file << cache.str();
         }
-        _imp->filename.utime(Timestamp(_imp->ebuild_stat.mtim().seconds(), 0));
+        _imp->filename.utime(Timestamp(_imp->ebuild_stat().mtim().seconds(), 0));
     }
     catch (const SafeOFStreamError & e)
     {
@@ -957,6 +1023,16 @@ EbuildFlatMetadataCache::save(const std::shared_ptr<const EbuildID> & id)
     }
 }
 
+void
+EbuildFlatMetadataCache::save(const std::shared_ptr<const EbuildID> & id, EbuildBinaryMetadataCacheWriter & writer)
+{
+    Context context("When saving version metadata for '" + _imp->binary_entry_name + "' to '" + stringify(_imp->filename) + "':");
+
+    std::ostringstream cache;
+    if (write_flat_hash(id, cache))
+        writer.add(_imp->binary_entry_name, cache.str());
+}
+
 namespace paludis
 {
     template class Pimp<EbuildFlatMetadataCache>;
@@ -23,6 +23,7 @@
 #include <paludis/repositories/e/ebuild.hh>
 #include <paludis/repositories/e/ebuild_id.hh>
 #include <paludis/repositories/e/eclass_mtimes.hh>
+#include <paludis/repositories/e/ebuild_binary_metadata_cache.hh>
 #include <paludis/util/pimp.hh>
 
 namespace paludis
@@ -43,12 +44,23 @@ namespace paludis
             private:
                 Pimp<EbuildFlatMetadataCache> _imp;
 
+                bool write_flat_hash(const std::shared_ptr<const EbuildID> &, std::ostream &) PALUDIS_ATTRIBUTE((warn_unused_result));
+
             public:
                 ///\name Basic operations
                 ///\{
 
                 EbuildFlatMetadataCache(const Environment * const, const FSPath & filename, const FSPath & ebuild,
                         time_t master_mtime, const std::shared_ptr<const EclassMtimes> & eclass_mtimes, bool silent);
+
+                /**
+                 * Use an entry in a binary cache, rather than a file. The
+                 * binary cache may be null if we are only going to save.
+                 */
+                EbuildFlatMetadataCache(const Environment * const, const std::shared_ptr<const EbuildBinaryMetadataCache> &,
+                        const FSPath & binary_filename, const std::string & entry_name, const FSPath & ebuild,
+                        time_t master_mtime, const std::shared_ptr<const EclassMtimes> & eclass_mtimes, bool silent);
+
                 ~EbuildFlatMetadataCache();
 
                 ///\}
@@ -56,8 +68,14 @@ namespace paludis
                 ///\name Cache operations
                 ///\{
 
-                bool load(const std::shared_ptr<const EbuildID> &, const bool silent_on_stale);
+                /**
+                 * Load from the cache. If known_valid, the cache entry is
+                 * assumed to be up to date, and we don't check the ebuild or
+                 * any eclasses.
+                 */
+                bool load(const std::shared_ptr<const EbuildID> &, const bool silent_on_stale, const bool known_valid);
                 void save(const std::shared_ptr<const EbuildID> &);
+                void save(const std::shared_ptr<const EbuildID> &, EbuildBinaryMetadataCacheWriter &);
 
                 ///\}
         };
@@ -36,6 +36,7 @@
 #include <paludis/util/visitor_cast.hh>
 #include <paludis/util/wrapped_forward_iterator.hh>
 #include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/safe_ofstream.hh>
 #include <paludis/util/timestamp.hh>
 #include <paludis/util/fs_stat.hh>
 #include <paludis/util/join.hh>
@@ -1192,3 +1193,96 @@ TEST(EbuildFlatMetadataCache, WriteExlibs)
     EXPECT_EQ(60, FSPath("ebuild_flat_metadata_cache_TEST_dir/cache/test-repo/cat/write-exlibs-1").stat().mtim().seconds());
 }
 
+
+TEST(EbuildFlatMetadataCache, Binary)
+{
+    std::shared_ptr<Map<std::string, std::string> > keys(std::make_shared<Map<std::string, std::string>>());
+    keys->insert("format", "e");
+    keys->insert("names_cache", "/var/empty");
+    keys->insert("location", stringify(FSPath::cwd() / "ebuild_flat_metadata_cache_TEST_dir/binary_repo"));
+    keys->insert("profiles", stringify(FSPath::cwd() / "ebuild_flat_metadata_cache_TEST_dir/binary_repo/profiles/profile"));
+    keys->insert("cache", stringify(FSPath::cwd() / "ebuild_flat_metadata_cache_TEST_dir/binary_repo.bincache"));
+    keys->insert("builddir", stringify(FSPath::cwd() / "ebuild_flat_metadata_cache_TEST_dir" / "build"));
+
+    {
+        TestEnvironment env;
+        std::shared_ptr<Repository> repo(ERepository::repository_factory_create(&env,
+                    std::bind(from_keys, keys, std::placeholders::_1)));
+        env.add_repository(1, repo);
+        repo->regenerate_cache();
+    }
+
+    ASSERT_TRUE(FSPath("ebuild_flat_metadata_cache_TEST_dir/binary_repo.bincache").stat().is_regular_file());
+
+    /* same mtime, so if we see the old description, it came from the cache */
+    FSPath ebuild("ebuild_flat_metadata_cache_TEST_dir/binary_repo/cat/binary/binary-1.ebuild");
+    {
+        SafeOFStream f(ebuild, -1, true);
+        f << "inherit foo" << std::endl << "DESCRIPTION=\"Changed\"" << std::endl << "SLOT=\"0\"" << std::endl;
+    }
+    ebuild.utime(Timestamp(60, 0));
+
+    TestEnvironment env;
+    std::shared_ptr<Repository> repo(ERepository::repository_factory_create(&env,
+                std::bind(from_keys, keys, std::placeholders::_1)));
+    env.add_repository(1, repo);
+
+    std::shared_ptr<const PackageID> id(*env[selection::RequireExactlyOne(generator::Matches(
+                    PackageDepSpec(parse_user_package_dep_spec("=cat/binary-1",
+                            &env, { })), nullptr, { }))]->begin());
+
+    ASSERT_TRUE(bool(id->short_description_key()));
+    EXPECT_EQ("The Generated Description binary", id->short_description_key()->parse_value());
+    auto v(visitor_cast<const MetadataCollectionKey<Set<std::string> > >(**id->find_metadata("INHERITED"))->parse_value());
+    EXPECT_EQ("foo", join(v->begin(), v->end(), " "));
+}
+
+TEST(EbuildFlatMetadataCache, ValidationSnapshot)
+{
+    std::shared_ptr<Map<std::string, std::string> > keys(std::make_shared<Map<std::string, std::string>>());
+    keys->insert("format", "e");
+    keys->insert("names_cache", "/var/empty");
+    keys->insert("location", stringify(FSPath::cwd() / "ebuild_flat_metadata_cache_TEST_dir/snapshot_repo"));
+    keys->insert("profiles", stringify(FSPath::cwd() / "ebuild_flat_metadata_cache_TEST_dir/snapshot_repo/profiles/profile"));
+    keys->insert("cache", "/var/empty");
+    keys->insert("write_cache", stringify(FSPath::cwd() / "ebuild_flat_metadata_cache_TEST_dir/snapshot_cache"));
+    keys->insert("sync", "git://example.com/snapshot");
+    keys->insert("builddir", stringify(FSPath::cwd() / "ebuild_flat_metadata_cache_TEST_dir" / "build"));
+
+    auto description([&] () -> std::string {
+            TestEnvironment env;
+            std::shared_ptr<Repository> repo(ERepository::repository_factory_create(&env,
+                        std::bind(from_keys, keys, std::placeholders::_1)));
+            env.add_repository(1, repo);
+            std::shared_ptr<const PackageID> id(*env[selection::RequireExactlyOne(generator::Matches(
+                            PackageDepSpec(parse_user_package_dep_spec("=cat/snapshot-1",
+                                    &env, { })), nullptr, { }))]->begin());
+            return id->short_description_key()->parse_value();
+            });
+
+    {
+        TestEnvironment env;
+        std::shared_ptr<Repository> repo(ERepository::repository_factory_create(&env,
+                    std::bind(from_keys, keys, std::placeholders::_1)));
+        env.add_repository(1, repo);
+        repo->regenerate_cache();
+    }
+
+    ASSERT_TRUE(FSPath("ebuild_flat_metadata_cache_TEST_dir/snapshot_cache/snapshot-repo/_VALIDATED_").stat().is_regular_file());
+
+    /* the ebuild is newer than the cache entry, but the snapshot says the
+     * entry was valid and nothing we check has changed since */
+    FSPath ebuild("ebuild_flat_metadata_cache_TEST_dir/snapshot_repo/cat/snapshot/snapshot-1.ebuild");
+    {
+        SafeOFStream f(ebuild, -1, true);
+        f << "inherit foo" << std::endl << "DESCRIPTION=\"Changed\"" << std::endl << "SLOT=\"0\"" << std::endl;
+    }
+    ebuild.utime(Timestamp(120, 0));
+
+    EXPECT_EQ("The Generated Description snapshot", description());
+
+    /* touching an eclass directory makes the snapshot stale */
+    FSPath("ebuild_flat_metadata_cache_TEST_dir/snapshot_repo/eclass").utime(Timestamp(500, 0));
+
+    EXPECT_EQ("Changed", description());
+}
@@ -1435,3 +1435,52 @@ EAPI=exheres-0
 DEFINED_PHASES=-
 END
 
+
+mkdir -p binary_repo/{eclass,profiles/profile,cat/binary} || exit 1
+cd binary_repo || exit 1
+echo "binary-repo" > profiles/repo_name || exit 1
+cat <<END > profiles/categories || exit 1
+cat
+END
+cat <<END > profiles/profile/make.defaults
+ARCH=test
+END
+cat <<END > eclass/foo.eclass
+DEPEND="cat/baz"
+END
+cat <<END > cat/binary/binary-1.ebuild || exit 1
+inherit foo
+DESCRIPTION="The Generated Description binary"
+HOMEPAGE="http://example.com/"
+SLOT="0"
+LICENSE="GPL-2"
+KEYWORDS="test"
+END
+TZ=UTC touch -t 197001010001 cat/binary/binary-1.ebuild || exit 2
+TZ=UTC touch -t 197001010003 eclass/foo.eclass || exit 2
+cd ..
+
+mkdir -p snapshot_cache/snapshot-repo || exit 1
+mkdir -p snapshot_repo/{eclass,profiles/profile,cat/snapshot} || exit 1
+cd snapshot_repo || exit 1
+echo "snapshot-repo" > profiles/repo_name || exit 1
+cat <<END > profiles/categories || exit 1
+cat
+END
+cat <<END > profiles/profile/make.defaults
+ARCH=test
+END
+cat <<END > eclass/foo.eclass
+DEPEND="cat/baz"
+END
+cat <<END > cat/snapshot/snapshot-1.ebuild || exit 1
+inherit foo
+DESCRIPTION="The Generated Description snapshot"
+HOMEPAGE="http://example.com/"
+SLOT="0"
+LICENSE="GPL-2"
+KEYWORDS="test"
+END
+TZ=UTC touch -t 197001010001 cat/snapshot/snapshot-1.ebuild || exit 2
+TZ=UTC touch -t 197001010003 eclass/foo.eclass || exit 2
+cd ..
@@ -19,6 +19,7 @@
 
 #include <paludis/repositories/e/ebuild_id.hh>
 #include <paludis/repositories/e/ebuild_flat_metadata_cache.hh>
+#include <paludis/repositories/e/metadata_validation_snapshot.hh>
 #include <paludis/repositories/e/e_repository.hh>
 #include <paludis/repositories/e/e_repository_params.hh>
 #include <paludis/repositories/e/eapi_phase.hh>
@@ -251,11 +252,28 @@ EbuildID::need_non_xml_keys_added() const
     write_cache_file /= stringify(name().category());
     write_cache_file /= stringify(name().package()) + "-" + stringify(version());
 
+    auto snapshot(e_repo->metadata_validation_snapshot());
+    auto load_from([&] (EbuildFlatMetadataCache & metadata_cache, const FSPath & f) -> bool {
+            bool known_valid(snapshot && snapshot->known_valid(f));
+            if (! metadata_cache.load(shared_from_this(), false, known_valid))
+                return false;
+            if (snapshot && ! known_valid)
+                snapshot->add(f);
+            return true;
+        });
+
     bool ok(false);
-    if (e_repo->params().cache().basename() != "empty")
+    if (auto binary_cache = e_repo->binary_metadata_cache())
+    {
+        EbuildFlatMetadataCache metadata_cache(_imp->environment, binary_cache, e_repo->params().cache(),
+                stringify(name()) + "-" + stringify(version()), _imp->fs_location->parse_value(), _imp->master_mtime, _imp->eclass_mtimes, false);
+        if (load_from(metadata_cache, cache_file))
+            ok = true;
+    }
+    else if (e_repo->params().cache().basename() != "empty" && ! EbuildBinaryMetadataCache::is_binary_cache_location(e_repo->params().cache()))
     {
         EbuildFlatMetadataCache metadata_cache(_imp->environment, cache_file, _imp->fs_location->parse_value(), _imp->master_mtime, _imp->eclass_mtimes, false);
-        if (metadata_cache.load(shared_from_this(), false))
+        if (load_from(metadata_cache, cache_file))
             ok = true;
     }
 
@@ -263,7 +281,7 @@ EbuildID::need_non_xml_keys_added() const
     {
         EbuildFlatMetadataCache write_metadata_cache(_imp->environment,
                 write_cache_file, _imp->fs_location->parse_value(), _imp->master_mtime, _imp->eclass_mtimes, true);
-        if (write_metadata_cache.load(shared_from_this(), false))
+        if (load_from(write_metadata_cache, write_cache_file))
             ok = true;
         else if (write_cache_file.stat().exists())
         {
@@ -341,6 +359,8 @@ EbuildID::need_non_xml_keys_added() const
                 EbuildFlatMetadataCache metadata_cache(_imp->environment, write_cache_file, _imp->fs_location->parse_value(), _imp->master_mtime,
                         _imp->eclass_mtimes, false);
                 metadata_cache.save(shared_from_this());
+                if (snapshot)
+                    snapshot->add(write_cache_file);
             }
         }
         else
@@ -1700,7 +1720,7 @@ EbuildID::purge_invalid_cache() const
         {
             EbuildFlatMetadataCache write_metadata_cache(_imp->environment,
                     write_cache_file, _imp->fs_location->parse_value(), _imp->master_mtime, _imp->eclass_mtimes, true);
-            if (! write_metadata_cache.load(shared_from_this(), true))
+            if (! write_metadata_cache.load(shared_from_this(), true, false))
                 write_cache_file.unlink();
         }
     }
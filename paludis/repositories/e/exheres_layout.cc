@@ -21,6 +21,7 @@
 #include <paludis/repositories/e/e_repository_exceptions.hh>
 #include <paludis/repositories/e/e_repository.hh>
 #include <paludis/repositories/e/file_suffixes.hh>
+#include <paludis/repositories/e/layout_index.hh>
 #include <paludis/repositories/e/exheres_mask_store.hh>
 
 #include <paludis/util/config_file.hh>
@@ -53,10 +54,6 @@
 using namespace paludis;
 using namespace paludis::erepository;
 
-typedef std::unordered_map<CategoryNamePart, bool, Hash<CategoryNamePart> > CategoryMap;
-typedef std::unordered_map<QualifiedPackageName, bool, Hash<QualifiedPackageName> > PackagesMap;
-typedef std::unordered_map<QualifiedPackageName, std::shared_ptr<PackageIDSequence>, Hash<QualifiedPackageName> > IDMap;
-
 namespace
 {
     std::shared_ptr<ExheresMaskStore> make_mask_store(
@@ -77,14 +74,7 @@ namespace paludis
         const ERepository * const repository;
         const FSPath tree_root;
 
-        mutable std::recursive_mutex big_nasty_mutex;
-
-        mutable bool has_category_names;
-        mutable CategoryMap category_names;
-        mutable PackagesMap package_names;
-        mutable IDMap ids;
-
-        mutable std::shared_ptr<CategoryNamePartSet> category_names_collection;
+        std::unique_ptr<LayoutIndex> index;
 
         std::shared_ptr<FSPathSequence> arch_list_files;
         std::shared_ptr<FSPathSequence> repository_mask_files;
@@ -99,7 +89,6 @@ namespace paludis
         Imp(const Environment * const env, const ERepository * const n, const FSPath & t) :
             repository(n),
             tree_root(t),
-            has_category_names(false),
             arch_list_files(std::make_shared<FSPathSequence>()),
             repository_mask_files(std::make_shared<FSPathSequence>()),
             profiles_desc_files(std::make_shared<FSPathSequence>()),
@@ -120,6 +109,12 @@ ExheresLayout::ExheresLayout(const Environment * const e, const ERepository * co
     Layout(f),
     _imp(e, r, tree_root)
 {
+    _imp->index.reset(new LayoutIndex(
+                std::bind(&ExheresLayout::load_category_names, this),
+                std::bind(&ExheresLayout::load_package_names, this, std::placeholders::_1),
+                std::bind(&ExheresLayout::load_package_ids, this, std::placeholders::_1),
+                std::bind(&ExheresLayout::package_directory_exists, this, std::placeholders::_1)));
+
     if (master_repositories_locations())
     {
         for (FSPathSequence::ConstIterator l(master_repositories_locations()->begin()), l_end(master_repositories_locations()->end()) ;
@@ -185,18 +180,14 @@ ExheresLayout::categories_file() const
     return _imp->tree_root / "metadata" / "categories.conf";
 }
 
-void
-ExheresLayout::need_category_names() const
+std::shared_ptr<const CategoryNamePartSet>
+ExheresLayout::load_category_names() const
 {
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
-
-    if (_imp->has_category_names)
-        return;
-
     Context context("When loading category names for " + stringify(_imp->repository->name()) + ":");
 
     Log::get_instance()->message("e.exheres_layout.need_category_names", ll_debug, lc_context) << "need_category_names";
 
+    std::shared_ptr<CategoryNamePartSet> result(std::make_shared<CategoryNamePartSet>());
     bool found_one(false);
 
     std::list<FSPath> cats_list;
@@ -215,7 +206,7 @@ ExheresLayout::need_category_names() const
         {
             try
             {
-                _imp->category_names.insert(std::make_pair(CategoryNamePart(*line), false));
+                result->insert(CategoryNamePart(*line));
             }
             catch (const NameError & e)
             {
@@ -232,19 +223,14 @@ ExheresLayout::need_category_names() const
         throw ERepositoryConfigurationError("No categories file available for repository '"
                 + stringify(_imp->repository->name()) + "', and this layout does not allow auto-generation");
 
-    _imp->has_category_names = true;
+    return result;
 }
 
-void
-ExheresLayout::need_package_ids(const QualifiedPackageName & n) const
+std::shared_ptr<const PackageIDSequence>
+ExheresLayout::load_package_ids(const QualifiedPackageName & n) const
 {
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
-
     using namespace std::placeholders;
 
-    if (_imp->package_names[n])
-        return;
-
     Context context("When loading versions for '" + stringify(n) + "' in "
             + stringify(_imp->repository->name()) + ":");
 
@@ -281,102 +267,47 @@ ExheresLayout::need_package_ids(const QualifiedPackageName & n) const
         }
     }
 
-    _imp->ids.insert(std::make_pair(n, v));
-    _imp->package_names[n] = true;
+    return v;
 }
 
 bool
-ExheresLayout::has_category_named(const CategoryNamePart & c) const
+ExheresLayout::package_directory_exists(const QualifiedPackageName & q) const
 {
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
+    FSPath fs(_imp->tree_root);
+    fs /= "packages";
+    fs /= stringify(q.category());
+    fs /= stringify(q.package());
+    return fs.stat().is_directory_or_symlink_to_directory();
+}
 
+bool
+ExheresLayout::has_category_named(const CategoryNamePart & c) const
+{
     Context context("When checking for category '" + stringify(c) + "' in '" + stringify(_imp->repository->name()) + "':");
 
-    need_category_names();
-    return _imp->category_names.end() != _imp->category_names.find(c);
+    return _imp->index->has_category_named(c);
 }
 
 bool
 ExheresLayout::has_package_named(const QualifiedPackageName & q) const
 {
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
-
     Context context("When checking for package '" + stringify(q) + "' in '" + stringify(_imp->repository->name()) + ":");
 
-    need_category_names();
-
-    CategoryMap::iterator cat_iter(_imp->category_names.find(q.category()));
-
-    if (_imp->category_names.end() == cat_iter)
-        return false;
-
-    if (cat_iter->second)
-    {
-        /* this category's package names are fully loaded */
-        return _imp->package_names.find(q) != _imp->package_names.end();
-    }
-    else
-    {
-        /* package names are only partially loaded or not loaded */
-        if (_imp->package_names.find(q) != _imp->package_names.end())
-            return true;
-
-        FSPath fs(_imp->tree_root);
-        fs /= "packages";
-        fs /= stringify(q.category());
-        fs /= stringify(q.package());
-        if (! fs.stat().is_directory_or_symlink_to_directory())
-            return false;
-        _imp->package_names.insert(std::make_pair(q, false));
-        return true;
-    }
-}
-
-void
-ExheresLayout::need_category_names_collection() const
-{
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
-
-    if (_imp->category_names_collection)
-        return;
-
-    need_category_names();
-
-    _imp->category_names_collection = std::make_shared<CategoryNamePartSet>();
-    std::transform(_imp->category_names.begin(), _imp->category_names.end(),
-            _imp->category_names_collection->inserter(),
-            std::mem_fn(&std::pair<const CategoryNamePart, bool>::first));
+    return _imp->index->has_package_named(q);
 }
 
 std::shared_ptr<const CategoryNamePartSet>
 ExheresLayout::category_names() const
 {
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
-
     Context context("When fetching category names in " + stringify(stringify(_imp->repository->name())) + ":");
 
-    need_category_names_collection();
-    return _imp->category_names_collection;
+    return _imp->index->category_names();
 }
 
 std::shared_ptr<const QualifiedPackageNameSet>
-ExheresLayout::package_names(const CategoryNamePart & c) const
+ExheresLayout::load_package_names(const CategoryNamePart & c) const
 {
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
-
-    using namespace std::placeholders;
-
-    /* this isn't particularly fast because it isn't called very often. avoid
-     * changing the data structures used to make this faster at the expense of
-     * slowing down single item queries. */
-
-    Context context("When fetching package names in category '" + stringify(c)
-            + "' in '" + stringify(_imp->repository->name()) + "':");
-
-    need_category_names();
-
-    if (_imp->category_names.end() == _imp->category_names.find(c))
-        return std::make_shared<QualifiedPackageNameSet>();
+    std::shared_ptr<QualifiedPackageNameSet> result(std::make_shared<QualifiedPackageNameSet>());
 
     if ((_imp->tree_root / "packages" / stringify(c)).stat().is_directory_or_symlink_to_directory())
         for (FSIterator d(_imp->tree_root / "packages" / stringify(c), { fsio_want_directories, fsio_deref_symlinks_for_wants }), d_end ;
@@ -387,7 +318,7 @@ ExheresLayout::package_names(const CategoryNamePart & c) const
                 if (d->basename() == "CVS")
                     continue;
 
-                _imp->package_names.insert(std::make_pair(c + PackageNamePart(d->basename()), false));
+                result->insert(c + PackageNamePart(d->basename()));
             }
             catch (const NameError & e)
             {
@@ -397,32 +328,24 @@ ExheresLayout::package_names(const CategoryNamePart & c) const
             }
         }
 
-    _imp->category_names[c] = true;
-
-    std::shared_ptr<QualifiedPackageNameSet> result(std::make_shared<QualifiedPackageNameSet>());
+    return result;
+}
 
-    for (PackagesMap::const_iterator p(_imp->package_names.begin()), p_end(_imp->package_names.end()) ;
-            p != p_end ; ++p)
-        if (p->first.category() == c)
-            result->insert(p->first);
+std::shared_ptr<const QualifiedPackageNameSet>
+ExheresLayout::package_names(const CategoryNamePart & c) const
+{
+    Context context("When fetching package names in category '" + stringify(c)
+            + "' in '" + stringify(_imp->repository->name()) + "':");
 
-    return result;
+    return _imp->index->package_names(c);
 }
 
 std::shared_ptr<const PackageIDSequence>
 ExheresLayout::package_ids(const QualifiedPackageName & n) const
 {
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
-
     Context context("When fetching versions of '" + stringify(n) + "' in " + stringify(_imp->repository->name()) + ":");
 
-    if (has_package_named(n))
-    {
-        need_package_ids(n);
-        return _imp->ids.find(n)->second;
-    }
-    else
-        return std::make_shared<PackageIDSequence>();
+    return _imp->index->package_ids(n);
 }
 
 const std::shared_ptr<const FSPathSequence>
@@ -546,6 +546,8 @@ ExndbamRepository::merge(const MergeParams & m)
                 n::root() = installed_root_key()->parse_value()
             ));
     post_merge_command();
+
+    update_owners_index();
 }
 
 void
@@ -709,11 +711,15 @@ ExndbamRepository::perform_uninstall(
 
         _imp->ndbam.deindex(id->name());
     }
+
+    if (! a.options.is_overwrite())
+        update_owners_index();
 }
 
 void
 ExndbamRepository::regenerate_cache() const
 {
+    update_owners_index();
 }
 
 void
@@ -0,0 +1,221 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/repositories/e/layout_index.hh>
+
+#include <paludis/util/pimp-impl.hh>
+#include <paludis/util/set.hh>
+#include <paludis/util/sequence.hh>
+#include <paludis/util/hashes.hh>
+#include <paludis/util/wrapped_forward_iterator.hh>
+
+#include <paludis/name.hh>
+#include <paludis/package_id.hh>
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+using namespace paludis;
+using namespace paludis::erepository;
+
+namespace
+{
+    struct CategoryEntry
+    {
+        std::once_flag packages_once;
+        std::atomic<bool> has_packages;
+        std::shared_ptr<const QualifiedPackageNameSet> packages;
+
+        CategoryEntry() :
+            has_packages(false)
+        {
+        }
+    };
+
+    struct PackageEntry
+    {
+        std::once_flag ids_once;
+        std::shared_ptr<const PackageIDSequence> ids;
+    };
+
+    /* packages are looked up and added from lots of threads at once, so
+     * spread them over several independently locked maps */
+    struct PackageShard
+    {
+        std::mutex mutex;
+        std::unordered_map<QualifiedPackageName, std::shared_ptr<PackageEntry>, Hash<QualifiedPackageName> > entries;
+    };
+
+    const std::size_t number_of_package_shards(64);
+}
+
+namespace paludis
+{
+    template <>
+    struct Imp<LayoutIndex>
+    {
+        const LoadCategoryNamesFunction load_category_names;
+        const LoadPackageNamesFunction load_package_names;
+        const LoadPackageIDsFunction load_package_ids;
+        const PackageDirectoryExistsFunction package_directory_exists;
+
+        /* neither of these change once categories_once has run */
+        mutable std::once_flag categories_once;
+        mutable std::shared_ptr<const CategoryNamePartSet> category_names;
+        mutable std::unordered_map<CategoryNamePart, std::unique_ptr<CategoryEntry>, Hash<CategoryNamePart> > categories;
+
+        mutable std::array<PackageShard, number_of_package_shards> package_shards;
+
+        Imp(const LoadCategoryNamesFunction & c, const LoadPackageNamesFunction & p,
+                const LoadPackageIDsFunction & i, const PackageDirectoryExistsFunction & d) :
+            load_category_names(c),
+            load_package_names(p),
+            load_package_ids(i),
+            package_directory_exists(d)
+        {
+        }
+
+        void need_categories() const
+        {
+            std::call_once(categories_once, [&] () {
+                    category_names = load_category_names();
+                    for (auto c(category_names->begin()), c_end(category_names->end()) ;
+                            c != c_end ; ++c)
+                        categories.insert(std::make_pair(*c, std::unique_ptr<CategoryEntry>(new CategoryEntry)));
+                    });
+        }
+
+        CategoryEntry * category(const CategoryNamePart & c) const
+        {
+            need_categories();
+            auto i(categories.find(c));
+            return categories.end() == i ? nullptr : i->second.get();
+        }
+
+        const std::shared_ptr<const QualifiedPackageNameSet> & packages(CategoryEntry & entry, const CategoryNamePart & c) const
+        {
+            std::call_once(entry.packages_once, [&] () {
+                    entry.packages = load_package_names(c);
+                    entry.has_packages.store(true, std::memory_order_release);
+                    });
+            return entry.packages;
+        }
+
+        PackageShard & shard(const QualifiedPackageName & q) const
+        {
+            return package_shards[Hash<QualifiedPackageName>()(q) % number_of_package_shards];
+        }
+    };
+}
+
+LayoutIndex::LayoutIndex(const LoadCategoryNamesFunction & c, const LoadPackageNamesFunction & p,
+        const LoadPackageIDsFunction & i, const PackageDirectoryExistsFunction & d) :
+    _imp(c, p, i, d)
+{
+}
+
+LayoutIndex::~LayoutIndex()
+{
+}
+
+bool
+LayoutIndex::has_category_named(const CategoryNamePart & c) const
+{
+    return _imp->category(c);
+}
+
+bool
+LayoutIndex::has_package_named(const QualifiedPackageName & q) const
+{
+    CategoryEntry * entry(_imp->category(q.category()));
+    if (! entry)
+        return false;
+
+    if (entry->has_packages.load(std::memory_order_acquire))
+    {
+        /* this category's package names are fully loaded */
+        return entry->packages->end() != entry->packages->find(q);
+    }
+    else
+    {
+        /* we don't want to read the whole category just to check for one
+         * package, so look for its directory instead, and remember it if
+         * it's there */
+        PackageShard & shard(_imp->shard(q));
+        {
+            std::unique_lock<std::mutex> lock(shard.mutex);
+            if (shard.entries.end() != shard.entries.find(q))
+                return true;
+        }
+
+        if (! _imp->package_directory_exists(q))
+            return false;
+
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        shard.entries.insert(std::make_pair(q, std::make_shared<PackageEntry>()));
+        return true;
+    }
+}
+
+std::shared_ptr<const CategoryNamePartSet>
+LayoutIndex::category_names() const
+{
+    _imp->need_categories();
+    return _imp->category_names;
+}
+
+std::shared_ptr<const QualifiedPackageNameSet>
+LayoutIndex::package_names(const CategoryNamePart & c) const
+{
+    CategoryEntry * entry(_imp->category(c));
+    if (! entry)
+        return std::make_shared<QualifiedPackageNameSet>();
+
+    return _imp->packages(*entry, c);
+}
+
+std::shared_ptr<const PackageIDSequence>
+LayoutIndex::package_ids(const QualifiedPackageName & q) const
+{
+    if (! has_package_named(q))
+        return std::make_shared<PackageIDSequence>();
+
+    std::shared_ptr<PackageEntry> entry;
+    {
+        PackageShard & shard(_imp->shard(q));
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        auto i(shard.entries.find(q));
+        if (shard.entries.end() == i)
+            i = shard.entries.insert(std::make_pair(q, std::make_shared<PackageEntry>())).first;
+        entry = i->second;
+    }
+
+    /* only this package waits whilst its IDs are loaded */
+    std::call_once(entry->ids_once, [&] () {
+            entry->ids = _imp->load_package_ids(q);
+            });
+    return entry->ids;
+}
+
+namespace paludis
+{
+    template class Pimp<LayoutIndex>;
+}
@@ -0,0 +1,87 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_REPOSITORIES_E_LAYOUT_INDEX_HH
+#define PALUDIS_GUARD_PALUDIS_REPOSITORIES_E_LAYOUT_INDEX_HH 1
+
+#include <paludis/util/pimp.hh>
+#include <paludis/util/attributes.hh>
+#include <paludis/name-fwd.hh>
+#include <paludis/package_id-fwd.hh>
+#include <functional>
+#include <memory>
+
+namespace paludis
+{
+    namespace erepository
+    {
+        typedef std::function<std::shared_ptr<const CategoryNamePartSet> ()> LoadCategoryNamesFunction;
+        typedef std::function<std::shared_ptr<const QualifiedPackageNameSet> (const CategoryNamePart &)> LoadPackageNamesFunction;
+        typedef std::function<std::shared_ptr<const PackageIDSequence> (const QualifiedPackageName &)> LoadPackageIDsFunction;
+        typedef std::function<bool (const QualifiedPackageName &)> PackageDirectoryExistsFunction;
+
+        /**
+         * Category, package and ID lists for a Layout.
+         *
+         * Each list is loaded at most once, using the supplied functions, and
+         * is never modified afterwards, so lookups on things that have already
+         * been loaded do not need to wait for anything else that is loading.
+         *
+         * \ingroup grperepository
+         * \nosubgrouping
+         */
+        class PALUDIS_VISIBLE LayoutIndex
+        {
+            private:
+                Pimp<LayoutIndex> _imp;
+
+            public:
+                ///\name Basic operations
+                ///\{
+
+                LayoutIndex(
+                        const LoadCategoryNamesFunction &,
+                        const LoadPackageNamesFunction &,
+                        const LoadPackageIDsFunction &,
+                        const PackageDirectoryExistsFunction &);
+                ~LayoutIndex();
+
+                LayoutIndex(const LayoutIndex &) = delete;
+                LayoutIndex & operator= (const LayoutIndex &) = delete;
+
+                ///\}
+
+                bool has_category_named(const CategoryNamePart &) const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                bool has_package_named(const QualifiedPackageName &) const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                std::shared_ptr<const CategoryNamePartSet> category_names() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                std::shared_ptr<const QualifiedPackageNameSet> package_names(const CategoryNamePart &) const
+                    PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                std::shared_ptr<const PackageIDSequence> package_ids(const QualifiedPackageName &) const
+                    PALUDIS_ATTRIBUTE((warn_unused_result));
+        };
+    }
+
+    extern template class Pimp<erepository::LayoutIndex>;
+}
+
+#endif
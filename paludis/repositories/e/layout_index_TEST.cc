@@ -0,0 +1,115 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <paludis/repositories/e/layout_index.hh>
+
+#include <paludis/util/set.hh>
+#include <paludis/util/sequence.hh>
+#include <paludis/util/wrapped_forward_iterator.hh>
+
+#include <paludis/name.hh>
+#include <paludis/package_id.hh>
+
+#include <gtest/gtest.h>
+
+using namespace paludis;
+using namespace paludis::erepository;
+
+namespace
+{
+    struct Counts
+    {
+        int category_loads, package_loads, directory_checks;
+
+        Counts() :
+            category_loads(0),
+            package_loads(0),
+            directory_checks(0)
+        {
+        }
+    };
+
+    std::shared_ptr<LayoutIndex> make_index(Counts & counts)
+    {
+        return std::make_shared<LayoutIndex>(
+                [&] () {
+                    ++counts.category_loads;
+                    auto result(std::make_shared<CategoryNamePartSet>());
+                    result->insert(CategoryNamePart("cat"));
+                    return result;
+                },
+                [&] (const CategoryNamePart & c) {
+                    ++counts.package_loads;
+                    auto result(std::make_shared<QualifiedPackageNameSet>());
+                    result->insert(c + PackageNamePart("one"));
+                    result->insert(c + PackageNamePart("two"));
+                    return result;
+                },
+                [&] (const QualifiedPackageName &) {
+                    return std::make_shared<PackageIDSequence>();
+                },
+                [&] (const QualifiedPackageName & q) {
+                    ++counts.directory_checks;
+                    /* "stale" has a directory but isn't in the package list */
+                    return q.package() == PackageNamePart("one") || q.package() == PackageNamePart("stale");
+                });
+    }
+}
+
+TEST(LayoutIndex, HasPackageNamedBeforeLoad)
+{
+    Counts counts;
+    auto index(make_index(counts));
+
+    EXPECT_TRUE(index->has_package_named(QualifiedPackageName("cat/one")));
+    EXPECT_TRUE(index->has_package_named(QualifiedPackageName("cat/one")));
+    EXPECT_FALSE(index->has_package_named(QualifiedPackageName("cat/two")));
+    EXPECT_FALSE(index->has_package_named(QualifiedPackageName("other/one")));
+
+    EXPECT_EQ(1, counts.category_loads);
+    EXPECT_EQ(0, counts.package_loads);
+    EXPECT_EQ(2, counts.directory_checks);
+}
+
+TEST(LayoutIndex, HasPackageNamedAfterLoad)
+{
+    Counts counts;
+    auto index(make_index(counts));
+
+    EXPECT_TRUE(index->has_package_named(QualifiedPackageName("cat/stale")));
+
+    auto names(index->package_names(CategoryNamePart("cat")));
+    EXPECT_EQ(2, std::distance(names->begin(), names->end()));
+    EXPECT_EQ(1, counts.package_loads);
+    EXPECT_EQ(1, counts.directory_checks);
+
+    EXPECT_TRUE(index->has_package_named(QualifiedPackageName("cat/one")));
+    EXPECT_TRUE(index->has_package_named(QualifiedPackageName("cat/two")));
+    EXPECT_FALSE(index->has_package_named(QualifiedPackageName("cat/stale")));
+    EXPECT_FALSE(index->has_package_named(QualifiedPackageName("cat/three")));
+    EXPECT_FALSE(index->has_package_named(QualifiedPackageName("other/one")));
+
+    auto again(index->package_names(CategoryNamePart("cat")));
+    EXPECT_EQ(names, again);
+    EXPECT_EQ(1, counts.package_loads);
+    EXPECT_EQ(1, counts.directory_checks);
+    EXPECT_EQ(1, counts.category_loads);
+}
+
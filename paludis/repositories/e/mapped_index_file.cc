@@ -0,0 +1,164 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <paludis/repositories/e/mapped_index_file.hh>
+
+#include <paludis/util/pimp-impl.hh>
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/log.hh>
+#include <paludis/util/safe_ofstream.hh>
+#include <paludis/util/stringify.hh>
+
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+using namespace paludis;
+using namespace paludis::erepository;
+
+namespace
+{
+    const uint32_t byte_order_marker(0x01020304);
+}
+
+namespace paludis
+{
+    template <>
+    struct Imp<MappedIndexFile>
+    {
+        const FSPath location;
+        const std::string description;
+
+        void * mapped;
+        std::size_t size;
+        bool usable;
+
+        Imp(const FSPath & l, const std::string & d) :
+            location(l),
+            description(d),
+            mapped(nullptr),
+            size(0),
+            usable(false)
+        {
+        }
+    };
+}
+
+MappedIndexFile::MappedIndexFile(const FSPath & l, const char (& magic)[8], const std::size_t header_size,
+        const std::string & description) :
+    _imp(l, description)
+{
+    int fd(::open(stringify(l).c_str(), O_RDONLY | O_CLOEXEC));
+    if (-1 == fd)
+    {
+        Log::get_instance()->message("e.mapped_index_file.open", ll_debug, lc_context)
+            << "Couldn't open " << description << " '" << l << "': " << std::strerror(errno);
+        return;
+    }
+
+    struct ::stat st;
+    if (0 != ::fstat(fd, &st) || static_cast<std::size_t>(st.st_size) < header_size)
+    {
+        Log::get_instance()->message("e.mapped_index_file.truncated", ll_warning, lc_context)
+            << "The " << description << " '" << l << "' is truncated";
+        ::close(fd);
+        return;
+    }
+
+    void * mapped(::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0));
+    ::close(fd);
+    if (MAP_FAILED == mapped)
+    {
+        Log::get_instance()->message("e.mapped_index_file.mmap", ll_warning, lc_context)
+            << "Couldn't mmap " << description << " '" << l << "': " << std::strerror(errno);
+        return;
+    }
+
+    _imp->mapped = mapped;
+    _imp->size = st.st_size;
+
+    const MappedIndexFileHeader * header(static_cast<const MappedIndexFileHeader *>(mapped));
+    if (0 != std::memcmp(header->magic, magic, sizeof(header->magic)) || byte_order_marker != header->byte_order)
+    {
+        Log::get_instance()->message("e.mapped_index_file.bad_header", ll_warning, lc_context)
+            << "'" << l << "' is not a " << description << " that we understand";
+        return;
+    }
+
+    _imp->usable = true;
+}
+
+MappedIndexFile::~MappedIndexFile()
+{
+    if (_imp->mapped)
+        ::munmap(_imp->mapped, _imp->size);
+}
+
+const char *
+MappedIndexFile::data() const
+{
+    return _imp->usable ? static_cast<const char *>(_imp->mapped) : nullptr;
+}
+
+std::size_t
+MappedIndexFile::size() const
+{
+    return _imp->size;
+}
+
+bool
+MappedIndexFile::check_size(const uint64_t s) const
+{
+    if (s <= _imp->size)
+        return true;
+
+    Log::get_instance()->message("e.mapped_index_file.truncated", ll_warning, lc_context)
+        << "The " << _imp->description << " '" << _imp->location << "' is truncated";
+    return false;
+}
+
+void
+MappedIndexFile::fill_header(MappedIndexFileHeader & header, const char (& magic)[8])
+{
+    std::memcpy(header.magic, magic, sizeof(header.magic));
+    header.byte_order = byte_order_marker;
+}
+
+void
+MappedIndexFile::write(const FSPath & l, const std::string & data)
+{
+    FSPath temp(l.dirname() / ("." + l.basename() + ".tmp." + stringify(::getpid())));
+    {
+        SafeOFStream f(temp, -1, true);
+        f << data;
+    }
+
+    temp.rename(l);
+}
+
+namespace paludis
+{
+    template class Pimp<MappedIndexFile>;
+}
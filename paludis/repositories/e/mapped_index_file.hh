@@ -0,0 +1,108 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef PALUDIS_GUARD_PALUDIS_REPOSITORIES_E_MAPPED_INDEX_FILE_HH
+#define PALUDIS_GUARD_PALUDIS_REPOSITORIES_E_MAPPED_INDEX_FILE_HH 1
+
+#include <paludis/util/pimp.hh>
+#include <paludis/util/fs_path-fwd.hh>
+#include <paludis/util/attributes.hh>
+#include <cstdint>
+#include <string>
+
+namespace paludis
+{
+    namespace erepository
+    {
+        /**
+         * The start of the header of every MappedIndexFile. Integers in the
+         * rest of the file are in native byte order, and byte_order is used
+         * to spot files written on a different architecture.
+         *
+         * \ingroup grperepository
+         */
+        struct MappedIndexFileHeader
+        {
+            char magic[8];
+            uint32_t byte_order;
+        };
+
+        /**
+         * A read-only, memory mapped index file, as used by
+         * EbuildBinaryMetadataCache and OwnersIndex.
+         *
+         * \ingroup grperepository
+         * \nosubgrouping
+         */
+        class PALUDIS_VISIBLE MappedIndexFile
+        {
+            private:
+                Pimp<MappedIndexFile> _imp;
+
+            public:
+                ///\name Basic operations
+                ///\{
+
+                /**
+                 * The description is used in log messages, and header_size is
+                 * the size of the file's full header, which must start with a
+                 * MappedIndexFileHeader.
+                 */
+                MappedIndexFile(const FSPath &, const char (& magic)[8], const std::size_t header_size,
+                        const std::string & description);
+                ~MappedIndexFile();
+
+                MappedIndexFile(const MappedIndexFile &) = delete;
+                MappedIndexFile & operator= (const MappedIndexFile &) = delete;
+
+                ///\}
+
+                /**
+                 * The file's contents, or a null pointer if it does not exist,
+                 * is truncated, or has the wrong magic or byte order.
+                 */
+                const char * data() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                std::size_t size() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Check that the file holds at least this many bytes, warning
+                 * and returning false if it does not.
+                 */
+                bool check_size(const uint64_t) const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Fill in the magic and byte order for a header that is
+                 * about to be written.
+                 */
+                static void fill_header(MappedIndexFileHeader &, const char (& magic)[8]);
+
+                /**
+                 * Write out a file, replacing any existing file atomically,
+                 * so that anyone still using the old one is not affected.
+                 */
+                static void write(const FSPath &, const std::string & data);
+        };
+    }
+
+    extern template class Pimp<erepository::MappedIndexFile>;
+}
+
+#endif
@@ -26,28 +26,348 @@
 #include <paludis/util/timestamp.hh>
 #include <paludis/util/fs_path.hh>
 #include <paludis/util/fs_stat.hh>
+#include <paludis/util/fs_error.hh>
+#include <paludis/util/exception.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/hashes.hh>
+#include <paludis/util/log.hh>
+#include <paludis/util/options.hh>
 
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
 
 using namespace paludis;
 using namespace paludis::erepository;
 
-namespace paludis
+/*
+ * Hashes are remembered on disk, in a file in a subdirectory of whichever
+ * directory holds the files being hashed (which is normally the distdir).
+ * After a header line, each line is:
+ *
+ *     inode size mtime-seconds mtime-nanoseconds ctime-seconds ctime-nanoseconds algorithm hexsum basename
+ *
+ * The ctime is there because the mtime can be set to anything, and so
+ * can't tell us on its own that a file hasn't been rewritten in place.
+ *
+ * Lines are only ever appended, and later lines win, so several processes
+ * can add to the file at once. Loading the file compacts it if it has built
+ * up too many superseded lines.
+ *
+ * Anyone who can write to the file can make us accept a tampered distfile,
+ * so the file and its directory are created 0600 and 0700, and are ignored
+ * unless they are owned by us and nobody else can write to them.
+ */
+
+namespace
 {
-    typedef std::map<std::pair<std::string, std::string>, std::pair<Timestamp, std::string> > HashesMap;
+    const std::string cache_format("paludis-hashes-2");
+
+    struct FileIdentity
+    {
+        ino_t inode;
+        off_t size;
+        time_t mtime_seconds;
+        long mtime_nanoseconds;
+        time_t ctime_seconds;
+        long ctime_nanoseconds;
+
+        bool operator== (const FileIdentity & other) const
+        {
+            return inode == other.inode && size == other.size &&
+                mtime_seconds == other.mtime_seconds && mtime_nanoseconds == other.mtime_nanoseconds &&
+                ctime_seconds == other.ctime_seconds && ctime_nanoseconds == other.ctime_nanoseconds;
+        }
+
+        bool operator!= (const FileIdentity & other) const
+        {
+            return ! operator== (other);
+        }
+    };
+
+    FileIdentity identity_of(const FSStat & s)
+    {
+        Timestamp mtime(s.mtim()), ctime(s.ctim());
+        return FileIdentity{ s.lowlevel_id().second, s.file_size(), mtime.seconds(), mtime.nanoseconds(),
+            ctime.seconds(), ctime.nanoseconds() };
+    }
+
+    bool trustworthy(const struct stat & st)
+    {
+        return st.st_uid == ::geteuid() && 0 == (st.st_mode & (S_IWGRP | S_IWOTH));
+    }
+
+    bool trustworthy_directory(const FSPath & dir)
+    {
+        struct stat st;
+        if (0 != ::lstat(stringify(dir).c_str(), &st))
+            throw FSError("Couldn't stat '" + stringify(dir) + "': " + std::strerror(errno));
+        return S_ISDIR(st.st_mode) && trustworthy(st);
+    }
+
+    /* returns -1 if the file exists but we mustn't trust it */
+    int open_trustworthy(const FSPath & f, const int flags)
+    {
+        int fd(::open(stringify(f).c_str(), flags | O_NOFOLLOW | O_CLOEXEC, 0600));
+        if (-1 == fd)
+        {
+            if (ELOOP == errno)
+                return -1;
+            throw FSError("Couldn't open '" + stringify(f) + "': " + std::strerror(errno));
+        }
+
+        struct stat st;
+        if (0 != ::fstat(fd, &st) || ! S_ISREG(st.st_mode) || ! trustworthy(st))
+        {
+            ::close(fd);
+            return -1;
+        }
+
+        return fd;
+    }
+
+    std::string line_for(const FileIdentity & i, const std::string & algo, const std::string & hexsum, const std::string & name)
+    {
+        return stringify(i.inode) + " " + stringify(i.size) + " " +
+            stringify(i.mtime_seconds) + " " + stringify(i.mtime_nanoseconds) + " " +
+            stringify(i.ctime_seconds) + " " + stringify(i.ctime_nanoseconds) + " " +
+            algo + " " + hexsum + " " + name + "\n";
+    }
+
+    /* the mutex is held whilst hashing, so two threads wanting the same file
+     * don't both read it, but unrelated files are hashed concurrently */
+    struct FileHashes
+    {
+        std::mutex mutex;
+        FileIdentity identity;
+        std::map<std::string, std::string> hashes;
+        std::set<std::string> remembered;
+
+        FileHashes() :
+            identity{ 0, 0, 0, 0, 0, 0 }
+        {
+        }
+    };
+
+    struct Shard
+    {
+        std::mutex mutex;
+        std::unordered_map<std::string, std::shared_ptr<FileHashes>, Hash<std::string> > files;
+    };
 
+    const unsigned shard_count(64);
+
+    struct HashesDirectory
+    {
+        const FSPath cache_file;
+        std::once_flag loaded;
+        std::mutex append_mutex;
+        bool usable;
+
+        HashesDirectory(const FSPath & d) :
+            cache_file(d / ".paludis-cache" / "hashes"),
+            usable(true)
+        {
+        }
+    };
+}
+
+namespace paludis
+{
     template <>
     struct Imp<MemoisedHashes>
     {
-        mutable std::mutex mutex;
-        mutable HashesMap hashes;
+        mutable Shard shards[shard_count];
+
+        mutable std::mutex directories_mutex;
+        mutable std::map<std::string, std::shared_ptr<HashesDirectory> > directories;
 
         Imp()
         {
         }
+
+        std::shared_ptr<FileHashes> file_hashes(const std::string & f) const
+        {
+            Shard & shard(shards[Hash<std::string>()(f) % shard_count]);
+            std::unique_lock<std::mutex> lock(shard.mutex);
+            std::shared_ptr<FileHashes> & result(shard.files[f]);
+            if (! result)
+                result = std::make_shared<FileHashes>();
+            return result;
+        }
+
+        void load(HashesDirectory & d, const FSPath & dir) const;
+        std::shared_ptr<HashesDirectory> directory(const FSPath & dir) const;
+        void append(HashesDirectory & d, const std::string & lines) const;
     };
 }
 
+void
+Imp<MemoisedHashes>::load(HashesDirectory & d, const FSPath & dir) const
+{
+    Context context("When loading remembered hashes from '" + stringify(d.cache_file) + "':");
+
+    unsigned line_count(0);
+    std::map<std::pair<std::string, std::string>, std::pair<FileIdentity, std::string> > latest;
+
+    try
+    {
+        if (! d.cache_file.dirname().stat().exists())
+            return;
+
+        int fd(-1);
+        if (! trustworthy_directory(d.cache_file.dirname()) ||
+                (d.cache_file.stat().exists() && -1 == ((fd = open_trustworthy(d.cache_file, O_RDONLY)))))
+        {
+            Log::get_instance()->message("e.memoised_hashes.untrusted", ll_warning, lc_context)
+                << "Ignoring '" << d.cache_file << "' because it or its directory could have been written by someone else";
+            d.usable = false;
+            return;
+        }
+
+        if (-1 == fd)
+            return;
+
+        std::shared_ptr<void> close_fd(nullptr, [fd] (void *) { ::close(fd); });
+        SafeIFStream f(fd);
+
+        std::string line;
+        if ((! std::getline(f, line)) || line != cache_format)
+        {
+            /* otherwise we'd keep appending to something we never read */
+            Log::get_instance()->message("e.memoised_hashes.bad_format", ll_debug, lc_context)
+                << "Removing '" << d.cache_file << "' because it has an unknown format";
+            d.cache_file.unlink();
+            return;
+        }
+
+        while (std::getline(f, line))
+        {
+            std::istringstream s(line);
+            FileIdentity identity;
+            std::string algo, hexsum, name;
+            if (! (s >> identity.inode >> identity.size >> identity.mtime_seconds >> identity.mtime_nanoseconds
+                        >> identity.ctime_seconds >> identity.ctime_nanoseconds >> algo >> hexsum))
+                continue;
+            s.get();
+            if (! std::getline(s, name) || name.empty())
+                continue;
+
+            ++line_count;
+            latest[std::make_pair(name, algo)] = std::make_pair(identity, hexsum);
+        }
+    }
+    catch (const Exception & e)
+    {
+        Log::get_instance()->message("e.memoised_hashes.load_failure", ll_warning, lc_context)
+            << "Couldn't load '" << d.cache_file << "': '" << e.message() << "' (" << e.what() << ")";
+        return;
+    }
+
+    for (auto l(latest.begin()), l_end(latest.end()) ;
+            l != l_end ; ++l)
+    {
+        std::shared_ptr<FileHashes> h(file_hashes(stringify(dir / l->first.first)));
+        std::unique_lock<std::mutex> lock(h->mutex);
+        if (h->hashes.empty() || h->identity != l->second.first)
+        {
+            h->hashes.clear();
+            h->remembered.clear();
+            h->identity = l->second.first;
+        }
+        if (h->hashes.insert(std::make_pair(l->first.second, l->second.second)).second)
+            h->remembered.insert(l->first.second);
+    }
+
+    /* the file only grows, so throw away superseded lines once there are
+     * lots of them. anything another process appends between our reading the
+     * file and the rename is lost, but that only costs a rehash later. */
+    if (line_count > 2 * latest.size() + 64)
+    {
+        std::string data(cache_format + "\n");
+        for (auto l(latest.begin()), l_end(latest.end()) ;
+                l != l_end ; ++l)
+            data.append(line_for(l->second.first, l->first.second, l->second.second, l->first.first));
+
+        try
+        {
+            FSPath temp(d.cache_file.dirname() / ("." + d.cache_file.basename() + ".tmp." + stringify(::getpid())));
+            temp.unlink();
+            int fd(::open(stringify(temp).c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600));
+            if (-1 == fd)
+                throw FSError("Couldn't open '" + stringify(temp) + "': " + std::strerror(errno));
+            ssize_t written(::write(fd, data.data(), data.length()));
+            ::close(fd);
+            if (written != ssize_t(data.length()))
+                throw FSError("Couldn't write to '" + stringify(temp) + "'");
+            temp.rename(d.cache_file);
+        }
+        catch (const Exception & e)
+        {
+            Log::get_instance()->message("e.memoised_hashes.compact_failure", ll_debug, lc_context)
+                << "Couldn't compact '" << d.cache_file << "': '" << e.message() << "' (" << e.what() << ")";
+        }
+    }
+}
+
+std::shared_ptr<HashesDirectory>
+Imp<MemoisedHashes>::directory(const FSPath & dir) const
+{
+    std::shared_ptr<HashesDirectory> result;
+    {
+        std::unique_lock<std::mutex> lock(directories_mutex);
+        std::shared_ptr<HashesDirectory> & d(directories[stringify(dir)]);
+        if (! d)
+            d = std::make_shared<HashesDirectory>(dir);
+        result = d;
+    }
+
+    std::call_once(result->loaded, [&] () { load(*result, dir); });
+    return result;
+}
+
+void
+Imp<MemoisedHashes>::append(HashesDirectory & d, const std::string & lines) const
+{
+    std::unique_lock<std::mutex> lock(d.append_mutex);
+    if (! d.usable)
+        return;
+
+    try
+    {
+        d.cache_file.dirname().mkdir(0700, { fspmkdo_ok_if_exists });
+
+        bool is_new(! d.cache_file.stat().exists());
+        int fd(-1);
+        if ((! trustworthy_directory(d.cache_file.dirname())) ||
+                -1 == ((fd = open_trustworthy(d.cache_file, O_WRONLY | O_APPEND | O_CREAT))))
+            throw FSError("Not writing to '" + stringify(d.cache_file) + "' because someone else could write to it or its directory");
+
+        /* one write per call, so concurrent appenders don't interleave */
+        std::string data((is_new ? cache_format + "\n" : "") + lines);
+        ssize_t written(::write(fd, data.data(), data.length()));
+        ::close(fd);
+        if (written != ssize_t(data.length()))
+            throw FSError("Couldn't write to '" + stringify(d.cache_file) + "'");
+    }
+    catch (const FSError & e)
+    {
+        Log::get_instance()->message("e.memoised_hashes.save_failure", ll_debug, lc_context)
+            << "Not remembering hashes in '" << d.cache_file << "': '" << e.message() << "' (" << e.what() << ")";
+        d.usable = false;
+    }
+}
+
 MemoisedHashes::MemoisedHashes() :
     _imp()
 {
@@ -60,26 +380,79 @@ MemoisedHashes::~MemoisedHashes()
 const std::string
 MemoisedHashes::get(const std::string & algo, const FSPath & file, SafeIFStream & stream) const
 {
-    std::pair<std::string, std::string> key(stringify(file), algo);
-    Timestamp mtime(file.stat().mtim());
+    auto result(get_all(std::vector<std::string>{ algo }, file, stream, true));
+    auto i(result.find(algo));
+    if (result.end() == i)
+        throw InternalError(PALUDIS_HERE, "Unsupported digest algorithm '" + algo + "'");
+    return i->second;
+}
+
+const std::map<std::string, std::string>
+MemoisedHashes::get_all(const std::vector<std::string> & algos, const FSPath & file, SafeIFStream & stream,
+        const bool use_remembered) const
+{
+    const FileIdentity identity(identity_of(file.stat()));
+    const std::shared_ptr<HashesDirectory> directory(_imp->directory(file.dirname()));
+    const std::shared_ptr<FileHashes> file_hashes(_imp->file_hashes(stringify(file)));
 
-    std::unique_lock<std::mutex> lock(_imp->mutex);
+    std::map<std::string, std::string> result;
+    std::map<std::string, std::shared_ptr<Digester> > digesters;
 
-    HashesMap::iterator i(_imp->hashes.find(key));
+    std::unique_lock<std::mutex> lock(file_hashes->mutex);
 
-    if (i == _imp->hashes.end() || i->second.first != mtime)
+    if (file_hashes->identity != identity)
     {
-        std::pair<Timestamp, std::string> value(std::make_pair(mtime, DigestRegistry::get_instance()->get(algo)(stream)));
-        stream.clear();
-        stream.seekg(0, std::ios::beg);
+        file_hashes->hashes.clear();
+        file_hashes->remembered.clear();
+        file_hashes->identity = identity;
+    }
 
-        if (i != _imp->hashes.end())
-            i->second = value;
+    for (auto a(algos.begin()), a_end(algos.end()) ;
+            a != a_end ; ++a)
+    {
+        auto i(file_hashes->hashes.find(*a));
+        if (i != file_hashes->hashes.end() && (use_remembered || ! file_hashes->remembered.count(*a)))
+            result.insert(*i);
         else
-            i = _imp->hashes.insert(std::make_pair(key, value)).first;
+        {
+            auto digester(DigestRegistry::get_instance()->make_digester(*a));
+            if (digester)
+                digesters.insert(std::make_pair(*a, digester));
+        }
     }
 
-    return i->second.second;
+    if (digesters.empty())
+        return result;
+
+    /* feed each chunk to every digest whilst it's still in cache, rather than
+     * reading the whole file once per algorithm */
+    const std::streamsize chunk_size(1 << 18);
+    std::unique_ptr<char[]> chunk(new char[chunk_size]);
+    std::streambuf * const buf(stream.rdbuf());
+
+    std::streamsize got;
+    while (0 < (got = buf->sgetn(chunk.get(), chunk_size)))
+        for (auto d(digesters.begin()), d_end(digesters.end()) ;
+                d != d_end ; ++d)
+            d->second->update(chunk.get(), got);
+
+    stream.clear();
+    stream.seekg(0, std::ios::beg);
+
+    std::string lines;
+    for (auto d(digesters.begin()), d_end(digesters.end()) ;
+            d != d_end ; ++d)
+    {
+        std::string hexsum(d->second->finish());
+        file_hashes->hashes[d->first] = hexsum;
+        file_hashes->remembered.erase(d->first);
+        result.insert(std::make_pair(d->first, hexsum));
+        lines.append(line_for(identity, d->first, hexsum, file.basename()));
+    }
+
+    _imp->append(*directory, lines);
+
+    return result;
 }
 
 namespace paludis
@@ -25,11 +25,23 @@
 #include <paludis/util/fs_path-fwd.hh>
 #include <paludis/util/safe_ifstream-fwd.hh>
 #include <string>
+#include <vector>
+#include <map>
 
 namespace paludis
 {
     namespace erepository
     {
+        /**
+         * Remembers the hashes of files, such as distfiles, so that they are
+         * only calculated once for each version of each file.
+         *
+         * Hashes are kept on disk too, in a '.paludis-cache' directory
+         * alongside the files being hashed, so later processes can reuse
+         * them. Files are identified by path, inode, size, modification
+         * time and change time. Hashes remembered on disk are only used if
+         * nobody but us could have written them.
+         */
         class PALUDIS_VISIBLE MemoisedHashes :
             public Singleton<MemoisedHashes>
         {
@@ -40,6 +52,21 @@ namespace paludis
 
                 const std::string get(const std::string & algo, const FSPath & file, SafeIFStream & stream) const;
 
+                /**
+                 * Get several hashes of a file at once. Any which we don't
+                 * already know are calculated together, so the file is only
+                 * read once however many algorithms are wanted. Unsupported
+                 * algorithms are left out of the result.
+                 *
+                 * If use_remembered is false, hashes loaded from disk are
+                 * recalculated rather than trusted, which is what we want
+                 * when writing a Manifest.
+                 *
+                 * \since 2.2.0
+                 */
+                const std::map<std::string, std::string> get_all(const std::vector<std::string> & algos,
+                        const FSPath & file, SafeIFStream & stream, const bool use_remembered) const;
+
             private:
                 MemoisedHashes();
                 ~MemoisedHashes();
@@ -0,0 +1,170 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/repositories/e/memoised_hashes.hh>
+
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/fs_stat.hh>
+#include <paludis/util/timestamp.hh>
+#include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/safe_ofstream.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/options.hh>
+
+#include <gtest/gtest.h>
+
+using namespace paludis;
+using namespace paludis::erepository;
+
+namespace
+{
+    void remember(const FSPath & dir, const std::string & lines, const mode_t dir_mode, const mode_t file_mode)
+    {
+        (dir / ".paludis-cache").mkdir(dir_mode, { fspmkdo_ok_if_exists });
+        (dir / ".paludis-cache").chmod(dir_mode);
+        {
+            SafeOFStream s(dir / ".paludis-cache" / "hashes", -1, true);
+            s << "paludis-hashes-2" << std::endl << lines;
+        }
+        (dir / ".paludis-cache" / "hashes").chmod(file_mode);
+    }
+
+    std::string identity_of(const FSPath & f)
+    {
+        FSStat f_stat(f);
+        return stringify(f_stat.lowlevel_id().second) + " " + stringify(f_stat.file_size()) + " " +
+            stringify(f_stat.mtim().seconds()) + " " + stringify(f_stat.mtim().nanoseconds()) + " " +
+            stringify(f_stat.ctim().seconds()) + " " + stringify(f_stat.ctim().nanoseconds());
+    }
+
+    std::vector<std::string> lines_of(const FSPath & f)
+    {
+        std::vector<std::string> result;
+        SafeIFStream s(f);
+        std::string line;
+        while (std::getline(s, line))
+            result.push_back(line);
+        return result;
+    }
+}
+
+TEST(MemoisedHashes, Works)
+{
+    FSPath dir(FSPath::cwd() / "memoised_hashes_TEST_dir" / "plain");
+    FSPath f(dir / "distfile");
+
+    {
+        SafeIFStream s(f);
+        auto sums(MemoisedHashes::get_instance()->get_all({ "MD5", "SHA256", "NOT_A_HASH" }, f, s, true));
+        EXPECT_EQ(2u, sums.size());
+        EXPECT_EQ("900150983cd24fb0d6963f7d28e17f72", sums["MD5"]);
+        EXPECT_EQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", sums["SHA256"]);
+        EXPECT_EQ("900150983cd24fb0d6963f7d28e17f72", MemoisedHashes::get_instance()->get("MD5", f, s));
+    }
+
+    EXPECT_EQ(0u, (dir / ".paludis-cache").stat().permissions() & 077);
+    EXPECT_EQ(0u, (dir / ".paludis-cache" / "hashes").stat().permissions() & 077);
+
+    auto lines(lines_of(dir / ".paludis-cache" / "hashes"));
+    ASSERT_EQ(3u, lines.size());
+    EXPECT_EQ("paludis-hashes-2", lines[0]);
+    EXPECT_NE(std::string::npos, lines[1].find(" MD5 900150983cd24fb0d6963f7d28e17f72 distfile"));
+    EXPECT_NE(std::string::npos, lines[2].find(" SHA256 ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad distfile"));
+
+    {
+        SafeOFStream s(f, -1, true);
+        s << "abcd";
+    }
+
+    {
+        SafeIFStream s(f);
+        EXPECT_EQ("e2fc714c4727ee9395f324cd2e7f331f", MemoisedHashes::get_instance()->get("MD5", f, s));
+    }
+
+    EXPECT_EQ(4u, lines_of(dir / ".paludis-cache" / "hashes").size());
+}
+
+TEST(MemoisedHashes, Remembered)
+{
+    FSPath dir(FSPath::cwd() / "memoised_hashes_TEST_dir" / "remembered");
+    FSPath f(dir / "distfile");
+
+    remember(dir,
+            "1 2 3 4 5 6 MD5 stale distfile\n" +
+            identity_of(f) + " MD5 remembered distfile\n"
+            "1 2 3 4 5 6 MD5 unrelated other\n", 0700, 0600);
+
+    SafeIFStream s(f);
+    auto sums(MemoisedHashes::get_instance()->get_all({ "MD5", "SHA256" }, f, s, true));
+    EXPECT_EQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", sums["SHA256"]);
+    EXPECT_EQ("remembered", sums["MD5"]);
+}
+
+TEST(MemoisedHashes, NotForManifests)
+{
+    FSPath dir(FSPath::cwd() / "memoised_hashes_TEST_dir" / "not_for_manifests");
+    FSPath f(dir / "distfile");
+
+    remember(dir, identity_of(f) + " MD5 remembered distfile\n", 0700, 0600);
+
+    SafeIFStream s(f);
+    EXPECT_EQ("900150983cd24fb0d6963f7d28e17f72",
+            MemoisedHashes::get_instance()->get_all({ "MD5" }, f, s, false).at("MD5"));
+    EXPECT_EQ("900150983cd24fb0d6963f7d28e17f72",
+            MemoisedHashes::get_instance()->get_all({ "MD5" }, f, s, true).at("MD5"));
+}
+
+TEST(MemoisedHashes, UntrustedDirectory)
+{
+    FSPath dir(FSPath::cwd() / "memoised_hashes_TEST_dir" / "untrusted_directory");
+    FSPath f(dir / "distfile");
+
+    remember(dir, identity_of(f) + " MD5 forged distfile\n", 0770, 0600);
+
+    SafeIFStream s(f);
+    EXPECT_EQ("900150983cd24fb0d6963f7d28e17f72", MemoisedHashes::get_instance()->get("MD5", f, s));
+    EXPECT_EQ(2u, lines_of(dir / ".paludis-cache" / "hashes").size());
+}
+
+TEST(MemoisedHashes, UntrustedFile)
+{
+    FSPath dir(FSPath::cwd() / "memoised_hashes_TEST_dir" / "untrusted_file");
+    FSPath f(dir / "distfile");
+
+    remember(dir, identity_of(f) + " MD5 forged distfile\n", 0700, 0622);
+
+    SafeIFStream s(f);
+    EXPECT_EQ("900150983cd24fb0d6963f7d28e17f72", MemoisedHashes::get_instance()->get("MD5", f, s));
+    EXPECT_EQ(2u, lines_of(dir / ".paludis-cache" / "hashes").size());
+}
+
+TEST(MemoisedHashes, ChangedCtime)
+{
+    FSPath dir(FSPath::cwd() / "memoised_hashes_TEST_dir" / "changed_ctime");
+    FSPath f(dir / "distfile");
+
+    FSStat f_stat(f);
+    remember(dir, stringify(f_stat.lowlevel_id().second) + " " + stringify(f_stat.file_size()) + " " +
+            stringify(f_stat.mtim().seconds()) + " " + stringify(f_stat.mtim().nanoseconds()) + " " +
+            stringify(f_stat.ctim().seconds() - 1) + " " + stringify(f_stat.ctim().nanoseconds()) +
+            " MD5 rewritten distfile\n", 0700, 0600);
+
+    SafeIFStream s(f);
+    EXPECT_EQ("900150983cd24fb0d6963f7d28e17f72", MemoisedHashes::get_instance()->get("MD5", f, s));
+}
@@ -0,0 +1,12 @@
+#!/usr/bin/env bash
+# vim: set ft=sh sw=4 sts=4 et :
+
+mkdir -p memoised_hashes_TEST_dir/{plain,remembered,not_for_manifests,untrusted_directory,untrusted_file,changed_ctime} || exit 1
+cd memoised_hashes_TEST_dir || exit 1
+
+printf abc > plain/distfile || exit 1
+printf abc > remembered/distfile || exit 1
+printf abc > not_for_manifests/distfile || exit 1
+printf abc > untrusted_directory/distfile || exit 1
+printf abc > untrusted_file/distfile || exit 1
+printf abc > changed_ctime/distfile || exit 1
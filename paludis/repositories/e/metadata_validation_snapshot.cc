@@ -0,0 +1,164 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/repositories/e/metadata_validation_snapshot.hh>
+
+#include <paludis/util/pimp-impl.hh>
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/fs_stat.hh>
+#include <paludis/util/fs_error.hh>
+#include <paludis/util/log.hh>
+#include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/safe_ofstream.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/hashes.hh>
+
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+#include <unistd.h>
+
+using namespace paludis;
+using namespace paludis::erepository;
+
+namespace
+{
+    const std::string format_version("paludis-metadata-validation-1");
+}
+
+namespace paludis
+{
+    template <>
+    struct Imp<MetadataValidationSnapshot>
+    {
+        const FSPath location;
+        const std::string state;
+
+        mutable std::mutex mutex;
+        std::unordered_set<std::string, Hash<std::string> > valid;
+
+        Imp(const FSPath & l, const std::string & s) :
+            location(l),
+            state(s)
+        {
+        }
+    };
+}
+
+MetadataValidationSnapshot::MetadataValidationSnapshot(const FSPath & l, const std::string & s) :
+    _imp(l, s)
+{
+    Context context("When loading metadata validation snapshot '" + stringify(l) + "':");
+
+    try
+    {
+        if (! l.stat().is_regular_file())
+            return;
+
+        SafeIFStream f(l);
+        std::string line;
+        if ((! std::getline(f, line)) || line != format_version)
+        {
+            Log::get_instance()->message("e.validation_snapshot.bad_version", ll_debug, lc_context)
+                << "Ignoring '" << l << "' because it has an unknown format";
+            return;
+        }
+
+        if ((! std::getline(f, line)) || line != s)
+        {
+            Log::get_instance()->message("e.validation_snapshot.stale", ll_debug, lc_context)
+                << "Ignoring '" << l << "' because the repository has changed since it was made";
+            return;
+        }
+
+        while (std::getline(f, line))
+            _imp->valid.insert(line);
+    }
+    catch (const Exception & e)
+    {
+        Log::get_instance()->message("e.validation_snapshot.failure", ll_warning, lc_context)
+            << "Couldn't load '" << l << "': '" << e.message() << "' (" << e.what() << ")";
+        _imp->valid.clear();
+    }
+}
+
+MetadataValidationSnapshot::~MetadataValidationSnapshot()
+{
+}
+
+bool
+MetadataValidationSnapshot::known_valid(const FSPath & f) const
+{
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+    return _imp->valid.end() != _imp->valid.find(stringify(f));
+}
+
+void
+MetadataValidationSnapshot::add(const FSPath & f)
+{
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+    _imp->valid.insert(stringify(f));
+}
+
+void
+MetadataValidationSnapshot::write() const
+{
+    Context context("When saving metadata validation snapshot '" + stringify(_imp->location) + "':");
+
+    if (! _imp->location.dirname().stat().is_directory())
+        return;
+
+    std::string data(format_version + "\n" + _imp->state + "\n");
+    {
+        std::unique_lock<std::mutex> lock(_imp->mutex);
+        for (auto v(_imp->valid.begin()), v_end(_imp->valid.end()) ;
+                v != v_end ; ++v)
+            data.append(*v + "\n");
+    }
+
+    /* write to a temporary file first, so other processes never see half a
+     * snapshot */
+    FSPath temp(_imp->location.dirname() / ("." + _imp->location.basename() + ".tmp." + stringify(::getpid())));
+    {
+        SafeOFStream f(temp, -1, true);
+        f << data;
+    }
+    temp.rename(_imp->location);
+}
+
+void
+MetadataValidationSnapshot::invalidate(const FSPath & l)
+{
+    try
+    {
+        if (l.stat().exists())
+            l.unlink();
+    }
+    catch (const FSError & e)
+    {
+        Log::get_instance()->message("e.validation_snapshot.invalidate_failed", ll_warning, lc_context)
+            << "Couldn't remove metadata validation snapshot '" << l << "': '" << e.message() << "' (" << e.what() << ")";
+    }
+}
+
+namespace paludis
+{
+    template class Pimp<MetadataValidationSnapshot>;
+}
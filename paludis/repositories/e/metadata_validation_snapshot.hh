@@ -0,0 +1,87 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_REPOSITORIES_E_METADATA_VALIDATION_SNAPSHOT_HH
+#define PALUDIS_GUARD_PALUDIS_REPOSITORIES_E_METADATA_VALIDATION_SNAPSHOT_HH 1
+
+#include <paludis/util/pimp.hh>
+#include <paludis/util/fs_path-fwd.hh>
+#include <paludis/util/attributes.hh>
+#include <string>
+
+namespace paludis
+{
+    namespace erepository
+    {
+        /**
+         * Remembers which metadata cache entries for a repository were
+         * found to be valid, so that we do not have to stat ebuilds and
+         * eclasses to check them again until the repository changes.
+         *
+         * The snapshot is tied to a state string describing the repository,
+         * and anything recorded under a different state is ignored. Syncing
+         * the repository removes the snapshot.
+         *
+         * \ingroup grperepository
+         * \nosubgrouping
+         */
+        class PALUDIS_VISIBLE MetadataValidationSnapshot
+        {
+            private:
+                Pimp<MetadataValidationSnapshot> _imp;
+
+            public:
+                ///\name Basic operations
+                ///\{
+
+                MetadataValidationSnapshot(const FSPath & location, const std::string & state);
+                ~MetadataValidationSnapshot();
+
+                MetadataValidationSnapshot(const MetadataValidationSnapshot &) = delete;
+                MetadataValidationSnapshot & operator= (const MetadataValidationSnapshot &) = delete;
+
+                ///\}
+
+                /**
+                 * Was the given cache file (or binary cache entry, named as if
+                 * it were a file) valid when the snapshot was made?
+                 */
+                bool known_valid(const FSPath &) const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Record that a cache file has been validated.
+                 */
+                void add(const FSPath &);
+
+                /**
+                 * Save everything known to be valid.
+                 */
+                void write() const;
+
+                /**
+                 * Throw away any saved snapshot at the given location.
+                 */
+                static void invalidate(const FSPath & location);
+        };
+    }
+
+    extern template class Pimp<erepository::MetadataValidationSnapshot>;
+}
+
+#endif
@@ -0,0 +1,373 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/repositories/e/metadata_worker_pool.hh>
+
+#include <paludis/util/pimp-impl.hh>
+#include <paludis/util/singleton-impl.hh>
+#include <paludis/util/map.hh>
+#include <paludis/util/log.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/destringify.hh>
+#include <paludis/util/tokeniser.hh>
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/safe_ifstream.hh>
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace paludis;
+using namespace paludis::erepository;
+
+namespace
+{
+    std::string quote(const std::string & s)
+    {
+        std::string result("'");
+        for (auto c(s.begin()), c_end(s.end()) ; c != c_end ; ++c)
+            if ('\'' == *c)
+                result.append("'\\''");
+            else
+                result.append(1, *c);
+        return result + "'";
+    }
+
+    void copy_file_to(const FSPath & f, std::ostream * const s)
+    {
+        SafeIFStream stream(f);
+        std::copy((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>(), std::ostreambuf_iterator<char>(*s));
+    }
+
+    struct Worker
+    {
+        const std::string key;
+        const std::shared_ptr<const Map<std::string, std::string> > startup_setenvs;
+
+        std::mutex mutex;
+        std::condition_variable condition;
+
+        ProcessPipeCommandFunction startup_pipe_command_handler;
+        const MetadataWorkerRequest * request;
+        bool request_taken, finished, dead, shutdown, handled_any_requests;
+        int exit_status;
+        std::string work_dir;
+
+        std::stringstream worker_stdout, worker_stderr;
+        std::unique_ptr<RunningProcessHandle> handle;
+        std::thread waiter;
+
+        Worker(const MetadataWorkerRequest & r) :
+            key(r.worker_key()),
+            startup_setenvs(r.setenvs()),
+            startup_pipe_command_handler(r.pipe_command_handler()),
+            request(nullptr),
+            request_taken(false),
+            finished(false),
+            dead(false),
+            shutdown(false),
+            handled_any_requests(false),
+            exit_status(0)
+        {
+        }
+
+        ~Worker()
+        {
+            stop();
+        }
+
+        void start(const MetadataWorkerRequest & r)
+        {
+            using namespace std::placeholders;
+
+            std::unique_ptr<Process> process(r.make_process()());
+            process->setenv("PALUDIS_EBUILD_SERVE_METADATA", "yes");
+            process->capture_stdout(worker_stdout);
+            process->capture_stderr(worker_stderr);
+            process->pipe_command_handler("PALUDIS_PIPE_COMMAND", std::bind(&Worker::handle_pipe_command, this, _1));
+
+            handle.reset(new RunningProcessHandle(process->run()));
+            waiter = std::thread(std::bind(&Worker::wait_for_exit, this));
+        }
+
+        void wait_for_exit()
+        {
+            try
+            {
+                int PALUDIS_ATTRIBUTE((unused)) status(handle->wait());
+            }
+            catch (const Exception &)
+            {
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            dead = true;
+            condition.notify_all();
+        }
+
+        void stop()
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                shutdown = true;
+                condition.notify_all();
+            }
+
+            if (waiter.joinable())
+                waiter.join();
+
+            /* normally the worker tidies up after itself, but not if it died */
+            if (! work_dir.empty())
+            {
+                FSPath dir(work_dir);
+                (dir / "stdout").unlink();
+                (dir / "stderr").unlink();
+                (dir / "metadata").unlink();
+                dir.rmdir();
+                work_dir.clear();
+            }
+        }
+
+        std::string request_script(const MetadataWorkerRequest & r) const
+        {
+            std::string result;
+
+            for (auto m(startup_setenvs->begin()), m_end(startup_setenvs->end()) ;
+                    m != m_end ; ++m)
+                if (r.setenvs()->end() == r.setenvs()->find(m->first))
+                    result.append("unset -v " + m->first + "\n");
+
+            for (auto m(r.setenvs()->begin()), m_end(r.setenvs()->end()) ;
+                    m != m_end ; ++m)
+                result.append("export " + m->first + "=" + quote(m->second) + "\n");
+
+            result.append("paludis_request_ebuild=" + quote(r.ebuild_file()) + "\n");
+            result.append("paludis_request_commands=" + quote(r.commands()) + "\n");
+
+            return result;
+        }
+
+        std::string handle_pipe_command(const std::string & s)
+        {
+            std::vector<std::string> tokens;
+            tokenise<delim_kind::AnyOfTag, delim_mode::DelimiterTag>(s, "\2", "", std::back_inserter(tokens));
+
+            if ((! tokens.empty()) && tokens[0] == "METADATA_WORKER_NEXT")
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (tokens.size() >= 2)
+                    work_dir = tokens[1];
+                startup_pipe_command_handler = ProcessPipeCommandFunction();
+
+                condition.wait(lock, [&] () { return shutdown || (request && ! request_taken); });
+                if (shutdown)
+                    return "O";
+
+                request_taken = true;
+                return "O" + request_script(*request);
+            }
+            else if ((! tokens.empty()) && tokens[0] == "METADATA_WORKER_DONE")
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (2 != tokens.size())
+                    return "Ebad METADATA_WORKER_DONE command";
+
+                try
+                {
+                    exit_status = destringify<int>(tokens[1]);
+                }
+                catch (const DestringifyError &)
+                {
+                    exit_status = 1;
+                }
+
+                finished = true;
+                condition.notify_all();
+                return "O";
+            }
+            else
+            {
+                ProcessPipeCommandFunction handler;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    handler = request ? request->pipe_command_handler() : startup_pipe_command_handler;
+                }
+
+                if (! handler)
+                    return "Eno metadata request is active";
+                return handler(s);
+            }
+        }
+
+        int run(const MetadataWorkerRequest & r)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            request = &r;
+            request_taken = false;
+            finished = false;
+            condition.notify_all();
+
+            condition.wait(lock, [&] () { return finished || dead; });
+            request = nullptr;
+
+            if (! finished)
+            {
+                Log::get_instance()->message("e.ebuild.metadata_worker.died", ll_debug, lc_context)
+                    << "Metadata worker exited unexpectedly, stdout says '" << worker_stdout.str()
+                    << "' and stderr says '" << worker_stderr.str() << "'";
+                return -1;
+            }
+
+            handled_any_requests = true;
+            FSPath dir(work_dir);
+            copy_file_to(dir / "stdout", r.captured_stdout());
+            copy_file_to(dir / "stderr", r.captured_stderr());
+            copy_file_to(dir / "metadata", r.metadata());
+
+            return exit_status;
+        }
+    };
+}
+
+namespace paludis
+{
+    template <>
+    struct Imp<MetadataWorkerPool>
+    {
+        const unsigned max_idle;
+
+        std::mutex mutex;
+        std::list<std::shared_ptr<Worker> > idle;
+        std::set<std::string> broken_keys;
+
+        Imp() :
+            max_idle(std::max(2 * std::thread::hardware_concurrency(), 4u))
+        {
+        }
+    };
+}
+
+MetadataWorkerPool::MetadataWorkerPool() :
+    _imp()
+{
+}
+
+MetadataWorkerPool::~MetadataWorkerPool()
+{
+    stop_idle_workers();
+}
+
+void
+MetadataWorkerPool::stop_idle_workers()
+{
+    std::list<std::shared_ptr<Worker> > to_stop;
+    {
+        std::unique_lock<std::mutex> lock(_imp->mutex);
+        to_stop.swap(_imp->idle);
+    }
+
+    /* our workers stop and wait for their threads when destroyed, which we
+     * must not do whilst holding the lock */
+    to_stop.clear();
+}
+
+int
+MetadataWorkerPool::run(const MetadataWorkerRequest & request)
+{
+    std::shared_ptr<Worker> worker;
+
+    {
+        std::unique_lock<std::mutex> lock(_imp->mutex);
+        if (_imp->broken_keys.end() != _imp->broken_keys.find(request.worker_key()))
+            return -1;
+
+        for (auto i(_imp->idle.begin()), i_end(_imp->idle.end()) ; i != i_end ; ++i)
+            if ((*i)->key == request.worker_key())
+            {
+                worker = *i;
+                _imp->idle.erase(i);
+                break;
+            }
+    }
+
+    if (! worker)
+    {
+        worker = std::make_shared<Worker>(request);
+
+        try
+        {
+            worker->start(request);
+        }
+        catch (const Exception & e)
+        {
+            Log::get_instance()->message("e.ebuild.metadata_worker.start_failed", ll_debug, lc_context)
+                << "Couldn't start a metadata worker: '" << e.message() << "' (" << e.what() << ")";
+
+            std::unique_lock<std::mutex> lock(_imp->mutex);
+            _imp->broken_keys.insert(request.worker_key());
+            return -1;
+        }
+    }
+
+    int exit_status(-1);
+    try
+    {
+        exit_status = worker->run(request);
+    }
+    catch (const Exception & e)
+    {
+        Log::get_instance()->message("e.ebuild.metadata_worker.failed", ll_debug, lc_context)
+            << "Metadata worker failed: '" << e.message() << "' (" << e.what() << ")";
+    }
+
+    std::list<std::shared_ptr<Worker> > to_stop;
+    {
+        std::unique_lock<std::mutex> lock(_imp->mutex);
+        if (-1 == exit_status)
+        {
+            if (! worker->handled_any_requests)
+                _imp->broken_keys.insert(request.worker_key());
+            to_stop.push_back(worker);
+        }
+        else
+        {
+            _imp->idle.push_front(worker);
+            while (_imp->idle.size() > _imp->max_idle)
+            {
+                to_stop.push_back(_imp->idle.back());
+                _imp->idle.pop_back();
+            }
+        }
+    }
+
+    return exit_status;
+}
+
+namespace paludis
+{
+    template class Pimp<MetadataWorkerPool>;
+    template class Singleton<MetadataWorkerPool>;
+}
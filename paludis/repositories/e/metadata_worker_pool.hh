@@ -0,0 +1,130 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_REPOSITORIES_E_METADATA_WORKER_POOL_HH
+#define PALUDIS_GUARD_PALUDIS_REPOSITORIES_E_METADATA_WORKER_POOL_HH 1
+
+#include <paludis/util/pimp.hh>
+#include <paludis/util/singleton.hh>
+#include <paludis/util/map-fwd.hh>
+#include <paludis/util/process.hh>
+#include <paludis/util/named_value.hh>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+namespace paludis
+{
+    namespace n
+    {
+        typedef Name<struct name_captured_stderr> captured_stderr;
+        typedef Name<struct name_captured_stdout> captured_stdout;
+        typedef Name<struct name_commands> commands;
+        typedef Name<struct name_ebuild_file> ebuild_file;
+        typedef Name<struct name_make_process> make_process;
+        typedef Name<struct name_metadata> metadata;
+        typedef Name<struct name_pipe_command_handler> pipe_command_handler;
+        typedef Name<struct name_setenvs> setenvs;
+        typedef Name<struct name_worker_key> worker_key;
+    }
+
+    namespace erepository
+    {
+        /**
+         * A request to generate metadata using a persistent worker.
+         *
+         * \see MetadataWorkerPool
+         */
+        struct MetadataWorkerRequest
+        {
+            NamedValue<n::captured_stderr, std::ostream *> captured_stderr;
+            NamedValue<n::captured_stdout, std::ostream *> captured_stdout;
+            NamedValue<n::commands, std::string> commands;
+            NamedValue<n::ebuild_file, std::string> ebuild_file;
+
+            /**
+             * Used to start a new worker, if there is no idle worker with the
+             * right key. The process is told to act as a worker, and has its
+             * output and pipe commands redirected.
+             */
+            NamedValue<n::make_process, std::function<std::unique_ptr<Process> ()> > make_process;
+
+            NamedValue<n::metadata, std::ostream *> metadata;
+            NamedValue<n::pipe_command_handler, ProcessPipeCommandFunction> pipe_command_handler;
+
+            /**
+             * The environment variables our ebuild process would have been
+             * given.
+             */
+            NamedValue<n::setenvs, std::shared_ptr<const Map<std::string, std::string> > > setenvs;
+
+            /**
+             * Only workers started with the same key are reused. The key must
+             * capture anything that ebuild.bash looks at before it starts
+             * handling requests.
+             */
+            NamedValue<n::worker_key, std::string> worker_key;
+        };
+
+        /**
+         * Keeps a pool of long-lived ebuild.bash processes for metadata
+         * generation, so that we do not have to pay bash startup and module
+         * loading costs for every ebuild.
+         *
+         * Each worker loads its modules once, and then forks a fresh subshell
+         * for each request, so nothing an ebuild does can leak into the next
+         * request.
+         */
+        class PALUDIS_VISIBLE MetadataWorkerPool :
+            public Singleton<MetadataWorkerPool>
+        {
+            friend class Singleton<MetadataWorkerPool>;
+
+            private:
+                Pimp<MetadataWorkerPool> _imp;
+
+                MetadataWorkerPool();
+                ~MetadataWorkerPool();
+
+            public:
+                /**
+                 * Generate metadata using a worker, and return the exit status.
+                 *
+                 * Returns -1 if no worker could be used, in which case the
+                 * caller should run the command itself.
+                 */
+                int run(const MetadataWorkerRequest &) PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Stop every idle worker, and wait for it to exit.
+                 *
+                 * Each worker has threads watching it, so this must be done
+                 * before anything that needs us to be single threaded. New
+                 * workers are started as they are needed.
+                 */
+                void stop_idle_workers();
+        };
+    }
+
+    extern template class Pimp<erepository::MetadataWorkerPool>;
+    extern template class Singleton<erepository::MetadataWorkerPool>;
+}
+
+#endif
@@ -0,0 +1,202 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <paludis/repositories/e/metadata_worker_pool.hh>
+
+#include <paludis/util/map.hh>
+#include <paludis/util/make_named_values.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/destringify.hh>
+#include <paludis/util/system.hh>
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/fs_iterator.hh>
+#include <paludis/util/options.hh>
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <cstdlib>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+using namespace paludis;
+using namespace paludis::erepository;
+
+namespace
+{
+    std::string pipe_command(const std::string & command)
+    {
+        const int read_fd(destringify<int>(getenv_with_default("PALUDIS_PIPE_COMMAND_READ_FD", "")));
+        const int write_fd(destringify<int>(getenv_with_default("PALUDIS_PIPE_COMMAND_WRITE_FD", "")));
+
+        std::string data(command + '\0');
+        if (static_cast<ssize_t>(data.length()) != ::write(write_fd, data.data(), data.length()))
+            _exit(125);
+
+        std::string result;
+        char c;
+        while (1 == ::read(read_fd, &c, 1) && '\0' != c)
+            result.append(1, c);
+        return result;
+    }
+
+    /* speaks the same protocol as ebuild.bash's ebuild_serve_metadata, and
+     * reports our pid on stdout and the request script as the metadata */
+    int fake_worker()
+    {
+        char dir_template[] = "metadata_worker_pool_TEST_XXXXXX";
+        if (! ::mkdtemp(dir_template))
+            return 1;
+
+        FSPath dir(FSPath::cwd() / dir_template);
+        while (true)
+        {
+            std::string request(pipe_command("METADATA_WORKER_NEXT\2" + stringify(dir) + "\2"));
+            if (request.empty() || 'O' != request.at(0) || 1 == request.length())
+                break;
+
+            if (std::string::npos != request.find("paludis_request_commands='die'"))
+                _exit(1);
+
+            std::ofstream(stringify(dir / "stdout")) << getpid();
+            std::ofstream(stringify(dir / "stderr"));
+            std::ofstream(stringify(dir / "metadata")) << request.substr(1);
+
+            pipe_command("METADATA_WORKER_DONE\2" "0\2");
+        }
+
+        (dir / "stdout").unlink();
+        (dir / "stderr").unlink();
+        (dir / "metadata").unlink();
+        dir.rmdir();
+        return 0;
+    }
+
+    struct Result
+    {
+        int exit_status;
+        std::string pid;
+        std::string metadata;
+    };
+
+    Result run(const std::string & key, const std::string & commands)
+    {
+        std::stringstream captured_stdout, captured_stderr, metadata;
+        auto setenvs(std::make_shared<Map<std::string, std::string> >());
+        setenvs->insert("MONKEY", "giant space");
+
+        Result result;
+        result.exit_status = MetadataWorkerPool::get_instance()->run(make_named_values<MetadataWorkerRequest>(
+                    n::captured_stderr() = &captured_stderr,
+                    n::captured_stdout() = &captured_stdout,
+                    n::commands() = commands,
+                    n::ebuild_file() = "cat-pkg-1.ebuild",
+                    n::make_process() = [] () {
+                        return std::unique_ptr<Process>(new Process(ProcessCommand(std::function<int ()>(&fake_worker))));
+                    },
+                    n::metadata() = &metadata,
+                    n::pipe_command_handler() = [] (const std::string &) { return std::string("Eunexpected pipe command"); },
+                    n::setenvs() = setenvs,
+                    n::worker_key() = key
+                    ));
+        result.pid = captured_stdout.str();
+        result.metadata = metadata.str();
+        return result;
+    }
+
+    long n_threads()
+    {
+        return std::distance(FSIterator(FSPath("/proc/self/task"), { }), FSIterator());
+    }
+
+    long n_work_dirs()
+    {
+        long result(0);
+        for (FSIterator d(FSPath::cwd(), { }), d_end ; d != d_end ; ++d)
+            if (0 == d->basename().compare(0, 26, "metadata_worker_pool_TEST_"))
+                ++result;
+        return result;
+    }
+}
+
+TEST(MetadataWorkerPool, Reuse)
+{
+    MetadataWorkerPool::get_instance()->stop_idle_workers();
+
+    Result first(run("reuse-a", "metadata"));
+    EXPECT_EQ(0, first.exit_status);
+    EXPECT_FALSE(first.pid.empty());
+    EXPECT_NE(std::string::npos, first.metadata.find("export MONKEY='giant space'"));
+    EXPECT_NE(std::string::npos, first.metadata.find("paludis_request_ebuild='cat-pkg-1.ebuild'"));
+
+    Result second(run("reuse-a", "metadata"));
+    EXPECT_EQ(0, second.exit_status);
+    EXPECT_EQ(first.pid, second.pid);
+
+    Result other(run("reuse-b", "metadata"));
+    EXPECT_EQ(0, other.exit_status);
+    EXPECT_NE(first.pid, other.pid);
+}
+
+TEST(MetadataWorkerPool, Dies)
+{
+    MetadataWorkerPool::get_instance()->stop_idle_workers();
+
+    Result first(run("dies", "metadata"));
+    EXPECT_EQ(0, first.exit_status);
+
+    Result died(run("dies", "die"));
+    EXPECT_EQ(-1, died.exit_status);
+
+    Result again(run("dies", "metadata"));
+    EXPECT_EQ(0, again.exit_status);
+    EXPECT_FALSE(again.pid.empty());
+    EXPECT_NE(first.pid, again.pid);
+}
+
+TEST(MetadataWorkerPool, DiesOnFirstRequest)
+{
+    MetadataWorkerPool::get_instance()->stop_idle_workers();
+
+    EXPECT_EQ(-1, run("broken", "die").exit_status);
+    EXPECT_EQ(-1, run("broken", "metadata").exit_status);
+}
+
+TEST(MetadataWorkerPool, Stop)
+{
+    MetadataWorkerPool::get_instance()->stop_idle_workers();
+    const long threads_before(n_threads());
+
+    Result first(run("stop", "metadata"));
+    EXPECT_EQ(0, first.exit_status);
+    EXPECT_LT(threads_before, n_threads());
+
+    MetadataWorkerPool::get_instance()->stop_idle_workers();
+    EXPECT_EQ(threads_before, n_threads());
+    EXPECT_EQ(0, n_work_dirs());
+
+    Result second(run("stop", "metadata"));
+    EXPECT_EQ(0, second.exit_status);
+    EXPECT_NE(first.pid, second.pid);
+
+    MetadataWorkerPool::get_instance()->stop_idle_workers();
+}
+
@@ -0,0 +1,436 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/repositories/e/owners_index.hh>
+#include <paludis/repositories/e/mapped_index_file.hh>
+
+#include <paludis/util/pimp-impl.hh>
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/fs_stat.hh>
+#include <paludis/util/log.hh>
+#include <paludis/util/exception.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/timestamp.hh>
+#include <paludis/util/options.hh>
+#include <paludis/util/sequence.hh>
+#include <paludis/util/wrapped_forward_iterator.hh>
+#include <paludis/util/indirect_iterator-impl.hh>
+#include <paludis/contents.hh>
+#include <paludis/metadata_key.hh>
+#include <paludis/name.hh>
+#include <paludis/package_id.hh>
+#include <paludis/repository.hh>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <vector>
+
+using namespace paludis;
+using namespace paludis::erepository;
+
+/*
+ * File layout, all integers in native byte order and all offsets from the
+ * start of the file:
+ *
+ *     Header
+ *     Watch[header.watch_count]
+ *     Owner[header.owner_count]
+ *     Record[header.record_count], sorted by path
+ *     uint32_t[header.record_count], record numbers sorted by basename
+ *     string data
+ */
+
+namespace
+{
+    const char magic[8] = { 'P', 'A', 'L', 'O', 'W', 'N', '0', '1' };
+
+    struct Header
+    {
+        MappedIndexFileHeader prefix;
+        uint32_t watch_count;
+        uint32_t owner_count;
+        uint32_t record_count;
+    };
+
+    struct Watch
+    {
+        uint32_t path_offset, path_length;
+        int64_t seconds, nanoseconds;
+    };
+
+    struct Owner
+    {
+        uint32_t name_offset, name_length;
+        uint32_t location_offset, location_length;
+        int64_t seconds, nanoseconds;
+    };
+
+    struct Record
+    {
+        uint32_t path_offset, path_length;
+        uint32_t basename_offset;
+        uint32_t owner;
+    };
+
+    struct StringRef
+    {
+        const char * data;
+        std::size_t length;
+
+        int compare(const std::string & s) const
+        {
+            int c(std::memcmp(data, s.data(), std::min(length, s.length())));
+            if (0 != c)
+                return c;
+            return length < s.length() ? -1 : length > s.length() ? 1 : 0;
+        }
+
+        bool starts_with(const std::string & s) const
+        {
+            return length >= s.length() && 0 == std::memcmp(data, s.data(), s.length());
+        }
+
+        bool contains(const std::string & s) const
+        {
+            return data + length != std::search(data, data + length, s.begin(), s.end());
+        }
+    };
+}
+
+namespace paludis
+{
+    template <>
+    struct Imp<OwnersIndex>
+    {
+        const FSPath location;
+        const MappedIndexFile file;
+
+        const char * data;
+        std::size_t size;
+
+        const Header * header;
+        const Watch * watches;
+        const Owner * owners;
+        const Record * records;
+        const uint32_t * by_basename;
+
+        bool stale;
+
+        Imp(const FSPath & l) :
+            location(l),
+            file(l, magic, sizeof(Header), "owners index"),
+            data(file.data()),
+            size(file.size()),
+            header(nullptr),
+            watches(nullptr),
+            owners(nullptr),
+            records(nullptr),
+            by_basename(nullptr),
+            stale(false)
+        {
+        }
+
+        StringRef string_at(uint32_t offset, uint32_t length) const
+        {
+            if (offset > size || length > size - offset)
+                return StringRef{ data, 0 };
+            return StringRef{ data + offset, length };
+        }
+
+        StringRef path(const Record & r) const
+        {
+            return string_at(r.path_offset, r.path_length);
+        }
+
+        StringRef basename(const Record & r) const
+        {
+            if (r.basename_offset > r.path_length)
+                return StringRef{ data, 0 };
+            return string_at(r.path_offset + r.basename_offset, r.path_length - r.basename_offset);
+        }
+
+        void add_owner(const Record & r, std::map<std::string, std::string> & result) const
+        {
+            if (r.owner >= header->owner_count)
+                return;
+
+            const Owner & o(owners[r.owner]);
+            StringRef n(string_at(o.name_offset, o.name_length)), l(string_at(o.location_offset, o.location_length));
+            result.insert(std::make_pair(std::string(l.data, l.length), std::string(n.data, n.length)));
+        }
+    };
+}
+
+OwnersIndex::OwnersIndex(const FSPath & l) :
+    _imp(l)
+{
+    Context context("When opening owners index '" + stringify(l) + "':");
+
+    if (! _imp->data)
+        return;
+
+    const Header * header(reinterpret_cast<const Header *>(_imp->data));
+    if (! _imp->file.check_size(sizeof(Header) + uint64_t(header->watch_count) * sizeof(Watch) +
+            uint64_t(header->owner_count) * sizeof(Owner) + uint64_t(header->record_count) * (sizeof(Record) + sizeof(uint32_t))))
+        return;
+
+    _imp->header = header;
+    _imp->watches = reinterpret_cast<const Watch *>(_imp->data + sizeof(Header));
+    _imp->owners = reinterpret_cast<const Owner *>(_imp->watches + header->watch_count);
+    _imp->records = reinterpret_cast<const Record *>(_imp->owners + header->owner_count);
+    _imp->by_basename = reinterpret_cast<const uint32_t *>(_imp->records + header->record_count);
+
+    for (const Watch * w(_imp->watches), * w_end(w + header->watch_count) ;
+            w != w_end ; ++w)
+    {
+        StringRef p(_imp->string_at(w->path_offset, w->path_length));
+        FSStat s(FSPath(std::string(p.data, p.length)));
+        if ((! s.exists()) || s.mtim().seconds() != w->seconds || s.mtim().nanoseconds() != w->nanoseconds)
+        {
+            Log::get_instance()->message("e.owners_index.stale", ll_debug, lc_context)
+                << "Not using owners index '" << l << "' because '" << std::string(p.data, p.length) << "' has changed";
+            _imp->stale = true;
+            break;
+        }
+    }
+}
+
+OwnersIndex::~OwnersIndex()
+{
+}
+
+bool
+OwnersIndex::usable() const
+{
+    return _imp->header && ! _imp->stale;
+}
+
+bool
+OwnersIndex::find(const std::string & q, const OwnerQueryType t, std::map<std::string, std::string> & result) const
+{
+    if (! usable())
+        return false;
+
+    const Record * const records_end(_imp->records + _imp->header->record_count);
+
+    switch (t)
+    {
+        case oqt_full:
+        case oqt_prefix:
+            {
+                const Record * r(std::lower_bound(_imp->records, records_end, q,
+                            [&] (const Record & a, const std::string & b) { return _imp->path(a).compare(b) < 0; }));
+                for ( ; r != records_end ; ++r)
+                {
+                    StringRef p(_imp->path(*r));
+                    if (oqt_full == t ? 0 != p.compare(q) : ! p.starts_with(q))
+                        break;
+                    _imp->add_owner(*r, result);
+                }
+            }
+            return true;
+
+        case oqt_basename:
+            {
+                const uint32_t * const by_basename_end(_imp->by_basename + _imp->header->record_count);
+                auto basename_of([&] (uint32_t i) {
+                        return i < _imp->header->record_count ? _imp->basename(_imp->records[i]) : StringRef{ _imp->data, 0 };
+                    });
+
+                const uint32_t * r(std::lower_bound(_imp->by_basename, by_basename_end, q,
+                            [&] (uint32_t a, const std::string & b) { return basename_of(a).compare(b) < 0; }));
+                for ( ; r != by_basename_end && 0 == basename_of(*r).compare(q) ; ++r)
+                    _imp->add_owner(_imp->records[*r], result);
+            }
+            return true;
+
+        case oqt_partial:
+            for (const Record * r(_imp->records) ; r != records_end ; ++r)
+                if (_imp->path(*r).contains(q))
+                    _imp->add_owner(*r, result);
+            return true;
+
+        case last_oqt:
+            break;
+    }
+
+    throw InternalError(PALUDIS_HERE, "Bad OwnerQueryType");
+}
+
+void
+OwnersIndex::update(const FSPath & l, const FSPath & repository_location, const std::shared_ptr<const PackageIDSequence> & ids)
+{
+    Context context("When updating owners index '" + stringify(l) + "':");
+
+    /* the index lives in its own directory, so that writing it doesn't change
+     * the mtime of anything it watches */
+    l.dirname().mkdir(0755, { fspmkdo_ok_if_exists });
+
+    /* contents from the old index, keyed by owner location, for anything whose
+     * directory hasn't changed */
+    std::map<std::string, std::pair<std::pair<int64_t, int64_t>, std::vector<std::string> > > old_contents;
+    {
+        OwnersIndex old(l);
+        if (old._imp->header)
+        {
+            std::vector<decltype(old_contents)::iterator> old_owners;
+            for (const Owner * o(old._imp->owners), * o_end(o + old._imp->header->owner_count) ;
+                    o != o_end ; ++o)
+            {
+                StringRef loc(old._imp->string_at(o->location_offset, o->location_length));
+                old_owners.push_back(old_contents.insert(std::make_pair(std::string(loc.data, loc.length),
+                                std::make_pair(std::make_pair(o->seconds, o->nanoseconds), std::vector<std::string>()))).first);
+            }
+
+            for (const Record * r(old._imp->records), * r_end(r + old._imp->header->record_count) ;
+                    r != r_end ; ++r)
+                if (r->owner < old_owners.size())
+                {
+                    StringRef p(old._imp->path(*r));
+                    old_owners[r->owner]->second.second.push_back(std::string(p.data, p.length));
+                }
+        }
+    }
+
+    std::string strings;
+    std::vector<Owner> owners;
+    std::vector<std::pair<std::string, uint32_t> > paths;
+    std::set<FSPath, FSPathComparator> watch_dirs;
+    watch_dirs.insert(repository_location);
+
+    auto add_string([&] (const std::string & s) -> uint32_t {
+            uint32_t result(strings.length());
+            strings.append(s);
+            return result;
+        });
+
+    for (auto i(ids->begin()), i_end(ids->end()) ;
+            i != i_end ; ++i)
+    {
+        if (! (*i)->fs_location_key())
+            continue;
+
+        const FSPath dir((*i)->fs_location_key()->parse_value());
+        FSStat dir_stat(dir);
+        if (! dir_stat.exists())
+            continue;
+
+        watch_dirs.insert(dir.dirname());
+        watch_dirs.insert(dir.dirname().dirname());
+
+        const std::string name(stringify((*i)->name())), location(stringify(dir));
+        const uint32_t owner(owners.size());
+        owners.push_back(Owner{ add_string(name), uint32_t(name.length()), add_string(location), uint32_t(location.length()),
+                dir_stat.mtim().seconds(), dir_stat.mtim().nanoseconds() });
+
+        auto old(old_contents.find(location));
+        if (old_contents.end() != old && old->second.first == std::make_pair(owners.back().seconds, owners.back().nanoseconds))
+        {
+            for (auto p(old->second.second.begin()), p_end(old->second.second.end()) ;
+                    p != p_end ; ++p)
+                paths.push_back(std::make_pair(*p, owner));
+            continue;
+        }
+
+        auto contents((*i)->contents());
+        if (! contents)
+            continue;
+
+        for (auto c(contents->begin()), c_end(contents->end()) ;
+                c != c_end ; ++c)
+            paths.push_back(std::make_pair(stringify((*c)->location_key()->parse_value()), owner));
+    }
+
+    std::vector<Watch> watches;
+    for (auto w(watch_dirs.begin()), w_end(watch_dirs.end()) ;
+            w != w_end ; ++w)
+    {
+        FSStat s(*w);
+        if (! s.exists())
+            continue;
+
+        const std::string p(stringify(*w));
+        watches.push_back(Watch{ add_string(p), uint32_t(p.length()), s.mtim().seconds(), s.mtim().nanoseconds() });
+    }
+
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<Record> records;
+    records.reserve(paths.size());
+    for (auto p(paths.begin()), p_end(paths.end()) ;
+            p != p_end ; ++p)
+    {
+        std::string::size_type slash(p->first.rfind('/'));
+        records.push_back(Record{ add_string(p->first), uint32_t(p->first.length()),
+                uint32_t(std::string::npos == slash ? 0 : slash + 1), p->second });
+    }
+
+    std::vector<uint32_t> by_basename(records.size());
+    for (uint32_t n(0) ; n != by_basename.size() ; ++n)
+        by_basename[n] = n;
+
+    auto basename_of([&] (uint32_t n) {
+            const std::string & p(paths[n].first);
+            return StringRef{ p.data() + records[n].basename_offset, p.length() - records[n].basename_offset };
+        });
+    std::stable_sort(by_basename.begin(), by_basename.end(), [&] (uint32_t a, uint32_t b) {
+            StringRef sa(basename_of(a)), sb(basename_of(b));
+            int c(std::memcmp(sa.data, sb.data, std::min(sa.length, sb.length)));
+            return c < 0 || (0 == c && sa.length < sb.length);
+        });
+
+    const std::size_t strings_start(sizeof(Header) + watches.size() * sizeof(Watch) + owners.size() * sizeof(Owner) +
+            records.size() * (sizeof(Record) + sizeof(uint32_t)));
+    if (strings_start + strings.length() > UINT32_MAX)
+        throw InternalError(PALUDIS_HERE, "owners index would be too large");
+
+    for (auto w(watches.begin()), w_end(watches.end()) ; w != w_end ; ++w)
+        w->path_offset += strings_start;
+    for (auto o(owners.begin()), o_end(owners.end()) ; o != o_end ; ++o)
+    {
+        o->name_offset += strings_start;
+        o->location_offset += strings_start;
+    }
+    for (auto r(records.begin()), r_end(records.end()) ; r != r_end ; ++r)
+        r->path_offset += strings_start;
+
+    Header header;
+    MappedIndexFile::fill_header(header.prefix, magic);
+    header.watch_count = watches.size();
+    header.owner_count = owners.size();
+    header.record_count = records.size();
+
+    std::string data;
+    data.reserve(strings_start + strings.length());
+    data.append(reinterpret_cast<const char *>(&header), sizeof(Header));
+    data.append(reinterpret_cast<const char *>(watches.data()), watches.size() * sizeof(Watch));
+    data.append(reinterpret_cast<const char *>(owners.data()), owners.size() * sizeof(Owner));
+    data.append(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(Record));
+    data.append(reinterpret_cast<const char *>(by_basename.data()), by_basename.size() * sizeof(uint32_t));
+    data.append(strings);
+
+    MappedIndexFile::write(l, data);
+}
+
+namespace paludis
+{
+    template class Pimp<OwnersIndex>;
+}
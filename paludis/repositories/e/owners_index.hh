@@ -0,0 +1,92 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_REPOSITORIES_E_OWNERS_INDEX_HH
+#define PALUDIS_GUARD_PALUDIS_REPOSITORIES_E_OWNERS_INDEX_HH 1
+
+#include <paludis/util/pimp.hh>
+#include <paludis/util/fs_path-fwd.hh>
+#include <paludis/util/attributes.hh>
+#include <paludis/package_id-fwd.hh>
+#include <paludis/repository-fwd.hh>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace paludis
+{
+    namespace erepository
+    {
+        /**
+         * A memory mapped index from paths to the installed packages whose
+         * contents include them, so that finding the owner of a file does
+         * not mean reading every package's contents.
+         *
+         * The index remembers the mtimes of the directories holding package
+         * entries, and refuses to answer queries if any of them have changed
+         * since it was written.
+         *
+         * \ingroup grperepository
+         * \nosubgrouping
+         */
+        class PALUDIS_VISIBLE OwnersIndex
+        {
+            private:
+                Pimp<OwnersIndex> _imp;
+
+            public:
+                ///\name Basic operations
+                ///\{
+
+                explicit OwnersIndex(const FSPath &);
+                ~OwnersIndex();
+
+                OwnersIndex(const OwnersIndex &) = delete;
+                OwnersIndex & operator= (const OwnersIndex &) = delete;
+
+                ///\}
+
+                /**
+                 * False if the file does not exist, is not an index we
+                 * understand, or is out of date.
+                 */
+                bool usable() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Find the owners of a path, as a map from the owner's
+                 * fs_location_key to its qualified package name. Returns false
+                 * if we are not usable.
+                 */
+                bool find(const std::string &, const OwnerQueryType, std::map<std::string, std::string> & owners) const
+                    PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Rewrite the index for a repository containing the given IDs,
+                 * reusing the contents of any ID whose directory has not
+                 * changed. The file is replaced atomically.
+                 */
+                static void update(const FSPath & index_file, const FSPath & repository_location,
+                        const std::shared_ptr<const PackageIDSequence> & ids);
+        };
+    }
+
+    extern template class Pimp<erepository::OwnersIndex>;
+}
+
+#endif
@@ -21,6 +21,7 @@
 #include <paludis/repositories/e/traditional_layout.hh>
 #include <paludis/repositories/e/e_repository.hh>
 #include <paludis/repositories/e/file_suffixes.hh>
+#include <paludis/repositories/e/layout_index.hh>
 #include <paludis/repositories/e/traditional_mask_store.hh>
 
 #include <paludis/util/config_file.hh>
@@ -53,10 +54,6 @@
 using namespace paludis;
 using namespace paludis::erepository;
 
-typedef std::unordered_map<CategoryNamePart, bool, Hash<CategoryNamePart> > CategoryMap;
-typedef std::unordered_map<QualifiedPackageName, bool, Hash<QualifiedPackageName> > PackagesMap;
-typedef std::unordered_map<QualifiedPackageName, std::shared_ptr<PackageIDSequence>, Hash<QualifiedPackageName>  > IDMap;
-
 namespace
 {
     std::shared_ptr<TraditionalMaskStore> make_mask_store(
@@ -77,14 +74,7 @@ namespace paludis
         const ERepository * const repository;
         const FSPath tree_root;
 
-        mutable std::recursive_mutex big_nasty_mutex;
-
-        mutable bool has_category_names;
-        mutable CategoryMap category_names;
-        mutable PackagesMap package_names;
-        mutable IDMap ids;
-
-        mutable std::shared_ptr<CategoryNamePartSet> category_names_collection;
+        std::unique_ptr<LayoutIndex> index;
 
         std::shared_ptr<FSPathSequence> arch_list_files;
         std::shared_ptr<FSPathSequence> repository_mask_files;
@@ -102,7 +92,6 @@ namespace paludis
                 const FSPath & t) :
             repository(r),
             tree_root(t),
-            has_category_names(false),
             arch_list_files(std::make_shared<FSPathSequence>()),
             repository_mask_files(std::make_shared<FSPathSequence>()),
             profiles_desc_files(std::make_shared<FSPathSequence>()),
@@ -126,6 +115,12 @@ TraditionalLayout::TraditionalLayout(
     Layout(f),
     _imp(env, repo, tree_root)
 {
+    _imp->index.reset(new LayoutIndex(
+                std::bind(&TraditionalLayout::load_category_names, this),
+                std::bind(&TraditionalLayout::load_package_names, this, std::placeholders::_1),
+                std::bind(&TraditionalLayout::load_package_ids, this, std::placeholders::_1),
+                std::bind(&TraditionalLayout::package_directory_exists, this, std::placeholders::_1)));
+
     if (master_repositories_locations())
     {
         for (FSPathSequence::ConstIterator l(master_repositories_locations()->begin()), l_end(master_repositories_locations()->end()) ;
@@ -183,18 +178,14 @@ TraditionalLayout::categories_file() const
     return _imp->tree_root / "profiles" / "categories";
 }
 
-void
-TraditionalLayout::need_category_names() const
+std::shared_ptr<const CategoryNamePartSet>
+TraditionalLayout::load_category_names() const
 {
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
-
-    if (_imp->has_category_names)
-        return;
-
     Context context("When loading category names for " + stringify(_imp->repository->name()) + ":");
 
     Log::get_instance()->message("e.traditional_layout.need_category_names", ll_debug, lc_context) << "need_category_names";
 
+    std::shared_ptr<CategoryNamePartSet> result(std::make_shared<CategoryNamePartSet>());
     bool found_one(false);
 
     std::list<FSPath> cats_list;
@@ -217,7 +208,7 @@ TraditionalLayout::need_category_names() const
         {
             try
             {
-                _imp->category_names.insert(std::make_pair(CategoryNamePart(*line), false));
+                result->insert(CategoryNamePart(*line));
             }
             catch (const NameError & e)
             {
@@ -243,7 +234,7 @@ TraditionalLayout::need_category_names() const
 
             try
             {
-                _imp->category_names.insert(std::make_pair(CategoryNamePart(n), false));
+                result->insert(CategoryNamePart(n));
             }
             catch (const NameError &)
             {
@@ -251,19 +242,14 @@ TraditionalLayout::need_category_names() const
         }
     }
 
-    _imp->has_category_names = true;
+    return result;
 }
 
-void
-TraditionalLayout::need_package_ids(const QualifiedPackageName & n) const
+std::shared_ptr<const PackageIDSequence>
+TraditionalLayout::load_package_ids(const QualifiedPackageName & n) const
 {
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
-
     using namespace std::placeholders;
 
-    if (_imp->package_names[n])
-        return;
-
     Context context("When loading versions for '" + stringify(n) + "' in "
             + stringify(_imp->repository->name()) + ":");
 
@@ -300,101 +286,46 @@ TraditionalLayout::need_package_ids(const QualifiedPackageName & n) const
         }
     }
 
-    _imp->ids.insert(std::make_pair(n, v));
-    _imp->package_names[n] = true;
+    return v;
 }
 
 bool
-TraditionalLayout::has_category_named(const CategoryNamePart & c) const
+TraditionalLayout::package_directory_exists(const QualifiedPackageName & q) const
 {
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
+    FSPath fs(_imp->tree_root);
+    fs /= stringify(q.category());
+    fs /= stringify(q.package());
+    return fs.stat().is_directory_or_symlink_to_directory();
+}
 
+bool
+TraditionalLayout::has_category_named(const CategoryNamePart & c) const
+{
     Context context("When checking for category '" + stringify(c) + "' in '" + stringify(_imp->repository->name()) + "':");
 
-    need_category_names();
-    return _imp->category_names.end() != _imp->category_names.find(c);
+    return _imp->index->has_category_named(c);
 }
 
 bool
 TraditionalLayout::has_package_named(const QualifiedPackageName & q) const
 {
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
-
     Context context("When checking for package '" + stringify(q) + "' in '" + stringify(_imp->repository->name()) + ":");
 
-    need_category_names();
-
-    CategoryMap::iterator cat_iter(_imp->category_names.find(q.category()));
-
-    if (_imp->category_names.end() == cat_iter)
-        return false;
-
-    if (cat_iter->second)
-    {
-        /* this category's package names are fully loaded */
-        return _imp->package_names.find(q) != _imp->package_names.end();
-    }
-    else
-    {
-        /* package names are only partially loaded or not loaded */
-        if (_imp->package_names.find(q) != _imp->package_names.end())
-            return true;
-
-        FSPath fs(_imp->tree_root);
-        fs /= stringify(q.category());
-        fs /= stringify(q.package());
-        if (! fs.stat().is_directory_or_symlink_to_directory())
-            return false;
-        _imp->package_names.insert(std::make_pair(q, false));
-        return true;
-    }
-}
-
-void
-TraditionalLayout::need_category_names_collection() const
-{
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
-
-    if (_imp->category_names_collection)
-        return;
-
-    need_category_names();
-
-    _imp->category_names_collection = std::make_shared<CategoryNamePartSet>();
-    std::transform(_imp->category_names.begin(), _imp->category_names.end(),
-            _imp->category_names_collection->inserter(),
-            std::mem_fn(&std::pair<const CategoryNamePart, bool>::first));
+    return _imp->index->has_package_named(q);
 }
 
 std::shared_ptr<const CategoryNamePartSet>
 TraditionalLayout::category_names() const
 {
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
-
     Context context("When fetching category names in " + stringify(stringify(_imp->repository->name())) + ":");
 
-    need_category_names_collection();
-    return _imp->category_names_collection;
+    return _imp->index->category_names();
 }
 
 std::shared_ptr<const QualifiedPackageNameSet>
-TraditionalLayout::package_names(const CategoryNamePart & c) const
+TraditionalLayout::load_package_names(const CategoryNamePart & c) const
 {
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
-
-    using namespace std::placeholders;
-
-    /* this isn't particularly fast because it isn't called very often. avoid
-     * changing the data structures used to make this faster at the expense of
-     * slowing down single item queries. */
-
-    Context context("When fetching package names in category '" + stringify(c)
-            + "' in " + stringify(_imp->repository->name()) + ":");
-
-    need_category_names();
-
-    if (_imp->category_names.end() == _imp->category_names.find(c))
-        return std::make_shared<QualifiedPackageNameSet>();
+    std::shared_ptr<QualifiedPackageNameSet> result(std::make_shared<QualifiedPackageNameSet>());
 
     if ((_imp->tree_root / stringify(c)).stat().is_directory_or_symlink_to_directory())
         for (FSIterator d(_imp->tree_root / stringify(c), { fsio_inode_sort, fsio_deref_symlinks_for_wants, fsio_want_directories }), d_end ; d != d_end ; ++d)
@@ -404,7 +335,7 @@ TraditionalLayout::package_names(const CategoryNamePart & c) const
                 if (d->basename() == "CVS")
                    continue;
 
-                _imp->package_names.insert(std::make_pair(c + PackageNamePart(d->basename()), false));
+                result->insert(c + PackageNamePart(d->basename()));
             }
             catch (const NameError & e)
             {
@@ -414,32 +345,24 @@ TraditionalLayout::package_names(const CategoryNamePart & c) const
             }
         }
 
-    _imp->category_names[c] = true;
-
-    std::shared_ptr<QualifiedPackageNameSet> result(std::make_shared<QualifiedPackageNameSet>());
+    return result;
+}
 
-    for (PackagesMap::const_iterator p(_imp->package_names.begin()), p_end(_imp->package_names.end()) ;
-            p != p_end ; ++p)
-        if (p->first.category() == c)
-            result->insert(p->first);
+std::shared_ptr<const QualifiedPackageNameSet>
+TraditionalLayout::package_names(const CategoryNamePart & c) const
+{
+    Context context("When fetching package names in category '" + stringify(c)
+            + "' in " + stringify(_imp->repository->name()) + ":");
 
-    return result;
+    return _imp->index->package_names(c);
 }
 
 std::shared_ptr<const PackageIDSequence>
 TraditionalLayout::package_ids(const QualifiedPackageName & n) const
 {
-    std::unique_lock<std::recursive_mutex> lock(_imp->big_nasty_mutex);
-
     Context context("When fetching versions of '" + stringify(n) + "' in " + stringify(_imp->repository->name()) + ":");
 
-    if (has_package_named(n))
-    {
-        need_package_ids(n);
-        return _imp->ids.find(n)->second;
-    }
-    else
-        return std::make_shared<PackageIDSequence>();
+    return _imp->index->package_ids(n);
 }
 
 const std::shared_ptr<const FSPathSequence>
@@ -41,9 +41,10 @@ namespace paludis
             private:
                 Pimp<TraditionalLayout> _imp;
 
-                void need_category_names() const;
-                void need_category_names_collection() const;
-                void need_package_ids(const QualifiedPackageName &) const;
+                std::shared_ptr<const CategoryNamePartSet> load_category_names() const;
+                std::shared_ptr<const QualifiedPackageNameSet> load_package_names(const CategoryNamePart &) const;
+                std::shared_ptr<const PackageIDSequence> load_package_ids(const QualifiedPackageName &) const;
+                bool package_directory_exists(const QualifiedPackageName &) const;
 
             public:
                 ///\name Basic operations
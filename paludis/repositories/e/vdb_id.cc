@@ -20,6 +20,7 @@
 #include <paludis/repositories/e/vdb_id.hh>
 #include <paludis/repositories/e/e_key.hh>
 #include <paludis/repositories/e/vdb_contents_tokeniser.hh>
+#include <paludis/repositories/e/vdb_index.hh>
 #include <paludis/util/fs_path.hh>
 #include <paludis/util/fs_stat.hh>
 #include <paludis/util/stringify.hh>
@@ -38,11 +39,21 @@ using namespace paludis::erepository;
 VDBID::VDBID(const QualifiedPackageName & q, const VersionSpec & v,
         const Environment * const e,
         const RepositoryName & r,
-        const FSPath & f) :
-    EInstalledRepositoryID(q, v, e, r, f)
+        const FSPath & f,
+        const std::shared_ptr<const VDBIndex> & i) :
+    EInstalledRepositoryID(q, v, e, r, f),
+    _index(i)
 {
 }
 
+const std::shared_ptr<const VDBIndexEntry>
+VDBID::index_entry() const
+{
+    if (! _index)
+        return nullptr;
+    return _index->entry(fs_location_key()->parse_value());
+}
+
 std::string
 VDBID::fs_location_raw_name() const
 {
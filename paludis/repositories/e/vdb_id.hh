@@ -26,14 +26,23 @@ namespace paludis
 {
     namespace erepository
     {
+        class VDBIndex;
+
         class VDBID :
             public EInstalledRepositoryID
         {
+            private:
+                const std::shared_ptr<const VDBIndex> _index;
+
+            protected:
+                virtual const std::shared_ptr<const VDBIndexEntry> index_entry() const;
+
             public:
                 VDBID(const QualifiedPackageName &, const VersionSpec &,
                         const Environment * const,
                         const RepositoryName &,
-                        const FSPath & file);
+                        const FSPath & file,
+                        const std::shared_ptr<const VDBIndex> & = nullptr);
 
                 virtual std::string fs_location_raw_name() const;
                 virtual std::string fs_location_human_name() const;
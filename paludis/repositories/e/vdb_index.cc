@@ -0,0 +1,235 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/repositories/e/vdb_index.hh>
+#include <paludis/repositories/e/ebuild_binary_metadata_cache.hh>
+
+#include <paludis/util/pimp-impl.hh>
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/fs_stat.hh>
+#include <paludis/util/fs_iterator.hh>
+#include <paludis/util/options.hh>
+#include <paludis/util/log.hh>
+#include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/tokeniser.hh>
+#include <paludis/util/join.hh>
+#include <paludis/util/timestamp.hh>
+
+#include <iterator>
+#include <list>
+#include <map>
+#include <set>
+
+using namespace paludis;
+using namespace paludis::erepository;
+
+/*
+ * The index uses the same file format as EbuildBinaryMetadataCache. Each
+ * entry is named 'cat/dir', and maps filenames to their contents. Names
+ * starting with a slash cannot be filenames, and are used for our own data.
+ */
+
+namespace
+{
+    const std::string index_name(".paludis-vdb-index.bincache");
+
+    /* anything bigger, like environment.bz2, is left on disk */
+    const off_t max_indexed_file_size(16384);
+
+    std::string mtime_string(const FSStat & s)
+    {
+        return stringify(s.mtim().seconds()) + "." + stringify(s.mtim().nanoseconds());
+    }
+
+    std::string entry_name(const FSPath & package_dir)
+    {
+        return package_dir.dirname().basename() + "/" + package_dir.basename();
+    }
+
+    void read_entry(const FSPath & package_dir, std::map<std::string, std::string> & keys)
+    {
+        std::set<std::string> unindexed;
+        for (FSIterator f(package_dir, { }), f_end ; f != f_end ; ++f)
+        {
+            FSStat f_stat(*f);
+            if (f_stat.is_regular_file() && f_stat.file_size() <= max_indexed_file_size)
+            {
+                SafeIFStream s(*f);
+                keys.insert(std::make_pair(f->basename(),
+                            std::string((std::istreambuf_iterator<char>(s)), std::istreambuf_iterator<char>())));
+            }
+            else
+                unindexed.insert(f->basename());
+        }
+
+        keys.insert(std::make_pair("/unindexed", join(unindexed.begin(), unindexed.end(), " ")));
+    }
+}
+
+namespace paludis
+{
+    template <>
+    struct Imp<VDBIndexEntry>
+    {
+        std::map<std::string, std::string> files;
+        std::set<std::string> unindexed_files;
+    };
+
+    template <>
+    struct Imp<VDBIndex>
+    {
+        EbuildBinaryMetadataCache cache;
+
+        Imp(const FSPath & l) :
+            cache(l / index_name)
+        {
+        }
+    };
+}
+
+VDBIndexEntry::VDBIndexEntry() :
+    _imp()
+{
+}
+
+VDBIndexEntry::~VDBIndexEntry()
+{
+}
+
+bool
+VDBIndexEntry::has_file(const std::string & f) const
+{
+    return _imp->files.end() != _imp->files.find(f) || _imp->unindexed_files.end() != _imp->unindexed_files.find(f);
+}
+
+bool
+VDBIndexEntry::file_contents(const std::string & f, std::string & result) const
+{
+    auto i(_imp->files.find(f));
+    if (_imp->files.end() == i)
+        return false;
+
+    result = i->second;
+    return true;
+}
+
+void
+VDBIndexEntry::add_file(const std::string & f, const std::string & contents)
+{
+    _imp->files.insert(std::make_pair(f, contents));
+}
+
+void
+VDBIndexEntry::add_unindexed_file(const std::string & f)
+{
+    _imp->unindexed_files.insert(f);
+}
+
+VDBIndex::VDBIndex(const FSPath & l) :
+    _imp(l)
+{
+}
+
+VDBIndex::~VDBIndex()
+{
+}
+
+const std::shared_ptr<const VDBIndexEntry>
+VDBIndex::entry(const FSPath & package_dir) const
+{
+    if (! _imp->cache.usable())
+        return nullptr;
+
+    std::map<std::string, std::string> keys;
+    if (! _imp->cache.find(entry_name(package_dir), keys))
+        return nullptr;
+
+    FSStat package_dir_stat(package_dir);
+    if ((! package_dir_stat.exists()) || keys["/mtime"] != mtime_string(package_dir_stat))
+        return nullptr;
+
+    auto result(std::make_shared<VDBIndexEntry>());
+    for (auto k(keys.begin()), k_end(keys.end()) ;
+            k != k_end ; ++k)
+    {
+        if (k->first == "/unindexed")
+        {
+            std::list<std::string> unindexed;
+            tokenise_whitespace(k->second, std::back_inserter(unindexed));
+            for (auto u(unindexed.begin()), u_end(unindexed.end()) ;
+                    u != u_end ; ++u)
+                result->add_unindexed_file(*u);
+        }
+        else if (0 != k->first.compare(0, 1, "/"))
+            result->add_file(k->first, k->second);
+    }
+
+    return result;
+}
+
+void
+VDBIndex::update(const FSPath & l)
+{
+    Context context("When updating VDB index for '" + stringify(l) + "':");
+
+    EbuildBinaryMetadataCache old_cache(l / index_name);
+    EbuildBinaryMetadataCacheWriter writer(l / index_name);
+
+    for (FSIterator c(l, { fsio_want_directories, fsio_deref_symlinks_for_wants }), c_end ; c != c_end ; ++c)
+        for (FSIterator d(*c, { fsio_want_directories }), d_end ; d != d_end ; ++d)
+        {
+            /* skip -checking- and -reinstalling- directories */
+            if (0 == d->basename().compare(0, 1, "-"))
+                continue;
+
+            const std::string name(entry_name(*d));
+            const std::string mtime(mtime_string(d->stat()));
+
+            std::map<std::string, std::string> keys;
+            if (old_cache.find(name, keys) && keys["/mtime"] == mtime)
+            {
+                writer.add(name, keys);
+                continue;
+            }
+
+            keys.clear();
+            try
+            {
+                read_entry(*d, keys);
+            }
+            catch (const Exception & e)
+            {
+                Log::get_instance()->message("e.vdb.index.skipping", ll_warning, lc_context)
+                    << "Not indexing '" << *d << "' due to exception '" << e.message() << "' (" << e.what() << ")";
+                continue;
+            }
+
+            keys["/mtime"] = mtime;
+            writer.add(name, keys);
+        }
+
+    writer.write();
+}
+
+namespace paludis
+{
+    template class Pimp<VDBIndexEntry>;
+    template class Pimp<VDBIndex>;
+}
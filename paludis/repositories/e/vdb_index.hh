@@ -0,0 +1,124 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_REPOSITORIES_E_VDB_INDEX_HH
+#define PALUDIS_GUARD_PALUDIS_REPOSITORIES_E_VDB_INDEX_HH 1
+
+#include <paludis/util/pimp.hh>
+#include <paludis/util/fs_path-fwd.hh>
+#include <paludis/util/attributes.hh>
+#include <memory>
+#include <string>
+
+namespace paludis
+{
+    namespace erepository
+    {
+        /**
+         * The indexed files from one VDB package directory.
+         *
+         * \see VDBIndex
+         * \ingroup grperepository
+         * \nosubgrouping
+         */
+        class PALUDIS_VISIBLE VDBIndexEntry
+        {
+            private:
+                Pimp<VDBIndexEntry> _imp;
+
+            public:
+                ///\name Basic operations
+                ///\{
+
+                VDBIndexEntry();
+                ~VDBIndexEntry();
+
+                VDBIndexEntry(const VDBIndexEntry &) = delete;
+                VDBIndexEntry & operator= (const VDBIndexEntry &) = delete;
+
+                ///\}
+
+                /**
+                 * Did the directory contain the named file?
+                 */
+                bool has_file(const std::string &) const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Fetch the contents of the named file, returning false if it
+                 * is too large to have been indexed, or does not exist.
+                 */
+                bool file_contents(const std::string &, std::string &) const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                ///\name For use by VDBIndex
+                ///\{
+
+                void add_file(const std::string &, const std::string &);
+                void add_unindexed_file(const std::string &);
+
+                ///\}
+        };
+
+        /**
+         * A single file index of the small files in every VDB package
+         * directory, so that loading installed IDs does not have to open and
+         * read dozens of files per ID.
+         *
+         * Each entry remembers its directory's mtime, and is ignored if the
+         * directory has since changed.
+         *
+         * \ingroup grperepository
+         * \nosubgrouping
+         */
+        class PALUDIS_VISIBLE VDBIndex
+        {
+            private:
+                Pimp<VDBIndex> _imp;
+
+            public:
+                ///\name Basic operations
+                ///\{
+
+                explicit VDBIndex(const FSPath & vdb_location);
+                ~VDBIndex();
+
+                VDBIndex(const VDBIndex &) = delete;
+                VDBIndex & operator= (const VDBIndex &) = delete;
+
+                ///\}
+
+                /**
+                 * The entry for a package directory, or null if it is not
+                 * indexed or the index entry is stale.
+                 */
+                const std::shared_ptr<const VDBIndexEntry> entry(const FSPath & package_dir) const
+                    PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Rewrite the index for a VDB, reusing any entries from the
+                 * existing index that are still valid.
+                 */
+                static void update(const FSPath & vdb_location);
+        };
+    }
+
+    extern template class Pimp<erepository::VDBIndexEntry>;
+    extern template class Pimp<erepository::VDBIndex>;
+}
+
+#endif
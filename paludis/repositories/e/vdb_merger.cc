@@ -146,6 +146,12 @@ VDBMerger::extend_hook(const Hook & h)
             ("PALUDIS_BASHRC_FILES", join(bashrc_files->begin(), bashrc_files->end(), " "));
 }
 
+std::string
+VDBMerger::install_file_digest_algorithm() const
+{
+    return "MD5";
+}
+
 void
 VDBMerger::record_install_file(const FSPath & src, const FSPath & dst_dir, const std::string & dst_name, const FSMergerStatusFlags & flags)
 {
@@ -156,16 +162,21 @@ VDBMerger::record_install_file(const FSPath & src, const FSPath & dst_dir, const
                       tidy_real(stringify(file.strip_leading(_imp->realroot)));
     const Timestamp timestamp(renamed_file.stat().mtim());
 
-    SafeIFStream infile(renamed_file);
-    if (! infile)
-        throw FSMergerError("Cannot read '" + stringify(renamed_file) + "'");
+    /* if we copied the file, we already know its md5 */
+    std::string md5(installed_file_digest(renamed_file));
+    if (md5.empty())
+    {
+        SafeIFStream infile(renamed_file);
+        if (! infile)
+            throw FSMergerError("Cannot read '" + stringify(renamed_file) + "'");
 
-    MD5 md5(infile);
+        md5 = MD5(infile).hexsum();
+    }
 
     display_merge(et_file, renamed_file, flags,
                   src.basename() == dst_name ? "" : dst_name);
 
-    *_imp->contents_file << "obj " << tidy_real << " " << md5.hexsum() << " " << timestamp.seconds() << std::endl;
+    *_imp->contents_file << "obj " << tidy_real << " " << md5 << " " << timestamp.seconds() << std::endl;
 }
 
 void
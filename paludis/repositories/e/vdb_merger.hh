@@ -96,6 +96,7 @@ namespace paludis
             virtual Hook extend_hook(const Hook &);
 
             virtual void record_install_file(const FSPath &, const FSPath &, const std::string &, const FSMergerStatusFlags &);
+            virtual std::string install_file_digest_algorithm() const;
             virtual void record_install_dir(const FSPath &, const FSPath &, const FSMergerStatusFlags &);
             virtual void record_install_under_dir(const FSPath &, const FSMergerStatusFlags &);
             virtual void record_install_sym(const FSPath &, const FSPath &, const FSMergerStatusFlags &);
@@ -21,6 +21,7 @@
 #include <paludis/repositories/e/vdb_merger.hh>
 #include <paludis/repositories/e/vdb_unmerger.hh>
 #include <paludis/repositories/e/vdb_id.hh>
+#include <paludis/repositories/e/vdb_index.hh>
 #include <paludis/repositories/e/eapi_phase.hh>
 #include <paludis/repositories/e/eapi.hh>
 #include <paludis/repositories/e/dep_parser.hh>
@@ -114,6 +115,8 @@ namespace paludis
         mutable bool has_category_names;
         mutable IDMap ids;
 
+        mutable std::shared_ptr<const VDBIndex> index;
+
         std::shared_ptr<RepositoryNameCache> names_cache;
 
         Imp(const VDBRepository * const, const VDBRepositoryParams &, std::shared_ptr<std::recursive_mutex> = std::make_shared<std::recursive_mutex>());
@@ -560,6 +563,8 @@ VDBRepository::perform_uninstall(
             }
         if (only)
             _imp->names_cache->remove(id->name());
+
+        update_index();
     }
 }
 
@@ -577,6 +582,24 @@ VDBRepository::regenerate_cache() const
     std::unique_lock<std::recursive_mutex> lock(*_imp->big_nasty_mutex);
 
     _imp->names_cache->regenerate_cache();
+    update_index();
+}
+
+void
+VDBRepository::update_index() const
+{
+    try
+    {
+        VDBIndex::update(_imp->params.location());
+    }
+    catch (const Exception & e)
+    {
+        Log::get_instance()->message("e.vdb.index.update_failed", ll_warning, lc_context)
+            << "Could not update VDB index for '" << _imp->params.location() << "' due to exception '"
+            << e.message() << "' (" << e.what() << ")";
+    }
+
+    update_owners_index();
 }
 
 std::shared_ptr<const CategoryNamePartSet>
@@ -797,6 +820,7 @@ VDBRepository::merge(const MergeParams & m)
     post_merge_command();
 
     _imp->names_cache->add(m.package_id()->name());
+    update_index();
 }
 
 void
@@ -877,7 +901,10 @@ VDBRepository::make_id(const QualifiedPackageName & q, const VersionSpec & v, co
 
     Context context("When creating ID for '" + stringify(q) + "-" + stringify(v) + "' from '" + stringify(f) + "':");
 
-    std::shared_ptr<VDBID> result(std::make_shared<VDBID>(q, v, _imp->params.environment(), name(), f));
+    if (! _imp->index)
+        _imp->index = std::make_shared<VDBIndex>(_imp->params.location());
+
+    std::shared_ptr<VDBID> result(std::make_shared<VDBID>(q, v, _imp->params.environment(), name(), f, _imp->index));
     return result;
 }
 
@@ -1050,8 +1077,13 @@ namespace
         if (v.changed)
         {
             std::cout << "    Rewriting " << f << std::endl;
-            SafeOFStream ff(f, -1, true);
-            ff << v.str.str() << std::endl;
+            {
+                SafeOFStream ff(f, -1, true);
+                ff << v.str.str() << std::endl;
+            }
+
+            /* so that the index notices the change */
+            f.dirname().utime(Timestamp::now());
         }
 
         return v.changed;
@@ -1304,8 +1336,13 @@ VDBRepository::perform_updates()
             {
                 std::cout << "    " << *m->first << " to " << m->second << std::endl;
 
-                SafeOFStream f(m->first->fs_location_key()->parse_value() / "SLOT", -1, true);
-                f << m->second << std::endl;
+                {
+                    SafeOFStream f(m->first->fs_location_key()->parse_value() / "SLOT", -1, true);
+                    f << m->second << std::endl;
+                }
+
+                /* so that the index notices the change */
+                m->first->fs_location_key()->parse_value().utime(Timestamp::now());
             }
         }
 
@@ -1315,6 +1352,7 @@ VDBRepository::perform_updates()
 
             std::cout << std::endl << "Invalidating names cache following updates" << std::endl;
             _imp->names_cache->regenerate_cache();
+            update_index();
         }
 
         if (! dep_rewrites.empty())
@@ -1338,6 +1376,12 @@ VDBRepository::perform_updates()
                             (*i)->post_dependencies_key(), dep_rewrites);
             }
 
+            if (rewrite_done)
+            {
+                invalidate();
+                update_index();
+            }
+
             std::cout << std::endl << "Updating configuration files" << std::endl;
 
             for (DepRewrites::const_iterator i(dep_rewrites.begin()), i_end(dep_rewrites.end()) ;
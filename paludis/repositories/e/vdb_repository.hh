@@ -81,6 +81,7 @@ namespace paludis
 
             void need_category_names() const;
             void need_package_ids(const CategoryNamePart &) const;
+            void update_index() const;
 
             const std::shared_ptr<const erepository::ERepositoryID> package_id_if_exists(const QualifiedPackageName &,
                     const VersionSpec &) const
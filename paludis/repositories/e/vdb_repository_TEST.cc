@@ -27,6 +27,8 @@
 #include <paludis/util/options.hh>
 #include <paludis/util/make_named_values.hh>
 #include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/safe_ofstream.hh>
+#include <paludis/util/timestamp.hh>
 #include <paludis/util/fs_iterator.hh>
 #include <paludis/util/fs_stat.hh>
 #include <paludis/util/join.hh>
@@ -50,6 +52,7 @@
 #include <algorithm>
 #include <iterator>
 #include <vector>
+#include <set>
 
 #include <gtest/gtest.h>
 
@@ -508,3 +511,94 @@ TEST(VDBRepository, RemoveStaleFiles)
     EXPECT_TRUE((FSPath("vdb_repository_TEST_dir/root") / "stale-both").stat().exists());
 }
 
+
+TEST(VDBRepository, Index)
+{
+    std::shared_ptr<Map<std::string, std::string> > keys(std::make_shared<Map<std::string, std::string>>());
+    keys->insert("format", "vdb");
+    keys->insert("names_cache", "/var/empty");
+    keys->insert("location", stringify(FSPath::cwd() / "vdb_repository_TEST_dir" / "indexrepo"));
+    keys->insert("builddir", stringify(FSPath::cwd() / "vdb_repository_TEST_dir" / "build"));
+
+    auto description([&] () -> std::string {
+            TestEnvironment env;
+            std::shared_ptr<Repository> repo(VDBRepository::VDBRepository::repository_factory_create(&env,
+                        std::bind(from_keys, keys, std::placeholders::_1)));
+            env.add_repository(1, repo);
+            std::shared_ptr<const PackageID> id(*env[selection::RequireExactlyOne(generator::Matches(
+                            PackageDepSpec(parse_user_package_dep_spec("=cat/pkg-1",
+                                    &env, { })), nullptr, { }))]->begin());
+            return id->short_description_key()->parse_value();
+            });
+
+    {
+        TestEnvironment env;
+        std::shared_ptr<Repository> repo(VDBRepository::VDBRepository::repository_factory_create(&env,
+                    std::bind(from_keys, keys, std::placeholders::_1)));
+        env.add_repository(1, repo);
+        repo->regenerate_cache();
+    }
+
+    EXPECT_EQ("Indexed description", description());
+
+    /* rewriting a file in place doesn't change the directory's mtime, so if
+     * we see the old value, it came from the index */
+    FSPath pkg_dir(FSPath("vdb_repository_TEST_dir") / "indexrepo" / "cat" / "pkg-1");
+    {
+        SafeOFStream f(pkg_dir / "DESCRIPTION", -1, true);
+        f << "Changed description" << std::endl;
+    }
+    pkg_dir.utime(Timestamp(946684800, 0));
+    EXPECT_EQ("Indexed description", description());
+
+    pkg_dir.utime(Timestamp(946684860, 0));
+    EXPECT_EQ("Changed description", description());
+}
+
+TEST(VDBRepository, OwnersIndex)
+{
+    std::shared_ptr<Map<std::string, std::string> > keys(std::make_shared<Map<std::string, std::string>>());
+    keys->insert("format", "vdb");
+    keys->insert("names_cache", "/var/empty");
+    keys->insert("location", stringify(FSPath::cwd() / "vdb_repository_TEST_dir" / "ownersrepo"));
+    keys->insert("builddir", stringify(FSPath::cwd() / "vdb_repository_TEST_dir" / "build"));
+
+    auto owners([&] (const std::string & q, const OwnerQueryType t) -> std::string {
+            TestEnvironment env;
+            std::shared_ptr<Repository> repo(VDBRepository::VDBRepository::repository_factory_create(&env,
+                        std::bind(from_keys, keys, std::placeholders::_1)));
+            env.add_repository(1, repo);
+            auto ids(repo->ids_owning_path(q, t));
+            if (! ids)
+                return "unindexed";
+
+            std::set<std::string> names;
+            for (auto i(ids->begin()), i_end(ids->end()) ; i != i_end ; ++i)
+                names.insert(stringify(**i));
+            return join(names.begin(), names.end(), " ");
+            });
+
+    EXPECT_EQ("unindexed", owners("/usr/bin/foo", oqt_full));
+
+    {
+        TestEnvironment env;
+        std::shared_ptr<Repository> repo(VDBRepository::VDBRepository::repository_factory_create(&env,
+                    std::bind(from_keys, keys, std::placeholders::_1)));
+        env.add_repository(1, repo);
+        repo->regenerate_cache();
+    }
+
+    EXPECT_EQ("cat/pkg-1::installed", owners("/usr/bin/foo", oqt_full));
+    EXPECT_EQ("", owners("/usr/bin/fo", oqt_full));
+    EXPECT_EQ("cat/other-2::installed cat/pkg-1::installed", owners("/usr", oqt_full));
+    EXPECT_EQ("cat/pkg-1::installed", owners("bar", oqt_basename));
+    EXPECT_EQ("cat/other-2::installed", owners("libfoo.so", oqt_basename));
+    EXPECT_EQ("cat/pkg-1::installed", owners("/usr/bin/", oqt_prefix));
+    EXPECT_EQ("cat/other-2::installed cat/pkg-1::installed", owners("/usr/", oqt_prefix));
+    EXPECT_EQ("cat/other-2::installed", owners("lib", oqt_partial));
+    EXPECT_EQ("", owners("/nothing", oqt_prefix));
+
+    /* a new package appearing behind our back makes the index stale */
+    FSPath(FSPath("vdb_repository_TEST_dir") / "ownersrepo" / "cat" / "new-1").mkdir(0755, { });
+    EXPECT_EQ("unindexed", owners("/usr/bin/foo", oqt_full));
+}
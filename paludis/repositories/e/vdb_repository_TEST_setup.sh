@@ -82,6 +82,29 @@ echo "exheres-0" >repo2/category/package-1/EAPI
 echo "0" >repo2/category/package-1/SLOT
 echo "cat/pkg1 build: cat/pkg2 build+run: cat/pkg3 suggestion: cat/pkg4 post: cat/pkg5" >repo2/category/package-1/DEPENDENCIES
 
+mkdir -p indexrepo/cat/pkg-1 || exit 1
+echo "0" >indexrepo/cat/pkg-1/EAPI
+echo "0" >indexrepo/cat/pkg-1/SLOT
+echo "Indexed description" >indexrepo/cat/pkg-1/DESCRIPTION
+TZ=UTC touch -t 200001010000 indexrepo/cat/pkg-1 || exit 1
+
+mkdir -p ownersrepo/cat/{pkg-1,other-2} || exit 1
+for d in ownersrepo/cat/{pkg-1,other-2} ; do
+    echo "0" >${d}/EAPI
+    echo "0" >${d}/SLOT
+done
+cat <<END > ownersrepo/cat/pkg-1/CONTENTS
+dir /usr
+dir /usr/bin
+obj /usr/bin/foo d41d8cd98f00b204e9800998ecf8427e 1234567890
+sym /usr/bin/bar -> foo 1234567890
+END
+cat <<END > ownersrepo/cat/other-2/CONTENTS
+dir /usr
+dir /usr/lib
+obj /usr/lib/libfoo.so d41d8cd98f00b204e9800998ecf8427e 1234567890
+END
+
 mkdir -p reinstalltest reinstalltest_src{1,2}/{eclass,profiles/profile,cat/pkg} || exit 1
 
 cat <<END > reinstalltest_src1/profiles/profile/make.defaults
@@ -159,6 +159,12 @@ Repository::category_names_containing_package(const PackageNamePart & p, const R
     return result;
 }
 
+std::shared_ptr<const PackageIDSequence>
+Repository::ids_owning_path(const std::string &, const OwnerQueryType) const
+{
+    return nullptr;
+}
+
 void
 Repository::regenerate_cache() const
 {
@@ -192,6 +198,11 @@ Repository::can_drop_in_memory_cache() const
 {
 }
 
+void
+Repository::stop_idle_workers() const
+{
+}
+
 namespace paludis
 {
     template class Set<std::shared_ptr<Repository> >;
@@ -412,6 +412,19 @@ namespace paludis
             virtual const std::shared_ptr<const Set<std::string> > maybe_expand_licence_nonrecursively(
                     const std::string &) const = 0;
 
+            /**
+             * Which of our IDs own a path?
+             *
+             * May return a null pointer, if we don't keep an index of our
+             * contents, in which case the caller must search each ID's
+             * contents itself.
+             *
+             * \since 2.2.0
+             */
+            virtual std::shared_ptr<const PackageIDSequence> ids_owning_path(
+                    const std::string &, const OwnerQueryType) const
+                PALUDIS_ATTRIBUTE((warn_unused_result));
+
             ///\}
 
             ///\name Repository behaviour methods
@@ -464,6 +477,18 @@ namespace paludis
              */
             virtual void can_drop_in_memory_cache() const;
 
+            /**
+             * Stop any helper processes that we keep running between
+             * requests, along with the threads that look after them. They
+             * are started again if they are needed.
+             *
+             * Clients that need to be single threaded, for example to fork
+             * without exec()ing, must call this first.
+             *
+             * \since 2.2.0
+             */
+            virtual void stop_idle_workers() const;
+
             ///\}
 
             ///\name Set methods
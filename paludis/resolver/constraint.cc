@@ -116,6 +116,23 @@ Constraints::add(const std::shared_ptr<const Constraint> & c)
     _imp->any_force_unable = _imp->any_force_unable || c->force_unable();
 }
 
+void
+Constraints::remove(const std::shared_ptr<const Constraint> & c)
+{
+    if (_imp->constraints.end() == std::find(_imp->constraints.begin(), _imp->constraints.end(), c))
+        return;
+
+    /* recalculate everything from what's left */
+    Sequence<std::shared_ptr<const Constraint> > old;
+    std::copy(_imp->constraints.begin(), _imp->constraints.end(), old.back_inserter());
+
+    _imp.reset(new Imp<Constraints>());
+    for (auto o(old.begin()), o_end(old.end()) ;
+            o != o_end ; ++o)
+        if (*o != c)
+            add(*o);
+}
+
 bool
 Constraints::empty() const
 {
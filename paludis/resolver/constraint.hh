@@ -80,6 +80,13 @@ namespace paludis
 
                 void add(const std::shared_ptr<const Constraint> &);
 
+                /**
+                 * Remove a particular constraint, if we have it.
+                 *
+                 * \since 2.2.0
+                 */
+                void remove(const std::shared_ptr<const Constraint> &);
+
                 struct ConstIteratorTag;
                 typedef WrappedForwardIterator<ConstIteratorTag, const std::shared_ptr<const Constraint> > ConstIterator;
                 ConstIterator begin() const PALUDIS_ATTRIBUTE((warn_unused_result));
@@ -42,6 +42,7 @@
 #include <paludis/resolver/has_behaviour-fwd.hh>
 #include <paludis/resolver/get_sameness.hh>
 #include <paludis/resolver/destination_utils.hh>
+#include <paludis/resolver/selection_cache.hh>
 #include <paludis/util/exception.hh>
 #include <paludis/util/stringify.hh>
 #include <paludis/util/make_named_values.hh>
@@ -53,6 +54,9 @@
 #include <paludis/util/tribool.hh>
 #include <paludis/util/log.hh>
 #include <paludis/util/visitor_cast.hh>
+#include <paludis/util/save.hh>
+#include <paludis/util/hashes.hh>
+#include <paludis/util/task_scheduler.hh>
 #include <paludis/environment.hh>
 #include <paludis/notifier_callback.hh>
 #include <paludis/repository.hh>
@@ -80,10 +84,53 @@
 #include <algorithm>
 #include <map>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <exception>
+#include <vector>
 
 using namespace paludis;
 using namespace paludis::resolver;
 
+namespace
+{
+    /* the decisions that a constraint was derived from. empty means it came
+     * from a target, and null means we don't know. */
+    typedef std::list<Resolvent> ConstraintSources;
+
+    struct LoggedConstraint
+    {
+        Resolvent resolvent;
+        std::shared_ptr<const Constraint> constraint;
+        std::shared_ptr<const ConstraintSources> sources;
+        unsigned long step;
+    };
+
+    typedef std::list<LoggedConstraint> ConstraintLog;
+
+    const std::shared_ptr<const ConstraintSources> copied_constraint_sources(
+            const ConstraintLog & log,
+            const Resolvent & copy_from,
+            const std::shared_ptr<const Constraint> & constraint,
+            const Resolvent & copy_to)
+    {
+        auto result(std::make_shared<ConstraintSources>(1, copy_to));
+
+        /* things that aren't logged are initial constraints */
+        for (auto l(log.rbegin()), l_end(log.rend()) ;
+                l != l_end ; ++l)
+            if (l->constraint == constraint && l->resolvent == copy_from)
+            {
+                if (! l->sources)
+                    return nullptr;
+                std::copy(l->sources->begin(), l->sources->end(), std::back_inserter(*result));
+                break;
+            }
+
+        return result;
+    }
+}
+
 namespace paludis
 {
     template <>
@@ -93,20 +140,39 @@ namespace paludis
         const ResolverFunctions fns;
 
         const std::shared_ptr<ResolutionsByResolvent> resolutions_by_resolvent;
+        const std::shared_ptr<SelectionCache> selection_cache;
+
+        /* what we need to undo only part of our work when restarting */
+        unsigned long step;
+        bool constraint_log_complete;
+        ConstraintLog constraint_log;
+        std::unordered_map<Resolvent, unsigned long, Hash<Resolvent> > decided_at;
+        std::shared_ptr<const ConstraintSources> current_sources;
+        mutable std::shared_ptr<const ConstraintSources> interrupted_sources;
+        std::list<Resolvent> unapplied_wave;
+
+        unsigned expansion_threads;
+        std::unique_ptr<TaskScheduler> expansion_scheduler;
 
         Imp(const Environment * const e, const ResolverFunctions & f,
-                const std::shared_ptr<ResolutionsByResolvent> & l) :
+                const std::shared_ptr<ResolutionsByResolvent> & l,
+                const std::shared_ptr<SelectionCache> & c) :
             env(e),
             fns(f),
-            resolutions_by_resolvent(l)
+            resolutions_by_resolvent(l),
+            selection_cache(c),
+            step(0),
+            constraint_log_complete(true),
+            expansion_threads(1)
         {
         }
     };
 }
 
 Decider::Decider(const Environment * const e, const ResolverFunctions & f,
-        const std::shared_ptr<ResolutionsByResolvent> & l) :
-    _imp(e, f, l)
+        const std::shared_ptr<ResolutionsByResolvent> & l,
+        const std::shared_ptr<SelectionCache> & c) :
+    _imp(e, f, l, c)
 {
 }
 
@@ -129,6 +195,7 @@ Decider::_resolve_decide_with_dependencies()
             break;
 
         changed = false;
+        std::list<std::shared_ptr<Resolution> > wave;
         for (ResolutionsByResolvent::ConstIterator i(_imp->resolutions_by_resolvent->begin()),
                 i_end(_imp->resolutions_by_resolvent->end()) ;
                 i != i_end ; ++i)
@@ -153,8 +220,19 @@ Decider::_resolve_decide_with_dependencies()
             changed = true;
             _decide(*i);
 
-            _add_dependencies_if_necessary(*i);
+            if (_imp->expansion_threads > 1)
+            {
+                /* if we restart before this one's dependencies have been
+                 * added, its decision has to be undone too */
+                _imp->unapplied_wave.push_back((*i)->resolvent());
+                wave.push_back(*i);
+            }
+            else
+                _add_dependencies_if_necessary(*i);
         }
+
+        if (! wave.empty())
+            _add_dependencies_in_parallel(wave);
     }
 }
 
@@ -197,6 +275,9 @@ Decider::_resolve_vias()
 
         changed = true;
 
+        Save<std::shared_ptr<const ConstraintSources> > save_sources(&_imp->current_sources,
+                std::make_shared<ConstraintSources>(1, (*i)->resolvent()));
+
         const std::shared_ptr<const ConstraintSequence> constraints(_imp->fns.get_constraints_for_via_binary_fn()(binary_resolution, *i));
 
         for (ConstraintSequence::ConstIterator c(constraints->begin()), c_end(constraints->end()) ;
@@ -431,7 +512,7 @@ Decider::_make_change_type_for(
         const std::shared_ptr<const Resolution> & resolution,
         const ChangesToMakeDecision & decision) const
 {
-    Context context("When determining change type for '" + stringify(resolution->resolvent()) + "':");
+    Context context([&] () { return "When determining change type for '" + stringify(resolution->resolvent()) + "':"; });
 
     if (decision.destination()->replacing()->empty())
     {
@@ -627,6 +708,11 @@ Decider::_apply_resolution_constraint(
             _made_wrong_decision(resolution, constraint);
 
     resolution->constraints()->add(constraint);
+
+    if (_imp->current_sources)
+        _imp->constraint_log.push_back(LoggedConstraint{ resolution->resolvent(), constraint, _imp->current_sources, ++_imp->step });
+    else
+        _imp->constraint_log_complete = false;
 }
 
 namespace
@@ -941,6 +1027,8 @@ Decider::_made_wrong_decision(
     }
     else
         resolution->decision() = _cannot_decide_for(adapted_resolution);
+
+    _imp->decided_at[resolution->resolvent()] = ++_imp->step;
 }
 
 void
@@ -949,6 +1037,7 @@ Decider::_suggest_restart_with(
         const std::shared_ptr<const Constraint> & constraint,
         const std::shared_ptr<const Decision> & decision) const
 {
+    _imp->interrupted_sources = _imp->current_sources;
     throw SuggestRestart(resolution->resolvent(), resolution->decision(), constraint, decision,
             _make_constraint_for_preloading(decision, constraint));
 }
@@ -999,7 +1088,7 @@ Decider::_make_spec_for_preloading(const PackageDepSpec & spec,
 void
 Decider::_decide(const std::shared_ptr<Resolution> & resolution)
 {
-    Context context("When deciding upon an origin ID to use for '" + stringify(resolution->resolvent()) + "':");
+    Context context([&] () { return "When deciding upon an origin ID to use for '" + stringify(resolution->resolvent()) + "':"; });
 
     _copy_other_destination_constraints(resolution);
 
@@ -1009,6 +1098,8 @@ Decider::_decide(const std::shared_ptr<Resolution> & resolution)
         resolution->decision() = decision;
     else
         resolution->decision() = _cannot_decide_for(resolution);
+
+    _imp->decided_at[resolution->resolvent()] = ++_imp->step;
 }
 
 void
@@ -1031,6 +1122,11 @@ Decider::_copy_other_destination_constraints(const std::shared_ptr<Resolution> &
                 c_end(copy_from_resolution->constraints()->end()) ;
                 c != c_end ; ++c)
         {
+            /* copies go away if the original does, or if we undo the decision
+             * we're copying them for */
+            Save<std::shared_ptr<const ConstraintSources> > save_sources(&_imp->current_sources,
+                    copied_constraint_sources(_imp->constraint_log, copy_from_resolution->resolvent(), *c, resolution->resolvent()));
+
             const std::shared_ptr<ConstraintSequence> constraints(_make_constraints_from_other_destination(
                         resolution, copy_from_resolution, *c));
             for (ConstraintSequence::ConstIterator d(constraints->begin()), d_end(constraints->end()) ;
@@ -1083,9 +1179,15 @@ namespace
     };
 }
 
-void
-Decider::_add_dependencies_if_necessary(
-        const std::shared_ptr<Resolution> & our_resolution)
+struct Decider::ExpandedDependencies
+{
+    std::shared_ptr<const PackageID> package_id;
+    std::list<std::pair<Resolvent, std::shared_ptr<const ConstraintSequence> > > constraints;
+};
+
+const std::shared_ptr<const Decider::ExpandedDependencies>
+Decider::_expand_dependencies(
+        const std::shared_ptr<const Resolution> & our_resolution) const
 {
     std::shared_ptr<const PackageID> package_id;
     std::shared_ptr<const ChangedChoices> changed_choices;
@@ -1093,10 +1195,13 @@ Decider::_add_dependencies_if_necessary(
         std::pair<std::shared_ptr<const PackageID>, std::shared_ptr<const ChangedChoices> > >(DependenciesNecessityVisitor());
 
     if (! package_id)
-        return;
+        return nullptr;
 
-    Context context("When adding dependencies for '" + stringify(our_resolution->resolvent()) + "' with '"
-            + stringify(*package_id) + "':");
+    Context context([&] () { return "When adding dependencies for '" + stringify(our_resolution->resolvent()) + "' with '"
+                + stringify(*package_id) + "':"; });
+
+    const std::shared_ptr<ExpandedDependencies> result(std::make_shared<ExpandedDependencies>());
+    result->package_id = package_id;
 
     const std::shared_ptr<SanitisedDependencies> deps(std::make_shared<SanitisedDependencies>());
     deps->populate(_imp->env, *this, our_resolution, package_id, changed_choices);
@@ -1104,7 +1209,7 @@ Decider::_add_dependencies_if_necessary(
     for (SanitisedDependencies::ConstIterator s(deps->begin()), s_end(deps->end()) ;
             s != s_end ; ++s)
     {
-        Context context_2("When handling dependency '" + stringify(s->spec()) + "':");
+        Context context_2([&] () { return "When handling dependency '" + stringify(s->spec()) + "':"; });
 
         SpecInterest interest(_imp->fns.interest_in_spec_fn()(our_resolution, package_id, *s));
 
@@ -1145,13 +1250,86 @@ Decider::_add_dependencies_if_necessary(
                         s->spec().if_block() ? _block_dep_spec_has_nothing_installed(*s->spec().if_block(), package_id, *r) :
                         _package_dep_spec_already_met(*s->spec().if_package(), package_id)));
 
-            const std::shared_ptr<Resolution> dep_resolution(_resolution_for_resolvent(*r, true));
-            const std::shared_ptr<ConstraintSequence> constraints(_make_constraints_from_dependency(our_resolution, *s, reason, interest));
+            result->constraints.push_back(std::make_pair(*r, _make_constraints_from_dependency(our_resolution, *s, reason, interest)));
+        }
+    }
 
-            for (ConstraintSequence::ConstIterator c(constraints->begin()), c_end(constraints->end()) ;
-                    c != c_end ; ++c)
-                _apply_resolution_constraint(dep_resolution, *c);
+    return result;
+}
+
+void
+Decider::_apply_expanded_dependencies(
+        const std::shared_ptr<Resolution> & our_resolution,
+        const std::shared_ptr<const ExpandedDependencies> & expanded)
+{
+    if (! expanded)
+        return;
+
+    Context context([&] () { return "When adding dependencies for '" + stringify(our_resolution->resolvent()) + "' with '"
+                + stringify(*expanded->package_id) + "':"; });
+
+    Save<std::shared_ptr<const ConstraintSources> > save_sources(&_imp->current_sources,
+            std::make_shared<ConstraintSources>(1, our_resolution->resolvent()));
+
+    for (auto c(expanded->constraints.begin()), c_end(expanded->constraints.end()) ;
+            c != c_end ; ++c)
+    {
+        const std::shared_ptr<Resolution> dep_resolution(_resolution_for_resolvent(c->first, true));
+        for (ConstraintSequence::ConstIterator d(c->second->begin()), d_end(c->second->end()) ;
+                d != d_end ; ++d)
+            _apply_resolution_constraint(dep_resolution, *d);
+    }
+}
+
+void
+Decider::_add_dependencies_if_necessary(
+        const std::shared_ptr<Resolution> & our_resolution)
+{
+    _apply_expanded_dependencies(our_resolution, _expand_dependencies(our_resolution));
+}
+
+void
+Decider::_add_dependencies_in_parallel(
+        const std::list<std::shared_ptr<Resolution> > & our_resolutions)
+{
+    /* working out dependencies doesn't change anything, so it can be done for
+     * several resolutions at once. Applying the constraints is done
+     * afterwards, in order. This isn't quite what doing everything serially
+     * would give: there, a constraint from an earlier member of the wave would
+     * be applied before a later member is decided, whereas here it can
+     * contradict that decision and make us restart. */
+    const std::vector<std::shared_ptr<Resolution> > resolutions(our_resolutions.begin(), our_resolutions.end());
+    std::vector<std::shared_ptr<const ExpandedDependencies> > expanded(resolutions.size());
+    std::vector<std::exception_ptr> errors(resolutions.size());
+
+    /* the scheduler's workers outlive the wave, so we don't start threads
+     * for every one. every task has to finish before we leave, even if an
+     * earlier one failed, because they write into our locals */
+    std::vector<std::shared_ptr<Task> > tasks;
+    tasks.reserve(resolutions.size());
+    for (std::size_t n(0) ; n != resolutions.size() ; ++n)
+        tasks.push_back(_imp->expansion_scheduler->spawn([&, n] () {
+                    expanded[n] = _expand_dependencies(resolutions[n]);
+                    }));
+
+    for (std::size_t n(0) ; n != resolutions.size() ; ++n)
+    {
+        try
+        {
+            tasks[n]->wait();
         }
+        catch (...)
+        {
+            errors[n] = std::current_exception();
+        }
+    }
+
+    for (std::size_t n(0) ; n != resolutions.size() ; ++n)
+    {
+        if (errors[n])
+            std::rethrow_exception(errors[n]);
+        _apply_expanded_dependencies(resolutions[n], expanded[n]);
+        _imp->unapplied_wave.pop_front();
     }
 }
 
@@ -1161,8 +1339,8 @@ Decider::find_any_score(
         const std::shared_ptr<const PackageID> & our_id,
         const SanitisedDependency & dep) const
 {
-    Context context("When working out whether we'd like || child '" + stringify(dep.spec()) + "' because of '"
-            + stringify(our_resolution->resolvent()) + "':");
+    Context context([&] () { return "When working out whether we'd like || child '" + stringify(dep.spec()) + "' because of '"
+                + stringify(our_resolution->resolvent()) + "':"; });
 
     const bool is_block(dep.spec().if_block());
     const PackageDepSpec & spec(is_block ? dep.spec().if_block()->blocking() : *dep.spec().if_package());
@@ -1371,7 +1549,7 @@ const std::shared_ptr<const Resolvents>
 Decider::_get_resolvents_for_blocker(const BlockDepSpec & spec,
         const std::shared_ptr<const Reason> & reason) const
 {
-    Context context("When finding slots for '" + stringify(spec) + "':");
+    Context context([&] () { return "When finding slots for '" + stringify(spec) + "':"; });
 
     std::shared_ptr<SlotName> exact_slot;
     if (spec.blocking().slot_requirement_ptr())
@@ -1408,7 +1586,7 @@ Decider::_get_resolvents_for(
         const PackageDepSpec & spec,
         const std::shared_ptr<const Reason> & reason) const
 {
-    Context context("When finding slots for '" + stringify(spec) + "':");
+    Context context([&] () { return "When finding slots for '" + stringify(spec) + "':"; });
 
     std::shared_ptr<SlotName> exact_slot;
 
@@ -1426,7 +1604,7 @@ Decider::_get_error_resolvents_for(
         const PackageDepSpec & spec,
         const std::shared_ptr<const Reason> & reason) const
 {
-    Context context("When finding slots for '" + stringify(spec) + "', which can't be found the normal way:");
+    Context context([&] () { return "When finding slots for '" + stringify(spec) + "', which can't be found the normal way:"; });
 
     std::shared_ptr<Resolvents> result(std::make_shared<Resolvents>());
     DestinationTypes destination_types(_imp->fns.get_destination_types_for_error_fn()(spec, reason));
@@ -1718,12 +1896,15 @@ Decider::_allowed_to_remove(
 const std::shared_ptr<const PackageIDSequence>
 Decider::_installed_ids(const std::shared_ptr<const Resolution> & resolution) const
 {
-    Context context("When finding installed IDs for '" + stringify(resolution->resolvent()) + "':");
-
-    return (*_imp->env)[selection::AllVersionsSorted(
-            _imp->fns.make_destination_filtered_generator_fn()(generator::Package(resolution->resolvent().package()), resolution) |
-            make_slot_filter(resolution->resolvent())
-            )];
+    Context context([&] () { return "When finding installed IDs for '" + stringify(resolution->resolvent()) + "':"; });
+
+    return (*_imp->selection_cache)(resolution->resolvent().package(), "installed " + stringify(resolution->resolvent()),
+            [&] () {
+                return (*_imp->env)[selection::AllVersionsSorted(
+                    _imp->fns.make_destination_filtered_generator_fn()(generator::Package(resolution->resolvent().package()), resolution) |
+                    make_slot_filter(resolution->resolvent())
+                    )];
+            });
 }
 
 const std::shared_ptr<const PackageIDSequence>
@@ -1734,16 +1915,22 @@ Decider::_find_installable_id_candidates_for(
         const bool include_errors,
         const bool include_unmaskable) const
 {
-    Context context("When finding installable ID candidates for '" + stringify(package) + "':");
-
-    return _imp->fns.remove_hidden_fn()(
-            (*_imp->env)[_imp->fns.promote_binaries_fn()(
-                _imp->fns.make_origin_filtered_generator_fn()(generator::Package(package)) |
-                slot_filter |
-                destination_type_filter |
-                filter::SupportsAction<InstallAction>() |
-                (include_errors ? filter::All() : include_unmaskable ? _imp->fns.make_unmaskable_filter_fn()(package) : filter::NotMasked())
-                )]);
+    Context context([&] () { return "When finding installable ID candidates for '" + stringify(package) + "':"; });
+
+    /* the filters we're given only vary by slot and destination type, so
+     * their descriptions are enough to tell them apart */
+    return (*_imp->selection_cache)(package, "installable " + slot_filter.as_string() + " / " + destination_type_filter.as_string()
+            + " / " + stringify(include_errors) + stringify(include_unmaskable),
+            [&] () {
+                return _imp->fns.remove_hidden_fn()(
+                    (*_imp->env)[_imp->fns.promote_binaries_fn()(
+                        _imp->fns.make_origin_filtered_generator_fn()(generator::Package(package)) |
+                        slot_filter |
+                        destination_type_filter |
+                        filter::SupportsAction<InstallAction>() |
+                        (include_errors ? filter::All() : include_unmaskable ? _imp->fns.make_unmaskable_filter_fn()(package) : filter::NotMasked())
+                        )]);
+            });
 }
 
 const Decider::FoundID
@@ -1920,6 +2107,9 @@ Decider::add_target_with_reason(const PackageOrBlockDepSpec & spec, const std::s
 
     _imp->env->trigger_notifier_callback(NotifierCallbackResolverStepEvent());
 
+    Save<std::shared_ptr<const ConstraintSources> > save_sources(&_imp->current_sources,
+            std::make_shared<ConstraintSources>());
+
     /* empty resolvents is always ok for blockers, since blocking on things
      * that don't exist is fine */
     bool empty_is_ok(spec.if_block());
@@ -1948,6 +2138,106 @@ Decider::add_target_with_reason(const PackageOrBlockDepSpec & spec, const std::s
     }
 }
 
+void
+Decider::set_expansion_threads(const unsigned n)
+{
+    _imp->expansion_threads = n;
+    _imp->expansion_scheduler.reset(n > 1 ? new TaskScheduler(n) : nullptr);
+}
+
+bool
+Decider::undo_for_restart(const SuggestRestart & restart)
+{
+    Context context("When undoing decisions for a restart for '" + stringify(restart.resolvent()) + "':");
+
+    std::list<Resolvent> unapplied_wave;
+    unapplied_wave.swap(_imp->unapplied_wave);
+
+    /* constraints from dependents and purges depend upon everything, so we
+     * can't tell what to undo if we've had any of them */
+    if ((! _imp->constraint_log_complete) || (! _imp->interrupted_sources))
+        return false;
+
+    if (_imp->resolutions_by_resolvent->end() == _imp->resolutions_by_resolvent->find(restart.resolvent()))
+        return false;
+
+    std::unordered_multimap<Resolvent, ConstraintLog::iterator, Hash<Resolvent> > by_source;
+    std::unordered_map<Resolvent, unsigned, Hash<Resolvent> > remaining_constraints;
+    for (auto l(_imp->constraint_log.begin()), l_end(_imp->constraint_log.end()) ;
+            l != l_end ; ++l)
+    {
+        for (auto s(l->sources->begin()), s_end(l->sources->end()) ;
+                s != s_end ; ++s)
+            by_source.insert(std::make_pair(*s, l));
+        ++remaining_constraints[l->resolvent];
+    }
+
+    /* undo the decision we're restarting for, whatever we were in the
+     * middle of adding constraints for, and anything decided in the same wave
+     * whose dependencies we hadn't added yet. then undo anything whose
+     * decision was made using a constraint derived from something we've
+     * undone, or that nothing wants any more */
+    std::unordered_set<Resolvent, Hash<Resolvent> > undo;
+    std::set<const LoggedConstraint *> removed;
+    std::list<Resolvent> pending(_imp->interrupted_sources->begin(), _imp->interrupted_sources->end());
+    pending.push_back(restart.resolvent());
+    std::copy(unapplied_wave.begin(), unapplied_wave.end(), std::back_inserter(pending));
+
+    while (! pending.empty())
+    {
+        const Resolvent r(pending.front());
+        pending.pop_front();
+        if (! undo.insert(r).second)
+            continue;
+
+        auto derived(by_source.equal_range(r));
+        for (auto d(derived.first) ; d != derived.second ; ++d)
+        {
+            const ConstraintLog::iterator l(d->second);
+            if (! removed.insert(&*l).second)
+                continue;
+
+            auto decided(_imp->decided_at.find(l->resolvent));
+            if (0 == --remaining_constraints[l->resolvent] ||
+                    (_imp->decided_at.end() != decided && decided->second > l->step))
+                pending.push_back(l->resolvent);
+        }
+    }
+
+    for (auto l(_imp->constraint_log.begin()), l_end(_imp->constraint_log.end()) ;
+            l != l_end ; )
+        if (removed.end() != removed.find(&*l))
+        {
+            _resolution_for_resolvent(l->resolvent, false)->constraints()->remove(l->constraint);
+            _imp->constraint_log.erase(l++);
+        }
+        else
+            ++l;
+
+    for (auto u(undo.begin()), u_end(undo.end()) ;
+            u != u_end ; ++u)
+    {
+        _imp->decided_at.erase(*u);
+
+        /* if nothing wants it any more, starting from scratch wouldn't have
+         * given us a resolution for it at all */
+        if (0 == remaining_constraints[*u])
+            _imp->resolutions_by_resolvent->erase(*u);
+        else
+            _resolution_for_resolvent(*u, false)->decision() = nullptr;
+    }
+
+    /* the new preset is already there if our initial constraints are shared
+     * with whatever made them */
+    auto still_there(_resolution_for_resolvent(restart.resolvent(), indeterminate));
+    if (still_there && still_there->constraints()->end() == std::find(still_there->constraints()->begin(),
+                still_there->constraints()->end(), restart.suggested_preset()))
+        still_there->constraints()->add(restart.suggested_preset());
+
+    _imp->interrupted_sources.reset();
+    return true;
+}
+
 void
 Decider::purge()
 {
@@ -2029,11 +2319,23 @@ Decider::resolve()
 bool
 Decider::_package_dep_spec_already_met(const PackageDepSpec & spec, const std::shared_ptr<const PackageID> & from_id) const
 {
-    Context context("When determining already met for '" + stringify(spec) + "':");
+    Context context([&] () { return "When determining already met for '" + stringify(spec) + "':"; });
 
-    const std::shared_ptr<const PackageIDSequence> installed_ids((*_imp->env)[selection::AllVersionsUnsorted(
+    auto select([&] () {
+            return (*_imp->env)[selection::AllVersionsUnsorted(
                 generator::Matches(spec, from_id, { }) |
-                filter::InstalledAtRoot(_imp->env->system_root_key()->parse_value()))]);
+                filter::InstalledAtRoot(_imp->env->system_root_key()->parse_value()))];
+            });
+
+    /* from_id only matters for additional requirements and annotations */
+    std::shared_ptr<const PackageIDSequence> installed_ids;
+    if (spec.package_ptr())
+        installed_ids = (*_imp->selection_cache)(*spec.package_ptr(), "already met " + stringify(spec) +
+                ((from_id && (spec.additional_requirements_ptr() || spec.maybe_annotations())) ? " from " + stringify(*from_id) : ""),
+                select);
+    else
+        installed_ids = select();
+
     if (installed_ids->empty())
         return false;
     else
@@ -2050,7 +2352,7 @@ bool
 Decider::_block_dep_spec_has_nothing_installed(const BlockDepSpec & spec, const std::shared_ptr<const PackageID> & from_id,
         const Resolvent & resolvent) const
 {
-    Context context("When determining already met for '" + stringify(spec) + "':");
+    Context context([&] () { return "When determining already met for '" + stringify(spec) + "':"; });
 
     const std::shared_ptr<const PackageIDSequence> installed_ids((*_imp->env)[selection::SomeArbitraryVersion(
                 generator::Matches(spec.blocking(), from_id, { }) |
@@ -38,6 +38,8 @@
 #include <paludis/resolver/resolutions_by_resolvent-fwd.hh>
 #include <paludis/resolver/change_by_resolvent-fwd.hh>
 #include <paludis/resolver/why_changed_choices-fwd.hh>
+#include <paludis/resolver/selection_cache-fwd.hh>
+#include <paludis/resolver/suggest_restart-fwd.hh>
 #include <paludis/util/attributes.hh>
 #include <paludis/util/pimp.hh>
 #include <paludis/util/tribool-fwd.hh>
@@ -48,6 +50,7 @@
 #include <paludis/generator-fwd.hh>
 #include <paludis/changed_choices-fwd.hh>
 #include <paludis/name-fwd.hh>
+#include <list>
 #include <tuple>
 
 namespace paludis
@@ -167,9 +170,21 @@ namespace paludis
                 const std::shared_ptr<Decision> _cannot_decide_for(
                         const std::shared_ptr<const Resolution> & resolution) const;
 
+                struct ExpandedDependencies;
+
+                const std::shared_ptr<const ExpandedDependencies> _expand_dependencies(
+                        const std::shared_ptr<const Resolution> & our_resolution) const;
+
+                void _apply_expanded_dependencies(
+                        const std::shared_ptr<Resolution> & our_resolution,
+                        const std::shared_ptr<const ExpandedDependencies> &);
+
                 void _add_dependencies_if_necessary(
                         const std::shared_ptr<Resolution> & our_resolution);
 
+                void _add_dependencies_in_parallel(
+                        const std::list<std::shared_ptr<Resolution> > & our_resolutions);
+
                 const std::shared_ptr<const PackageID> _find_existing_id_for(
                         const std::shared_ptr<const Resolution> &) const;
 
@@ -234,11 +249,31 @@ namespace paludis
             public:
                 Decider(const Environment * const,
                         const ResolverFunctions &,
-                        const std::shared_ptr<ResolutionsByResolvent> &);
+                        const std::shared_ptr<ResolutionsByResolvent> &,
+                        const std::shared_ptr<SelectionCache> &);
                 ~Decider();
 
                 void resolve();
 
+                /**
+                 * Undo only those decisions that could have been affected by
+                 * a SuggestRestart thrown by resolve(), so that resolve() can
+                 * be called again. Returns false if we can't tell, in which
+                 * case a new Decider must be used.
+                 *
+                 * \since 2.2.0
+                 */
+                bool undo_for_restart(const SuggestRestart &) PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * If more than one, work out the dependencies of resolutions
+                 * decided in the same pass using this many threads. Only
+                 * applying the resulting constraints is done serially.
+                 *
+                 * \since 2.2.0
+                 */
+                void set_expansion_threads(const unsigned);
+
                 void add_target_with_reason(const PackageOrBlockDepSpec &, const std::shared_ptr<const Reason> &);
 
                 void purge();
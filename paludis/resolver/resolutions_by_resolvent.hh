@@ -49,6 +49,11 @@ namespace paludis
 
                 ConstIterator insert_new(const std::shared_ptr<Resolution> &);
 
+                /**
+                 * \since 2.2.0
+                 */
+                void erase(const Resolvent &);
+
                 void serialise(Serialiser &) const;
 
                 static const std::shared_ptr<ResolutionsByResolvent> deserialise(
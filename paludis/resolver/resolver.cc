@@ -28,6 +28,7 @@
 #include <paludis/resolver/job_list.hh>
 #include <paludis/resolver/job_lists.hh>
 #include <paludis/resolver/nag.hh>
+#include <paludis/resolver/selection_cache.hh>
 #include <paludis/util/stringify.hh>
 #include <paludis/util/sequence.hh>
 #include <paludis/util/wrapped_forward_iterator.hh>
@@ -59,7 +60,7 @@ namespace paludis
         const std::shared_ptr<Decider> decider;
         const std::shared_ptr<Orderer> orderer;
 
-        Imp(const Environment * const e, const ResolverFunctions & f) :
+        Imp(const Environment * const e, const ResolverFunctions & f, const std::shared_ptr<SelectionCache> & c) :
             env(e),
             fns(f),
             resolved(std::make_shared<Resolved>(make_named_values<Resolved>(
@@ -76,7 +77,7 @@ namespace paludis
                             n::untaken_change_or_remove_decisions() = std::make_shared<Decisions<ChangeOrRemoveDecision>>(),
                             n::untaken_unable_to_make_decisions() = std::make_shared<Decisions<UnableToMakeDecision>>()
                             ))),
-            decider(std::make_shared<Decider>(e, f, resolved->resolutions_by_resolvent())),
+            decider(std::make_shared<Decider>(e, f, resolved->resolutions_by_resolvent(), c)),
             orderer(std::make_shared<Orderer>(e, f, resolved))
         {
         }
@@ -84,7 +85,12 @@ namespace paludis
 }
 
 Resolver::Resolver(const Environment * const e, const ResolverFunctions & f) :
-    _imp(e, f)
+    _imp(e, f, std::make_shared<SelectionCache>())
+{
+}
+
+Resolver::Resolver(const Environment * const e, const ResolverFunctions & f, const std::shared_ptr<SelectionCache> & c) :
+    _imp(e, f, c)
 {
 }
 
@@ -175,6 +181,18 @@ Resolver::resolve()
     _imp->env->trigger_notifier_callback(NotifierCallbackResolverStageEvent("Done"));
 }
 
+bool
+Resolver::undo_for_restart(const SuggestRestart & e)
+{
+    return _imp->decider->undo_for_restart(e);
+}
+
+void
+Resolver::set_expansion_threads(const unsigned n)
+{
+    _imp->decider->set_expansion_threads(n);
+}
+
 const std::shared_ptr<const Resolved>
 Resolver::resolved() const
 {
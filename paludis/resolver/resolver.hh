@@ -25,6 +25,8 @@
 #include <paludis/resolver/resolver_functions-fwd.hh>
 #include <paludis/resolver/decider-fwd.hh>
 #include <paludis/resolver/resolved-fwd.hh>
+#include <paludis/resolver/selection_cache-fwd.hh>
+#include <paludis/resolver/suggest_restart-fwd.hh>
 #include <paludis/resolver/sanitised_dependencies-fwd.hh>
 #include <paludis/resolver/package_or_block_dep_spec-fwd.hh>
 #include <paludis/util/pimp.hh>
@@ -51,6 +53,18 @@ namespace paludis
                 Resolver(
                         const Environment * const,
                         const ResolverFunctions &);
+
+                /**
+                 * Use a SelectionCache that may be shared with other Resolver
+                 * instances, for example when restarting.
+                 *
+                 * \since 2.2.0
+                 */
+                Resolver(
+                        const Environment * const,
+                        const ResolverFunctions &,
+                        const std::shared_ptr<SelectionCache> &);
+
                 ~Resolver();
 
                 void add_target(const PackageOrBlockDepSpec &, const std::string & extra_information);
@@ -59,6 +73,27 @@ namespace paludis
 
                 void resolve();
 
+                /**
+                 * After resolve() throws a SuggestRestart, try to undo only the
+                 * decisions affected by it, so that resolve() can be called
+                 * again without adding targets again. Returns false if this
+                 * isn't possible, in which case a new Resolver must be used.
+                 *
+                 * The suggested preset must already be available via the
+                 * get_initial_constraints_for_fn.
+                 *
+                 * \since 2.2.0
+                 */
+                bool undo_for_restart(const SuggestRestart &) PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Work out dependencies for several resolutions at once, using
+                 * this many threads. The default is 1.
+                 *
+                 * \since 2.2.0
+                 */
+                void set_expansion_threads(const unsigned);
+
                 const std::shared_ptr<const Resolved> resolved() const PALUDIS_ATTRIBUTE((warn_unused_result));
         };
     }
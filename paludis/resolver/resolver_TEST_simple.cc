@@ -111,6 +111,31 @@ TEST_F(ResolverSimpleTestCase, BuildDeps)
             );
 }
 
+TEST_F(ResolverSimpleTestCase, BuildDepsParallelExpansion)
+{
+    data->expansion_threads = 4;
+    std::shared_ptr<const Resolved> resolved(data->get_resolved("build-deps/target"));
+
+    this->check_resolved(resolved,
+            n::taken_change_or_remove_decisions() = make_shared_copy(DecisionChecks()
+                .change(QualifiedPackageName("build-deps/a-dep"))
+                .change(QualifiedPackageName("build-deps/b-dep"))
+                .change(QualifiedPackageName("build-deps/z-dep"))
+                .change(QualifiedPackageName("build-deps/target"))
+                .finished()),
+            n::taken_unable_to_make_decisions() = make_shared_copy(DecisionChecks()
+                .finished()),
+            n::taken_unconfirmed_decisions() = make_shared_copy(DecisionChecks()
+                .finished()),
+            n::taken_unorderable_decisions() = make_shared_copy(DecisionChecks()
+                .finished()),
+            n::untaken_change_or_remove_decisions() = make_shared_copy(DecisionChecks()
+                .finished()),
+            n::untaken_unable_to_make_decisions() = make_shared_copy(DecisionChecks()
+                .finished())
+            );
+}
+
 TEST_F(ResolverSimpleTestCase, RunDeps)
 {
     std::shared_ptr<const Resolved> resolved(data->get_resolved("run-deps/target"));
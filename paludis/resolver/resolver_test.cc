@@ -30,6 +30,7 @@
 #include <paludis/resolver/reason.hh>
 #include <paludis/resolver/change_by_resolvent.hh>
 #include <paludis/resolver/labels_classifier.hh>
+#include <paludis/resolver/selection_cache.hh>
 
 #include <paludis/util/map.hh>
 #include <paludis/util/sequence.hh>
@@ -99,7 +100,8 @@ ResolverTestData::ResolverTestData(const std::string & t, const std::string & e,
     promote_binaries_helper(&env),
     remove_hidden_helper(&env),
     remove_if_dependent_helper(&env),
-    get_resolvents_for_helper(&env, std::cref(remove_hidden_helper))
+    get_resolvents_for_helper(&env, std::cref(remove_hidden_helper)),
+    expansion_threads(1)
 {
     std::shared_ptr<Map<std::string, std::string> > keys(std::make_shared<Map<std::string, std::string>>());
     keys->insert("format", "e");
@@ -197,18 +199,26 @@ ResolverTestData::get_resolver_functions()
 const std::shared_ptr<const Resolved>
 ResolverTestData::get_resolved(const PackageOrBlockDepSpec & target)
 {
+    const std::shared_ptr<SelectionCache> selection_cache(std::make_shared<SelectionCache>());
+    std::shared_ptr<Resolver> resolver;
     while (true)
     {
         try
         {
-            Resolver resolver(&env, get_resolver_functions());
-            resolver.add_target(target, "");
-            resolver.resolve();
-            return resolver.resolved();
+            if (! resolver)
+            {
+                resolver = std::make_shared<Resolver>(&env, get_resolver_functions(), selection_cache);
+                resolver->set_expansion_threads(expansion_threads);
+                resolver->add_target(target, "");
+            }
+            resolver->resolve();
+            return resolver->resolved();
         }
         catch (const SuggestRestart & e)
         {
             get_initial_constraints_for_helper.add_suggested_restart(e);
+            if (! resolver->undo_for_restart(e))
+                resolver.reset();
         }
     }
 }
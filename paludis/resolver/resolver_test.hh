@@ -120,6 +120,8 @@ namespace paludis
                 RemoveIfDependentHelper remove_if_dependent_helper;
                 GetResolventsForHelper get_resolvents_for_helper;
 
+                unsigned expansion_threads;
+
                 ResolverTestData(const std::string & group, const std::string & eapi, const std::string & layout);
 
                 ResolverFunctions get_resolver_functions();
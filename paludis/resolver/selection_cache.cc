@@ -0,0 +1,126 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/resolver/selection_cache.hh>
+#include <paludis/util/pimp-impl.hh>
+#include <paludis/util/hashes.hh>
+#include <paludis/name.hh>
+#include <paludis/package_id.hh>
+#include <paludis/repository.hh>
+#include <paludis/util/sequence.hh>
+#include <paludis/util/wrapped_forward_iterator.hh>
+
+#include <mutex>
+#include <unordered_map>
+
+using namespace paludis;
+using namespace paludis::resolver;
+
+namespace
+{
+    typedef std::unordered_map<std::string, std::shared_ptr<const PackageIDSequence>, Hash<std::string> > Results;
+    typedef std::unordered_map<QualifiedPackageName, Results, Hash<QualifiedPackageName> > ResultsByPackage;
+
+    bool mentions(const Results & results, const RepositoryName & repository)
+    {
+        for (auto r(results.begin()), r_end(results.end()) ;
+                r != r_end ; ++r)
+            for (auto i(r->second->begin()), i_end(r->second->end()) ;
+                    i != i_end ; ++i)
+                if ((*i)->repository_name() == repository)
+                    return true;
+
+        return false;
+    }
+}
+
+namespace paludis
+{
+    template <>
+    struct Imp<SelectionCache>
+    {
+        mutable std::mutex mutex;
+        mutable ResultsByPackage results;
+    };
+}
+
+SelectionCache::SelectionCache() :
+    _imp()
+{
+}
+
+SelectionCache::~SelectionCache() = default;
+
+const std::shared_ptr<const PackageIDSequence>
+SelectionCache::operator() (
+        const QualifiedPackageName & name,
+        const std::string & key,
+        const std::function<std::shared_ptr<const PackageIDSequence> ()> & f) const
+{
+    {
+        std::unique_lock<std::mutex> lock(_imp->mutex);
+        auto p(_imp->results.find(name));
+        if (_imp->results.end() != p)
+        {
+            auto r(p->second.find(key));
+            if (p->second.end() != r)
+                return r->second;
+        }
+    }
+
+    /* don't hold the lock whilst selecting, since that can take a while, and
+     * two threads asking the same question at once get the same answer */
+    const std::shared_ptr<const PackageIDSequence> result(f());
+
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+    return _imp->results[name].insert(std::make_pair(key, result)).first->second;
+}
+
+void
+SelectionCache::invalidate(const QualifiedPackageName & name)
+{
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+    _imp->results.erase(name);
+}
+
+void
+SelectionCache::invalidate(const Repository & repository)
+{
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+    for (auto p(_imp->results.begin()) ; p != _imp->results.end() ; )
+    {
+        /* packages it has gained IDs for, and packages it has lost them for */
+        if (repository.has_package_named(p->first, { }) || mentions(p->second, repository.name()))
+            p = _imp->results.erase(p);
+        else
+            ++p;
+    }
+}
+
+void
+SelectionCache::invalidate_all()
+{
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+    _imp->results.clear();
+}
+
+namespace paludis
+{
+    template class Pimp<resolver::SelectionCache>;
+}
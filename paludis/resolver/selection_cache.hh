@@ -0,0 +1,92 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_RESOLVER_SELECTION_CACHE_HH
+#define PALUDIS_GUARD_PALUDIS_RESOLVER_SELECTION_CACHE_HH 1
+
+#include <paludis/resolver/selection_cache-fwd.hh>
+#include <paludis/util/pimp.hh>
+#include <paludis/util/attributes.hh>
+#include <paludis/package_id-fwd.hh>
+#include <paludis/name-fwd.hh>
+#include <paludis/repository-fwd.hh>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace paludis
+{
+    namespace resolver
+    {
+        /**
+         * Remembers the results of environment selections made whilst
+         * resolving, so that asking the same question again (including after a
+         * restart, if the cache is shared between Resolver instances) does not
+         * mean running every generator and filter again.
+         *
+         * Entries are grouped by package name, and the key must describe
+         * everything else that the selection depends upon.
+         *
+         * \since 2.2.0
+         */
+        class PALUDIS_VISIBLE SelectionCache
+        {
+            private:
+                Pimp<SelectionCache> _imp;
+
+            public:
+                SelectionCache();
+                ~SelectionCache();
+
+                SelectionCache(const SelectionCache &) = delete;
+                SelectionCache & operator= (const SelectionCache &) = delete;
+
+                /**
+                 * Return the remembered result for the given package name and
+                 * key, or call the function and remember what it returns.
+                 */
+                const std::shared_ptr<const PackageIDSequence> operator() (
+                        const QualifiedPackageName &,
+                        const std::string & key,
+                        const std::function<std::shared_ptr<const PackageIDSequence> ()> &) const
+                    PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * Forget everything about a package, for example because a
+                 * repository containing it has changed.
+                 */
+                void invalidate(const QualifiedPackageName &);
+
+                /**
+                 * Forget everything about packages that a repository has, or
+                 * had when we remembered them, because it has changed.
+                 */
+                void invalidate(const Repository &);
+
+                /**
+                 * Forget everything.
+                 */
+                void invalidate_all();
+        };
+    }
+
+    extern template class Pimp<resolver::SelectionCache>;
+}
+
+#endif
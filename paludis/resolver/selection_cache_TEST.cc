@@ -0,0 +1,152 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/resolver/selection_cache.hh>
+
+#include <paludis/environments/test/test_environment.hh>
+
+#include <paludis/repositories/fake/fake_repository.hh>
+#include <paludis/repositories/fake/fake_package_id.hh>
+
+#include <paludis/generator.hh>
+#include <paludis/filtered_generator.hh>
+#include <paludis/selection.hh>
+
+#include <paludis/util/sequence.hh>
+#include <paludis/util/make_named_values.hh>
+
+#include <gtest/gtest.h>
+
+using namespace paludis;
+using namespace paludis::resolver;
+
+namespace
+{
+    struct SelectionCacheTest :
+        testing::Test
+    {
+        TestEnvironment env;
+        std::shared_ptr<FakeRepository> repo1, repo2;
+        SelectionCache cache;
+        int calls;
+
+        SelectionCacheTest() :
+            repo1(std::make_shared<FakeRepository>(make_named_values<FakeRepositoryParams>(
+                            n::environment() = &env,
+                            n::name() = RepositoryName("repo1")))),
+            repo2(std::make_shared<FakeRepository>(make_named_values<FakeRepositoryParams>(
+                            n::environment() = &env,
+                            n::name() = RepositoryName("repo2")))),
+            calls(0)
+        {
+            env.add_repository(1, repo1);
+            env.add_repository(2, repo2);
+
+            repo1->add_version("cat", "one", "1");
+            repo2->add_version("cat", "two", "1");
+        }
+
+        const std::shared_ptr<const PackageIDSequence> select(const std::string & name, const std::string & key)
+        {
+            const QualifiedPackageName qpn(name);
+            return cache(qpn, key, [&] () {
+                    ++calls;
+                    return env[selection::AllVersionsSorted(generator::Package(qpn))];
+                    });
+        }
+    };
+}
+
+TEST_F(SelectionCacheTest, Hits)
+{
+    auto first(select("cat/one", "all"));
+    auto second(select("cat/one", "all"));
+
+    EXPECT_EQ(1, calls);
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(1, std::distance(first->begin(), first->end()));
+}
+
+TEST_F(SelectionCacheTest, KeysAreSeparate)
+{
+    select("cat/one", "all");
+    select("cat/one", "something else");
+    select("cat/two", "all");
+    EXPECT_EQ(3, calls);
+
+    select("cat/one", "all");
+    select("cat/one", "something else");
+    select("cat/two", "all");
+    EXPECT_EQ(3, calls);
+}
+
+TEST_F(SelectionCacheTest, InvalidatePackage)
+{
+    select("cat/one", "all");
+    select("cat/two", "all");
+
+    cache.invalidate(QualifiedPackageName("cat/one"));
+
+    select("cat/one", "all");
+    select("cat/two", "all");
+    EXPECT_EQ(3, calls);
+}
+
+TEST_F(SelectionCacheTest, InvalidateAll)
+{
+    select("cat/one", "all");
+    select("cat/two", "all");
+
+    cache.invalidate_all();
+
+    select("cat/one", "all");
+    select("cat/two", "all");
+    EXPECT_EQ(4, calls);
+}
+
+TEST_F(SelectionCacheTest, InvalidateRepository)
+{
+    select("cat/one", "all");
+    select("cat/two", "all");
+    select("cat/three", "all");
+
+    /* repo1 gains a package we've already asked about and found nothing */
+    repo1->add_version("cat", "three", "1");
+    cache.invalidate(*repo1);
+
+    auto three(select("cat/three", "all"));
+    EXPECT_EQ(1, std::distance(three->begin(), three->end()));
+    select("cat/one", "all");
+    select("cat/two", "all");
+    EXPECT_EQ(5, calls);
+}
+
+TEST_F(SelectionCacheTest, InvalidateRepositoryWithRemembered)
+{
+    select("cat/one", "all");
+    select("cat/two", "all");
+
+    /* cat/two has an ID from repo2 remembered, even though we don't check
+     * whether repo2 still has it */
+    cache.invalidate(*repo2);
+
+    select("cat/one", "all");
+    select("cat/two", "all");
+    EXPECT_EQ(3, calls);
+}
@@ -89,7 +89,7 @@ Selection::operator= (const Selection & other)
 std::shared_ptr<PackageIDSequence>
 Selection::perform_select(const Environment * const env) const
 {
-    Context context("When finding " + _imp->handler->as_string() + ":");
+    Context context([&] () { return "When finding " + _imp->handler->as_string() + ":"; });
     return _imp->handler->perform_select(env);
 }
 
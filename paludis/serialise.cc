@@ -24,6 +24,7 @@
 #include <paludis/util/sequence-impl.hh>
 #include <paludis/util/join.hh>
 #include <paludis/util/member_iterator-impl.hh>
+#include <paludis/util/hashes.hh>
 #include <paludis/package_id.hh>
 #include <paludis/dep_spec.hh>
 #include <paludis/selection.hh>
@@ -33,9 +34,76 @@
 #include <paludis/elike_package_dep_spec.hh>
 #include <list>
 #include <map>
+#include <unordered_map>
+#include <vector>
 
 using namespace paludis;
 
+#include <paludis/serialise-se.cc>
+
+/*
+ * The sf_binary format starts with binary_magic, and is then a single
+ * record. A record is one of:
+ *
+ *     's' string                  a string value
+ *     'n'                         null
+ *     'o' string ('m' string record)* 'e'
+ *                                 an object, with its class name and then
+ *                                 each member's name and value
+ *
+ * A string is a variable length integer n. If n is zero, it is followed by
+ * a variable length integer giving the string's length and then its
+ * content, and is remembered as the next string in the table. Otherwise it
+ * is entry n - 1 in the table. Integers are written seven bits at a time,
+ * least significant first, with the top bit set on all but the last byte.
+ */
+
+namespace
+{
+    const std::string binary_magic("\0PALSER\1", 8);
+}
+
+namespace paludis
+{
+    template <>
+    struct Imp<Serialiser>
+    {
+        std::ostream & stream;
+        const SerialisationFormat format;
+        std::unordered_map<std::string, unsigned, Hash<std::string> > strings;
+
+        Imp(std::ostream & s, const SerialisationFormat f) :
+            stream(s),
+            format(f)
+        {
+        }
+
+        void write_number(unsigned n)
+        {
+            while (n >= 0x80)
+            {
+                stream.put(static_cast<char>((n & 0x7f) | 0x80));
+                n >>= 7;
+            }
+            stream.put(static_cast<char>(n));
+        }
+
+        void write_binary_string(const std::string & s)
+        {
+            auto i(strings.find(s));
+            if (strings.end() != i)
+                write_number(i->second + 1);
+            else
+            {
+                write_number(0);
+                write_number(s.length());
+                stream.write(s.data(), s.length());
+                strings.insert(std::make_pair(s, strings.size()));
+            }
+        }
+    };
+}
+
 SerialiserObjectWriter::SerialiserObjectWriter(Serialiser & s) :
     _serialiser(s)
 {
@@ -43,12 +111,19 @@ SerialiserObjectWriter::SerialiserObjectWriter(Serialiser & s) :
 
 SerialiserObjectWriter::~SerialiserObjectWriter()
 {
-    _serialiser.raw_stream() << ");";
+    _serialiser.write_object_end();
 }
 
 Serialiser::Serialiser(std::ostream & s) :
-    _stream(s)
+    _imp(s, sf_text)
+{
+}
+
+Serialiser::Serialiser(std::ostream & s, const SerialisationFormat f) :
+    _imp(s, f)
 {
+    if (sf_binary == _imp->format)
+        _imp->stream << binary_magic;
 }
 
 Serialiser::~Serialiser()
@@ -58,45 +133,143 @@ Serialiser::~Serialiser()
 std::ostream &
 Serialiser::raw_stream()
 {
-    return _stream;
+    return _imp->stream;
 }
 
 SerialiserObjectWriter
 Serialiser::object(const std::string & c)
 {
-    raw_stream() << c << "(";
+    write_object_start(c);
     return SerialiserObjectWriter(*this);
 }
 
+void
+Serialiser::write_object_start(const std::string & c)
+{
+    switch (_imp->format)
+    {
+        case sf_text:
+            raw_stream() << c << "(";
+            return;
+
+        case sf_binary:
+            raw_stream().put('o');
+            _imp->write_binary_string(c);
+            return;
+
+        case last_sf:
+            break;
+    }
+
+    throw InternalError(PALUDIS_HERE, "bad SerialisationFormat");
+}
+
+void
+Serialiser::write_member_name(const std::string & n)
+{
+    switch (_imp->format)
+    {
+        case sf_text:
+            raw_stream() << n << "=";
+            return;
+
+        case sf_binary:
+            raw_stream().put('m');
+            _imp->write_binary_string(n);
+            return;
+
+        case last_sf:
+            break;
+    }
+
+    throw InternalError(PALUDIS_HERE, "bad SerialisationFormat");
+}
+
+void
+Serialiser::write_object_end()
+{
+    switch (_imp->format)
+    {
+        case sf_text:
+            raw_stream() << ");";
+            return;
+
+        case sf_binary:
+            raw_stream().put('e');
+            return;
+
+        case last_sf:
+            break;
+    }
+
+    throw InternalError(PALUDIS_HERE, "bad SerialisationFormat");
+}
+
+void
+Serialiser::write_string(const std::string & t)
+{
+    switch (_imp->format)
+    {
+        case sf_text:
+            raw_stream() << "\"";
+            escape_write(t);
+            raw_stream() << "\";";
+            return;
+
+        case sf_binary:
+            raw_stream().put('s');
+            _imp->write_binary_string(t);
+            return;
+
+        case last_sf:
+            break;
+    }
+
+    throw InternalError(PALUDIS_HERE, "bad SerialisationFormat");
+}
+
+void
+Serialiser::write_null()
+{
+    switch (_imp->format)
+    {
+        case sf_text:
+            raw_stream() << "null;";
+            return;
+
+        case sf_binary:
+            raw_stream().put('n');
+            return;
+
+        case last_sf:
+            break;
+    }
+
+    throw InternalError(PALUDIS_HERE, "bad SerialisationFormat");
+}
+
 void
 SerialiserObjectWriterHandler<false, false, bool>::write(Serialiser & s, const bool t)
 {
-    if (t)
-        s.raw_stream() << "\"true\";";
-    else
-        s.raw_stream() << "\"false\";";
+    s.write_string(t ? "true" : "false");
 }
 
 void
 SerialiserObjectWriterHandler<false, false, int>::write(Serialiser & s, const int i)
 {
-    s.raw_stream() << "\"" << i << "\";";
+    s.write_string(stringify(i));
 }
 
 void
 SerialiserObjectWriterHandler<false, false, std::string>::write(Serialiser & s, const std::string & t)
 {
-    s.raw_stream() << "\"";
-    s.escape_write(t);
-    s.raw_stream() << "\";";
+    s.write_string(t);
 }
 
 void
 SerialiserObjectWriterHandler<false, false, const PackageID>::write(Serialiser & s, const PackageID & t)
 {
-    s.raw_stream() << "\"";
-    s.escape_write(stringify(t.uniquely_identifying_spec()));
-    s.raw_stream() << "\";";
+    s.write_string(stringify(t.uniquely_identifying_spec()));
 }
 
 void
@@ -126,11 +299,31 @@ namespace paludis
         const Environment * const env;
         std::istream & stream;
 
+        SerialisationFormat format;
+        std::vector<std::string> strings;
+
+        mutable std::unordered_map<std::string, std::shared_ptr<const PackageID>, Hash<std::string> > package_ids;
+
         Imp(const Environment * const e, std::istream & s) :
             env(e),
-            stream(s)
+            stream(s),
+            format(sf_text)
         {
         }
+
+        unsigned read_number()
+        {
+            unsigned result(0);
+            for (unsigned shift(0) ; ; shift += 7)
+            {
+                char c;
+                if (shift > 28 || ! stream.get(c))
+                    throw InternalError(PALUDIS_HERE, "can't parse number");
+                result |= static_cast<unsigned>(static_cast<unsigned char>(c) & 0x7f) << shift;
+                if (! (c & 0x80))
+                    return result;
+            }
+        }
     };
 
     template <>
@@ -174,6 +367,13 @@ namespace paludis
 Deserialiser::Deserialiser(const Environment * const e, std::istream & s) :
     _imp(e, s)
 {
+    if (binary_magic[0] == _imp->stream.peek())
+    {
+        std::string magic(binary_magic.length(), '\0');
+        if ((! _imp->stream.read(&magic[0], magic.length())) || magic != binary_magic)
+            throw InternalError(PALUDIS_HERE, "unknown binary serialisation version");
+        _imp->format = sf_binary;
+    }
 }
 
 Deserialiser::~Deserialiser()
@@ -192,6 +392,51 @@ Deserialiser::environment() const
     return _imp->env;
 }
 
+SerialisationFormat
+Deserialiser::format() const
+{
+    return _imp->format;
+}
+
+const std::string
+Deserialiser::read_binary_string()
+{
+    unsigned n(_imp->read_number());
+    if (0 != n)
+    {
+        if (n > _imp->strings.size())
+            throw InternalError(PALUDIS_HERE, "can't parse string");
+        return _imp->strings[n - 1];
+    }
+
+    std::string result(_imp->read_number(), '\0');
+    if ((! result.empty()) && ! _imp->stream.read(&result[0], result.length()))
+        throw InternalError(PALUDIS_HERE, "can't parse string");
+    _imp->strings.push_back(result);
+    return result;
+}
+
+const std::shared_ptr<const PackageID>
+Deserialiser::package_id(const std::string & s) const
+{
+    auto i(_imp->package_ids.find(s));
+    if (_imp->package_ids.end() != i)
+        return i->second;
+
+    auto id(*(*_imp->env)[selection::RequireExactlyOne(generator::Matches(
+                    parse_elike_package_dep_spec(s,
+                        { epdso_allow_tilde_greater_deps, epdso_nice_equal_star,
+                        epdso_allow_ranged_deps, epdso_allow_use_deps, epdso_allow_use_deps_portage,
+                        epdso_allow_use_dep_defaults, epdso_allow_repository_deps, epdso_allow_slot_star_deps,
+                        epdso_allow_slot_equal_deps, epdso_allow_slot_equal_deps_portage,
+                        epdso_allow_slot_deps, epdso_allow_key_requirements,
+                        epdso_allow_use_dep_question_defaults, epdso_allow_subslot_deps },
+                        { vso_flexible_dashes, vso_flexible_dots, vso_ignore_case,
+                        vso_letters_anywhere, vso_dotted_suffixes }), nullptr, { }))]->begin());
+
+    return _imp->package_ids.insert(std::make_pair(s, id)).first->second;
+}
+
 Deserialisation::Deserialisation(const std::string & i, Deserialiser & d) :
     _imp(d, i)
 {
@@ -199,6 +444,38 @@ Deserialisation::Deserialisation(const std::string & i, Deserialiser & d) :
     if (! d.stream().get(c))
         throw InternalError(PALUDIS_HERE, "can't parse string");
 
+    if (sf_binary == d.format())
+    {
+        switch (c)
+        {
+            case 's':
+                _imp->string_value = d.read_binary_string();
+                return;
+
+            case 'n':
+                _imp->null = true;
+                return;
+
+            case 'o':
+                _imp->class_name = d.read_binary_string();
+                while (true)
+                {
+                    if (! d.stream().get(c))
+                        throw InternalError(PALUDIS_HERE, "can't parse object");
+                    if (c == 'e')
+                        break;
+                    else if (c != 'm')
+                        throw InternalError(PALUDIS_HERE, "can't parse object");
+
+                    const std::string k(d.read_binary_string());
+                    _imp->children.push_back(std::make_shared<Deserialisation>(k, d));
+                }
+                return;
+        }
+
+        throw InternalError(PALUDIS_HERE, "can't parse record");
+    }
+
     if (c == '"')
     {
         while (true)
@@ -368,21 +645,12 @@ DeserialisatorHandler<std::shared_ptr<const PackageID> >::handle(Deserialisation
     if (v.null())
         return nullptr;
 
-    return *(*v.deserialiser().environment())[
-        selection::RequireExactlyOne(generator::Matches(
-                    parse_elike_package_dep_spec(v.string_value(),
-                        { epdso_allow_tilde_greater_deps, epdso_nice_equal_star,
-                        epdso_allow_ranged_deps, epdso_allow_use_deps, epdso_allow_use_deps_portage,
-                        epdso_allow_use_dep_defaults, epdso_allow_repository_deps, epdso_allow_slot_star_deps,
-                        epdso_allow_slot_equal_deps, epdso_allow_slot_equal_deps_portage,
-                        epdso_allow_slot_deps, epdso_allow_key_requirements,
-                        epdso_allow_use_dep_question_defaults, epdso_allow_subslot_deps },
-                        { vso_flexible_dashes, vso_flexible_dots, vso_ignore_case,
-                        vso_letters_anywhere, vso_dotted_suffixes }), nullptr, { }))]->begin();
+    return v.deserialiser().package_id(v.string_value());
 }
 
 namespace paludis
 {
+    template class Pimp<Serialiser>;
     template class Pimp<Deserialiser>;
     template class Pimp<Deserialisation>;
     template class Pimp<Deserialisator>;
@@ -25,6 +25,7 @@
 #include <paludis/util/wrapped_forward_iterator-fwd.hh>
 #include <paludis/serialise-fwd.hh>
 #include <paludis/environment-fwd.hh>
+#include <paludis/package_id-fwd.hh>
 #include <memory>
 #include <string>
 #include <ostream>
@@ -70,10 +71,16 @@ namespace paludis
     class PALUDIS_VISIBLE Serialiser
     {
         private:
-            std::ostream & _stream;
+            Pimp<Serialiser> _imp;
 
         public:
             Serialiser(std::ostream &);
+
+            /**
+             * \since 2.2.0
+             */
+            Serialiser(std::ostream &, const SerialisationFormat);
+
             ~Serialiser();
 
             SerialiserObjectWriter object(const std::string & class_name)
@@ -82,6 +89,18 @@ namespace paludis
             std::ostream & raw_stream() PALUDIS_ATTRIBUTE((warn_unused_result));
 
             void escape_write(const std::string &);
+
+            ///\name Writing, in whichever format we are using
+            ///\since 2.2.0
+            ///\{
+
+            void write_object_start(const std::string & class_name);
+            void write_member_name(const std::string &);
+            void write_object_end();
+            void write_string(const std::string &);
+            void write_null();
+
+            ///\}
     };
 
     class PALUDIS_VISIBLE Deserialiser
@@ -96,6 +115,30 @@ namespace paludis
             const Environment * environment() const PALUDIS_ATTRIBUTE((warn_unused_result));
 
             std::istream & stream() PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            /**
+             * Worked out from the start of the stream.
+             *
+             * \since 2.2.0
+             */
+            SerialisationFormat format() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            /**
+             * Read a string written by Serialiser in sf_binary format.
+             *
+             * \since 2.2.0
+             */
+            const std::string read_binary_string() PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            /**
+             * Find the PackageID for a uniquely identifying spec. The same
+             * PackageID is usually written many times, so we only look each
+             * one up once.
+             *
+             * \since 2.2.0
+             */
+            const std::shared_ptr<const PackageID> package_id(const std::string &) const
+                PALUDIS_ATTRIBUTE((warn_unused_result));
     };
 
     class PALUDIS_VISIBLE Deserialisation
@@ -153,6 +196,7 @@ namespace paludis
             const std::string &,
             const std::string &) PALUDIS_VISIBLE PALUDIS_ATTRIBUTE((warn_unused_result));
 
+    extern template class Pimp<Serialiser>;
     extern template class Pimp<Deserialiser>;
     extern template class Pimp<Deserialisation>;
     extern template class Pimp<Deserialisator>;
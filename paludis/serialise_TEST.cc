@@ -0,0 +1,163 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <paludis/serialise-impl.hh>
+#include <paludis/util/string_list_stream.hh>
+#include <paludis/util/exception.hh>
+
+#include <sstream>
+#include <list>
+
+#include <gtest/gtest.h>
+
+using namespace paludis;
+
+namespace
+{
+    struct Thing
+    {
+        std::string name;
+        int number;
+        bool flag;
+        std::list<std::string> words;
+        std::shared_ptr<Thing> child;
+
+        void serialise(Serialiser & s) const
+        {
+            s.object("Thing")
+                .member(SerialiserFlags<>(), "name", name)
+                .member(SerialiserFlags<>(), "number", number)
+                .member(SerialiserFlags<>(), "flag", flag)
+                .member(SerialiserFlags<serialise::container>(), "words", words)
+                .member(SerialiserFlags<serialise::might_be_null>(), "child", child)
+                ;
+        }
+
+        static std::shared_ptr<Thing> deserialise(Deserialisation & d)
+        {
+            Deserialisator v(d, "Thing");
+
+            auto result(std::make_shared<Thing>());
+            result->name = v.member<std::string>("name");
+            result->number = v.member<int>("number");
+            result->flag = v.member<bool>("flag");
+
+            Deserialisator vv(*v.find_remove_member("words"), "c");
+            for (int n(1), n_end(vv.member<int>("count") + 1) ; n != n_end ; ++n)
+                result->words.push_back(vv.member<std::string>(stringify(n)));
+
+            result->child = v.member<std::shared_ptr<Thing> >("child");
+            return result;
+        }
+    };
+
+    Thing make_thing()
+    {
+        Thing result;
+        result.name = "a \"name\"; with (awkward) \\ characters";
+        result.number = -123;
+        result.flag = true;
+        result.words = { "one", "two", "one", "", std::string("with\0nul", 8) };
+        result.child = std::make_shared<Thing>();
+        result.child->name = "one";
+        result.child->number = 300;
+        result.child->flag = false;
+        return result;
+    }
+
+    void check_thing(const Thing & t)
+    {
+        EXPECT_EQ("a \"name\"; with (awkward) \\ characters", t.name);
+        EXPECT_EQ(-123, t.number);
+        EXPECT_TRUE(t.flag);
+        EXPECT_EQ((std::list<std::string>{ "one", "two", "one", "", std::string("with\0nul", 8) }), t.words);
+        ASSERT_TRUE(bool(t.child));
+        EXPECT_EQ("one", t.child->name);
+        EXPECT_EQ(300, t.child->number);
+        EXPECT_FALSE(t.child->flag);
+        EXPECT_TRUE(t.child->words.empty());
+        EXPECT_FALSE(bool(t.child->child));
+    }
+
+    std::shared_ptr<Thing> round_trip(const Thing & t, const SerialisationFormat f)
+    {
+        StringListStream str;
+        {
+            Serialiser ser(str, f);
+            t.serialise(ser);
+        }
+        str.nothing_more_to_write();
+
+        Deserialiser deser(nullptr, str);
+        EXPECT_EQ(f, deser.format());
+        Deserialisation desern("Thing", deser);
+        return Thing::deserialise(desern);
+    }
+}
+
+TEST(Serialise, Text)
+{
+    check_thing(*round_trip(make_thing(), sf_text));
+}
+
+TEST(Serialise, Binary)
+{
+    check_thing(*round_trip(make_thing(), sf_binary));
+}
+
+TEST(Serialise, TextUnchanged)
+{
+    Thing t;
+    t.name = "x;y";
+    t.number = 2;
+    t.flag = false;
+    t.words = { "a" };
+
+    std::stringstream str;
+    Serialiser ser(str);
+    t.serialise(ser);
+
+    EXPECT_EQ("Thing(name=\"x\\;y\";number=\"2\";flag=\"false\";words=c(1=\"a\";count=\"1\";);child=null;);", str.str());
+}
+
+TEST(Serialise, BinaryInterns)
+{
+    Thing t(make_thing());
+    t.words.assign(100, "a rather long string which we do not want to write out more than once");
+
+    std::stringstream text, binary;
+    {
+        Serialiser ser(text, sf_text);
+        t.serialise(ser);
+    }
+    {
+        Serialiser ser(binary, sf_binary);
+        t.serialise(ser);
+    }
+
+    EXPECT_LT(binary.str().length() * 5, text.str().length());
+}
+
+TEST(Serialise, BadBinary)
+{
+    std::stringstream str(std::string("\0PALSER\1o\0\5Thing", 16));
+    Deserialiser deser(nullptr, str);
+    EXPECT_THROW(Deserialisation("Thing", deser), InternalError);
+}
@@ -33,6 +33,11 @@ namespace paludis
 
     namespace spec_tree_internals
     {
+        class NodeArena;
+
+        template <typename T_>
+        class NodeArenaAllocator;
+
         template <typename Tree_>
         class BasicNode;
 
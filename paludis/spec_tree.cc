@@ -18,14 +18,102 @@
  */
 
 #include <paludis/spec_tree.hh>
-#include <paludis/util/sequence-impl.hh>
+#include <paludis/util/pimp-impl.hh>
 #include <paludis/util/wrapped_forward_iterator-impl.hh>
 #include <paludis/util/indirect_iterator-impl.hh>
 #include <algorithm>
+#include <cstdint>
+#include <list>
+#include <memory>
 
 using namespace paludis;
 using namespace paludis::spec_tree_internals;
 
+namespace
+{
+    /* Lots of trees only have a node or two, so start small, and double the
+     * block size each time we run out. */
+    const std::size_t first_block_size(256);
+    const std::size_t max_block_size(65536);
+}
+
+namespace paludis
+{
+    template <>
+    struct Imp<NodeArena>
+    {
+        std::list<std::unique_ptr<char[]> > blocks;
+        char * current;
+        std::size_t remaining;
+        std::size_t next_block_size;
+        std::size_t size;
+
+        Imp() :
+            current(nullptr),
+            remaining(0),
+            next_block_size(first_block_size),
+            size(0)
+        {
+        }
+    };
+}
+
+NodeArena::NodeArena() :
+    _imp()
+{
+}
+
+NodeArena::~NodeArena() = default;
+
+void *
+NodeArena::allocate(std::size_t size, std::size_t align)
+{
+    std::size_t padding((align - (reinterpret_cast<std::uintptr_t>(_imp->current) % align)) % align);
+    if (_imp->remaining < size + padding)
+    {
+        std::size_t block_size(std::max(_imp->next_block_size, size + align));
+        _imp->blocks.push_back(std::unique_ptr<char[]>(new char[block_size]));
+        _imp->current = _imp->blocks.back().get();
+        _imp->remaining = block_size;
+        _imp->size += block_size;
+        _imp->next_block_size = std::min(_imp->next_block_size * 2, max_block_size);
+
+        padding = (align - (reinterpret_cast<std::uintptr_t>(_imp->current) % align)) % align;
+    }
+
+    void * result(_imp->current + padding);
+    _imp->current += size + padding;
+    _imp->remaining -= size + padding;
+    return result;
+}
+
+std::size_t
+NodeArena::size() const
+{
+    return _imp->size;
+}
+
+namespace
+{
+    template <typename Tree_, typename Item_>
+    std::shared_ptr<LeafNode<Tree_, Item_> > make_node(
+            NodeArena * const arena,
+            const std::shared_ptr<const Item_> & i,
+            LeafNode<Tree_, Item_> *)
+    {
+        return std::allocate_shared<LeafNode<Tree_, Item_> >(NodeArenaAllocator<LeafNode<Tree_, Item_> >(arena), i);
+    }
+
+    template <typename Tree_, typename Item_>
+    std::shared_ptr<InnerNode<Tree_, Item_> > make_node(
+            NodeArena * const arena,
+            const std::shared_ptr<const Item_> & i,
+            InnerNode<Tree_, Item_> *)
+    {
+        return std::allocate_shared<InnerNode<Tree_, Item_> >(NodeArenaAllocator<InnerNode<Tree_, Item_> >(arena), i, arena);
+    }
+}
+
 template <typename Tree_, typename Item_>
 LeafNode<Tree_, Item_>::LeafNode(const std::shared_ptr<const Item_> & i) :
     _spec(i)
@@ -48,7 +136,23 @@ LeafNode<Tree_, Item_>::spec() const
 
 template <typename Tree_>
 BasicInnerNode<Tree_>::BasicInnerNode() :
-    _child_list(std::make_shared<ChildList>())
+    _arena(nullptr),
+    _child_list(NodeArenaAllocator<std::shared_ptr<const BasicNode<Tree_> > >(_arena))
+{
+}
+
+template <typename Tree_>
+BasicInnerNode<Tree_>::BasicInnerNode(NodeArena * const a) :
+    _arena(a),
+    _child_list(NodeArenaAllocator<std::shared_ptr<const BasicNode<Tree_> > >(_arena))
+{
+}
+
+template <typename Tree_>
+BasicInnerNode<Tree_>::BasicInnerNode(const std::shared_ptr<NodeArena> & a) :
+    _owned_arena(a),
+    _arena(_owned_arena.get()),
+    _child_list(NodeArenaAllocator<std::shared_ptr<const BasicNode<Tree_> > >(_arena))
 {
 }
 
@@ -56,21 +160,21 @@ template <typename Tree_>
 typename BasicInnerNode<Tree_>::ConstIterator
 BasicInnerNode<Tree_>::begin() const
 {
-    return ConstIterator(_child_list->begin());
+    return ConstIterator(_child_list.begin());
 }
 
 template <typename Tree_>
 typename BasicInnerNode<Tree_>::ConstIterator
 BasicInnerNode<Tree_>::end() const
 {
-    return ConstIterator(_child_list->end());
+    return ConstIterator(_child_list.end());
 }
 
 template <typename Tree_>
 void
 BasicInnerNode<Tree_>::append_node(const std::shared_ptr<const BasicNode<Tree_> > & t)
 {
-    _child_list->push_back(t);
+    _child_list.push_back(t);
 }
 
 template <typename Tree_>
@@ -78,8 +182,8 @@ template <typename T_>
 const std::shared_ptr<typename Tree_::template NodeType<T_>::Type>
 BasicInnerNode<Tree_>::append(const std::shared_ptr<const T_> & t)
 {
-    const std::shared_ptr<typename Tree_::template NodeType<T_>::Type> tt(
-            std::make_shared<typename Tree_::template NodeType<T_>::Type>(t));
+    const std::shared_ptr<typename Tree_::template NodeType<T_>::Type> tt(make_node(_arena, t,
+                static_cast<typename Tree_::template NodeType<T_>::Type *>(nullptr)));
     append_node(tt);
     return tt;
 }
@@ -98,6 +202,20 @@ InnerNode<Tree_, Item_>::InnerNode(const std::shared_ptr<const Item_> & i) :
 {
 }
 
+template <typename Tree_, typename Item_>
+InnerNode<Tree_, Item_>::InnerNode(const std::shared_ptr<const Item_> & i, NodeArena * const a) :
+    BasicInnerNode<Tree_>(a),
+    _spec(i)
+{
+}
+
+template <typename Tree_, typename Item_>
+InnerNode<Tree_, Item_>::InnerNode(const std::shared_ptr<const Item_> & i, const std::shared_ptr<NodeArena> & a) :
+    BasicInnerNode<Tree_>(a),
+    _spec(i)
+{
+}
+
 template <typename Tree_, typename Item_>
 const std::shared_ptr<const Item_>
 InnerNode<Tree_, Item_>::spec() const
@@ -107,13 +225,14 @@ InnerNode<Tree_, Item_>::spec() const
 
 template <typename NodeList_, typename RootNode_>
 SpecTree<NodeList_, RootNode_>::SpecTree(const std::shared_ptr<RootNode_> & spec) :
-    _top(std::make_shared<typename InnerNodeType<RootNode_>::Type>(spec))
+    SpecTree(std::shared_ptr<const RootNode_>(spec))
 {
 }
 
 template <typename NodeList_, typename RootNode_>
 SpecTree<NodeList_, RootNode_>::SpecTree(const std::shared_ptr<const RootNode_> & spec) :
-    _top(std::make_shared<typename InnerNodeType<RootNode_>::Type>(spec))
+    _arena(new NodeArena),
+    _top(std::make_shared<typename InnerNodeType<RootNode_>::Type>(spec, std::shared_ptr<NodeArena>(_arena)))
 {
 }
 
@@ -131,6 +250,13 @@ SpecTree<NodeList_, RootNode_>::top() const
     return _top;
 }
 
+template <typename NodeList_, typename RootNode_>
+std::size_t
+SpecTree<NodeList_, RootNode_>::arena_size() const
+{
+    return _arena->size();
+}
+
 namespace
 {
     template <typename Tree_, typename OtherTree_, typename Item_>
@@ -171,12 +297,15 @@ namespace paludis
     template <typename T_>
     struct WrappedForwardIteratorTraits<BasicInnerNodeConstIteratorTag<T_> >
     {
-        typedef typename Sequence<std::shared_ptr<const BasicNode<T_> > >::ConstIterator UnderlyingIterator;
+        typedef typename std::vector<std::shared_ptr<const BasicNode<T_> >,
+                NodeArenaAllocator<std::shared_ptr<const BasicNode<T_> > > >::const_iterator UnderlyingIterator;
     };
 }
 
 namespace paludis
 {
+    template class Pimp<spec_tree_internals::NodeArena>;
+
     template class SpecTree<MakeTypeList<
         SpecTreeLeafNodeType<PlainTextDepSpec>,
             SpecTreeLeafNodeType<PlainTextLabelDepSpec>,
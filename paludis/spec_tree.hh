@@ -24,12 +24,102 @@
 #include <paludis/util/wrapped_forward_iterator.hh>
 #include <paludis/util/visitor.hh>
 #include <paludis/util/sequence.hh>
+#include <paludis/util/pimp.hh>
 #include <type_traits>
+#include <vector>
+#include <new>
 
 namespace paludis
 {
     namespace spec_tree_internals
     {
+        /**
+         * Memory for the nodes in a single tree.
+         *
+         * Space is handed out from growing blocks, and is only given back when
+         * the arena goes away, which is when the tree's top node is destroyed.
+         * Nothing below the top node keeps the arena alive, so a node must
+         * not be held on to for longer than its top node. Allocation is not
+         * thread safe, but nothing builds a single tree from more than one
+         * thread.
+         *
+         * \since 2.2.0
+         */
+        class PALUDIS_VISIBLE NodeArena
+        {
+            private:
+                Pimp<NodeArena> _imp;
+
+            public:
+                NodeArena();
+                ~NodeArena();
+
+                NodeArena(const NodeArena &) = delete;
+                NodeArena & operator= (const NodeArena &) = delete;
+
+                void * allocate(std::size_t size, std::size_t align) PALUDIS_ATTRIBUTE((warn_unused_result));
+
+                /**
+                 * How many bytes we have taken from the heap.
+                 */
+                std::size_t size() const PALUDIS_ATTRIBUTE((warn_unused_result));
+        };
+
+        /**
+         * An allocator using a NodeArena, or the heap if we don't have one.
+         *
+         * \since 2.2.0
+         */
+        template <typename T_>
+        class NodeArenaAllocator
+        {
+            template <typename U_>
+            friend class NodeArenaAllocator;
+
+            private:
+                NodeArena * _arena;
+
+            public:
+                typedef T_ value_type;
+
+                explicit NodeArenaAllocator(NodeArena * const a) :
+                    _arena(a)
+                {
+                }
+
+                template <typename U_>
+                NodeArenaAllocator(const NodeArenaAllocator<U_> & other) :
+                    _arena(other._arena)
+                {
+                }
+
+                T_ * allocate(std::size_t n)
+                {
+                    if (_arena)
+                        return static_cast<T_ *>(_arena->allocate(n * sizeof(T_), alignof(T_)));
+                    else
+                        return static_cast<T_ *>(::operator new(n * sizeof(T_)));
+                }
+
+                void deallocate(T_ * p, std::size_t)
+                {
+                    if (! _arena)
+                        ::operator delete(p);
+                }
+
+                template <typename U_>
+                bool operator== (const NodeArenaAllocator<U_> & other) const
+                {
+                    return _arena == other._arena;
+                }
+
+                template <typename U_>
+                bool operator!= (const NodeArenaAllocator<U_> & other) const
+                {
+                    return _arena != other._arena;
+                }
+        };
+
         template <typename Tree_>
         class PALUDIS_VISIBLE BasicNode :
             public virtual DeclareAbstractAcceptMethods<BasicNode<Tree_>, typename Tree_::VisitableTypeList>
@@ -61,12 +151,24 @@ namespace paludis
             public BasicNode<Tree_>
         {
             private:
-                typedef Sequence<std::shared_ptr<const BasicNode<Tree_> > > ChildList;
-                std::shared_ptr<ChildList> _child_list;
+                /* what a vector leaves behind as it grows isn't reused, but
+                 * that is never more than it ends up using */
+                typedef std::vector<std::shared_ptr<const BasicNode<Tree_> >,
+                        NodeArenaAllocator<std::shared_ptr<const BasicNode<Tree_> > > > ChildList;
+
+                /* only set for a tree's top node, and must go after our
+                 * children do */
+                const std::shared_ptr<NodeArena> _owned_arena;
+                NodeArena * const _arena;
+                ChildList _child_list;
 
             public:
                 BasicInnerNode();
 
+                explicit BasicInnerNode(NodeArena * const);
+
+                explicit BasicInnerNode(const std::shared_ptr<NodeArena> &);
+
                 typedef BasicInnerNodeConstIteratorTag<Tree_> ConstIteratorTag;
                 typedef WrappedForwardIterator<ConstIteratorTag,
                         const std::shared_ptr<const BasicNode<Tree_> > > ConstIterator;
@@ -97,6 +199,21 @@ namespace paludis
             public:
                 explicit InnerNode(const std::shared_ptr<const Item_> & i);
 
+                /**
+                 * Our children, and any children they have, will be allocated
+                 * using this arena, which must outlive us.
+                 *
+                 * \since 2.2.0
+                 */
+                InnerNode(const std::shared_ptr<const Item_> & i, NodeArena * const);
+
+                /**
+                 * As above, but we keep the arena alive, for a tree's top node.
+                 *
+                 * \since 2.2.0
+                 */
+                InnerNode(const std::shared_ptr<const Item_> & i, const std::shared_ptr<NodeArena> &);
+
                 template <typename OtherTree_>
                 operator InnerNode<OtherTree_, Item_> () const;
 
@@ -173,10 +290,21 @@ namespace paludis
 
             const std::shared_ptr<const typename InnerNodeType<RootNode_>::Type> top() const;
 
+            /**
+             * How much memory our nodes are using, not including the specs
+             * they hold.
+             *
+             * \since 2.2.0
+             */
+            std::size_t arena_size() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
         private:
+            spec_tree_internals::NodeArena * const _arena;
             const std::shared_ptr<typename InnerNodeType<RootNode_>::Type> _top;
     };
 
+    extern template class Pimp<spec_tree_internals::NodeArena>;
+
     extern template class PALUDIS_VISIBLE SpecTree<MakeTypeList<
         SpecTreeLeafNodeType<PlainTextDepSpec>,
             SpecTreeLeafNodeType<PlainTextLabelDepSpec>,
@@ -0,0 +1,139 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/spec_tree.hh>
+#include <paludis/dep_spec.hh>
+#include <paludis/util/indirect_iterator-impl.hh>
+
+#include <algorithm>
+#include <string>
+
+#include <gtest/gtest.h>
+
+using namespace paludis;
+
+namespace
+{
+    struct Collector
+    {
+        std::string result;
+
+        void visit(const PlainTextSpecTree::NodeType<PlainTextDepSpec>::Type & node)
+        {
+            result.append(node.spec()->text() + " ");
+        }
+
+        void visit(const PlainTextSpecTree::NodeType<PlainTextLabelDepSpec>::Type & node)
+        {
+            result.append(node.spec()->text() + " ");
+        }
+
+        void visit(const PlainTextSpecTree::NodeType<AllDepSpec>::Type & node)
+        {
+            result.append("( ");
+            std::for_each(indirect_iterator(node.begin()), indirect_iterator(node.end()), accept_visitor(*this));
+            result.append(") ");
+        }
+
+        void visit(const PlainTextSpecTree::NodeType<ConditionalDepSpec>::Type & node)
+        {
+            std::for_each(indirect_iterator(node.begin()), indirect_iterator(node.end()), accept_visitor(*this));
+        }
+    };
+}
+
+TEST(SpecTree, Build)
+{
+    PlainTextSpecTree tree(std::make_shared<AllDepSpec>());
+    tree.top()->append(std::make_shared<PlainTextDepSpec>("a"));
+    auto inner(tree.top()->append(std::make_shared<AllDepSpec>()));
+    inner->append(std::make_shared<PlainTextDepSpec>("b"));
+    inner->append(std::make_shared<AllDepSpec>())->append(std::make_shared<PlainTextDepSpec>("c"));
+    tree.top()->append(std::make_shared<PlainTextDepSpec>("d"));
+
+    Collector c;
+    tree.top()->accept(c);
+    EXPECT_EQ("( a ( b ( c ) ) d ) ", c.result);
+}
+
+TEST(SpecTree, Large)
+{
+    PlainTextSpecTree tree(std::make_shared<AllDepSpec>());
+    std::string expected("( ");
+    for (int i(0) ; i < 10000 ; ++i)
+    {
+        auto inner(tree.top()->append(std::make_shared<AllDepSpec>()));
+        inner->append(std::make_shared<PlainTextDepSpec>("x" + std::to_string(i)));
+        expected.append("( x" + std::to_string(i) + " ) ");
+    }
+    expected.append(") ");
+
+    Collector c;
+    tree.top()->accept(c);
+    EXPECT_EQ(expected, c.result);
+}
+
+TEST(SpecTree, NodesOutliveTree)
+{
+    std::shared_ptr<const PlainTextSpecTree::NodeType<AllDepSpec>::Type> top;
+    std::shared_ptr<const PlainTextDepSpec> spec;
+    {
+        auto tree(std::make_shared<PlainTextSpecTree>(std::make_shared<AllDepSpec>()));
+        for (int i(0) ; i < 1000 ; ++i)
+            tree->top()->append(std::make_shared<PlainTextDepSpec>("x"));
+        spec = std::make_shared<PlainTextDepSpec>("y");
+        tree->top()->append(spec);
+        top = tree->top();
+    }
+
+    EXPECT_EQ(1001, std::distance(top->begin(), top->end()));
+
+    Collector c;
+    (*std::next(top->begin(), 1000))->accept(c);
+    EXPECT_EQ("y ", c.result);
+    EXPECT_EQ(2, spec.use_count());
+
+    top.reset();
+    EXPECT_EQ(1, spec.use_count());
+}
+
+TEST(SpecTree, Convert)
+{
+    PlainTextSpecTree tree(std::make_shared<AllDepSpec>());
+    tree.top()->append(std::make_shared<PlainTextDepSpec>("a"));
+    tree.top()->append(std::make_shared<AllDepSpec>())->append(std::make_shared<PlainTextLabelDepSpec>("b:"));
+
+    GenericSpecTree::NodeType<AllDepSpec>::Type converted(*tree.top());
+    EXPECT_EQ(2, std::distance(converted.begin(), converted.end()));
+}
+
+TEST(SpecTree, ArenaSize)
+{
+    PlainTextSpecTree empty(std::make_shared<AllDepSpec>());
+    EXPECT_EQ(0u, empty.arena_size());
+
+    PlainTextSpecTree small(std::make_shared<AllDepSpec>());
+    small.top()->append(std::make_shared<PlainTextDepSpec>("x"));
+    EXPECT_EQ(256u, small.arena_size());
+
+    PlainTextSpecTree large(std::make_shared<AllDepSpec>());
+    for (int i(0) ; i < 10000 ; ++i)
+        large.top()->append(std::make_shared<PlainTextDepSpec>("x"));
+    EXPECT_LT(10000 * sizeof(std::shared_ptr<const PlainTextSpecTree::BasicNode>), large.arena_size());
+}
@@ -74,4 +74,20 @@
 
 #define PALUDIS_TLS static __thread
 
+/** \def PALUDIS_UNROLL_LOOP
+ * Ask for the following loop, which must have a small constant trip count,
+ * to be unrolled completely, if the compiler supports doing so.
+ *
+ * \ingroup g_utils
+ * \since 2.2.0
+ */
+
+#if (defined(__GNUC__) && ! defined(__clang__) && ! defined(__ICC) && (__GNUC__ >= 8) && ! defined(DOXYGEN))
+#  define PALUDIS_UNROLL_LOOP _Pragma("GCC unroll 80")
+#elif (defined(__clang__) && ! defined(DOXYGEN))
+#  define PALUDIS_UNROLL_LOOP _Pragma("unroll")
+#else
+#  define PALUDIS_UNROLL_LOOP
+#endif
+
 #endif
@@ -0,0 +1,150 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_UTIL_DIGEST_BUFFER_HH
+#define PALUDIS_GUARD_PALUDIS_UTIL_DIGEST_BUFFER_HH 1
+
+#include <paludis/util/attributes.hh>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <inttypes.h>
+
+/** \file
+ * Declarations for the DigestBuffer class.
+ *
+ * \ingroup g_digests
+ *
+ * \section Examples
+ *
+ * - None at this time.
+ */
+
+namespace paludis
+{
+    /**
+     * Collects data for a digest which works on fixed size blocks, so that
+     * callers can feed it data in whatever sized pieces are convenient.
+     *
+     * Whole blocks are handed to the digest straight from the caller's data
+     * where possible, rather than being copied first.
+     *
+     * \ingroup g_digests
+     * \since 2.2.0
+     */
+    template <std::size_t block_size_>
+    class DigestBuffer
+    {
+        private:
+            uint8_t _data[block_size_];
+            std::size_t _used;
+            uint64_t _total;
+
+        public:
+            DigestBuffer() :
+                _used(0),
+                _total(0)
+            {
+            }
+
+            /**
+             * Add more data, calling process_blocks(const uint8_t *, std::size_t)
+             * for every run of complete blocks.
+             */
+            template <typename F_>
+            void update(const void * const data, std::size_t size, const F_ & process_blocks)
+            {
+                const uint8_t * d(static_cast<const uint8_t *>(data));
+                _total += size;
+
+                if (0 != _used)
+                {
+                    std::size_t take(std::min(block_size_ - _used, size));
+                    std::memcpy(_data + _used, d, take);
+                    _used += take;
+                    d += take;
+                    size -= take;
+
+                    if (block_size_ != _used)
+                        return;
+
+                    process_blocks(_data, 1);
+                    _used = 0;
+                }
+
+                if (size >= block_size_)
+                {
+                    std::size_t n(size / block_size_);
+                    process_blocks(d, n);
+                    d += n * block_size_;
+                    size -= n * block_size_;
+                }
+
+                std::memcpy(_data, d, size);
+                _used = size;
+            }
+
+            /**
+             * Apply the usual Merkle-Damgård padding: a single one bit, zeroes,
+             * and then a length field of length_size bytes at the end of the
+             * final block, which write_length(uint8_t *, uint64_t bytes) fills
+             * in.
+             */
+            template <typename L_, typename F_>
+            void finish(const std::size_t length_size, const L_ & write_length, const F_ & process_blocks)
+            {
+                _data[_used++] = 0x80;
+
+                if (_used > block_size_ - length_size)
+                {
+                    std::fill(_data + _used, _data + block_size_, 0);
+                    process_blocks(_data, 1);
+                    _used = 0;
+                }
+
+                std::fill(_data + _used, _data + block_size_ - length_size, 0);
+                write_length(_data + block_size_ - length_size, _total);
+                process_blocks(_data, 1);
+                _used = 0;
+            }
+    };
+
+    /**
+     * Feed the entire contents of a stream to a digest's update method, in
+     * large chunks.
+     *
+     * \ingroup g_digests
+     * \since 2.2.0
+     */
+    template <typename T_>
+    void digest_stream(T_ & digest, std::istream & stream)
+    {
+        const std::streamsize chunk_size(1 << 16);
+        std::unique_ptr<char[]> chunk(new char[chunk_size]);
+        std::streambuf * const buf(stream.rdbuf());
+
+        std::streamsize got;
+        while (0 < (got = buf->sgetn(chunk.get(), chunk_size)))
+            digest.update(chunk.get(), got);
+    }
+}
+
+#endif
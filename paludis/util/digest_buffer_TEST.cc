@@ -0,0 +1,91 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include <paludis/util/digest_buffer.hh>
+#include <paludis/util/md5.hh>
+#include <paludis/util/rmd160.hh>
+#include <paludis/util/sha1.hh>
+#include <paludis/util/sha256.hh>
+#include <paludis/util/sha512.hh>
+#include <paludis/util/whirlpool.hh>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+using namespace paludis;
+
+namespace
+{
+    /* feeding a digest its input in pieces of awkward sizes must give the
+     * same result as reading it all from a stream */
+    template <typename Digest_>
+    void check_pieces()
+    {
+        std::string data;
+        for (int i(0) ; i < 100000 ; ++i)
+            data.append(1, char(i * 7 + i / 251));
+
+        for (std::string::size_type length(0) ; length <= data.length() ; length += (length < 300 ? 1 : 9973))
+        {
+            std::stringstream ss(data.substr(0, length));
+            Digest_ whole(ss);
+
+            Digest_ pieces;
+            for (std::string::size_type p(0), n(1) ; p < length ; p += n, n = (n * 5 + 3) % 200)
+                pieces.update(data.data() + p, std::min(n, length - p));
+            pieces.finish();
+
+            EXPECT_EQ(whole.hexsum(), pieces.hexsum()) << "length " << length;
+        }
+    }
+}
+
+TEST(DigestBuffer, MD5Pieces)
+{
+    check_pieces<MD5>();
+}
+
+TEST(DigestBuffer, RMD160Pieces)
+{
+    check_pieces<RMD160>();
+}
+
+TEST(DigestBuffer, SHA1Pieces)
+{
+    check_pieces<SHA1>();
+}
+
+TEST(DigestBuffer, SHA256Pieces)
+{
+    check_pieces<SHA256>();
+}
+
+TEST(DigestBuffer, SHA512Pieces)
+{
+    check_pieces<SHA512>();
+}
+
+TEST(DigestBuffer, WhirlpoolPieces)
+{
+    check_pieces<Whirlpool>();
+}
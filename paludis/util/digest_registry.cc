@@ -28,6 +28,7 @@ using namespace paludis;
 namespace
 {
     typedef std::map<std::string, DigestRegistry::Function> FunctionMap;
+    typedef std::map<std::string, std::function<std::shared_ptr<Digester> ()> > MakeFunctionMap;
 }
 
 namespace paludis
@@ -42,9 +43,12 @@ namespace paludis
     struct Imp<DigestRegistry>
     {
         FunctionMap functions;
+        MakeFunctionMap make_functions;
     };
 }
 
+Digester::~Digester() = default;
+
 DigestRegistry::DigestRegistry()
 {
 }
@@ -62,6 +66,15 @@ DigestRegistry::get(const std::string & algo) const
     return it->second;
 }
 
+std::shared_ptr<Digester>
+DigestRegistry::make_digester(const std::string & algo) const
+{
+    MakeFunctionMap::const_iterator it(_imp->make_functions.find(algo));
+    if (_imp->make_functions.end() == it)
+        return nullptr;
+    return it->second();
+}
+
 DigestRegistry::AlgorithmsConstIterator
 DigestRegistry::begin_algorithms() const
 {
@@ -75,9 +88,11 @@ DigestRegistry::end_algorithms() const
 }
 
 void
-DigestRegistry::register_function(const std::string & algo, const Function & func)
+DigestRegistry::register_function(const std::string & algo, const Function & func,
+        const std::function<std::shared_ptr<Digester> ()> & make_func)
 {
     _imp->functions.insert(std::make_pair(algo, func));
+    _imp->make_functions.insert(std::make_pair(algo, make_func));
 }
 
 namespace paludis
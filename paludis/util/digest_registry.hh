@@ -27,12 +27,33 @@
 #include <paludis/util/singleton.hh>
 #include <paludis/util/wrapped_forward_iterator-fwd.hh>
 #include <functional>
+#include <memory>
 #include <utility>
+#include <cstddef>
 
 namespace paludis
 {
     class DigestRegistry;
 
+    /**
+     * A digest which is fed its data a piece at a time.
+     *
+     * \since 2.2.0
+     */
+    class PALUDIS_VISIBLE Digester
+    {
+        public:
+            virtual ~Digester() = 0;
+
+            virtual void update(const void * data, std::size_t size) = 0;
+
+            /**
+             * No more data is coming. Return the checksum, as a string of hex
+             * characters.
+             */
+            virtual std::string finish() = 0;
+    };
+
     extern template class Pimp<DigestRegistry>;
     extern template class PALUDIS_VISIBLE Singleton<DigestRegistry>;
 
@@ -46,6 +67,14 @@ namespace paludis
 
             Function get(const std::string & algo) const;
 
+            /**
+             * Return a new Digester for the named algorithm, or a null pointer
+             * if there is no such algorithm.
+             *
+             * \since 2.2.0
+             */
+            std::shared_ptr<Digester> make_digester(const std::string & algo) const;
+
             struct AlgorithmsConstIteratorTag;
             typedef WrappedForwardIterator<AlgorithmsConstIteratorTag, const std::pair<const std::string, Function> > AlgorithmsConstIterator;
 
@@ -58,7 +87,7 @@ namespace paludis
                 public:
                     Registration(const std::string & algo)
                     {
-                        get_instance()->register_function(algo, do_digest<T_>);
+                        get_instance()->register_function(algo, do_digest<T_>, make<T_>);
                     }
             };
 
@@ -68,7 +97,8 @@ namespace paludis
 
             Pimp<DigestRegistry> _imp;
 
-            void register_function(const std::string & algo, const Function & func);
+            void register_function(const std::string & algo, const Function & func,
+                    const std::function<std::shared_ptr<Digester> ()> & make_func);
 
             template <typename T_>
             static std::string
@@ -77,6 +107,33 @@ namespace paludis
                 T_ digest(stream);
                 return digest.hexsum();
             }
+
+            template <typename T_>
+            class DigesterFor :
+                public Digester
+            {
+                private:
+                    T_ _digest;
+
+                public:
+                    virtual void update(const void * data, std::size_t size)
+                    {
+                        _digest.update(data, size);
+                    }
+
+                    virtual std::string finish()
+                    {
+                        _digest.finish();
+                        return _digest.hexsum();
+                    }
+            };
+
+            template <typename T_>
+            static std::shared_ptr<Digester>
+            make()
+            {
+                return std::make_shared<DigesterFor<T_> >();
+            }
     };
 }
 
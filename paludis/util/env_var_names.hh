@@ -43,6 +43,8 @@ namespace paludis
         const std::string no_global_hooks("PALUDIS_NO_GLOBAL_HOOKS");
         const std::string no_global_sets("PALUDIS_NO_GLOBAL_SETS");
         const std::string no_global_syncers("PALUDIS_NO_GLOBAL_SYNCERS");
+        const std::string no_metadata_workers("PALUDIS_NO_METADATA_WORKERS");
+        const std::string no_sha_ni("PALUDIS_NO_SHA_NI");
         const std::string no_xml("PALUDIS_NO_XML");
         const std::string portage_bashrc("PALUDIS_PORTAGE_BASHRC");
         const std::string python_dir("PALUDIS_PYTHON_DIR");
@@ -35,35 +35,83 @@ using namespace paludis;
 
 namespace
 {
-    PALUDIS_TLS std::list<std::string> * context = 0;
+    /* Anything deeper than this still gets counted, but doesn't show up in
+     * backtraces */
+    const unsigned context_stack_capacity(256);
+
+    PALUDIS_TLS const Context * context_stack[context_stack_capacity];
+    PALUDIS_TLS unsigned context_depth = 0;
+    PALUDIS_TLS bool rendering_context = false;
+
+    std::list<std::string> render_context()
+    {
+        std::list<std::string> result;
+
+        /* if working out a context's text throws, don't try to work out the
+         * context for that exception too */
+        if (rendering_context)
+            return result;
+        rendering_context = true;
+
+        for (unsigned i(0) ; i < context_depth && i < context_stack_capacity ; ++i)
+        {
+            try
+            {
+                result.push_back(context_stack[i]->text());
+            }
+            catch (...)
+            {
+                result.push_back("(context unavailable)");
+            }
+        }
+
+        if (context_depth > context_stack_capacity)
+            result.push_back("(" + stringify(context_depth - context_stack_capacity) + " more)");
+
+        rendering_context = false;
+        return result;
+    }
 }
 
-Context::Context(const std::string & s)
+Context::Context(const std::string & s) :
+    _text(s),
+    _render(nullptr)
 {
-    if (! context)
-        context = new std::list<std::string>;
-    context->push_back(s);
+    _push();
+}
+
+void
+Context::_push()
+{
+    if (context_depth < context_stack_capacity)
+        context_stack[context_depth] = this;
+    ++context_depth;
 }
 
 Context::~Context()
 {
-    if (! context)
+    if (0 == context_depth)
         throw InternalError(PALUDIS_HERE, "no context");
-    context->pop_back();
-    if (context->empty())
-    {
-        delete context;
-        context = 0;
-    }
+    --context_depth;
+}
+
+std::string
+Context::text() const
+{
+    if (_render)
+        return _render(&_closure);
+    else
+        return _text;
 }
 
 std::string
 Context::backtrace(const std::string & delim)
 {
-    if (! context)
+    if (0 == context_depth)
         return "";
 
-    return join(context->begin(), context->end(), delim) + delim;
+    std::list<std::string> context(render_context());
+    return join(context.begin(), context.end(), delim) + delim;
 }
 
 namespace paludis
@@ -72,10 +120,9 @@ namespace paludis
     {
         std::list<std::string> local_context;
 
-        ContextData()
+        ContextData() :
+            local_context(render_context())
         {
-            if (context)
-                local_context.assign(context->begin(), context->end());
         }
 
         ContextData(const ContextData & other) :
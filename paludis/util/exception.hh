@@ -23,6 +23,8 @@
 #include <paludis/util/attributes.hh>
 #include <string>
 #include <exception>
+#include <new>
+#include <type_traits>
 
 /** \file
  * Declaration for the Exception base class, the InternalError exception
@@ -49,16 +51,57 @@ namespace paludis
             Context(const Context &);
             const Context & operator= (const Context &);
 
+            static const std::size_t closure_size = 8 * sizeof(void *);
+
+            std::string _text;
+            std::string (* _render)(const void *);
+            std::aligned_storage<closure_size>::type _closure;
+
+            template <typename F_>
+            static std::string _render_closure(const void * f)
+            {
+                return (*static_cast<const F_ *>(f))();
+            }
+
+            void _push();
+
         public:
             ///\name Basic operations
             ///\{
 
             Context(const std::string &);
 
+            /**
+             * A context whose text is only worked out if something needs it,
+             * usually because an exception is being thrown.
+             *
+             * The function is kept by value, so it should capture by
+             * reference, and must stay callable for as long as we exist.
+             *
+             * \since 2.2.0
+             */
+            template <typename F_>
+            explicit Context(const F_ & f,
+                    typename std::enable_if<! std::is_convertible<F_, std::string>::value>::type * = 0) :
+                _render(&_render_closure<F_>)
+            {
+                static_assert(sizeof(F_) <= closure_size, "Context function is too big, capture less");
+                static_assert(std::is_trivially_destructible<F_>::value, "Context function must capture by reference");
+                new (&_closure) F_(f);
+                _push();
+            }
+
             ~Context();
 
             ///\}
 
+            /**
+             * Our text.
+             *
+             * \since 2.2.0
+             */
+            std::string text() const;
+
             /**
              * Current context.
              */
@@ -0,0 +1,102 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/util/exception.hh>
+#include <paludis/util/stringify.hh>
+
+#include <gtest/gtest.h>
+
+using namespace paludis;
+
+TEST(Context, Backtrace)
+{
+    EXPECT_EQ("", Context::backtrace("/"));
+
+    Context c1("one");
+    {
+        std::string two("two");
+        Context c2([&] () { return two; });
+        Context c3("three");
+        EXPECT_EQ("one/two/three/", Context::backtrace("/"));
+    }
+    EXPECT_EQ("one/", Context::backtrace("/"));
+}
+
+TEST(Context, Lazy)
+{
+    int calls(0);
+    {
+        Context c([&] () { ++calls; return std::string("lazy"); });
+        EXPECT_EQ(0, calls);
+
+        try
+        {
+            throw NotAvailableError("x");
+        }
+        catch (const Exception & e)
+        {
+            EXPECT_EQ(1, calls);
+            EXPECT_EQ("lazy/", e.backtrace("/"));
+        }
+    }
+    EXPECT_EQ(1, calls);
+}
+
+TEST(Context, ExceptionOutlivesContext)
+{
+    std::string s("in scope");
+    std::shared_ptr<NotAvailableError> e;
+    {
+        Context c([&] () { return "When " + s + ":"; });
+        e = std::make_shared<NotAvailableError>("x");
+    }
+    s = "changed";
+    EXPECT_EQ("When in scope:", e->backtrace(""));
+}
+
+TEST(Context, ThrowingContext)
+{
+    Context c1("one");
+    Context c2([&] () -> std::string { throw NotAvailableError("y"); });
+    Context c3("three");
+
+    NotAvailableError e("x");
+    EXPECT_EQ("one/(context unavailable)/three/", e.backtrace("/"));
+}
+
+namespace
+{
+    std::string deep(int n)
+    {
+        Context c("level " + stringify(n));
+        if (0 == n)
+            return Context::backtrace("\n");
+        else
+            return deep(n - 1);
+    }
+}
+
+TEST(Context, Deep)
+{
+    std::string b(deep(1000));
+    EXPECT_EQ(0u, b.find("level 1000\nlevel 999\n"));
+    EXPECT_EQ(std::string::npos, b.find("level 0\n"));
+    EXPECT_NE(std::string::npos, b.find("more)"));
+    EXPECT_EQ("", Context::backtrace("/"));
+}
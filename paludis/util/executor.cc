@@ -21,9 +21,11 @@
 #include <paludis/util/pimp-impl.hh>
 #include <paludis/util/exception.hh>
 #include <paludis/util/stringify.hh>
+#include <paludis/util/task_scheduler.hh>
 #include <map>
+#include <algorithm>
 #include <list>
-#include <thread>
+#include <functional>
 #include <mutex>
 #include <condition_variable>
 #include <iostream>
@@ -34,6 +36,17 @@ typedef std::list<std::shared_ptr<Executive> > ExecutiveList;
 typedef std::map<std::string, ExecutiveList> Queues;
 typedef std::list<std::shared_ptr<Executive> > ReadyForPost;
 
+namespace
+{
+    struct QueueParallelism
+    {
+        int max_running;
+        std::function<bool ()> can_start_another;
+    };
+
+    typedef std::map<std::string, QueueParallelism> QueueParallelisms;
+}
+
 Executive::~Executive()
 {
 }
@@ -49,6 +62,7 @@ namespace paludis
         int done;
 
         Queues queues;
+        QueueParallelisms queue_parallelisms;
         ReadyForPost ready_for_post;
         std::mutex mutex;
         std::condition_variable condition;
@@ -78,17 +92,22 @@ Executor::_one(const std::shared_ptr<Executive> executive)
     try
     {
         executive->execute_threaded();
-
-        std::unique_lock<std::mutex> lock(_imp->mutex);
-        _imp->ready_for_post.push_back(executive);
-        _imp->condition.notify_all();
     }
     catch (const std::exception & e)
     {
         std::cerr << "Things are about go to horribly wrong. Got an exception inside executor: "
             << e.what() << std::endl;
+
+        /* still hand it back, so that execute() rethrows when it waits */
+        std::unique_lock<std::mutex> lock(_imp->mutex);
+        _imp->ready_for_post.push_back(executive);
+        _imp->condition.notify_all();
         throw;
     }
+
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+    _imp->ready_for_post.push_back(executive);
+    _imp->condition.notify_all();
 }
 
 
@@ -117,12 +136,35 @@ Executor::add(const std::shared_ptr<Executive> & x)
     _imp->queues.insert(std::make_pair(x->queue_name(), ExecutiveList())).first->second.push_back(x);
 }
 
+void
+Executor::set_queue_parallelism(const std::string & queue_name, const int max_running,
+        const std::function<bool ()> & can_start_another)
+{
+    if (max_running < 1)
+        throw InternalError(PALUDIS_HERE, "max_running must be at least 1 for queue '" + queue_name + "'");
+
+    _imp->queue_parallelisms[queue_name] = QueueParallelism{ max_running, can_start_another };
+}
+
 void
 Executor::execute()
 {
-    typedef std::map<std::string, std::pair<std::thread, std::shared_ptr<Executive> > > Running;
+    typedef std::multimap<std::string, std::pair<std::shared_ptr<Task>, std::shared_ptr<Executive> > > Running;
     Running running;
 
+    /* executives can block for a long time, so we need a worker for
+     * everything that could possibly be running at once */
+    unsigned n_workers(0);
+    for (Queues::const_iterator q(_imp->queues.begin()), q_end(_imp->queues.end()) ;
+            q != q_end ; ++q)
+    {
+        QueueParallelisms::const_iterator p(_imp->queue_parallelisms.find(q->first));
+        const unsigned max_running(_imp->queue_parallelisms.end() == p ? 1 : p->second.max_running);
+        n_workers += std::min<unsigned>(max_running, q->second.size());
+    }
+
+    TaskScheduler scheduler(std::max(n_workers, 1u));
+
     std::unique_lock<std::mutex> lock(_imp->mutex);
     while (true)
     {
@@ -130,22 +172,39 @@ Executor::execute()
         for (Queues::iterator q(_imp->queues.begin()), q_end(_imp->queues.end()) ;
                 q != q_end ; )
         {
-            if ((running.end() != running.find(q->first)) || ! (*q->second.begin())->can_run())
+            QueueParallelisms::const_iterator p(_imp->queue_parallelisms.find(q->first));
+            const int max_running(_imp->queue_parallelisms.end() == p ? 1 : p->second.max_running);
+            int n_running(running.count(q->first));
+
+            /* a queue without parallelism only ever considers its first
+             * executive, so that order is preserved */
+            for (ExecutiveList::iterator e(q->second.begin()), e_end(q->second.end()) ;
+                    e != e_end && n_running < max_running ; )
             {
-                ++q;
-                continue;
+                if (! (*e)->can_run())
+                {
+                    if (1 == max_running)
+                        break;
+                    ++e;
+                    continue;
+                }
+
+                if (0 != n_running && p->second.can_start_another && ! p->second.can_start_another())
+                    break;
+
+                ++_imp->active;
+                --_imp->pending;
+                ++n_running;
+                (*e)->pre_execute_exclusive();
+                running.insert(std::make_pair(q->first, std::make_pair(scheduler.spawn(std::bind(&Executor::_one, this, *e)), *e)));
+                q->second.erase(e++);
+                any = true;
             }
 
-            ++_imp->active;
-            --_imp->pending;
-            (*q->second.begin())->pre_execute_exclusive();
-            running.insert(std::make_pair(q->first, std::make_pair(std::thread(std::bind(&Executor::_one, this, *q->second.begin())), *q->second.begin())));
-            q->second.erase(q->second.begin());
             if (q->second.empty())
                 _imp->queues.erase(q++);
             else
                 ++q;
-            any = true;
         }
 
         if ((! any) && running.empty())
@@ -166,8 +225,10 @@ Executor::execute()
         {
             --_imp->active;
             ++_imp->done;
-            auto r = running.find((*p)->queue_name());
-            r->second.first.join();
+            auto r = running.equal_range((*p)->queue_name()).first;
+            while (r->second.second != *p)
+                ++r;
+            r->second.first->wait();
             running.erase(r);
             (*p)->post_execute_exclusive();
         }
@@ -26,6 +26,7 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <functional>
 
 namespace paludis
 {
@@ -61,6 +62,21 @@ namespace paludis
 
             void add(const std::shared_ptr<Executive> & x);
 
+            /**
+             * Allow up to max_running executives from the named queue to run
+             * at once, rather than just one.
+             *
+             * Unlike the default one-at-a-time queues, any executive in the
+             * queue whose can_run() is true may be started, not just the
+             * first one. If can_start_another is provided, it is consulted
+             * before starting an executive whilst another executive from the
+             * same queue is already running.
+             */
+            void set_queue_parallelism(
+                    const std::string & queue_name,
+                    const int max_running,
+                    const std::function<bool ()> & can_start_another = std::function<bool ()>());
+
             void execute();
 
             std::mutex & exclusivity_mutex() PALUDIS_ATTRIBUTE((warn_unused_result));
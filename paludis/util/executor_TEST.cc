@@ -0,0 +1,149 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/util/executor.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/join.hh>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace paludis;
+
+namespace
+{
+    struct Counts
+    {
+        int running;
+        int max_running;
+        std::vector<std::string> started;
+
+        Counts() :
+            running(0),
+            max_running(0)
+        {
+        }
+    };
+
+    struct TestExecutive :
+        Executive
+    {
+        Counts & counts;
+        const std::string queue;
+        const std::string id;
+        bool runnable;
+
+        TestExecutive(Counts & c, const std::string & q, const std::string & i, const bool r) :
+            counts(c),
+            queue(q),
+            id(i),
+            runnable(r)
+        {
+        }
+
+        virtual std::string queue_name() const
+        {
+            return queue;
+        }
+
+        virtual std::string unique_id() const
+        {
+            return id;
+        }
+
+        virtual bool can_run() const
+        {
+            return runnable || (! counts.started.empty());
+        }
+
+        virtual void pre_execute_exclusive()
+        {
+            counts.started.push_back(id);
+            counts.max_running = std::max(counts.max_running, ++counts.running);
+        }
+
+        virtual void execute_threaded()
+        {
+        }
+
+        virtual void flush_threaded()
+        {
+        }
+
+        virtual void post_execute_exclusive()
+        {
+            --counts.running;
+        }
+    };
+}
+
+TEST(Executor, OneAtATime)
+{
+    Counts counts;
+    Executor executor(10);
+    for (int i(0) ; i < 5 ; ++i)
+        executor.add(std::make_shared<TestExecutive>(counts, "q", stringify(i), true));
+    executor.execute();
+
+    EXPECT_EQ(1, counts.max_running);
+    EXPECT_EQ("0 1 2 3 4", join(counts.started.begin(), counts.started.end(), " "));
+    EXPECT_EQ(5, executor.done());
+}
+
+TEST(Executor, Parallel)
+{
+    Counts counts;
+    Executor executor(10);
+    executor.set_queue_parallelism("q", 3);
+    for (int i(0) ; i < 6 ; ++i)
+        executor.add(std::make_shared<TestExecutive>(counts, "q", stringify(i), true));
+    executor.execute();
+
+    EXPECT_EQ(3, counts.max_running);
+    EXPECT_EQ(6u, counts.started.size());
+    EXPECT_EQ(6, executor.done());
+}
+
+TEST(Executor, ParallelOutOfOrder)
+{
+    Counts counts;
+    Executor executor(10);
+    executor.set_queue_parallelism("q", 2);
+    executor.add(std::make_shared<TestExecutive>(counts, "q", "waits", false));
+    executor.add(std::make_shared<TestExecutive>(counts, "q", "first", true));
+    executor.execute();
+
+    EXPECT_EQ("first waits", join(counts.started.begin(), counts.started.end(), " "));
+}
+
+TEST(Executor, ParallelGated)
+{
+    Counts counts;
+    Executor executor(10);
+    executor.set_queue_parallelism("q", 4, [] () { return false; });
+    for (int i(0) ; i < 4 ; ++i)
+        executor.add(std::make_shared<TestExecutive>(counts, "q", stringify(i), true));
+    executor.execute();
+
+    EXPECT_EQ(1, counts.max_running);
+    EXPECT_EQ(4, executor.done());
+}
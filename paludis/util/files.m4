@@ -21,6 +21,7 @@ add(`create_iterator',                   `hh', `fwd', `impl', `gtest')
 add(`damerau_levenshtein',               `hh', `cc', `gtest')
 add(`destringify',                       `hh', `cc', `gtest')
 add(`deferred_construction_ptr',         `hh', `cc', `fwd', `gtest')
+add(`digest_buffer',                     `hh', `gtest')
 add(`digest_registry',                   `hh', `cc')
 add(`discard_output_stream',             `hh', `cc')
 add(`elf',                               `hh', `cc')
@@ -31,8 +32,8 @@ add(`elf_symbol_section',                `hh', `cc')
 add(`elf_types',                         `hh')
 add(`enum_iterator',                     `hh', `cc', `fwd', `gtest')
 add(`env_var_names',                     `hh', `cc')
-add(`exception',                         `hh', `cc')
-add(`executor',                          `hh', `cc', `fwd')
+add(`exception',                         `hh', `cc', `gtest')
+add(`executor',                          `hh', `cc', `fwd', `gtest')
 add(`extract_host_from_url',             `hh', `cc', `fwd', `gtest')
 add(`fd_holder',                         `hh')
 add(`fs_iterator',                       `hh', `cc', `fwd', `se', `gtest', `testscript')
@@ -81,6 +82,7 @@ add(`string_list_stream',                `hh', `cc', `fwd', `gtest')
 add(`strip',                             `hh', `cc', `gtest')
 add(`system',                            `hh', `cc', `gtest')
 add(`tail_output_stream',                `hh', `cc', `fwd', `gtest')
+add(`task_scheduler',                    `hh', `cc', `fwd', `gtest')
 add(`tee_output_stream',                 `hh', `cc', `fwd')
 add(`thread_pool',                       `hh', `cc', `gtest')
 add(`timestamp',                         `hh', `cc', `fwd')
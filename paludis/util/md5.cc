@@ -18,6 +18,7 @@
  */
 
 #include <paludis/util/md5.hh>
+#include <paludis/util/attributes.hh>
 #include <paludis/util/digest_registry.hh>
 #include <sstream>
 #include <istream>
@@ -80,6 +81,12 @@ namespace
             ((x & 0xff0000) >> 8) |
             ((x & 0xff000000) >> 24);
     }
+
+    void write_little_endian_length(uint8_t * const dest, const uint64_t bytes)
+    {
+        for (int j(0) ; j < 8 ; ++j)
+            dest[j] = static_cast<uint8_t>((bytes << 3) >> (j * 8));
+    }
 }
 
 void
@@ -87,6 +94,11 @@ MD5::_update(const uint8_t * const block)
 {
     uint32_t a(_r[0]), b(_r[1]), c(_r[2]), d(_r[3]), f, g, t;
 
+    uint32_t x[16];
+    for (int i(0) ; i < 16 ; ++i)
+        x[i] = _x(i, block);
+
+    PALUDIS_UNROLL_LOOP
     for (int i(0) ; i < 16 ; ++i)
     {
         f = _f(b, c, d);
@@ -95,10 +107,11 @@ MD5::_update(const uint8_t * const block)
         t = d;
         d = c;
         c = b;
-        b = _rl(a + f + _t[i] + _x(g, block), _s[i]) + b;
+        b = _rl(a + f + _t[i] + x[g], _s[i]) + b;
         a = t;
     }
 
+    PALUDIS_UNROLL_LOOP
     for (int i(16) ; i < 32 ; ++i)
     {
         f = _g(b, c, d);
@@ -107,10 +120,11 @@ MD5::_update(const uint8_t * const block)
         t = d;
         d = c;
         c = b;
-        b = _rl(a + f + _t[i] + _x(g, block), _s[i]) + b;
+        b = _rl(a + f + _t[i] + x[g], _s[i]) + b;
         a = t;
     }
 
+    PALUDIS_UNROLL_LOOP
     for (int i(32) ; i < 48 ; ++i)
     {
         f = _h(b, c, d);
@@ -119,10 +133,11 @@ MD5::_update(const uint8_t * const block)
         t = d;
         d = c;
         c = b;
-        b = _rl(a + f + _t[i] + _x(g, block), _s[i]) + b;
+        b = _rl(a + f + _t[i] + x[g], _s[i]) + b;
         a = t;
     }
 
+    PALUDIS_UNROLL_LOOP
     for (int i(48) ; i < 64 ; ++i)
     {
         f = _i(b, c, d);
@@ -131,7 +146,7 @@ MD5::_update(const uint8_t * const block)
         t = d;
         d = c;
         c = b;
-        b = _rl(a + f + _t[i] + _x(g, block), _s[i]) + b;
+        b = _rl(a + f + _t[i] + x[g], _s[i]) + b;
         a = t;
     }
 
@@ -141,45 +156,39 @@ MD5::_update(const uint8_t * const block)
     _r[3] += d;
 }
 
-MD5::MD5(std::istream & stream) :
-    _size(0),
-    _done_one_pad(false)
+MD5::MD5() :
+    _buffer()
 {
     _r[0] = 0x67452301;
     _r[1] = 0xefcdab89;
     _r[2] = 0x98badcfe;
     _r[3] = 0x10325476;
+}
 
-    uint8_t buffer[64];
-    int c, s(0);
-    while (-1 != ((c = _get(stream))))
-    {
-        buffer[s++] = c;
-        if (64 == s)
-        {
-            _update(&buffer[0]);
-            s = 0;
-        }
-    }
-    while (56 != s)
-    {
-        buffer[s++] = 0;
-        if (64 == s)
-        {
-            _update(&buffer[0]);
-            s = 0;
-        }
-    }
+MD5::MD5(std::istream & stream) :
+    MD5()
+{
+    digest_stream(*this, stream);
+    finish();
+}
 
-    buffer[56] = static_cast<uint8_t>(_size >> (0 * 8));
-    buffer[57] = static_cast<uint8_t>(_size >> (1 * 8));
-    buffer[58] = static_cast<uint8_t>(_size >> (2 * 8));
-    buffer[59] = static_cast<uint8_t>(_size >> (3 * 8));
-    buffer[60] = static_cast<uint8_t>(_size >> (4 * 8));
-    buffer[61] = static_cast<uint8_t>(_size >> (5 * 8));
-    buffer[62] = static_cast<uint8_t>(_size >> (6 * 8));
-    buffer[63] = static_cast<uint8_t>(_size >> (7 * 8));
-    _update(&buffer[0]);
+void
+MD5::update(const void * data, std::size_t size)
+{
+    _buffer.update(data, size, [&] (const uint8_t * blocks, std::size_t n) { _process_blocks(blocks, n); });
+}
+
+void
+MD5::finish()
+{
+    _buffer.finish(8, write_little_endian_length, [&] (const uint8_t * blocks, std::size_t n) { _process_blocks(blocks, n); });
+}
+
+void
+MD5::_process_blocks(const uint8_t * blocks, std::size_t n)
+{
+    for ( ; n > 0 ; --n, blocks += 64)
+        _update(blocks);
 }
 
 std::string
@@ -194,24 +203,6 @@ MD5::hexsum() const
     return result.str();
 }
 
-int
-MD5::_get(std::istream & stream)
-{
-    char c;
-    if (stream.get(c))
-    {
-        _size += 8;
-        return static_cast<unsigned char>(c);
-    }
-    else if (! _done_one_pad)
-    {
-        _done_one_pad = true;
-        return 0x80;
-    }
-    else
-        return -1;
-}
-
 const uint8_t MD5::_s[64] = {
     7, 12, 17, 22,  7, 12, 17, 22,  7, 12, 17, 22,  7, 12, 17, 22,
     5,  9, 14, 20,  5,  9, 14, 20,  5,  9, 14, 20,  5,  9, 14, 20,
@@ -24,6 +24,7 @@
 #include <string>
 #include <inttypes.h>
 #include <paludis/util/attributes.hh>
+#include <paludis/util/digest_buffer.hh>
 
 /** \file
  * Declarations for the MD5 digest class.
@@ -48,19 +49,39 @@ namespace paludis
             static const PALUDIS_HIDDEN uint32_t _t[64];
             static const PALUDIS_HIDDEN uint8_t _s[64];
             uint32_t _r[4];
-            uint64_t _size;
-            bool _done_one_pad;
+            DigestBuffer<64> _buffer;
 
             void PALUDIS_HIDDEN _update(const uint8_t * const block);
-
-            inline int PALUDIS_HIDDEN _get(std::istream & stream);
+            void PALUDIS_HIDDEN _process_blocks(const uint8_t * blocks, std::size_t n);
 
         public:
             /**
-             * Constructor.
+             * Constructor, for use with update() and finish().
+             *
+             * \since 2.2.0
+             */
+            MD5();
+
+            /**
+             * Constructor, digesting the entire contents of a stream.
              */
             MD5(std::istream & stream);
 
+            /**
+             * Add more data.
+             *
+             * \since 2.2.0
+             */
+            void update(const void * data, std::size_t size);
+
+            /**
+             * No more data is coming. Must be called exactly once, before
+             * hexsum(), if we were not constructed from a stream.
+             *
+             * \since 2.2.0
+             */
+            void finish();
+
             /**
              * Our checksum, as a string of hex characters.
              */
@@ -27,6 +27,7 @@
 #include <paludis/util/log.hh>
 #include <paludis/util/system.hh>
 #include <paludis/util/env_var_names.hh>
+#include <paludis/util/map.hh>
 
 #include <iostream>
 #include <functional>
@@ -63,27 +64,34 @@ namespace paludis
     {
         std::vector<std::string> args;
         std::string args_string;
+        std::function<int ()> function;
 
-        Imp(std::vector<std::string> && i, const std::string & s) :
+        Imp(std::vector<std::string> && i, const std::string & s, const std::function<int ()> & f) :
             args(i),
-            args_string(s)
+            args_string(s),
+            function(f)
         {
         }
     };
 }
 
 ProcessCommand::ProcessCommand(const std::initializer_list<std::string> & i) :
-    _imp(std::vector<std::string>(i), "")
+    _imp(std::vector<std::string>(i), "", std::function<int ()>())
 {
 }
 
 ProcessCommand::ProcessCommand(const std::string & s) :
-    _imp(std::vector<std::string>(), s)
+    _imp(std::vector<std::string>(), s, std::function<int ()>())
+{
+}
+
+ProcessCommand::ProcessCommand(const std::function<int ()> & f) :
+    _imp(std::vector<std::string>(), "", f)
 {
 }
 
 ProcessCommand::ProcessCommand(ProcessCommand && other) :
-    _imp(std::move(other._imp->args), other._imp->args_string)
+    _imp(std::move(other._imp->args), other._imp->args_string, std::move(other._imp->function))
 {
 }
 
@@ -104,7 +112,24 @@ ProcessCommand::append_args(const std::initializer_list<std::string> & l)
 void
 ProcessCommand::exec()
 {
-    if (! _imp->args_string.empty())
+    if (_imp->function)
+    {
+        /* we must not return into whatever our parent was doing, and we must
+         * not run our parent's atexit handlers or static destructors either.
+         * Nor do we flush anything: what's buffered may be output that another
+         * of our parent's threads hasn't written yet. */
+        int result(EXIT_FAILURE);
+        try
+        {
+            result = _imp->function();
+        }
+        catch (...)
+        {
+        }
+
+        _exit(result);
+    }
+    else if (! _imp->args_string.empty())
     {
         std::string s;
         for (auto v_begin(_imp->args.begin()), v(v_begin), v_end(_imp->args.end()) ;
@@ -926,6 +951,16 @@ Process::clearenv()
     return *this;
 }
 
+const std::shared_ptr<const Map<std::string, std::string> >
+Process::setenvs() const
+{
+    auto result(std::make_shared<Map<std::string, std::string> >());
+    for (auto m(_imp->setenvs.begin()), m_end(_imp->setenvs.end()) ;
+            m != m_end ; ++m)
+        result->insert(m->first, m->second);
+    return result;
+}
+
 Process &
 Process::chdir(const FSPath & f)
 {
@@ -1074,7 +1109,7 @@ RunningProcessHandle::~RunningProcessHandle() noexcept(false)
 RunningProcessHandle::RunningProcessHandle(RunningProcessHandle && other) :
     _imp(other._imp->pid, std::move(other._imp->thread))
 {
-    _imp->pid = -1;
+    other._imp->pid = -1;
 }
 
 int
@@ -25,6 +25,7 @@
 #include <paludis/util/pimp.hh>
 #include <paludis/util/exception.hh>
 #include <paludis/util/fs_path-fwd.hh>
+#include <paludis/util/map-fwd.hh>
 
 #include <string>
 #include <iosfwd>
@@ -62,6 +63,20 @@ namespace paludis
              */
             explicit ProcessCommand(const std::string &);
 
+            /**
+             * Call a function in the child, rather than exec()ing anything.
+             * The child exits with the function's return value, without
+             * flushing any output, so the function must flush anything it
+             * writes.
+             *
+             * The child is a fork of a process that may have other threads,
+             * so the function must be careful not to use anything that those
+             * threads could have been holding locks for.
+             *
+             * \since 2.2.0
+             */
+            explicit ProcessCommand(const std::function<int ()> &);
+
             ProcessCommand(ProcessCommand &&);
             ~ProcessCommand();
 
@@ -100,6 +115,8 @@ namespace paludis
             Process & setenv(const std::string &, const std::string &);
             Process & clearenv();
 
+            const std::shared_ptr<const Map<std::string, std::string> > setenvs() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
             Process & chdir(const FSPath &);
             Process & use_ptys();
             Process & setuid_setgid(uid_t, gid_t);
@@ -22,8 +22,11 @@
 #include <paludis/util/pipe.hh>
 #include <paludis/util/safe_ofstream.hh>
 #include <paludis/util/stringify.hh>
+#include <paludis/util/map.hh>
 
 #include <sstream>
+#include <iostream>
+#include <cstdlib>
 #include <sys/types.h>
 #include <pwd.h>
 
@@ -75,6 +78,15 @@ TEST(Process, TwoWait)
     EXPECT_THROW(int PALUDIS_ATTRIBUTE((unused)) x(handle.wait()), ProcessError);
 }
 
+TEST(Process, MoveHandle)
+{
+    Process true_process(ProcessCommand({"true"}));
+
+    RunningProcessHandle handle(true_process.run());
+    RunningProcessHandle moved(std::move(handle));
+    EXPECT_EQ(0, moved.wait());
+}
+
 TEST(Process, GrabStdout)
 {
     std::stringstream stdout_stream;
@@ -95,6 +107,36 @@ TEST(Process, GrabStdoutSingleCommand)
     EXPECT_EQ("giant space monkey\n", stdout_stream.str());
 }
 
+TEST(Process, Function)
+{
+    std::stringstream stdout_stream;
+    Process function_process(ProcessCommand([] () -> int {
+                std::cout << "monkey" << std::endl;
+                return 3;
+                }));
+    function_process.capture_stdout(stdout_stream);
+    EXPECT_EQ(3, function_process.run().wait());
+    EXPECT_EQ("monkey\n", stdout_stream.str());
+}
+
+TEST(Process, FunctionThrows)
+{
+    Process function_process(ProcessCommand([] () -> int {
+                throw ProcessError("monkey");
+                }));
+    EXPECT_EQ(1, function_process.run().wait());
+}
+
+TEST(Process, FunctionSetenv)
+{
+    Process function_process(ProcessCommand([] () -> int {
+                const char * const v(std::getenv("BANANAS"));
+                return (v && std::string(v) == "IN PYJAMAS") ? 0 : 1;
+                }));
+    function_process.setenv("BANANAS", "IN PYJAMAS");
+    EXPECT_EQ(0, function_process.run().wait());
+}
+
 TEST(Process, GrabStderr)
 {
     std::stringstream stderr_stream;
@@ -147,6 +189,19 @@ TEST(Process, Setenv)
     EXPECT_EQ("in space\n", stdout_stream.str());
 }
 
+TEST(Process, Setenvs)
+{
+    Process process(ProcessCommand({"true"}));
+    process.setenv("monkey", "in space");
+    process.setenv("monkey", "on a rocket");
+    process.setenv("giant", "space monkey");
+
+    auto setenvs(process.setenvs());
+    EXPECT_EQ(2, std::distance(setenvs->begin(), setenvs->end()));
+    EXPECT_EQ("on a rocket", setenvs->find("monkey")->second);
+    EXPECT_EQ("space monkey", setenvs->find("giant")->second);
+}
+
 TEST(Process, Chdir)
 {
     std::stringstream stdout_stream;
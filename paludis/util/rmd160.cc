@@ -82,6 +82,12 @@ namespace
             ((x & 0xff0000) >> 8) |
             ((x & 0xff000000) >> 24);
     }
+
+    void write_little_endian_length(uint8_t * const dest, const uint64_t bytes)
+    {
+        for (int j(0) ; j < 8 ; ++j)
+            dest[j] = static_cast<uint8_t>((bytes << 3) >> (j * 8));
+    }
 }
 
 void
@@ -118,46 +124,40 @@ RMD160::_update(const uint8_t * const block)
     _h[0] = t;
 }
 
-RMD160::RMD160(std::istream & stream) :
-    _size(0),
-    _done_one_pad(false)
+RMD160::RMD160() :
+    _buffer()
 {
     _h[0] = 0x67452301;
     _h[1] = 0xefcdab89;
     _h[2] = 0x98badcfe;
     _h[3] = 0x10325476;
     _h[4] = 0xc3d2e1f0;
+}
 
-    uint8_t buffer[64];
-    int c, s(0);
-    while (-1 != ((c = _get(stream))))
-    {
-        buffer[s++] = c;
-        if (64 == s)
-        {
-            _update(&buffer[0]);
-            s = 0;
-        }
-    }
-    while (56 != s)
-    {
-        buffer[s++] = 0;
-        if (64 == s)
-        {
-            _update(&buffer[0]);
-            s = 0;
-        }
-    }
+RMD160::RMD160(std::istream & stream) :
+    RMD160()
+{
+    digest_stream(*this, stream);
+    finish();
+}
 
-    buffer[56] = static_cast<uint8_t>(_size >> (0 * 8));
-    buffer[57] = static_cast<uint8_t>(_size >> (1 * 8));
-    buffer[58] = static_cast<uint8_t>(_size >> (2 * 8));
-    buffer[59] = static_cast<uint8_t>(_size >> (3 * 8));
-    buffer[60] = static_cast<uint8_t>(_size >> (4 * 8));
-    buffer[61] = static_cast<uint8_t>(_size >> (5 * 8));
-    buffer[62] = static_cast<uint8_t>(_size >> (6 * 8));
-    buffer[63] = static_cast<uint8_t>(_size >> (7 * 8));
-    _update(&buffer[0]);
+void
+RMD160::update(const void * data, std::size_t size)
+{
+    _buffer.update(data, size, [&] (const uint8_t * blocks, std::size_t n) { _process_blocks(blocks, n); });
+}
+
+void
+RMD160::finish()
+{
+    _buffer.finish(8, write_little_endian_length, [&] (const uint8_t * blocks, std::size_t n) { _process_blocks(blocks, n); });
+}
+
+void
+RMD160::_process_blocks(const uint8_t * blocks, std::size_t n)
+{
+    for ( ; n > 0 ; --n, blocks += 64)
+        _update(blocks);
 }
 
 std::string
@@ -172,24 +172,6 @@ RMD160::hexsum() const
     return result.str();
 }
 
-int
-RMD160::_get(std::istream & stream)
-{
-    char c;
-    if (stream.get(c))
-    {
-        _size += 8;
-        return static_cast<unsigned char>(c);
-    }
-    else if (! _done_one_pad)
-    {
-        _done_one_pad = true;
-        return 0x80;
-    }
-    else
-        return -1;
-}
-
 const uint8_t RMD160::_r[80] = {
     0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
     7, 4, 13, 1, 10, 6, 15, 3, 12, 0, 9, 5, 2, 14, 11, 8,
@@ -25,6 +25,7 @@
 #include <fcntl.h>
 #include <string.h>
 #include <cstring>
+#include <algorithm>
 #include <errno.h>
 
 using namespace paludis;
@@ -58,6 +59,35 @@ SafeIFStreamBuf::underflow()
     return traits_type::to_int_type(*gptr());
 }
 
+std::streamsize
+SafeIFStreamBuf::xsgetn(char * s, std::streamsize n)
+{
+    std::streamsize done(std::min<std::streamsize>(n, egptr() - gptr()));
+    std::memcpy(s, gptr(), done);
+    gbump(done);
+
+    /* small reads go through our buffer as usual, but large reads go
+     * straight to the caller rather than being copied 512 bytes at a time */
+    if (n - done < buffer_size - lookbehind_size)
+        return done + std::streambuf::xsgetn(s + done, n - done);
+
+    while (done < n)
+    {
+        ssize_t n_read(read(fd, s + done, n - done));
+        if (-1 == n_read)
+            throw SafeIFStreamError("Error reading from fd " + stringify(fd) + ": " + strerror(errno));
+        else if (0 == n_read)
+            break;
+        done += n_read;
+    }
+
+    std::streamsize n_putback(std::min<std::streamsize>(done, lookbehind_size));
+    std::memcpy(buffer + (lookbehind_size - n_putback), s + done - n_putback, n_putback);
+    setg(buffer + (lookbehind_size - n_putback), buffer + lookbehind_size, buffer + lookbehind_size);
+
+    return done;
+}
+
 SafeIFStreamBuf::pos_type
 SafeIFStreamBuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode)
 {
@@ -56,6 +56,7 @@ namespace paludis
             char buffer[buffer_size];
 
             virtual int_type underflow();
+            virtual std::streamsize xsgetn(char *, std::streamsize);
             virtual pos_type seekoff(off_type, std::ios_base::seekdir, std::ios_base::openmode);
             virtual pos_type seekpos(pos_type, std::ios_base::openmode);
 
@@ -49,6 +49,29 @@ TEST(SafeIFStream, Existing)
     EXPECT_EQ(std::string(1000, 'x'), t);
 }
 
+TEST(SafeIFStream, LargeRead)
+{
+    SafeIFStream s(FSPath::cwd() / "safe_ifstream_TEST_dir" / "existing");
+    ASSERT_TRUE(s);
+    std::string t;
+    s >> t;
+    EXPECT_EQ("first", t);
+
+    char buf[2000];
+    ASSERT_EQ(1001, s.rdbuf()->sgetn(buf, 1001));
+    EXPECT_EQ("\n" + std::string(1000, 'x'), std::string(buf, 1001));
+
+    EXPECT_EQ('\n', s.get());
+    s.unget();
+    EXPECT_EQ('\n', s.get());
+    EXPECT_EQ(0, s.rdbuf()->sgetn(buf, 2000));
+
+    s.clear();
+    s.seekg(0, std::ios::beg);
+    ASSERT_EQ(1007, s.rdbuf()->sgetn(buf, 2000));
+    EXPECT_EQ("first\n" + std::string(1000, 'x') + "\n", std::string(buf, 1007));
+}
+
 TEST(SafeIFStream, ExistingSym)
 {
     SafeIFStream s(FSPath::cwd() / "safe_ifstream_TEST_dir" / "existing");
@@ -24,6 +24,7 @@
 #include <istream>
 #include <iomanip>
 #include <algorithm>
+#include <cstring>
 
 using namespace paludis;
 
@@ -131,46 +132,46 @@ SHA1::process_block(uint32_t * w)
 }
 
 
-SHA1::SHA1(std::istream & s) :
+SHA1::SHA1() :
     h0(0x67452301U),
     h1(0xEFCDAB89U),
     h2(0x98BADCFEU),
     h3(0x10325476U),
     h4(0xC3D2E1F0U)
 {
-    std::streambuf * buf(s.rdbuf());
-    uint64_t size(0);
+}
 
-    union
-    {
-        uint8_t  m[64];
-        uint32_t w[80];
-    } block;
-    std::streamsize block_size;
+SHA1::SHA1(std::istream & s) :
+    SHA1()
+{
+    digest_stream(*this, s);
+    finish();
+}
 
-    do
+void
+SHA1::process_blocks(const uint8_t * blocks, std::size_t n)
+{
+    uint32_t w[80];
+    for ( ; n > 0 ; --n, blocks += 64)
     {
-        block_size = buf->sgetn(reinterpret_cast<char *>(block.m), 64);
-        size += block_size * 8;
+        std::memcpy(w, blocks, 64);
+        process_block(w);
+    }
+}
 
-        if (64 != block_size)
-        {
-            block.m[block_size++] = 0x80U;
-
-            if (56 < block_size)
-            {
-                std::fill(&block.m[block_size], &block.m[64], 0);
-                process_block(block.w);
-                block_size = 0;
-            }
-
-            std::fill(&block.m[block_size], &block.m[56], 0);
-            block.w[14] = to_bigendian<uint32_t>((size >> 32) & 0xFFFFFFFFU);
-            block.w[15] = to_bigendian<uint32_t>(size & 0xFFFFFFFFU);
-        }
+void
+SHA1::update(const void * data, std::size_t size)
+{
+    _buffer.update(data, size, [&] (const uint8_t * blocks, std::size_t n) { process_blocks(blocks, n); });
+}
 
-        process_block(block.w);
-    } while (64 == block_size);
+void
+SHA1::finish()
+{
+    _buffer.finish(8, [] (uint8_t * const dest, const uint64_t bytes) {
+            const uint64_t size(to_bigendian<uint64_t>(bytes << 3));
+            std::memcpy(dest, &size, 8);
+            }, [&] (const uint8_t * blocks, std::size_t n) { process_blocks(blocks, n); });
 }
 
 std::string
@@ -25,6 +25,7 @@
 #include <string>
 #include <inttypes.h>
 #include <paludis/util/attributes.hh>
+#include <paludis/util/digest_buffer.hh>
 
 /** \file
  * Declarations for the SHA-1 digest class.
@@ -47,15 +48,39 @@ namespace paludis
     {
         private:
             uint32_t h0, h1, h2, h3, h4;
+            DigestBuffer<64> _buffer;
 
             void PALUDIS_HIDDEN process_block(uint32_t *);
+            void PALUDIS_HIDDEN process_blocks(const uint8_t * blocks, std::size_t n);
 
         public:
             /**
-             * Constructor.
+             * Constructor, for use with update() and finish().
+             *
+             * \since 2.2.0
+             */
+            SHA1();
+
+            /**
+             * Constructor, digesting the entire contents of a stream.
              */
             SHA1(std::istream & stream);
 
+            /**
+             * Add more data.
+             *
+             * \since 2.2.0
+             */
+            void update(const void * data, std::size_t size);
+
+            /**
+             * No more data is coming. Must be called exactly once, before
+             * hexsum(), if we were not constructed from a stream.
+             *
+             * \since 2.2.0
+             */
+            void finish();
+
             /**
              * Our checksum, as a string of hex characters.
              */
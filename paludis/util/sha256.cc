@@ -20,10 +20,18 @@
 #include "sha256.hh"
 #include <paludis/util/attributes.hh>
 #include <paludis/util/digest_registry.hh>
+#include <paludis/util/system.hh>
+#include <paludis/util/env_var_names.hh>
 #include <istream>
 #include <iomanip>
 #include <sstream>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define PALUDIS_SHA256_HAVE_SHA_NI 1
+#  include <cpuid.h>
+#  include <immintrin.h>
+#endif
+
 using namespace paludis;
 
 /*
@@ -92,6 +100,100 @@ namespace
     {
         dest[j] = lsigma1(dest[j - 2]) + dest[j - 7] + lsigma0(dest[j - 15]) + dest[j - 16];
     }
+
+    void write_big_endian_length(uint8_t * const dest, const uint64_t bytes)
+    {
+        for (int j(0) ; j < 8 ; ++j)
+            dest[7 - j] = static_cast<uint8_t>((bytes << 3) >> (j * 8));
+    }
+
+#ifdef PALUDIS_SHA256_HAVE_SHA_NI
+    /*
+     * Use the SHA extensions where the CPU has them. The state is kept as
+     * ABEF / CDGH pairs, which is what sha256rnds2 wants, and each group of
+     * four rounds also does a share of the message schedule for later
+     * groups.
+     */
+    bool cpu_has_sha_ni()
+    {
+        unsigned a, b, c, d;
+        if (! __get_cpuid(1, &a, &b, &c, &d))
+            return false;
+        if (! ((c & bit_SSSE3) && (c & bit_SSE4_1)))
+            return false;
+        if (__get_cpuid_max(0, 0) < 7)
+            return false;
+        __cpuid_count(7, 0, a, b, c, d);
+        return b & (1 << 29);
+    }
+
+    __attribute__((target("sha,ssse3,sse4.1")))
+    void process_blocks_sha_ni(uint32_t * const h, const uint32_t * const k, const uint8_t * blocks, std::size_t n)
+    {
+        const __m128i byte_swap_mask(_mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL));
+
+        __m128i tmp(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&h[0])));
+        __m128i state1(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&h[4])));
+        tmp = _mm_shuffle_epi32(tmp, 0xb1);
+        state1 = _mm_shuffle_epi32(state1, 0x1b);
+        __m128i state0(_mm_alignr_epi8(tmp, state1, 8));
+        state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+        for ( ; n > 0 ; --n, blocks += 64)
+        {
+            const __m128i abef_save(state0), cdgh_save(state1);
+            __m128i w[4];
+
+            PALUDIS_UNROLL_LOOP
+            for (int g(0) ; g < 16 ; ++g)
+            {
+                __m128i & w_this(w[g & 3]), & w_next(w[(g + 1) & 3]), & w_prev(w[(g + 3) & 3]);
+
+                if (g < 4)
+                    w_this = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(blocks + 16 * g)), byte_swap_mask);
+
+                __m128i msg(_mm_add_epi32(w_this, _mm_loadu_si128(reinterpret_cast<const __m128i *>(&k[4 * g]))));
+                state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+
+                if (g >= 3 && g <= 14)
+                {
+                    w_next = _mm_add_epi32(w_next, _mm_alignr_epi8(w_this, w_prev, 4));
+                    w_next = _mm_sha256msg2_epu32(w_next, w_this);
+                }
+
+                msg = _mm_shuffle_epi32(msg, 0x0e);
+                state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+
+                if (g >= 1 && g <= 12)
+                    w_prev = _mm_sha256msg1_epu32(w_prev, w_this);
+            }
+
+            state0 = _mm_add_epi32(state0, abef_save);
+            state1 = _mm_add_epi32(state1, cdgh_save);
+        }
+
+        tmp = _mm_shuffle_epi32(state0, 0x1b);
+        state1 = _mm_shuffle_epi32(state1, 0xb1);
+        state0 = _mm_blend_epi16(tmp, state1, 0xf0);
+        state1 = _mm_alignr_epi8(state1, tmp, 8);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&h[0]), state0);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&h[4]), state1);
+    }
+
+    const bool have_sha_ni(cpu_has_sha_ni());
+#endif
+
+    /* checked for each new digest rather than once, so that tests can
+     * check both implementations against the known vectors */
+    bool use_sha_ni()
+    {
+#ifdef PALUDIS_SHA256_HAVE_SHA_NI
+        return have_sha_ni && getenv_with_default(env_vars::no_sha_ni, "").empty();
+#else
+        return false;
+#endif
+    }
 }
 
 void
@@ -132,9 +234,9 @@ SHA256::_update(const uint8_t * const block)
     _h[7] += h;
 }
 
-SHA256::SHA256(std::istream & stream) :
-    _size(0),
-    _done_one_pad(false)
+SHA256::SHA256() :
+    _buffer(),
+    _use_sha_ni(use_sha_ni())
 {
     _h[0] = 0x6a09e667;
     _h[1] = 0xbb67ae85;
@@ -144,37 +246,40 @@ SHA256::SHA256(std::istream & stream) :
     _h[5] = 0x9b05688c;
     _h[6] = 0x1f83d9ab;
     _h[7] = 0x5be0cd19;
+}
 
-    uint8_t buffer[64];
-    int c, s(0);
-    while (-1 != ((c = _get(stream))))
-    {
-        buffer[s++] = c;
-        if (64 == s)
-        {
-            _update(&buffer[0]);
-            s = 0;
-        }
-    }
-    while (56 != s)
+SHA256::SHA256(std::istream & stream) :
+    SHA256()
+{
+    digest_stream(*this, stream);
+    finish();
+}
+
+void
+SHA256::update(const void * data, std::size_t size)
+{
+    _buffer.update(data, size, [&] (const uint8_t * blocks, std::size_t n) { _process_blocks(blocks, n); });
+}
+
+void
+SHA256::finish()
+{
+    _buffer.finish(8, write_big_endian_length, [&] (const uint8_t * blocks, std::size_t n) { _process_blocks(blocks, n); });
+}
+
+void
+SHA256::_process_blocks(const uint8_t * blocks, std::size_t n)
+{
+#ifdef PALUDIS_SHA256_HAVE_SHA_NI
+    if (_use_sha_ni)
     {
-        buffer[s++] = 0;
-        if (64 == s)
-        {
-            _update(&buffer[0]);
-            s = 0;
-        }
+        process_blocks_sha_ni(_h, _k, blocks, n);
+        return;
     }
+#endif
 
-    buffer[56] = static_cast<uint8_t>(_size >> (7 * 8));
-    buffer[57] = static_cast<uint8_t>(_size >> (6 * 8));
-    buffer[58] = static_cast<uint8_t>(_size >> (5 * 8));
-    buffer[59] = static_cast<uint8_t>(_size >> (4 * 8));
-    buffer[60] = static_cast<uint8_t>(_size >> (3 * 8));
-    buffer[61] = static_cast<uint8_t>(_size >> (2 * 8));
-    buffer[62] = static_cast<uint8_t>(_size >> (1 * 8));
-    buffer[63] = static_cast<uint8_t>(_size >> (0 * 8));
-    _update(&buffer[0]);
+    for ( ; n > 0 ; --n, blocks += 64)
+        _update(blocks);
 }
 
 std::string
@@ -189,24 +294,6 @@ SHA256::hexsum() const
     return result.str();
 }
 
-int
-SHA256::_get(std::istream & stream)
-{
-    char c;
-    if (stream.get(c))
-    {
-        _size += 8;
-        return static_cast<unsigned char>(c);
-    }
-    else if (! _done_one_pad)
-    {
-        _done_one_pad = true;
-        return 0x80;
-    }
-    else
-        return -1;
-}
-
 const uint32_t
 paludis::SHA256::_k[64] = {
     0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
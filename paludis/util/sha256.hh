@@ -23,6 +23,7 @@
 #include <iosfwd>
 #include <string>
 #include <paludis/util/attributes.hh>
+#include <paludis/util/digest_buffer.hh>
 #include <inttypes.h>
 
 /** \file
@@ -40,6 +41,9 @@ namespace paludis
     /**
      * SHA256 digest class.
      *
+     * The SHA extensions are used where the CPU has them, unless
+     * PALUDIS_NO_SHA_NI is set to something non-empty.
+     *
      * \ingroup g_digests
      */
     class PALUDIS_VISIBLE SHA256
@@ -48,19 +52,40 @@ namespace paludis
             static const PALUDIS_HIDDEN uint32_t _k[64];
 
             uint32_t _h[8];
-            uint64_t _size;
-            bool _done_one_pad;
+            DigestBuffer<64> _buffer;
+            bool _use_sha_ni;
 
             void PALUDIS_HIDDEN _update(const uint8_t * const block);
-
-            inline int PALUDIS_HIDDEN _get(std::istream & stream);
+            void PALUDIS_HIDDEN _process_blocks(const uint8_t * blocks, std::size_t n);
 
         public:
             /**
-             * Constructor.
+             * Constructor, for use with update() and finish().
+             *
+             * \since 2.2.0
+             */
+            SHA256();
+
+            /**
+             * Constructor, digesting the entire contents of a stream.
              */
             SHA256(std::istream & stream);
 
+            /**
+             * Add more data.
+             *
+             * \since 2.2.0
+             */
+            void update(const void * data, std::size_t size);
+
+            /**
+             * No more data is coming. Must be called exactly once, before
+             * hexsum(), if we were not constructed from a stream.
+             *
+             * \since 2.2.0
+             */
+            void finish();
+
             /**
              * Our checksum, as a string of hex characters.
              */
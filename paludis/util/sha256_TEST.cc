@@ -18,9 +18,12 @@
  */
 
 #include <paludis/util/sha256.hh>
+#include <paludis/util/env_var_names.hh>
 
 #include <gtest/gtest.h>
 
+#include <cstdlib>
+
 using namespace paludis;
 
 namespace
@@ -49,18 +52,32 @@ namespace
         return result;
     }
 
-    std::string sha256(const std::string & data)
+    std::string sha256_with(const std::string & data, const bool portable)
     {
+        if (portable)
+            ::setenv(env_vars::no_sha_ni.c_str(), "yes", 1);
+        else
+            ::unsetenv(env_vars::no_sha_ni.c_str());
+
         std::stringstream ss(data);
         SHA256 s(ss);
+        ::unsetenv(env_vars::no_sha_ni.c_str());
         return s.hexsum();
     }
 
+    /* checks the portable implementation, and the SHA-NI one too if the CPU
+     * has it, and gives us something that can't match if they disagree */
+    std::string sha256(const std::string & data)
+    {
+        std::string portable(sha256_with(data, true)), native(sha256_with(data, false));
+        if (portable != native)
+            return "portable " + portable + " native " + native;
+        return portable;
+    }
+
     std::string sha256_dehex(const std::string & data)
     {
-        std::stringstream ss(dehex(data));
-        SHA256 s(ss);
-        return s.hexsum();
+        return sha256(dehex(data));
     }
 }
 
@@ -534,3 +551,9 @@ TEST(SHA256, t200SHA256ShortMsg)
                 "2f5748ad"));
 }
 
+
+TEST(SHA256, LotsOfBlocks)
+{
+    EXPECT_EQ("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0",
+            sha256(std::string(1000000, 'a')));
+}
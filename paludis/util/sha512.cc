@@ -23,8 +23,8 @@
 #include <sstream>
 #include <istream>
 #include <iomanip>
-#include <limits>
 #include <algorithm>
+#include <cstring>
 
 using namespace paludis;
 
@@ -128,7 +128,7 @@ SHA512::process_block(uint64_t * w)
     h7 += h;
 }
 
-SHA512::SHA512(std::istream & s) :
+SHA512::SHA512() :
     h0(0x6A09E667F3BCC908ULL),
     h1(0xBB67AE8584CAA73BULL),
     h2(0x3C6EF372FE94F82BULL),
@@ -138,41 +138,39 @@ SHA512::SHA512(std::istream & s) :
     h6(0x1F83D9ABFB41BD6BULL),
     h7(0x5BE0CD19137E2179ULL)
 {
-    std::streambuf * buf(s.rdbuf());
-    uint64_t size_l(0), size_h(0);
+}
 
-    union
-    {
-        uint8_t  m[128];
-        uint64_t w[80];
-    } block;
-    std::streamsize block_size;
+SHA512::SHA512(std::istream & s) :
+    SHA512()
+{
+    digest_stream(*this, s);
+    finish();
+}
 
-    do
+void
+SHA512::process_blocks(const uint8_t * blocks, std::size_t n)
+{
+    uint64_t w[80];
+    for ( ; n > 0 ; --n, blocks += 128)
     {
-        block_size = buf->sgetn(reinterpret_cast<char *>(block.m), 128);
-        if (size_l > std::numeric_limits<uint64_t>::max() - block_size * 8)
-            ++size_h;
-        size_l += block_size * 8;
-
-        if (128 != block_size)
-        {
-            block.m[block_size++] = 0x80U;
-
-            if (112 < block_size)
-            {
-                std::fill(&block.m[block_size], &block.m[128], 0);
-                process_block(block.w);
-                block_size = 0;
-            }
-
-            std::fill(&block.m[block_size], &block.m[112], 0);
-            block.w[14] = to_bigendian(size_h);
-            block.w[15] = to_bigendian(size_l);
-        }
-
-        process_block(block.w);
-    } while (128 == block_size);
+        std::memcpy(w, blocks, 128);
+        process_block(w);
+    }
+}
+
+void
+SHA512::update(const void * data, std::size_t size)
+{
+    _buffer.update(data, size, [&] (const uint8_t * blocks, std::size_t n) { process_blocks(blocks, n); });
+}
+
+void
+SHA512::finish()
+{
+    _buffer.finish(16, [] (uint8_t * const dest, const uint64_t bytes) {
+            const uint64_t size[2] = { to_bigendian<uint64_t>(bytes >> 61), to_bigendian<uint64_t>(bytes << 3) };
+            std::memcpy(dest, size, 16);
+            }, [&] (const uint8_t * blocks, std::size_t n) { process_blocks(blocks, n); });
 }
 
 std::string
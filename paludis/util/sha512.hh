@@ -24,6 +24,7 @@
 #include <iosfwd>
 #include <string>
 #include <paludis/util/attributes.hh>
+#include <paludis/util/digest_buffer.hh>
 #include <inttypes.h>
 
 /** \file
@@ -47,15 +48,39 @@ namespace paludis
     {
         private:
             uint64_t h0, h1, h2, h3, h4, h5, h6, h7;
+            DigestBuffer<128> _buffer;
 
             void PALUDIS_HIDDEN process_block(uint64_t *);
+            void PALUDIS_HIDDEN process_blocks(const uint8_t * blocks, std::size_t n);
 
         public:
             /**
-             * Constructor.
+             * Constructor, for use with update() and finish().
+             *
+             * \since 2.2.0
+             */
+            SHA512();
+
+            /**
+             * Constructor, digesting the entire contents of a stream.
              */
             SHA512(std::istream & stream);
 
+            /**
+             * Add more data.
+             *
+             * \since 2.2.0
+             */
+            void update(const void * data, std::size_t size);
+
+            /**
+             * No more data is coming. Must be called exactly once, before
+             * hexsum(), if we were not constructed from a stream.
+             *
+             * \since 2.2.0
+             */
+            void finish();
+
             /**
              * Our checksum, as a string of hex characters.
              */
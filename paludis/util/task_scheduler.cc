@@ -0,0 +1,365 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/util/task_scheduler.hh>
+#include <paludis/util/pimp-impl.hh>
+#include <deque>
+#include <list>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+
+using namespace paludis;
+
+namespace
+{
+    enum TaskState
+    {
+        ts_pending,
+        ts_running,
+        ts_succeeded,
+        ts_failed,
+        ts_cancelled
+    };
+
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<std::shared_ptr<Task> > tasks;
+    };
+
+    PALUDIS_TLS const TaskScheduler * current_scheduler = 0;
+    PALUDIS_TLS unsigned current_worker = 0;
+}
+
+namespace paludis
+{
+    template <>
+    struct Imp<Task>
+    {
+        TaskScheduler * const scheduler;
+        const std::function<void ()> function;
+
+        mutable std::mutex mutex;
+        std::condition_variable condition;
+        TaskState state;
+        std::exception_ptr exception;
+        std::list<std::shared_ptr<Task> > continuations;
+
+        Imp(TaskScheduler * const s, const std::function<void ()> & f) :
+            scheduler(s),
+            function(f),
+            state(ts_pending)
+        {
+        }
+    };
+
+    template <>
+    struct Imp<TaskScheduler>
+    {
+        std::vector<std::unique_ptr<WorkerQueue> > queues;
+        std::vector<std::thread> threads;
+
+        std::mutex sleep_mutex;
+        std::condition_variable sleep_condition;
+        int queued;
+        unsigned next_queue;
+        std::atomic<bool> stopping;
+
+        Imp() :
+            queued(0),
+            next_queue(0),
+            stopping(false)
+        {
+        }
+    };
+}
+
+TaskCancelledError::TaskCancelledError() throw () :
+    Exception("Task was cancelled")
+{
+}
+
+Task::Task(TaskScheduler * const s, const std::function<void ()> & f) :
+    _imp(s, f)
+{
+}
+
+Task::~Task()
+{
+}
+
+void
+Task::_run()
+{
+    {
+        std::unique_lock<std::mutex> lock(_imp->mutex);
+        if (ts_pending != _imp->state)
+            return;
+        _imp->state = ts_running;
+    }
+
+    std::exception_ptr exception;
+    try
+    {
+        _imp->function();
+    }
+    catch (...)
+    {
+        exception = std::current_exception();
+    }
+
+    std::list<std::shared_ptr<Task> > continuations;
+    {
+        std::unique_lock<std::mutex> lock(_imp->mutex);
+        _imp->state = exception ? ts_failed : ts_succeeded;
+        _imp->exception = exception;
+        continuations.swap(_imp->continuations);
+        _imp->condition.notify_all();
+    }
+
+    for (auto & c : continuations)
+        if (exception)
+            c->cancel();
+        else
+            _imp->scheduler->_enqueue(c);
+}
+
+bool
+Task::done() const
+{
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+    return ts_pending != _imp->state && ts_running != _imp->state;
+}
+
+bool
+Task::cancelled() const
+{
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+    return ts_cancelled == _imp->state;
+}
+
+void
+Task::cancel()
+{
+    std::list<std::shared_ptr<Task> > continuations;
+    {
+        std::unique_lock<std::mutex> lock(_imp->mutex);
+        if (ts_pending != _imp->state)
+            return;
+
+        _imp->state = ts_cancelled;
+        continuations.swap(_imp->continuations);
+        _imp->condition.notify_all();
+    }
+
+    for (auto & c : continuations)
+        c->cancel();
+}
+
+void
+Task::wait()
+{
+    if (current_scheduler == _imp->scheduler)
+    {
+        /* we're one of our scheduler's workers, so blocking here could starve
+         * the task we're waiting for. do something useful instead. */
+        while (! done())
+            if (! _imp->scheduler->_run_one(current_worker))
+            {
+                std::unique_lock<std::mutex> lock(_imp->mutex);
+                _imp->condition.wait_for(lock, std::chrono::milliseconds(1));
+            }
+    }
+
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+    _imp->condition.wait(lock, [&] () { return ts_pending != _imp->state && ts_running != _imp->state; });
+
+    switch (_imp->state)
+    {
+        case ts_failed:
+            std::rethrow_exception(_imp->exception);
+
+        case ts_cancelled:
+            throw TaskCancelledError();
+
+        case ts_succeeded:
+        case ts_pending:
+        case ts_running:
+            break;
+    }
+}
+
+const std::shared_ptr<Task>
+Task::then(const std::function<void ()> & f)
+{
+    auto result(std::make_shared<Task>(_imp->scheduler, f));
+
+    TaskState state;
+    {
+        std::unique_lock<std::mutex> lock(_imp->mutex);
+        state = _imp->state;
+        if (ts_pending == state || ts_running == state)
+            _imp->continuations.push_back(result);
+    }
+
+    if (ts_succeeded == state)
+        _imp->scheduler->_enqueue(result);
+    else if (ts_failed == state || ts_cancelled == state)
+        result->cancel();
+
+    return result;
+}
+
+TaskScheduler::TaskScheduler(const unsigned n) :
+    _imp()
+{
+    unsigned number_of_workers(n);
+    if (0 == number_of_workers)
+        number_of_workers = std::thread::hardware_concurrency();
+    if (0 == number_of_workers)
+        number_of_workers = 1;
+
+    for (unsigned w(0) ; w != number_of_workers ; ++w)
+        _imp->queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue));
+
+    for (unsigned w(0) ; w != number_of_workers ; ++w)
+        _imp->threads.emplace_back(std::bind(&TaskScheduler::_worker, this, w));
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    {
+        std::unique_lock<std::mutex> lock(_imp->sleep_mutex);
+        _imp->stopping = true;
+        _imp->sleep_condition.notify_all();
+    }
+
+    for (auto & t : _imp->threads)
+        t.join();
+
+    for (auto & q : _imp->queues)
+        for (auto & t : q->tasks)
+            t->cancel();
+}
+
+const std::shared_ptr<Task>
+TaskScheduler::spawn(const std::function<void ()> & f)
+{
+    auto result(std::make_shared<Task>(this, f));
+    _enqueue(result);
+    return result;
+}
+
+unsigned
+TaskScheduler::number_of_workers() const
+{
+    return _imp->queues.size();
+}
+
+void
+TaskScheduler::_enqueue(const std::shared_ptr<Task> & task)
+{
+    /* our own workers push onto the back of their queue, and pop from there
+     * too. tasks from outside go on the front of a queue, so that they are
+     * run in the order they were spawned. */
+    if (current_scheduler == this)
+    {
+        std::unique_lock<std::mutex> lock(_imp->queues[current_worker]->mutex);
+        _imp->queues[current_worker]->tasks.push_back(task);
+    }
+    else
+    {
+        unsigned q;
+        {
+            std::unique_lock<std::mutex> lock(_imp->sleep_mutex);
+            q = _imp->next_queue++ % _imp->queues.size();
+        }
+
+        std::unique_lock<std::mutex> lock(_imp->queues[q]->mutex);
+        _imp->queues[q]->tasks.push_front(task);
+    }
+
+    std::unique_lock<std::mutex> lock(_imp->sleep_mutex);
+    ++_imp->queued;
+    _imp->sleep_condition.notify_one();
+}
+
+bool
+TaskScheduler::_run_one(const unsigned w)
+{
+    std::shared_ptr<Task> task;
+
+    {
+        WorkerQueue & ours(*_imp->queues[w]);
+        std::unique_lock<std::mutex> lock(ours.mutex);
+        if (! ours.tasks.empty())
+        {
+            task = ours.tasks.back();
+            ours.tasks.pop_back();
+        }
+    }
+
+    for (unsigned n(1), n_end(_imp->queues.size()) ; n < n_end && ! task ; ++n)
+    {
+        WorkerQueue & victim(*_imp->queues[(w + n) % n_end]);
+        std::unique_lock<std::mutex> lock(victim.mutex);
+        if (! victim.tasks.empty())
+        {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+        }
+    }
+
+    if (! task)
+        return false;
+
+    {
+        std::unique_lock<std::mutex> lock(_imp->sleep_mutex);
+        --_imp->queued;
+    }
+
+    task->_run();
+    return true;
+}
+
+void
+TaskScheduler::_worker(const unsigned w)
+{
+    current_scheduler = this;
+    current_worker = w;
+
+    while (! _imp->stopping)
+    {
+        if (_run_one(w))
+            continue;
+
+        std::unique_lock<std::mutex> lock(_imp->sleep_mutex);
+        _imp->sleep_condition.wait(lock, [&] () { return _imp->stopping || 0 < _imp->queued; });
+    }
+}
+
+namespace paludis
+{
+    template class Pimp<Task>;
+    template class Pimp<TaskScheduler>;
+}
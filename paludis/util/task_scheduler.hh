@@ -0,0 +1,180 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PALUDIS_GUARD_PALUDIS_UTIL_TASK_SCHEDULER_HH
+#define PALUDIS_GUARD_PALUDIS_UTIL_TASK_SCHEDULER_HH 1
+
+#include <paludis/util/task_scheduler-fwd.hh>
+#include <paludis/util/attributes.hh>
+#include <paludis/util/exception.hh>
+#include <paludis/util/pimp.hh>
+#include <functional>
+#include <memory>
+
+/** \file
+ * Declarations for the TaskScheduler class.
+ *
+ * \ingroup g_threads
+ *
+ * \section Examples
+ *
+ * - None at this time.
+ */
+
+namespace paludis
+{
+    /**
+     * Thrown by Task::wait if the task was cancelled before it could run.
+     *
+     * \ingroup g_threads
+     * \ingroup g_exceptions
+     */
+    class PALUDIS_VISIBLE TaskCancelledError :
+        public Exception
+    {
+        public:
+            TaskCancelledError() throw ();
+    };
+
+    /**
+     * A unit of work that has been given to a TaskScheduler.
+     *
+     * A Task acts as a future: it can be waited upon, cancelled if it has not
+     * yet started, and have continuations attached that are scheduled only
+     * once it has completed successfully.
+     *
+     * \ingroup g_threads
+     * \nosubgrouping
+     */
+    class PALUDIS_VISIBLE Task
+    {
+        friend class TaskScheduler;
+
+        private:
+            Pimp<Task> _imp;
+
+            void _run();
+
+        public:
+            ///\name Basic operations
+            ///\{
+
+            Task(TaskScheduler * const, const std::function<void ()> &);
+            ~Task();
+
+            Task(const Task &) = delete;
+            Task & operator= (const Task &) = delete;
+
+            ///\}
+
+            /**
+             * Has the task finished running, failed, or been cancelled?
+             */
+            bool done() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            /**
+             * Was the task cancelled before it ran?
+             */
+            bool cancelled() const PALUDIS_ATTRIBUTE((warn_unused_result));
+
+            /**
+             * Stop the task from running, if it has not already started. Any
+             * continuations are also cancelled. A task that is already
+             * running is not interrupted.
+             */
+            void cancel();
+
+            /**
+             * Wait for the task to complete.
+             *
+             * If called from one of the scheduler's own workers, other tasks
+             * are run whilst waiting. If the task threw, the exception is
+             * rethrown here, and if it was cancelled, TaskCancelledError is
+             * thrown.
+             */
+            void wait();
+
+            /**
+             * Schedule a further task to be run once this one has completed
+             * successfully. If this task fails or is cancelled, the
+             * continuation is cancelled.
+             */
+            const std::shared_ptr<Task> then(const std::function<void ()> &);
+    };
+
+    /**
+     * A work-stealing scheduler that runs many small tasks on a fixed set of
+     * worker threads.
+     *
+     * Each worker has its own queue. Tasks spawned from inside a worker go onto
+     * that worker's queue and are run most-recent-first; idle workers steal
+     * from the other end of other workers' queues. Tasks spawned from outside
+     * are distributed between the workers, and are run in the order in which
+     * they were spawned.
+     *
+     * \ingroup g_threads
+     * \nosubgrouping
+     */
+    class PALUDIS_VISIBLE TaskScheduler
+    {
+        friend class Task;
+
+        private:
+            Pimp<TaskScheduler> _imp;
+
+            void _enqueue(const std::shared_ptr<Task> &);
+            bool _run_one(const unsigned);
+            void _worker(const unsigned);
+
+        public:
+            ///\name Basic operations
+            ///\{
+
+            /**
+             * If number_of_workers is zero, one worker per processor is used.
+             */
+            explicit TaskScheduler(const unsigned number_of_workers = 0);
+
+            /**
+             * Any tasks that have not yet started are cancelled, and any that
+             * are running are waited for.
+             */
+            ~TaskScheduler();
+
+            TaskScheduler(const TaskScheduler &) = delete;
+            TaskScheduler & operator= (const TaskScheduler &) = delete;
+
+            ///\}
+
+            /**
+             * Schedule a task to be run.
+             */
+            const std::shared_ptr<Task> spawn(const std::function<void ()> &);
+
+            /**
+             * How many worker threads do we have?
+             */
+            unsigned number_of_workers() const PALUDIS_ATTRIBUTE((warn_unused_result));
+    };
+
+    extern template class Pimp<Task>;
+    extern template class Pimp<TaskScheduler>;
+}
+
+#endif
@@ -0,0 +1,128 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <paludis/util/task_scheduler.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace paludis;
+
+namespace
+{
+    void fib(TaskScheduler & scheduler, const int n, std::atomic<int> & result)
+    {
+        if (n < 2)
+        {
+            result += n;
+            return;
+        }
+
+        auto a(scheduler.spawn([&, n] () { fib(scheduler, n - 1, result); }));
+        auto b(scheduler.spawn([&, n] () { fib(scheduler, n - 2, result); }));
+        a->wait();
+        b->wait();
+    }
+}
+
+TEST(TaskScheduler, Works)
+{
+    const int n_tasks(10000);
+    std::vector<int> t(n_tasks, 0);
+    {
+        TaskScheduler scheduler(4);
+        EXPECT_EQ(4u, scheduler.number_of_workers());
+
+        std::list<std::shared_ptr<Task> > tasks;
+        for (int x(0) ; x < n_tasks ; ++x)
+            tasks.push_back(scheduler.spawn([&t, x] () { t[x] = 1; }));
+
+        for (auto & task : tasks)
+            task->wait();
+    }
+    EXPECT_EQ(n_tasks, std::count(t.begin(), t.end(), 1));
+}
+
+TEST(TaskScheduler, Nested)
+{
+    std::atomic<int> result(0);
+    TaskScheduler scheduler(3);
+    scheduler.spawn([&] () { fib(scheduler, 15, result); })->wait();
+    EXPECT_EQ(610, result);
+}
+
+TEST(TaskScheduler, Continuations)
+{
+    std::mutex mutex;
+    std::vector<int> order;
+    TaskScheduler scheduler(2);
+
+    auto first(scheduler.spawn([&] () { std::unique_lock<std::mutex> lock(mutex); order.push_back(1); }));
+    auto second(first->then([&] () { std::unique_lock<std::mutex> lock(mutex); order.push_back(2); }));
+    auto third(second->then([&] () { std::unique_lock<std::mutex> lock(mutex); order.push_back(3); }));
+    third->wait();
+
+    ASSERT_EQ(3u, order.size());
+    EXPECT_EQ(1, order[0]);
+    EXPECT_EQ(2, order[1]);
+    EXPECT_EQ(3, order[2]);
+
+    bool ran(false);
+    auto late(first->then([&] () { ran = true; }));
+    late->wait();
+    EXPECT_TRUE(ran);
+}
+
+TEST(TaskScheduler, Exceptions)
+{
+    TaskScheduler scheduler(2);
+    bool ran(false);
+
+    auto failing(scheduler.spawn([] () { throw std::runtime_error("oops"); }));
+    auto after(failing->then([&] () { ran = true; }));
+
+    EXPECT_THROW(failing->wait(), std::runtime_error);
+    EXPECT_THROW(after->wait(), TaskCancelledError);
+    EXPECT_TRUE(after->cancelled());
+    EXPECT_FALSE(ran);
+}
+
+TEST(TaskScheduler, Cancel)
+{
+    TaskScheduler scheduler(1);
+    std::mutex mutex;
+    bool ran(false);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    auto blocker(scheduler.spawn([&] () { std::unique_lock<std::mutex> l(mutex); }));
+    auto victim(scheduler.spawn([&] () { ran = true; }));
+    victim->cancel();
+    lock.unlock();
+
+    blocker->wait();
+    EXPECT_THROW(victim->wait(), TaskCancelledError);
+    EXPECT_TRUE(victim->done());
+    EXPECT_FALSE(ran);
+}
@@ -23,8 +23,8 @@
 #include <sstream>
 #include <istream>
 #include <iomanip>
-#include <limits>
 #include <algorithm>
+#include <cstring>
 #include <utility>
 
 using namespace paludis;
@@ -395,59 +395,44 @@ Whirlpool::process_block(const uint64_t *eta)
         H[i] = w(i) ^ H[i] ^ eta[i];
 }
 
-Whirlpool::Whirlpool(std::istream & s)
+Whirlpool::Whirlpool()
 {
     std::fill(&H[0], &H[8], 0);
+}
 
-    std::streambuf * buf(s.rdbuf());
-    uint64_t size_1(0), size_2(0), size_3(0), size_4(0);
+Whirlpool::Whirlpool(std::istream & s) :
+    Whirlpool()
+{
+    digest_stream(*this, s);
+    finish();
+}
 
-    union mu
-    {
-        uint8_t m[64];
-        // Nominally uint8_t[8][8], but for efficiency we process an entire row
-        // at a time where possible.
-        uint64_t eta[8];
-    } block;
-    std::streamsize block_size;
-
-    do
+void
+Whirlpool::process_blocks(const uint8_t * blocks, std::size_t n)
+{
+    // Nominally uint8_t[8][8], but for efficiency we process an entire row
+    // at a time where possible.
+    uint64_t eta[8];
+    for ( ; n > 0 ; --n, blocks += 64)
     {
-        block_size = buf->sgetn(reinterpret_cast<char *>(block.m), 64);
-        if (size_1 > std::numeric_limits<uint64_t>::max() - block_size * 8)
-        {
-            if (size_2 == std::numeric_limits<uint64_t>::max())
-            {
-                if (size_3 == std::numeric_limits<uint64_t>::max())
-                {
-                    ++size_4;
-                }
-                ++size_3;
-            }
-            ++size_2;
-        }
-        size_1 += block_size * 8;
+        std::memcpy(eta, blocks, 64);
+        process_block(eta);
+    }
+}
 
-        if (64 != block_size)
-        {
-            block.m[block_size++] = 0x80U;
-
-            if (32 < block_size)
-            {
-                std::fill(&block.m[block_size], &block.m[64], 0);
-                process_block(block.eta);
-                block_size = 0;
-            }
-
-            std::fill(&block.m[block_size], &block.m[32], 0);
-            block.eta[4] = to_bigendian(size_4);
-            block.eta[5] = to_bigendian(size_3);
-            block.eta[6] = to_bigendian(size_2);
-            block.eta[7] = to_bigendian(size_1);
-        }
+void
+Whirlpool::update(const void * data, std::size_t size)
+{
+    _buffer.update(data, size, [&] (const uint8_t * blocks, std::size_t n) { process_blocks(blocks, n); });
+}
 
-        process_block(block.eta);
-    } while (64 == block_size);
+void
+Whirlpool::finish()
+{
+    _buffer.finish(32, [] (uint8_t * const dest, const uint64_t bytes) {
+            const uint64_t size[4] = { 0, 0, to_bigendian<uint64_t>(bytes >> 61), to_bigendian<uint64_t>(bytes << 3) };
+            std::memcpy(dest, size, 32);
+            }, [&] (const uint8_t * blocks, std::size_t n) { process_blocks(blocks, n); });
 }
 
 std::string
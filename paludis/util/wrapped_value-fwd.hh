@@ -31,6 +31,9 @@ namespace paludis
     template <typename Tag_>
     struct WrappedValueTraits;
 
+    template <typename Tag_>
+    struct WrappedValueInterning;
+
     template <typename Type_>
     struct WrappedValueDevoid;
 
@@ -42,15 +42,45 @@ namespace paludis
         }
     };
 
+    template <typename Tag_, bool interned_ = WrappedValueInterning<Tag_>::enabled>
+    struct WrappedValueStorage
+    {
+        static std::shared_ptr<const typename WrappedValueTraits<Tag_>::UnderlyingType> make(
+                const typename WrappedValueTraits<Tag_>::UnderlyingType & v,
+                const typename WrappedValueDevoid<typename WrappedValueTraits<Tag_>::ValidationParamsType>::Type & p)
+        {
+            if (WrappedValueValidate<Tag_, typename WrappedValueTraits<Tag_>::ValidationParamsType>::Type::validate(v, p))
+                return std::make_shared<typename WrappedValueTraits<Tag_>::UnderlyingType>(v);
+            else
+                throw typename WrappedValueTraits<Tag_>::ExceptionType(v);
+        }
+    };
+
+    template <typename Tag_>
+    struct WrappedValueStorage<Tag_, true>
+    {
+        static std::shared_ptr<const typename WrappedValueTraits<Tag_>::UnderlyingType> make(
+                const typename WrappedValueTraits<Tag_>::UnderlyingType & v,
+                const typename WrappedValueDevoid<typename WrappedValueTraits<Tag_>::ValidationParamsType>::Type & p)
+        {
+            /* anything already interned has been validated */
+            auto result(WrappedValueInterning<Tag_>::find(v));
+            if (result)
+                return result;
+
+            if (WrappedValueValidate<Tag_, typename WrappedValueTraits<Tag_>::ValidationParamsType>::Type::validate(v, p))
+                return WrappedValueInterning<Tag_>::insert(v);
+            else
+                throw typename WrappedValueTraits<Tag_>::ExceptionType(v);
+        }
+    };
+
     template <typename Tag_>
     WrappedValue<Tag_>::WrappedValue(
             const typename WrappedValueTraits<Tag_>::UnderlyingType & v,
-            const typename WrappedValueDevoid<typename WrappedValueTraits<Tag_>::ValidationParamsType>::Type & p)
+            const typename WrappedValueDevoid<typename WrappedValueTraits<Tag_>::ValidationParamsType>::Type & p) :
+        _value(WrappedValueStorage<Tag_>::make(v, p))
     {
-        if (WrappedValueValidate<Tag_, typename WrappedValueTraits<Tag_>::ValidationParamsType>::Type::validate(v, p))
-            _value = std::make_shared<typename WrappedValueTraits<Tag_>::UnderlyingType>(v);
-        else
-            throw typename WrappedValueTraits<Tag_>::ExceptionType(v);
     }
 
     template <typename Tag_>
@@ -65,6 +95,8 @@ namespace paludis
     bool
     WrappedValue<Tag_>::WrappedValue::operator< (const WrappedValue & other) const
     {
+        if (_value == other._value)
+            return false;
         return value() < other.value();
     }
 
@@ -72,7 +104,12 @@ namespace paludis
     bool
     WrappedValue<Tag_>::WrappedValue::operator== (const WrappedValue & other) const
     {
-        return value() == other.value();
+        if (_value == other._value)
+            return true;
+        else if (WrappedValueInterning<Tag_>::enabled)
+            return false;
+        else
+            return value() == other.value();
     }
 
     template <typename Tag_>
@@ -39,6 +39,20 @@ namespace paludis
         typedef NoType<0u> * Type;
     };
 
+    /**
+     * Specialise this, with enabled set to true and find and insert
+     * functions, to make every WrappedValue with the same value share the
+     * same storage. Equal values can then be compared by pointer, and a
+     * value that has been seen before need not be validated again.
+     *
+     * \since 2.2.0
+     */
+    template <typename Tag_>
+    struct WrappedValueInterning
+    {
+        static const bool enabled = false;
+    };
+
     template <typename Tag_>
     class PALUDIS_VISIBLE WrappedValue :
         public relational_operators::HasRelationalOperators
@@ -33,6 +33,7 @@
 #include <paludis/version_spec.hh>
 #include <vector>
 #include <limits>
+#include <cstdint>
 
 using namespace paludis;
 
@@ -50,6 +51,65 @@ BadVersionSpecError::BadVersionSpecError(const std::string & name, const std::st
 
 typedef std::vector<VersionSpecComponent> Parts;
 
+namespace
+{
+    /* A packed word holds the component type in the top four bits, and a
+     * value that orders the same way as the component's number_value in the
+     * rest. Anything that won't fit makes us fall back to comparing parts. */
+    const unsigned packed_max_words(12);
+    const unsigned packed_value_bits(60);
+    const unsigned packed_max_digits(18);
+    const uint64_t packed_value_max((uint64_t(1) << packed_value_bits) - 1);
+
+    uint64_t make_packed_word(const VersionSpecComponentType t, const uint64_t v)
+    {
+        return (uint64_t(t) << packed_value_bits) | v;
+    }
+
+    bool make_packed_value(const VersionSpecComponent & c, uint64_t & result)
+    {
+        const std::string & v(c.number_value());
+
+        if (c.type() == vsct_letter)
+        {
+            if (v.length() != 1)
+                return false;
+            result = static_cast<unsigned char>(v[0]);
+            return true;
+        }
+
+        /* _suffix-scm */
+        if (v == "MAX")
+        {
+            result = packed_value_max;
+            return true;
+        }
+
+        std::string::size_type len(v.length());
+        if (c.type() == vsct_floatlike)
+            while (len > 0 && '0' == v[len - 1])
+                --len;
+
+        if (len > packed_max_digits)
+            return false;
+
+        result = 0;
+        for (std::string::size_type i(0) ; i < len ; ++i)
+        {
+            if (v[i] < '0' || v[i] > '9')
+                return false;
+            result = result * 10 + (v[i] - '0');
+        }
+
+        /* floatlike parts compare as strings, so pad them out on the right */
+        if (c.type() == vsct_floatlike)
+            for (std::string::size_type i(len) ; i < packed_max_digits ; ++i)
+                result *= 10;
+
+        return true;
+    }
+}
+
 namespace paludis
 {
     template<>
@@ -60,9 +120,50 @@ namespace paludis
 
         const VersionSpecOptions options;
 
+        bool packed_usable;
+        unsigned packed_size;
+        uint64_t packed[packed_max_words];
+
         Imp(const VersionSpecOptions & o) :
-            options(o)
+            options(o),
+            packed_usable(false),
+            packed_size(0)
+        {
+        }
+
+        void copy_packed(const Imp & other)
         {
+            packed_usable = other.packed_usable;
+            packed_size = other.packed_size;
+            std::copy(other.packed, other.packed + other.packed_size, packed);
+        }
+
+        /* must be called whenever parts changes */
+        void pack()
+        {
+            packed_usable = false;
+            packed_size = 0;
+
+            for (Parts::const_iterator p(parts.begin()), p_end(parts.end()) ;
+                    p != p_end ; ++p)
+            {
+                if ((*p).type() == vsct_ignore)
+                    continue;
+
+                uint64_t v;
+                if (packed_size == packed_max_words || ! make_packed_value(*p, v))
+                    return;
+
+                packed[packed_size++] = make_packed_word((*p).type(), v);
+            }
+
+            /* a trailing -r0 is the same as no revision, and this is the only
+             * place where comparing against the end isn't just comparing
+             * against vsct_empty */
+            while (packed_size > 0 && packed[packed_size - 1] == make_packed_word(vsct_revision, 0))
+                --packed_size;
+
+            packed_usable = true;
         }
     };
 
@@ -330,6 +431,8 @@ VersionSpec::VersionSpec(const std::string & text, const VersionSpecOptions & op
     /* trailing stuff? */
     if (! parser.eof())
         throw BadVersionSpecError(text, "unexpected trailing text '" + text.substr(parser.offset()) + "'");
+
+    _imp->pack();
 }
 
 VersionSpec::VersionSpec(const VersionSpec & other) :
@@ -337,6 +440,7 @@ VersionSpec::VersionSpec(const VersionSpec & other) :
 {
     _imp->text = other._imp->text;
     _imp->parts = other._imp->parts;
+    _imp->copy_packed(*other._imp.get());
 }
 
 const VersionSpec &
@@ -346,6 +450,7 @@ VersionSpec::operator= (const VersionSpec & other)
     {
         _imp->text = other._imp->text;
         _imp->parts = other._imp->parts;
+        _imp->copy_packed(*other._imp.get());
     }
     return *this;
 }
@@ -500,6 +605,19 @@ namespace
 int
 VersionSpec::compare(const VersionSpec & other) const
 {
+    if (_imp->packed_usable && other._imp->packed_usable)
+    {
+        const uint64_t end_word(make_packed_word(vsct_empty, 0));
+        for (unsigned i(0) ; i < _imp->packed_size || i < other._imp->packed_size ; ++i)
+        {
+            const uint64_t a(i < _imp->packed_size ? _imp->packed[i] : end_word);
+            const uint64_t b(i < other._imp->packed_size ? other._imp->packed[i] : end_word);
+            if (a != b)
+                return a < b ? -1 : 1;
+        }
+        return 0;
+    }
+
     return componentwise_compare(_imp->parts, other._imp->parts, compare_comparator);
 }
 
@@ -603,6 +721,7 @@ VersionSpec::remove_revision() const
                 result._imp->parts.begin(),
                 result._imp->parts.end(),
                 IsVersionSpecComponentType<vsct_revision>()), result._imp->parts.end());
+    result._imp->pack();
 
     std::string::size_type p;
     if (std::string::npos != ((p = result._imp->text.rfind("-r"))))
@@ -469,6 +469,36 @@ TEST(VersionSpec, Ordering)
     }
 }
 
+TEST(VersionSpec, LongOrdering)
+{
+    /* too big or too long to compare quickly */
+    ASSERT_TRUE(VersionSpec("1.1234567890123456789", { }) > VersionSpec("1.123456789012345678", { }));
+    ASSERT_TRUE(VersionSpec("1.1234567890123456789", { }) < VersionSpec("1.1234567890123456790", { }));
+    ASSERT_TRUE(VersionSpec("1.1234567890123456789", { }) < VersionSpec("2", { }));
+    ASSERT_TRUE(VersionSpec("1.01234567890123456789", { }) > VersionSpec("1.0123456789012345678", { }));
+    ASSERT_TRUE(VersionSpec("1.01234567890123456789", { }) < VersionSpec("1.0123456789012345679", { }));
+    ASSERT_TRUE(VersionSpec("1.012345678901234567890000", { }) == VersionSpec("1.01234567890123456789", { }));
+    ASSERT_TRUE(VersionSpec("1.012345678901234567", { }) == VersionSpec("1.012345678901234567000", { }));
+    ASSERT_TRUE(VersionSpec("1_alpha999999999999999999", { }) < VersionSpec("1_alpha-scm", { }));
+    ASSERT_TRUE(VersionSpec("1_alpha9999999999999999999", { }) < VersionSpec("1_alpha-scm", { }));
+
+    ASSERT_TRUE(VersionSpec("1.2.3.4.5.6.7.8.9.10.11.12.13", { }) < VersionSpec("1.2.3.4.5.6.7.8.9.10.11.12.14", { }));
+    ASSERT_TRUE(VersionSpec("1.2.3.4.5.6.7.8.9.10.11.12.13", { }) > VersionSpec("1.2.3.4.5.6.7.8.9.10.11.12", { }));
+    ASSERT_TRUE(VersionSpec("1.2.3.4.5.6.7.8.9.10.11.12", { }) < VersionSpec("1.2.3.4.5.6.7.8.9.10.11.12.13", { }));
+    ASSERT_TRUE(VersionSpec("1.2.3.4.5.6.7.8.9.10.11.12-r0.0", { }) == VersionSpec("1.2.3.4.5.6.7.8.9.10.11.12", { }));
+    ASSERT_TRUE(VersionSpec("1.2.3.4.5.6.7.8.9.10.11.12.13-r0", { }) == VersionSpec("1.2.3.4.5.6.7.8.9.10.11.12.13", { }));
+    ASSERT_TRUE(VersionSpec("1.2.3.4.5.6.7.8.9.10.11.12.13-r1", { }).remove_revision() == VersionSpec("1.2.3.4.5.6.7.8.9.10.11.12.13", { }));
+    ASSERT_TRUE(VersionSpec("1.2-r3", { }).remove_revision() < VersionSpec("1.2-r1", { }));
+    ASSERT_TRUE(VersionSpec("1.2-r3", { }).remove_revision() == VersionSpec("1.2-r0", { }));
+
+    VersionSpec v("1.2-r3", { });
+    v = VersionSpec("1.2.3.4.5.6.7.8.9.10.11.12.13", { });
+    ASSERT_TRUE(v > VersionSpec("1.2.3.4.5.6.7.8.9.10.11.12", { }));
+    v = VersionSpec("1.2", { });
+    ASSERT_TRUE(v < VersionSpec("1.2-r1", { }));
+    ASSERT_TRUE(VersionSpec(v) == VersionSpec("1.2-r0", { }));
+}
+
 TEST(VersionSpec, Components)
 {
     VersionSpec v1("1.2x_pre3_rc-scm", { });
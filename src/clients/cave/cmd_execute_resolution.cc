@@ -25,9 +25,12 @@
 #include "colours.hh"
 #include "resume_data.hh"
 #include "format_user_config.hh"
+#include "perform_zygote.hh"
 #include <paludis/args/do_help.hh>
 #include <paludis/args/escape.hh>
 #include <paludis/util/safe_ifstream.hh>
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/fs_stat.hh>
 #include <paludis/util/safe_ofstream.hh>
 #include <paludis/util/system.hh>
 #include <paludis/util/destringify.hh>
@@ -78,10 +81,12 @@
 #include <paludis/filter.hh>
 #include <paludis/elike_blocker.hh>
 #include <paludis/repository.hh>
+#include <paludis/notifier_callback.hh>
 
 #include <set>
 #include <iterator>
 #include <iostream>
+#include <sstream>
 #include <list>
 #include <cstdlib>
 #include <algorithm>
@@ -93,6 +98,7 @@ using namespace cave;
 using namespace paludis::resolver;
 
 using std::cout;
+using std::cerr;
 using std::endl;
 
 namespace
@@ -420,42 +426,32 @@ namespace
                     + cmdline.execution_options.a_change_phases_for.long_name() + "'");
     }
 
-    bool do_fetch(
-            const std::shared_ptr<Environment> & env,
+    bool want_output_with_others(
             const ExecuteResolutionCommandLine & cmdline,
-            const int n_fetch_jobs,
-            const PackageDepSpec & id_spec,
-            const int x, const int y, const int f, const int s, bool normal_only, const bool was_target,
-            std::recursive_mutex & job_mutex,
-            JobActiveState & active_state,
-            std::mutex & executor_mutex)
+            const int n_fetch_jobs)
     {
-        Context context("When fetching for '" + stringify(id_spec) + "':");
-
-        std::string command(cmdline.program_options.a_perform_program.argument());
-        if (command.empty())
-            command = "$CAVE perform";
-
-        command.append(" fetch --hooks --if-supported --managed-output ");
-        if (0 != n_fetch_jobs)
-            command.append("--output-exclusivity with-others --no-terminal-titles ");
-        command.append(stringify(id_spec));
-        command.append(" --x-of-y '" + make_x_of_y(x, y, f, s) + "'");
-
-        if (normal_only)
-            command.append(" --regulars-only --ignore-manual-fetch-errors");
+        return 0 != n_fetch_jobs || 1 < cmdline.execution_options.a_jobs.argument();
+    }
 
+    void append_phase_args(
+            const std::shared_ptr<Sequence<std::string> > & args,
+            const ExecuteResolutionCommandLine & cmdline,
+            const int x, const int y, const bool was_target)
+    {
         if (cmdline.execution_options.a_skip_phase.specified() || cmdline.execution_options.a_abort_at_phase.specified()
                 || cmdline.execution_options.a_skip_until_phase.specified())
         {
             if (apply_phase(cmdline, x, y, was_target))
             {
                 if (cmdline.execution_options.a_skip_phase.specified())
-                    command.append(" " + cmdline.execution_options.a_skip_phase.forwardable_string());
+                    std::copy(cmdline.execution_options.a_skip_phase.forwardable_args()->begin(),
+                            cmdline.execution_options.a_skip_phase.forwardable_args()->end(), args->back_inserter());
                 if (cmdline.execution_options.a_abort_at_phase.specified())
-                    command.append(" " + cmdline.execution_options.a_abort_at_phase.forwardable_string());
+                    std::copy(cmdline.execution_options.a_abort_at_phase.forwardable_args()->begin(),
+                            cmdline.execution_options.a_abort_at_phase.forwardable_args()->end(), args->back_inserter());
                 if (cmdline.execution_options.a_skip_until_phase.specified())
-                    command.append(" " + cmdline.execution_options.a_skip_until_phase.forwardable_string());
+                    std::copy(cmdline.execution_options.a_skip_until_phase.forwardable_args()->begin(),
+                            cmdline.execution_options.a_skip_until_phase.forwardable_args()->end(), args->back_inserter());
             }
         }
 
@@ -464,17 +460,120 @@ namespace
             for (args::StringSetArg::ConstIterator p(cmdline.import_options.a_unpackaged_repository_params.begin_args()),
                     p_end(cmdline.import_options.a_unpackaged_repository_params.end_args()) ;
                     p != p_end ; ++p)
-                command.append(" --" + cmdline.import_options.a_unpackaged_repository_params.long_name() + " " + args::escape(*p));
+            {
+                args->push_back("--" + cmdline.import_options.a_unpackaged_repository_params.long_name());
+                args->push_back(*p);
+            }
         }
+    }
 
-        IPCInputManager input_manager(env.get(), std::bind(&set_output_manager, std::ref(job_mutex),
-                    std::ref(active_state), std::placeholders::_1));
+    int perform_in_child(
+            const std::shared_ptr<Environment> & env,
+            const std::shared_ptr<const Sequence<std::string> > & args,
+            const std::shared_ptr<const PackageID> & id)
+    {
+        try
+        {
+            PerformCommand command;
+            return command.run_for_id(env, args, id);
+        }
+        catch (const args::DoHelp & h)
+        {
+            cerr << "Usage error: " << h.message << endl;
+            return EXIT_FAILURE;
+        }
+        catch (const ActionAbortedError & e)
+        {
+            cout << endl;
+            cerr << "Action aborted:" << endl
+                << "  * " << e.backtrace("\n  * ")
+                << e.message() << " (" << e.what() << ")" << endl;
+            return 42;
+        }
+        catch (const Exception & e)
+        {
+            cerr << endl;
+            cerr << "Error:" << endl;
+            cerr << "  * " << e.backtrace("\n  * ") << e.message() << " (" << e.what() << ")" << endl;
+            cerr << endl;
+            return EXIT_FAILURE;
+        }
+    }
 
-        Process process(ProcessCommand({ "sh", "-c", command }));
-        process.pipe_command_handler("PALUDIS_IPC", std::bind(lock_pipe_command,
+    int run_perform(
+            const ExecuteResolutionCommandLine & cmdline,
+            const std::shared_ptr<const Sequence<std::string> > & args,
+            const PackageDepSpec & id_spec,
+            IPCInputManager & input_manager,
+            std::mutex & executor_mutex,
+            const std::shared_ptr<PerformZygote> & zygote)
+    {
+        const ProcessPipeCommandFunction pipe_command_handler(std::bind(lock_pipe_command,
                     std::ref(executor_mutex), input_manager.pipe_command_handler(), std::placeholders::_1));
 
-        int retcode(process.run().wait());
+        if (! zygote)
+        {
+            std::string command(cmdline.program_options.a_perform_program.argument());
+            if (command.empty())
+                command = "$CAVE perform";
+
+            for (Sequence<std::string>::ConstIterator a(args->begin()), a_end(args->end()) ;
+                    a != a_end ; ++a)
+                command = command + " " + args::escape(*a);
+
+            Process process(ProcessCommand({ "sh", "-c", command }));
+            process.pipe_command_handler("PALUDIS_IPC", pipe_command_handler);
+            return process.run().wait();
+        }
+
+        /* We have already loaded the environment, so rather than making
+         * '$CAVE perform' load it all over again for every job, have the
+         * zygote fork a copy of itself to carry out the action. */
+        Process process(ProcessCommand(zygote->make_relay(args, stringify(id_spec), "PALUDIS_IPC")));
+        process.pipe_command_handler("PALUDIS_IPC", pipe_command_handler);
+        return process.run().wait();
+    }
+
+    bool do_fetch(
+            const std::shared_ptr<Environment> & env,
+            const ExecuteResolutionCommandLine & cmdline,
+            const int n_fetch_jobs,
+            const PackageDepSpec & id_spec,
+            const int x, const int y, const int f, const int s, bool normal_only, const bool was_target,
+            std::recursive_mutex & job_mutex,
+            JobActiveState & active_state,
+            std::mutex & executor_mutex,
+            const std::shared_ptr<PerformZygote> & zygote)
+    {
+        Context context("When fetching for '" + stringify(id_spec) + "':");
+
+        std::shared_ptr<Sequence<std::string> > args(std::make_shared<Sequence<std::string>>());
+        args->push_back("fetch");
+        args->push_back("--hooks");
+        args->push_back("--if-supported");
+        args->push_back("--managed-output");
+        if (want_output_with_others(cmdline, n_fetch_jobs))
+        {
+            args->push_back("--output-exclusivity");
+            args->push_back("with-others");
+            args->push_back("--no-terminal-titles");
+        }
+        args->push_back(stringify(id_spec));
+        args->push_back("--x-of-y");
+        args->push_back(make_x_of_y(x, y, f, s));
+
+        if (normal_only)
+        {
+            args->push_back("--regulars-only");
+            args->push_back("--ignore-manual-fetch-errors");
+        }
+
+        append_phase_args(args, cmdline, x, y, was_target);
+
+        IPCInputManager input_manager(env.get(), std::bind(&set_output_manager, std::ref(job_mutex),
+                    std::ref(active_state), std::placeholders::_1));
+
+        int retcode(run_perform(cmdline, args, id_spec, input_manager, executor_mutex, zygote));
         return 0 == retcode;
     }
 
@@ -491,55 +590,40 @@ namespace
             const bool was_target,
             std::recursive_mutex & job_mutex,
             JobActiveState & active_state,
-            std::mutex & executor_mutex)
+            std::mutex & executor_mutex,
+            const std::shared_ptr<PerformZygote> & zygote)
     {
         Context context("When " + destination_string + " for '" + stringify(id_spec) + "':");
 
-        std::string command(cmdline.program_options.a_perform_program.argument());
-        if (command.empty())
-            command = "$CAVE perform";
-
-        command.append(" install --hooks --managed-output ");
-        if (0 != n_fetch_jobs)
-            command.append("--output-exclusivity with-others ");
-        command.append(stringify(id_spec));
-        command.append(" --destination " + stringify(destination_repository_name));
+        std::shared_ptr<Sequence<std::string> > args(std::make_shared<Sequence<std::string>>());
+        args->push_back("install");
+        args->push_back("--hooks");
+        args->push_back("--managed-output");
+        if (want_output_with_others(cmdline, n_fetch_jobs))
+        {
+            args->push_back("--output-exclusivity");
+            args->push_back("with-others");
+        }
+        args->push_back(stringify(id_spec));
+        args->push_back("--destination");
+        args->push_back(stringify(destination_repository_name));
         for (Sequence<PackageDepSpec>::ConstIterator i(replacing_specs->begin()),
                 i_end(replacing_specs->end()) ;
                 i != i_end ; ++i)
-            command.append(" --replacing " + stringify(*i));
-
-        command.append(" --x-of-y '" + make_x_of_y(x, y, f, s) + "'");
-
-        if (cmdline.execution_options.a_skip_phase.specified() || cmdline.execution_options.a_abort_at_phase.specified()
-                || cmdline.execution_options.a_skip_until_phase.specified())
         {
-            if (apply_phase(cmdline, x, y, was_target))
-            {
-                if (cmdline.execution_options.a_skip_phase.specified())
-                    command.append(" " + cmdline.execution_options.a_skip_phase.forwardable_string());
-                if (cmdline.execution_options.a_abort_at_phase.specified())
-                    command.append(" " + cmdline.execution_options.a_abort_at_phase.forwardable_string());
-                if (cmdline.execution_options.a_skip_until_phase.specified())
-                    command.append(" " + cmdline.execution_options.a_skip_until_phase.forwardable_string());
-            }
+            args->push_back("--replacing");
+            args->push_back(stringify(*i));
         }
 
-        if (cmdline.import_options.a_unpackaged_repository_params.specified())
-        {
-            for (args::StringSetArg::ConstIterator p(cmdline.import_options.a_unpackaged_repository_params.begin_args()),
-                    p_end(cmdline.import_options.a_unpackaged_repository_params.end_args()) ;
-                    p != p_end ; ++p)
-                command.append(" --" + cmdline.import_options.a_unpackaged_repository_params.long_name() + " " + args::escape(*p));
-        }
+        args->push_back("--x-of-y");
+        args->push_back(make_x_of_y(x, y, f, s));
+
+        append_phase_args(args, cmdline, x, y, was_target);
 
         IPCInputManager input_manager(env.get(), std::bind(&set_output_manager, std::ref(job_mutex),
                     std::ref(active_state), std::placeholders::_1));
-        Process process(ProcessCommand({ "sh", "-c", command }));
-        process.pipe_command_handler("PALUDIS_IPC", std::bind(lock_pipe_command,
-                    std::ref(executor_mutex), input_manager.pipe_command_handler(), std::placeholders::_1));
 
-        int retcode(process.run().wait());
+        int retcode(run_perform(cmdline, args, id_spec, input_manager, executor_mutex, zygote));
         const std::shared_ptr<OutputManager> output_manager(input_manager.underlying_output_manager_if_constructed());
         return 0 == retcode;
     }
@@ -554,51 +638,30 @@ namespace
             const bool was_target,
             std::recursive_mutex & job_mutex,
             JobActiveState & active_state,
-            std::mutex & executor_mutex)
+            std::mutex & executor_mutex,
+            const std::shared_ptr<PerformZygote> & zygote)
     {
         Context context("When removing '" + stringify(id_spec) + "':");
 
-        std::string command(cmdline.program_options.a_perform_program.argument());
-        if (command.empty())
-            command = "$CAVE perform";
-
-        command.append(" uninstall --hooks --managed-output ");
-        if (0 != n_fetch_jobs)
-            command.append("--output-exclusivity with-others ");
-        command.append(stringify(id_spec));
-
-        command.append(" --x-of-y '" + make_x_of_y(x, y, f, s) + "'");
-
-        if (cmdline.execution_options.a_skip_phase.specified() || cmdline.execution_options.a_abort_at_phase.specified()
-                || cmdline.execution_options.a_skip_until_phase.specified())
+        std::shared_ptr<Sequence<std::string> > args(std::make_shared<Sequence<std::string>>());
+        args->push_back("uninstall");
+        args->push_back("--hooks");
+        args->push_back("--managed-output");
+        if (want_output_with_others(cmdline, n_fetch_jobs))
         {
-            if (apply_phase(cmdline, x, y, was_target))
-            {
-                if (cmdline.execution_options.a_skip_phase.specified())
-                    command.append(" " + cmdline.execution_options.a_skip_phase.forwardable_string());
-                if (cmdline.execution_options.a_abort_at_phase.specified())
-                    command.append(" " + cmdline.execution_options.a_abort_at_phase.forwardable_string());
-                if (cmdline.execution_options.a_skip_until_phase.specified())
-                    command.append(" " + cmdline.execution_options.a_skip_until_phase.forwardable_string());
-            }
+            args->push_back("--output-exclusivity");
+            args->push_back("with-others");
         }
+        args->push_back(stringify(id_spec));
+        args->push_back("--x-of-y");
+        args->push_back(make_x_of_y(x, y, f, s));
 
-        if (cmdline.import_options.a_unpackaged_repository_params.specified())
-        {
-            for (args::StringSetArg::ConstIterator p(cmdline.import_options.a_unpackaged_repository_params.begin_args()),
-                    p_end(cmdline.import_options.a_unpackaged_repository_params.end_args()) ;
-                    p != p_end ; ++p)
-                command.append(" --" + cmdline.import_options.a_unpackaged_repository_params.long_name() + " " + args::escape(*p));
-        }
+        append_phase_args(args, cmdline, x, y, was_target);
 
         IPCInputManager input_manager(env.get(), std::bind(&set_output_manager, std::ref(job_mutex),
                     std::ref(active_state), std::placeholders::_1));
 
-        Process process(ProcessCommand({ "sh", "-c", command }));
-        process.pipe_command_handler("PALUDIS_IPC", std::bind(lock_pipe_command,
-                    std::ref(executor_mutex), input_manager.pipe_command_handler(), std::placeholders::_1));
-
-        int retcode(process.run().wait());
+        int retcode(run_perform(cmdline, args, id_spec, input_manager, executor_mutex, zygote));
         const std::shared_ptr<OutputManager> output_manager(input_manager.underlying_output_manager_if_constructed());
         if (output_manager)
             output_manager->succeeded();
@@ -813,6 +876,46 @@ namespace
         }
     };
 
+    /* jobs forked from the zygote are given these, rather than having to
+     * find them all over again */
+    struct PerformIDsFinder
+    {
+        const std::shared_ptr<Environment> env;
+        PerformZygoteIDs ids;
+
+        PerformIDsFinder(const std::shared_ptr<Environment> & e) :
+            env(e)
+        {
+        }
+
+        void add(const PackageDepSpec & spec)
+        {
+            /* if it's not there, perform can explain why */
+            const std::shared_ptr<const PackageIDSequence> found((*env)[selection::AllVersionsUnsorted(
+                        generator::Matches(spec, nullptr, { }))]);
+            if (1 == std::distance(found->begin(), found->end()))
+                ids.insert(std::make_pair(stringify(spec), *found->begin()));
+        }
+
+        void visit(const FetchJob & j)
+        {
+            add(j.origin_id_spec());
+        }
+
+        void visit(const InstallJob & j)
+        {
+            add(j.origin_id_spec());
+        }
+
+        void visit(const UninstallJob & j)
+        {
+            for (Sequence<PackageDepSpec>::ConstIterator i(j.ids_to_remove_specs()->begin()),
+                    i_end(j.ids_to_remove_specs()->end()) ;
+                    i != i_end ; ++i)
+                add(*i);
+        }
+    };
+
     enum ExecuteOneVisitorPart
     {
         x1_pre,
@@ -835,8 +938,10 @@ namespace
         ExecuteCounts & counts;
         std::recursive_mutex & job_mutex;
         std::mutex & executor_mutex;
+        const std::shared_ptr<PerformZygote> zygote;
         const ExecuteOneVisitorPart part;
         int retcode;
+        int & job_x;
 
         ExecuteOneVisitor(
                 const std::shared_ptr<Environment> & e,
@@ -845,19 +950,29 @@ namespace
                 ExecuteCounts & k,
                 std::recursive_mutex & m,
                 std::mutex & x,
+                const std::shared_ptr<PerformZygote> & z,
                 ExecuteOneVisitorPart p,
-                int r) :
+                int r,
+                int & j) :
             env(e),
             cmdline(c),
             n_fetch_jobs(n),
             counts(k),
             job_mutex(m),
             executor_mutex(x),
+            zygote(z),
             part(p),
-            retcode(r)
+            retcode(r),
+            job_x(j)
         {
         }
 
+        void count_failure(int & f)
+        {
+            std::unique_lock<std::mutex> lock(counts.mutex);
+            ++f;
+        }
+
         int visit(InstallJob & install_item)
         {
             std::string destination_string, action_string;
@@ -889,9 +1004,9 @@ namespace
             {
                 case x1_pre:
                     {
-                        ++counts.x_installs;
+                        job_x = ++counts.x_installs;
                         starting_action(env, action_string, ensequence(install_item.origin_id_spec()),
-                                install_item.replacing_specs(), counts.x_installs, counts.y_installs,
+                                install_item.replacing_specs(), job_x, counts.y_installs,
                                 counts.f_installs, counts.s_installs);
                     }
                     break;
@@ -904,24 +1019,24 @@ namespace
                             install_item.set_state(active_state);
                         }
 
-                        if (! do_fetch(env, cmdline, n_fetch_jobs, install_item.origin_id_spec(), counts.x_installs, counts.y_installs,
+                        if (! do_fetch(env, cmdline, n_fetch_jobs, install_item.origin_id_spec(), job_x, counts.y_installs,
                                     counts.f_installs, counts.s_installs, false, install_item.was_target(),
-                                    job_mutex, *active_state, executor_mutex))
+                                    job_mutex, *active_state, executor_mutex, zygote))
                         {
                             std::unique_lock<std::recursive_mutex> lock(job_mutex);
                             install_item.set_state(active_state->failed());
-                            ++counts.f_installs;
+                            count_failure(counts.f_installs);
                             return 1;
                         }
 
                         if (! do_install(env, cmdline, n_fetch_jobs, install_item.origin_id_spec(), install_item.destination_repository_name(),
                                     install_item.replacing_specs(), destination_string,
-                                    counts.x_installs, counts.y_installs, counts.f_installs, counts.s_installs,
-                                    install_item.was_target(), job_mutex, *active_state, executor_mutex))
+                                    job_x, counts.y_installs, counts.f_installs, counts.s_installs,
+                                    install_item.was_target(), job_mutex, *active_state, executor_mutex, zygote))
                         {
                             std::unique_lock<std::recursive_mutex> lock(job_mutex);
                             install_item.set_state(active_state->failed());
-                            ++counts.f_installs;
+                            count_failure(counts.f_installs);
                             return 1;
                         }
 
@@ -933,6 +1048,9 @@ namespace
                 case x1_post:
                     done_action(env, action_string, ensequence(install_item.origin_id_spec()), install_item.replacing_specs(), 0 == retcode);
                     env->fetch_repository(install_item.destination_repository_name())->invalidate();
+                    env->trigger_notifier_callback(NotifierCallbackRepositoryInvalidatedEvent(install_item.destination_repository_name()));
+                    if (zygote)
+                        zygote->repository_invalidated(install_item.destination_repository_name());
                     break;
             }
 
@@ -945,8 +1063,8 @@ namespace
             {
                 case x1_pre:
                     {
-                        ++counts.x_installs;
-                        starting_action(env, "remove", uninstall_item.ids_to_remove_specs(), nullptr, counts.x_installs, counts.y_installs,
+                        job_x = ++counts.x_installs;
+                        starting_action(env, "remove", uninstall_item.ids_to_remove_specs(), nullptr, job_x, counts.y_installs,
                                 counts.f_installs, counts.s_installs);
                     }
                     break;
@@ -962,13 +1080,13 @@ namespace
                         for (Sequence<PackageDepSpec>::ConstIterator i(uninstall_item.ids_to_remove_specs()->begin()),
                                 i_end(uninstall_item.ids_to_remove_specs()->end()) ;
                                 i != i_end ; ++i)
-                            if (! do_uninstall(env, cmdline, n_fetch_jobs, *i, counts.x_installs, counts.y_installs,
+                            if (! do_uninstall(env, cmdline, n_fetch_jobs, *i, job_x, counts.y_installs,
                                         counts.f_installs, counts.s_installs, uninstall_item.was_target(),
-                                        job_mutex, *active_state, executor_mutex))
+                                        job_mutex, *active_state, executor_mutex, zygote))
                             {
                                 std::unique_lock<std::recursive_mutex> lock(job_mutex);
                                 uninstall_item.set_state(active_state->failed());
-                                ++counts.f_installs;
+                                count_failure(counts.f_installs);
                                 return 1;
                             }
 
@@ -979,6 +1097,13 @@ namespace
 
                 case x1_post:
                     done_action(env, "remove", uninstall_item.ids_to_remove_specs(), nullptr, 0 == retcode);
+
+                    /* the zygote was forked before anything was uninstalled */
+                    if (zygote)
+                        for (auto i(uninstall_item.ids_to_remove_specs()->begin()), i_end(uninstall_item.ids_to_remove_specs()->end()) ;
+                                i != i_end ; ++i)
+                            if (i->in_repository_ptr())
+                                zygote->repository_invalidated(*i->in_repository_ptr());
                     break;
             }
 
@@ -991,8 +1116,8 @@ namespace
             {
                 case x1_pre:
                     {
-                        ++counts.x_fetches;
-                        starting_action(env, "fetch", ensequence(fetch_item.origin_id_spec()), nullptr, counts.x_fetches, counts.y_fetches,
+                        job_x = ++counts.x_fetches;
+                        starting_action(env, "fetch", ensequence(fetch_item.origin_id_spec()), nullptr, job_x, counts.y_fetches,
                                 counts.f_fetches, counts.s_fetches);
                     }
                     break;
@@ -1005,12 +1130,12 @@ namespace
                             fetch_item.set_state(active_state);
                         }
 
-                        if (! do_fetch(env, cmdline, n_fetch_jobs, fetch_item.origin_id_spec(), counts.x_fetches, counts.y_fetches,
-                                    counts.f_fetches, counts.s_fetches, true, fetch_item.was_target(), job_mutex, *active_state, executor_mutex))
+                        if (! do_fetch(env, cmdline, n_fetch_jobs, fetch_item.origin_id_spec(), job_x, counts.y_fetches,
+                                    counts.f_fetches, counts.s_fetches, true, fetch_item.was_target(), job_mutex, *active_state, executor_mutex, zygote))
                         {
                             std::unique_lock<std::recursive_mutex> lock(job_mutex);
                             fetch_item.set_state(active_state->failed());
-                            ++counts.f_fetches;
+                            count_failure(counts.f_fetches);
                             return 1;
                         }
 
@@ -1169,7 +1294,9 @@ namespace
         const ExecuteResolutionCommandLine & cmdline;
         Executor & executor;
         const int n_fetch_jobs;
+        const int n_jobs;
         const std::shared_ptr<ExecuteJob> job;
+        const JobNumber job_number;
         const std::shared_ptr<JobLists> lists;
         JobRequirementIf require_if;
         std::mutex & global_retcode_mutex;
@@ -1177,30 +1304,37 @@ namespace
         int local_retcode;
         ExecuteCounts & counts;
         std::string & old_heading;
+        const std::shared_ptr<PerformZygote> zygote;
 
         Timestamp last_flushed, last_output;
 
         std::recursive_mutex job_mutex;
 
         bool want, already_done;
+        int job_x;
 
         ExecuteJobExecutive(
                 const std::shared_ptr<Environment> & e,
                 const ExecuteResolutionCommandLine & c,
                 Executor & x,
                 const int n,
+                const int nj,
                 const std::shared_ptr<ExecuteJob> & j,
+                const JobNumber jn,
                 const std::shared_ptr<JobLists> & l,
                 JobRequirementIf r,
                 std::mutex & m,
                 int & rc,
                 ExecuteCounts & k,
-                std::string & h) :
+                std::string & h,
+                const std::shared_ptr<PerformZygote> & z) :
             env(e),
             cmdline(c),
             executor(x),
             n_fetch_jobs(n),
+            n_jobs(nj),
             job(j),
+            job_number(jn),
             lists(l),
             require_if(r),
             global_retcode_mutex(m),
@@ -1208,10 +1342,12 @@ namespace
             local_retcode(0),
             counts(k),
             old_heading(h),
+            zygote(z),
             last_flushed(Timestamp::now()),
             last_output(last_flushed),
             want(true),
-            already_done(false)
+            already_done(false),
+            job_x(0)
         {
         }
 
@@ -1242,8 +1378,64 @@ namespace
                 );
         }
 
+        static bool is_finished(const std::shared_ptr<const ExecuteJob> & j)
+        {
+            return j->state()->make_accept_returning(
+                    [&] (const JobSkippedState &)   { return true; },
+                    [&] (const JobPendingState &)   { return false; },
+                    [&] (const JobActiveState &)    { return false; },
+                    [&] (const JobSucceededState &) { return true; },
+                    [&] (const JobFailedState &)    { return true; }
+                    );
+        }
+
+        static bool is_active(const std::shared_ptr<const ExecuteJob> & j)
+        {
+            return j->state()->make_accept_returning(
+                    [&] (const JobSkippedState &)   { return false; },
+                    [&] (const JobPendingState &)   { return false; },
+                    [&] (const JobActiveState &)    { return true; },
+                    [&] (const JobSucceededState &) { return false; },
+                    [&] (const JobFailedState &)    { return false; }
+                    );
+        }
+
+        bool can_run_in_parallel() const
+        {
+            /* when we aren't being run in order, everything earlier in the
+             * list that we require must be done first. requirements on later
+             * jobs are circular deps that we're ignoring, but we still mustn't
+             * run alongside them. */
+            for (JobRequirements::ConstIterator r(job->requirements()->begin()), r_end(job->requirements()->end()) ;
+                    r != r_end ; ++r)
+            {
+                const std::shared_ptr<const ExecuteJob> req(*lists->execute_job_list()->fetch(r->job_number()));
+                if (r->job_number() < job_number ? ! is_finished(req) : is_active(req))
+                    return false;
+            }
+
+            /* uninstalls act as a barrier: they wait for every earlier
+             * install or uninstall, and everything after them waits for them */
+            const bool is_uninstall(visitor_cast<const UninstallJob>(*job));
+            for (JobList<ExecuteJob>::ConstIterator c(lists->execute_job_list()->begin()),
+                    c_end(lists->execute_job_list()->fetch(job_number)) ;
+                    c != c_end ; ++c)
+            {
+                if (visitor_cast<const FetchJob>(**c))
+                    continue;
+
+                if ((is_uninstall || visitor_cast<const UninstallJob>(**c)) && ! is_finished(*c))
+                    return false;
+            }
+
+            return true;
+        }
+
         bool can_run() const
         {
+            if (1 != n_jobs && ! visitor_cast<const FetchJob>(*job))
+                return can_run_in_parallel();
+
             for (JobRequirements::ConstIterator r(job->requirements()->begin()), r_end(job->requirements()->end()) ;
                     r != r_end ; ++r)
             {
@@ -1251,13 +1443,7 @@ namespace
                     continue;
 
                 const std::shared_ptr<const ExecuteJob> req(*lists->execute_job_list()->fetch(r->job_number()));
-                if (! req->state()->make_accept_returning(
-                            [&] (const JobSkippedState &)   { return true; },
-                            [&] (const JobPendingState &)   { return false; },
-                            [&] (const JobActiveState &)    { return false; },
-                            [&] (const JobSucceededState &) { return true; },
-                            [&] (const JobFailedState &)    { return true; }
-                            ))
+                if (! is_finished(req))
                     return false;
             }
 
@@ -1297,6 +1483,29 @@ namespace
             if (want && cmdline.execution_options.a_fetch.specified())
                 want = visitor_cast<const FetchJob>(*job);
 
+            /* when running in parallel, a requirement can have failed without
+             * that having reached global_retcode yet, since that only happens
+             * once it has been post processed. if we're not continuing on
+             * failure, any failed requirement stops us. */
+            if (want && 1 != n_jobs && ! visitor_cast<const FetchJob>(*job))
+            {
+                for (JobRequirements::ConstIterator r(job->requirements()->begin()), r_end(job->requirements()->end()) ;
+                        r != r_end && want ; ++r)
+                {
+                    if (r->job_number() >= job_number || ! (last_jri == require_if || r->required_if()[require_if]))
+                        continue;
+
+                    const std::shared_ptr<const ExecuteJob> req(*lists->execute_job_list()->fetch(r->job_number()));
+                    want = req->state()->make_accept_returning(
+                            [&] (const JobPendingState &)   { return true; },
+                            [&] (const JobActiveState &)    { return true; },
+                            [&] (const JobSucceededState &) { return true; },
+                            [&] (const JobFailedState &)    { return false; },
+                            [&] (const JobSkippedState &)   { return false; }
+                            );
+                }
+            }
+
             int current_global_retcode;
             {
                 std::unique_lock<std::mutex> lock(global_retcode_mutex);
@@ -1346,7 +1555,7 @@ namespace
 
             if (want)
             {
-                ExecuteOneVisitor execute(env, cmdline, n_fetch_jobs, counts, job_mutex, executor.exclusivity_mutex(), x1_pre, local_retcode);
+                ExecuteOneVisitor execute(env, cmdline, n_fetch_jobs, counts, job_mutex, executor.exclusivity_mutex(), zygote, x1_pre, local_retcode, job_x);
                 int job_retcode(job->accept_returning<int>(execute));
                 local_retcode |= job_retcode;
             }
@@ -1356,7 +1565,7 @@ namespace
         {
             if (want)
             {
-                ExecuteOneVisitor execute(env, cmdline, n_fetch_jobs, counts, job_mutex, executor.exclusivity_mutex(), x1_main, local_retcode);
+                ExecuteOneVisitor execute(env, cmdline, n_fetch_jobs, counts, job_mutex, executor.exclusivity_mutex(), zygote, x1_main, local_retcode, job_x);
                 int job_retcode(job->accept_returning<int>(execute));
                 local_retcode |= job_retcode;
             }
@@ -1369,7 +1578,7 @@ namespace
 
         void display_active(const bool force)
         {
-            if (n_fetch_jobs == 0)
+            if (! want_output_with_others(cmdline, n_fetch_jobs))
                 return;
 
             std::unique_lock<std::recursive_mutex> lock(job_mutex);
@@ -1438,7 +1647,7 @@ namespace
         {
             if (want)
             {
-                ExecuteOneVisitor execute(env, cmdline, n_fetch_jobs, counts, job_mutex, executor.exclusivity_mutex(), x1_post, local_retcode);
+                ExecuteOneVisitor execute(env, cmdline, n_fetch_jobs, counts, job_mutex, executor.exclusivity_mutex(), zygote, x1_post, local_retcode, job_x);
                 local_retcode |= job->accept_returning<int>(execute);
 
                 std::unique_lock<std::recursive_mutex> lock(job_mutex);
@@ -1465,11 +1674,55 @@ namespace
         }
     };
 
+    long available_memory_in_megabytes()
+    {
+        FSPath meminfo_path("/proc/meminfo");
+        if (! meminfo_path.stat().exists())
+            return -1;
+
+        SafeIFStream meminfo(meminfo_path);
+        std::string line;
+        while (std::getline(meminfo, line))
+        {
+            if (0 != line.compare(0, 13, "MemAvailable:"))
+                continue;
+
+            std::istringstream value(line.substr(13));
+            long kilobytes;
+            if (value >> kilobytes)
+                return kilobytes / 1024;
+        }
+
+        return -1;
+    }
+
+    bool have_capacity_for_another_job(const ExecuteResolutionCommandLine & cmdline)
+    {
+        const int max_load(cmdline.execution_options.a_jobs_max_load.argument());
+        if (0 < max_load)
+        {
+            double load;
+            if (1 == getloadavg(&load, 1) && load >= max_load)
+                return false;
+        }
+
+        const int min_free_memory(cmdline.execution_options.a_jobs_min_free_memory.argument());
+        if (0 < min_free_memory)
+        {
+            long available(available_memory_in_megabytes());
+            if (-1 != available && available < min_free_memory)
+                return false;
+        }
+
+        return true;
+    }
+
     int execute_executions(
             const std::shared_ptr<Environment> & env,
             const std::shared_ptr<JobLists> & lists,
             const ExecuteResolutionCommandLine & cmdline,
-            const int n_fetch_jobs)
+            const int n_fetch_jobs,
+            const std::shared_ptr<PerformZygote> & zygote)
     {
         int retcode(0);
         std::mutex retcode_mutex;
@@ -1499,14 +1752,18 @@ namespace
                     + cmdline.execution_options.a_continue_on_failure.argument() + "' to '--"
                     + cmdline.execution_options.a_continue_on_failure.long_name() + "'");
 
+        const int n_jobs(cmdline.execution_options.a_jobs.argument());
+
         Executor executor(100);
+        if (1 != n_jobs)
+            executor.set_queue_parallelism("execute", n_jobs, std::bind(&have_capacity_for_another_job, std::cref(cmdline)));
 
         std::string old_heading;
         for (JobList<ExecuteJob>::ConstIterator c(lists->execute_job_list()->begin()),
                 c_end(lists->execute_job_list()->end()) ;
                 c != c_end ; ++c)
-            executor.add(std::make_shared<ExecuteJobExecutive>(env, cmdline, executor, n_fetch_jobs, *c, lists, require_if, retcode_mutex,
-                            retcode, counts, old_heading));
+            executor.add(std::make_shared<ExecuteJobExecutive>(env, cmdline, executor, n_fetch_jobs, n_jobs,
+                        *c, lists->execute_job_list()->number(c), lists, require_if, retcode_mutex, retcode, counts, old_heading, zygote));
 
         executor.execute();
 
@@ -1522,7 +1779,8 @@ namespace
             const std::shared_ptr<Environment> & env,
             const std::shared_ptr<JobLists> & lists,
             const ExecuteResolutionCommandLine & cmdline,
-            const int n_fetch_jobs)
+            const int n_fetch_jobs,
+            const std::shared_ptr<PerformZygote> & zygote)
     {
         for (JobList<ExecuteJob>::ConstIterator c(lists->execute_job_list()->begin()),
                 c_end(lists->execute_job_list()->end()) ;
@@ -1536,7 +1794,7 @@ namespace
         if (0 != retcode || cmdline.a_pretend.specified())
             return retcode;
 
-        retcode |= execute_executions(env, lists, cmdline, n_fetch_jobs);
+        retcode |= execute_executions(env, lists, cmdline, n_fetch_jobs, zygote);
 
         if (0 != retcode)
             return retcode;
@@ -1682,7 +1940,8 @@ namespace
             const std::shared_ptr<Environment> & env,
             const std::shared_ptr<JobLists> & lists,
             const ExecuteResolutionCommandLine & cmdline,
-            const int n_fetch_jobs)
+            const int n_fetch_jobs,
+            const std::shared_ptr<PerformZygote> & zygote)
     {
         Context context("When executing chosen resolution:");
 
@@ -1694,7 +1953,7 @@ namespace
 
         try
         {
-            retcode = execute_resolution_main(env, lists, cmdline, n_fetch_jobs);
+            retcode = execute_resolution_main(env, lists, cmdline, n_fetch_jobs, zygote);
         }
         catch (...)
         {
@@ -1770,7 +2029,24 @@ ExecuteResolutionCommand::run(
     else
         n_fetch_jobs = 1;
 
-    return execute_resolution(env, lists, cmdline, n_fetch_jobs);
+    if (cmdline.execution_options.a_jobs.argument() < 1)
+        throw args::DoHelp("Argument to '--" + cmdline.execution_options.a_jobs.long_name() + "' must be at least 1");
+
+    /* this must happen before we start any threads */
+    std::shared_ptr<PerformZygote> zygote;
+    if ((! cmdline.a_pretend.specified()) && (! cmdline.program_options.a_perform_program.specified()))
+    {
+        PerformIDsFinder finder(env);
+        for (JobList<ExecuteJob>::ConstIterator c(lists->execute_job_list()->begin()),
+                c_end(lists->execute_job_list()->end()) ;
+                c != c_end ; ++c)
+            (*c)->accept(finder);
+
+        zygote = PerformZygote::make_if_single_threaded(env, finder.ids, std::bind(&perform_in_child, env,
+                    std::placeholders::_1, std::placeholders::_2));
+    }
+
+    return execute_resolution(env, lists, cmdline, n_fetch_jobs, zygote);
 }
 
 int
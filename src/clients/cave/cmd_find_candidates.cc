@@ -152,7 +152,7 @@ int
 FindCandidatesCommand::run_hosted(
         const std::shared_ptr<Environment> & env,
         const SearchCommandLineCandidateOptions & search_options,
-        const SearchCommandLineMatchOptions &,
+        const SearchCommandLineMatchOptions & match_options,
         const SearchCommandLineIndexOptions & index_options,
         const std::string & name_description_substring_hint,
         const std::function<void (const PackageDepSpec &)> & yield,
@@ -168,10 +168,18 @@ FindCandidatesCommand::run_hosted(
 
         std::list<std::string> specs;
 
+        /* if we're only going to match against names or only against
+         * descriptions, the hint need only hold for those */
+        bool default_names_and_descriptions((! match_options.a_name.specified()) &&
+                (! match_options.a_description.specified()) && (! match_options.a_key.specified()));
+        bool hint_names(default_names_and_descriptions || match_options.a_key.specified() || match_options.a_name.specified());
+        bool hint_descriptions(default_names_and_descriptions || match_options.a_key.specified() || match_options.a_description.specified());
+
         SearchExtrasHandle::get_instance()->find_candidates_function(db, specs,
                 search_options.a_all_versions.specified(),
                 search_options.a_visible.specified(),
-                name_description_substring_hint);
+                name_description_substring_hint,
+                hint_names, hint_descriptions);
 
         SearchExtrasHandle::get_instance()->cleanup_db_function(db);
 
@@ -28,7 +28,7 @@
 #include <paludis/util/wrapped_forward_iterator.hh>
 #include <paludis/util/indirect_iterator-impl.hh>
 #include <paludis/util/visitor_cast.hh>
-#include <paludis/util/thread_pool.hh>
+#include <paludis/util/task_scheduler.hh>
 #include <paludis/util/stringify.hh>
 #include <paludis/generator.hh>
 #include <paludis/filtered_generator.hh>
@@ -46,7 +46,7 @@
 #include <algorithm>
 #include <mutex>
 #include <map>
-#include <thread>
+#include <list>
 #include <unistd.h>
 
 #include "command_command_line.hh"
@@ -226,43 +226,34 @@ namespace
         void visit(const NotifierCallbackLinkageStepEvent &) const
         {
         }
+
+        void visit(const NotifierCallbackRepositoryInvalidatedEvent &) const
+        {
+        }
     };
 
-    void worker(std::mutex & mutex, PackageIDSequence::ConstIterator & i, const PackageIDSequence::ConstIterator & i_end, bool & fail,
+    void generate_one(const std::shared_ptr<const PackageID> & id, std::mutex & mutex, bool & fail,
             DisplayCallback & display_callback)
     {
-        while (true)
-        {
-            std::shared_ptr<const PackageID> id;
+        for (PackageID::MetadataConstIterator m(id->begin_metadata()), m_end(id->end_metadata()); m_end != m; ++m)
+            try
+            {
+                MetadataVisitor v;
+                (*m)->accept(v);
+            }
+            catch (const InternalError &)
+            {
+                throw;
+            }
+            catch (const Exception & e)
             {
                 std::unique_lock<std::mutex> lock(mutex);
-                if (i != i_end)
-                    id = *i++;
+                std::cerr << "When processing '" << *id << "' got exception '" << e.message() << "' (" << e.what() << ")" << std::endl;
+                fail = true;
+                break;
             }
 
-            if (! id)
-                return;
-
-            for (PackageID::MetadataConstIterator m(id->begin_metadata()), m_end(id->end_metadata()); m_end != m; ++m)
-                try
-                {
-                    MetadataVisitor v;
-                    (*m)->accept(v);
-                }
-                catch (const InternalError &)
-                {
-                    throw;
-                }
-                catch (const Exception & e)
-                {
-                    std::unique_lock<std::mutex> lock(mutex);
-                    std::cerr << "When processing '" << **i << "' got exception '" << e.message() << "' (" << e.what() << ")" << std::endl;
-                    fail = true;
-                    break;
-                }
-
-                display_callback(DoneOne());
-        }
+        display_callback(DoneOne());
     }
 }
 
@@ -300,19 +291,19 @@ GenerateMetadataCommand::run(
     bool fail(false);
     std::mutex mutex;
 
-    PackageIDSequence::ConstIterator i(ids->begin()), i_end(ids->end());
     {
         DisplayCallback callback;
         callback.total = std::distance(ids->begin(), ids->end());
         ScopedNotifierCallback display_callback_holder(env.get(), NotifierCallbackFunction(std::cref(callback)));
-        ThreadPool pool;
+        TaskScheduler scheduler;
 
-        unsigned n_procs(std::thread::hardware_concurrency());
-        if (n_procs == 0)
-            n_procs = 1;
+        std::list<std::shared_ptr<Task> > tasks;
+        for (PackageIDSequence::ConstIterator i(ids->begin()), i_end(ids->end()) ;
+                i != i_end ; ++i)
+            tasks.push_back(scheduler.spawn(std::bind(&generate_one, *i, std::ref(mutex), std::ref(fail), std::ref(callback))));
 
-        for (int n(0), n_end(n_procs) ; n != n_end ; ++n)
-            pool.create_thread(std::bind(&worker, std::ref(mutex), std::ref(i), std::cref(i_end), std::ref(fail), std::ref(callback)));
+        for (auto & t : tasks)
+            t->wait();
     }
 
     return fail ? EXIT_FAILURE : EXIT_SUCCESS;
@@ -47,6 +47,13 @@
 #include <paludis/util/visitor_cast.hh>
 #include <paludis/util/iterator_funcs.hh>
 #include <paludis/util/stringify.hh>
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/fs_stat.hh>
+#include <paludis/util/fs_iterator.hh>
+#include <paludis/util/options.hh>
+#include <paludis/util/sequence.hh>
+#include <paludis/util/timestamp.hh>
+#include <paludis/util/md5.hh>
 
 #include <cstdlib>
 #include <iostream>
@@ -54,6 +61,8 @@
 #include <list>
 #include <map>
 #include <mutex>
+#include <set>
+#include <sstream>
 #include <unistd.h>
 
 #include "config.h"
@@ -191,6 +200,10 @@ namespace
         void visit(const NotifierCallbackLinkageStepEvent &) const
         {
         }
+
+        void visit(const NotifierCallbackRepositoryInvalidatedEvent &) const
+        {
+        }
     };
 
     struct ManageSearchIndexCommandLine :
@@ -198,6 +211,7 @@ namespace
     {
         args::ArgsGroup g_actions;
         args::SwitchArg a_create;
+        args::SwitchArg a_update;
 
         virtual std::string app_name() const
         {
@@ -219,91 +233,292 @@ namespace
         ManageSearchIndexCommandLine() :
             g_actions(main_options_section(), "Actions", "Specify which action to perform. Exactly one action must be specified."),
             a_create(&g_actions, "create", 'c', "Create a new search index. The existing search index is removed if "
-                    "it already exists", true)
+                    "it already exists", true),
+            a_update(&g_actions, "update", 'u', "Update an existing search index, only rewriting entries for "
+                    "packages where an ID has been added or removed, or where the files an ID is made from have "
+                    "changed. If profiles, eclasses or configuration have changed, or if the index does not exist "
+                    "or was made by an older version, it is created from scratch", true)
         {
             add_usage_line("--create ~/cave-search-index");
+            add_usage_line("--update ~/cave-search-index");
         }
     };
-}
 
-int
-ManageSearchIndexCommand::run(
-        const std::shared_ptr<Environment> & env,
-        const std::shared_ptr<const Sequence<std::string > > & args
-        )
-{
-    ManageSearchIndexCommandLine cmdline;
-    cmdline.run(args, "CAVE", "CAVE_MANAGE_SEARCH_INDEX_OPTIONS", "CAVE_MANAGE_SEARCH_INDEX_CMDLINE");
+    struct Candidate
+    {
+        std::shared_ptr<const PackageID> id;
+        std::string spec;
+        bool is_visible, is_best, is_best_visible;
+        std::string short_desc, long_desc;
+        std::string marker;
+    };
 
-    if (cmdline.a_help.specified())
+    void add_stat(std::ostream & s, const FSPath & f)
     {
-        cout << cmdline;
-        return EXIT_SUCCESS;
+        FSStat f_stat(f.realpath_if_exists());
+        s << f << '\0';
+        if (f_stat.exists())
+            s << f_stat.mtim().seconds() << '.' << f_stat.mtim().nanoseconds() << ' ' << f_stat.file_size();
+        s << '\0';
     }
 
-    if (capped_distance(cmdline.begin_parameters(), cmdline.end_parameters(), 2) != 1)
-        throw args::DoHelp("manage-search-index requires exactly one parameter");
+    void add_tree(std::ostream & s, const FSPath & f)
+    {
+        add_stat(s, f);
+        if (f.stat().is_directory())
+            for (FSIterator d(f, { fsio_include_dotfiles }), d_end ; d != d_end ; ++d)
+                add_tree(s, *d);
+    }
 
-    if (! cmdline.a_create.specified())
-        throw args::DoHelp("exactly one action must be specified");
+    void add_trees(std::ostream & s, const Repository & repo, const std::string & key)
+    {
+        auto k(repo.find_metadata(key));
+        if (k == repo.end_metadata())
+            return;
+
+        if (auto paths = visitor_cast<const MetadataCollectionKey<FSPathSequence> >(**k))
+        {
+            auto v(paths->parse_value());
+            for (auto p(v->begin()), p_end(v->end()) ;
+                    p != p_end ; ++p)
+                add_tree(s, *p);
+        }
+    }
+
+    /* covers everything that can change the masks or metadata of lots of IDs
+     * at once without any of the IDs' own files changing: profiles, eclasses,
+     * single file metadata caches and configuration. if any of it changes,
+     * we rebuild the whole index rather than trying to work out which
+     * packages are affected */
+    std::string global_marker(const Environment * const env)
+    {
+        std::stringstream s;
+        s << PALUDIS_VERSION << PALUDIS_VERSION_SUFFIX << '\0';
+
+        if (env->config_location_key())
+            add_tree(s, env->config_location_key()->parse_value());
+
+        for (auto r(env->begin_repositories()), r_end(env->end_repositories()) ;
+                r != r_end ; ++r)
+        {
+            s << (*r)->name() << '\0';
+
+            if ((*r)->location_key())
+            {
+                FSPath location((*r)->location_key()->parse_value());
+                add_tree(s, location / "profiles");
+                add_stat(s, location / "metadata" / "layout.conf");
+            }
+
+            add_trees(s, **r, "profiles");
+            add_trees(s, **r, "eclassdirs");
+
+            auto cache((*r)->find_metadata("cache"));
+            if (cache != (*r)->end_metadata())
+                if (auto path = visitor_cast<const MetadataValueKey<FSPath> >(**cache))
+                    if (path->parse_value().stat().is_regular_file_or_symlink_to_regular_file())
+                        add_stat(s, path->parse_value());
+        }
+
+        return MD5(s).hexsum();
+    }
+
+    /* per entry metadata cache directories, by repository */
+    std::map<RepositoryName, FSPath> cache_dirs(const Environment * const env)
+    {
+        std::map<RepositoryName, FSPath> result;
 
-    FSPath index_file(*cmdline.begin_parameters());
-    index_file.unlink();
+        for (auto r(env->begin_repositories()), r_end(env->end_repositories()) ;
+                r != r_end ; ++r)
+        {
+            auto cache((*r)->find_metadata("cache"));
+            if (cache != (*r)->end_metadata())
+                if (auto path = visitor_cast<const MetadataValueKey<FSPath> >(**cache))
+                    if (path->parse_value().stat().is_directory_or_symlink_to_directory())
+                        result.insert(std::make_pair((*r)->name(), path->parse_value()));
+        }
+
+        return result;
+    }
 
+    /* changes whenever the files an ID is made from change, so that we can
+     * tell which packages need rewriting without loading any metadata. IDs
+     * with nothing on the filesystem have to fall back to looking at the
+     * things we store */
+    std::string marker_for(const std::shared_ptr<const PackageID> & id, const std::map<RepositoryName, FSPath> & caches)
+    {
+        std::stringstream s;
+
+        if (id->fs_location_key())
+        {
+            add_stat(s, id->fs_location_key()->parse_value());
+
+            auto cache(caches.find(id->repository_name()));
+            if (cache != caches.end())
+                add_stat(s, cache->second / stringify(id->name().category()) /
+                        (stringify(id->name().package()) + "-" + stringify(id->version())));
+        }
+        else
+        {
+            s << id->masked() << '\0';
+            if (id->short_description_key())
+                s << id->short_description_key()->parse_value();
+            s << '\0';
+            if (id->long_description_key())
+                s << id->long_description_key()->parse_value();
+        }
+
+        return MD5(s).hexsum();
+    }
+
+    void write_index(
+            const std::shared_ptr<Environment> & env,
+            const FSPath & index_file,
+            const bool update)
     {
         DisplayCallback display_callback;
         ScopedNotifierCallback display_callback_holder(env.get(),
                 NotifierCallbackFunction(std::cref(display_callback)));
 
-        display_callback(ManageStep{"Creating DB"});
-        CaveSearchExtrasDB * db(SearchExtrasHandle::get_instance()->create_db_function(stringify(index_file).c_str()));
+        display_callback(ManageStep{"Checking configuration"});
+        const std::string marker(global_marker(env.get()));
+
+        CaveSearchExtrasDB * db(nullptr);
+        if (update && index_file.stat().exists())
+        {
+            display_callback(ManageStep{"Opening DB"});
+            db = SearchExtrasHandle::get_instance()->open_db_for_update_function(stringify(index_file).c_str());
+
+            if (db)
+            {
+                std::string old_marker;
+                SearchExtrasHandle::get_instance()->get_marker_function(db, old_marker);
+                if (old_marker != marker)
+                {
+                    SearchExtrasHandle::get_instance()->cleanup_db_function(db);
+                    db = nullptr;
+                }
+            }
+        }
+
+        bool updating(db);
+        if (! updating)
+        {
+            index_file.unlink();
+
+            display_callback(ManageStep{"Creating DB"});
+            db = SearchExtrasHandle::get_instance()->create_db_function(stringify(index_file).c_str());
+        }
 
         display_callback(ManageStep{"Querying"});
         auto ids((*env)[selection::AllVersionsSorted(generator::All())]);
         display_callback.total = display_callback.steps + std::distance(ids->begin(), ids->end()) + 1;
 
+        std::set<std::string> removed_names;
+        if (updating)
+            SearchExtrasHandle::get_instance()->find_package_names_function(db, removed_names);
+
+        const auto caches(cache_dirs(env.get()));
+
         SearchExtrasHandle::get_instance()->starting_adds_function(db);
 
-        bool is_best(false), had_best_visible(false);
-        std::string old_name;
         for (auto i(ids->rbegin()), i_end(ids->rend()) ;
-                i != i_end ; ++i)
+                i != i_end ; )
         {
-            display_callback(ManageStep{"Writing"});
-
-            std::string name(stringify((*i)->name())), short_desc, long_desc;
-            if ((*i)->short_description_key())
-                short_desc = (*i)->short_description_key()->parse_value();
-            if ((*i)->long_description_key())
-                long_desc = (*i)->long_description_key()->parse_value();
-
-            bool is_visible(! (*i)->masked());
+            const QualifiedPackageName qpn((*i)->name());
+            const std::string name(stringify(qpn));
+            removed_names.erase(name);
 
-            if (name != old_name)
+            std::list<std::shared_ptr<const PackageID> > package_ids;
+            std::map<std::string, std::string> markers;
+            for ( ; i != i_end && (*i)->name() == qpn ; ++i)
             {
-                is_best = true;
-                had_best_visible = false;
-                old_name = name;
+                display_callback(ManageStep{"Checking"});
+                package_ids.push_back(*i);
+                markers.insert(std::make_pair(stringify((*i)->uniquely_identifying_spec()), marker_for(*i, caches)));
             }
 
-            bool is_best_visible(is_visible && ! had_best_visible);
-            if (is_best_visible)
-                had_best_visible = true;
+            if (updating)
+            {
+                std::map<std::string, std::string> old_markers;
+                SearchExtrasHandle::get_instance()->find_package_function(db, name, old_markers);
+                if (old_markers == markers)
+                    continue;
 
-            SearchExtrasHandle::get_instance()->add_candidate_function(db, stringify((*i)->uniquely_identifying_spec()),
-                    is_visible, is_best, is_best_visible, name, short_desc, long_desc);
+                SearchExtrasHandle::get_instance()->remove_package_function(db, name);
+            }
 
-            is_best = false;
+            bool is_best(true), had_best_visible(false);
+            for (auto p(package_ids.begin()), p_end(package_ids.end()) ;
+                    p != p_end ; ++p)
+            {
+                Candidate c;
+                c.id = *p;
+                c.spec = stringify((*p)->uniquely_identifying_spec());
+                c.marker = markers.find(c.spec)->second;
+
+                if ((*p)->short_description_key())
+                    c.short_desc = (*p)->short_description_key()->parse_value();
+                if ((*p)->long_description_key())
+                    c.long_desc = (*p)->long_description_key()->parse_value();
+
+                c.is_visible = ! (*p)->masked();
+                c.is_best = is_best;
+                c.is_best_visible = c.is_visible && ! had_best_visible;
+                if (c.is_best_visible)
+                    had_best_visible = true;
+                is_best = false;
+
+                SearchExtrasHandle::get_instance()->add_candidate_function(db, c.spec,
+                        c.is_visible, c.is_best, c.is_best_visible, name, c.short_desc, c.long_desc, c.marker);
+            }
         }
 
+        for (auto n(removed_names.begin()), n_end(removed_names.end()) ;
+                n != n_end ; ++n)
+            SearchExtrasHandle::get_instance()->remove_package_function(db, *n);
+
         display_callback(ManageStep{"Finalising"});
+        SearchExtrasHandle::get_instance()->set_marker_function(db, marker);
         SearchExtrasHandle::get_instance()->done_adds_function(db);
         SearchExtrasHandle::get_instance()->cleanup_db_function(db);
     }
+}
+
+int
+ManageSearchIndexCommand::run(
+        const std::shared_ptr<Environment> & env,
+        const std::shared_ptr<const Sequence<std::string > > & args
+        )
+{
+    ManageSearchIndexCommandLine cmdline;
+    cmdline.run(args, "CAVE", "CAVE_MANAGE_SEARCH_INDEX_OPTIONS", "CAVE_MANAGE_SEARCH_INDEX_CMDLINE");
+
+    if (cmdline.a_help.specified())
+    {
+        cout << cmdline;
+        return EXIT_SUCCESS;
+    }
+
+    if (capped_distance(cmdline.begin_parameters(), cmdline.end_parameters(), 2) != 1)
+        throw args::DoHelp("manage-search-index requires exactly one parameter");
+
+    if (cmdline.a_create.specified() == cmdline.a_update.specified())
+        throw args::DoHelp("exactly one action must be specified");
+
+    write_index(env, FSPath(*cmdline.begin_parameters()), cmdline.a_update.specified());
 
     return EXIT_SUCCESS;
 }
 
+void
+ManageSearchIndexCommand::update_hosted(
+        const std::shared_ptr<Environment> & env,
+        const FSPath & index_file)
+{
+    write_index(env, index_file, true);
+}
+
 std::shared_ptr<args::ArgsHandler>
 ManageSearchIndexCommand::make_doc_cmdline()
 {
@@ -21,6 +21,7 @@
 #define PALUDIS_GUARD_SRC_CLIENTS_CAVE_CMD_MANAGE_SEARCH_INDEX_HH 1
 
 #include "command.hh"
+#include <paludis/util/fs_path-fwd.hh>
 
 namespace paludis
 {
@@ -37,6 +38,10 @@ namespace paludis
                         const std::shared_ptr<const Sequence<std::string > > & args
                         );
 
+                void update_hosted(
+                        const std::shared_ptr<Environment> &,
+                        const FSPath & index_file);
+
                 std::shared_ptr<args::ArgsHandler> make_doc_cmdline();
         };
     }
@@ -48,6 +48,8 @@
 #include <iostream>
 #include <algorithm>
 #include <list>
+#include <map>
+#include <mutex>
 #include <string.h>
 #include <dlfcn.h>
 #include <stdint.h>
@@ -60,6 +62,8 @@ using namespace cave;
 using std::cout;
 using std::endl;
 
+struct CaveMatchExtrasRegex;
+
 #define STUPID_CAST(type, val) reinterpret_cast<type>(reinterpret_cast<uintptr_t>(val))
 
 namespace
@@ -67,29 +71,64 @@ namespace
     struct ExtrasHandle :
         Singleton<ExtrasHandle>
     {
-        typedef bool (* MatchFunction)(const std::string &, const std::string &, bool);
+        typedef CaveMatchExtrasRegex * (* CompileFunction)(const std::string &, bool);
+        typedef bool (* MatchFunction)(const CaveMatchExtrasRegex * const, const std::string &);
+        typedef void (* CleanupFunction)(CaveMatchExtrasRegex * const);
 
         void * handle;
+        CompileFunction compile_function;
         MatchFunction match_function;
+        CleanupFunction cleanup_function;
+
+        /* we're called once per candidate, usually with the same few
+         * patterns every time, so only compile each one once */
+        std::mutex mutex;
+        std::map<std::pair<std::string, bool>, CaveMatchExtrasRegex *> compiled;
 
         ExtrasHandle() :
             handle(nullptr),
-            match_function(nullptr)
+            compile_function(nullptr),
+            match_function(nullptr),
+            cleanup_function(nullptr)
         {
             handle = ::dlopen(("libcavematchextras_" + stringify(PALUDIS_PC_SLOT) + ".so").c_str(), RTLD_NOW | RTLD_GLOBAL);
             if (! handle)
                 throw args::DoHelp("Regular expression match not available because dlopen said " + stringify(::dlerror()));
 
+            compile_function = STUPID_CAST(CompileFunction, ::dlsym(handle, "cave_match_extras_compile_regex"));
+            if (! compile_function)
+                throw args::DoHelp("Regular expression match not available because dlsym said " + stringify(::dlerror()));
+
             match_function = STUPID_CAST(MatchFunction, ::dlsym(handle, "cave_match_extras_match_regex"));
             if (! match_function)
                 throw args::DoHelp("Regular expression match not available because dlsym said " + stringify(::dlerror()));
+
+            cleanup_function = STUPID_CAST(CleanupFunction, ::dlsym(handle, "cave_match_extras_cleanup_regex"));
+            if (! cleanup_function)
+                throw args::DoHelp("Regular expression match not available because dlsym said " + stringify(::dlerror()));
         }
 
         ~ExtrasHandle()
         {
+            for (auto c(compiled.begin()), c_end(compiled.end()) ;
+                    c != c_end ; ++c)
+                cleanup_function(c->second);
+
             if (handle)
                 ::dlclose(handle);
         }
+
+        const CaveMatchExtrasRegex * regex(const std::string & pattern, bool case_sensitive)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            auto c(compiled.find(std::make_pair(pattern, case_sensitive)));
+            if (compiled.end() == c)
+                c = compiled.insert(std::make_pair(std::make_pair(pattern, case_sensitive),
+                            compile_function(pattern, case_sensitive))).first;
+
+            return c->second;
+        }
     };
 
     struct MatchCommandLine :
@@ -138,7 +177,8 @@ namespace
 
     bool match_regex(const std::string & text, const std::string & pattern, bool case_sensitive)
     {
-        return ExtrasHandle::get_instance()->match_function(text, pattern, case_sensitive);
+        return ExtrasHandle::get_instance()->match_function(
+                ExtrasHandle::get_instance()->regex(pattern, case_sensitive), text);
     }
 
     bool match(const std::string & text, const std::string & pattern, bool case_sensitive, const std::string & algorithm)
@@ -77,6 +77,7 @@ namespace
                     ("auto",          'a', "If pattern starts with a /, full; if it contains a /, partial; otherwise, basename")
                     ("basename",      'b', "Basename match")
                     ("full",          'f', "Full match")
+                    ("prefix",        'P', "Match anything whose path starts with the pattern")
                     ("partial",       'p', "Partial match"),
                     "auto"),
             a_dereference(&g_owner_options, "dereference", 'd', "If the pattern is a path that exists and is a symbolic link, "
@@ -394,6 +394,16 @@ PerformCommand::run(
         const std::shared_ptr<Environment> & env,
         const std::shared_ptr<const Sequence<std::string > > & args
         )
+{
+    return run_for_id(env, args, nullptr);
+}
+
+int
+PerformCommand::run_for_id(
+        const std::shared_ptr<Environment> & env,
+        const std::shared_ptr<const Sequence<std::string > > & args,
+        const std::shared_ptr<const PackageID> & maybe_id
+        )
 {
     PerformCommandLine cmdline;
     cmdline.run(args, "CAVE", "CAVE_PERFORM_OPTIONS", "CAVE_PERFORM_CMDLINE");
@@ -411,14 +421,18 @@ PerformCommand::run(
 
     std::string action(*cmdline.begin_parameters());
 
-    const auto spec_str(*next(cmdline.begin_parameters()));
-    const auto spec(parse_spec_with_nice_error(spec_str, env.get(), { }, filter::All()));
-    const auto ids((*env)[selection::AllVersionsUnsorted(generator::Matches(spec, nullptr, { }))]);
-    if (ids->empty())
-        nothing_matching_error(env.get(), spec_str, filter::All());
-    else if (1 != std::distance(ids->begin(), ids->end()))
-        throw BeMoreSpecific(spec, ids);
-    const std::shared_ptr<const PackageID> id(*ids->begin());
+    std::shared_ptr<const PackageID> id(maybe_id);
+    if (! id)
+    {
+        const auto spec_str(*next(cmdline.begin_parameters()));
+        const auto spec(parse_spec_with_nice_error(spec_str, env.get(), { }, filter::All()));
+        const auto ids((*env)[selection::AllVersionsUnsorted(generator::Matches(spec, nullptr, { }))]);
+        if (ids->empty())
+            nothing_matching_error(env.get(), spec_str, filter::All());
+        else if (1 != std::distance(ids->begin(), ids->end()))
+            throw BeMoreSpecific(spec, ids);
+        id = *ids->begin();
+    }
 
     FetchParts parts;
     parts += fp_regulars;
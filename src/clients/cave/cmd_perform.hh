@@ -21,6 +21,7 @@
 #define PALUDIS_GUARD_SRC_CLIENTS_CAVE_CMD_PERFORM_HH 1
 
 #include "command.hh"
+#include <paludis/package_id-fwd.hh>
 
 namespace paludis
 {
@@ -37,6 +38,17 @@ namespace paludis
                         const std::shared_ptr<const Sequence<std::string > > & args
                         );
 
+                /**
+                 * As run(), but for an ID that the caller has already found,
+                 * rather than looking up the spec parameter again. If the ID
+                 * is null, the spec is used as normal.
+                 */
+                int run_for_id(
+                        const std::shared_ptr<Environment> &,
+                        const std::shared_ptr<const Sequence<std::string > > & args,
+                        const std::shared_ptr<const PackageID> &
+                        );
+
                 std::shared_ptr<args::ArgsHandler> make_doc_cmdline();
         };
     }
@@ -74,6 +74,7 @@ namespace
                     ("auto",          "If pattern starts with a /, full; if it contains a /, partial; otherwise, basename")
                     ("basename",      "Basename match")
                     ("full",          "Full match")
+                    ("prefix",        "Match anything whose path starts with the pattern")
                     ("partial",       "Partial match"),
                     "auto"),
             a_matching(&g_owner_options, "matching", 'm', "Show only IDs matching this spec. If specified multiple "
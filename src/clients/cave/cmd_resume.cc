@@ -159,7 +159,7 @@ namespace
         if (program_options.a_execute_resolution_program.specified())
         {
             StringListStream ser_stream;
-            Serialiser ser(ser_stream);
+            Serialiser ser(ser_stream, sf_binary);
             data->job_lists()->serialise(ser);
             ser_stream.nothing_more_to_write();
 
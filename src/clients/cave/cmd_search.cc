@@ -48,6 +48,7 @@
 #include <paludis/util/iterator_funcs.hh>
 #include <paludis/util/stringify.hh>
 
+#include <cctype>
 #include <cstdlib>
 #include <iostream>
 #include <algorithm>
@@ -108,6 +109,114 @@ namespace
         }
     };
 
+    /* a literal substring that anything matching the regex must contain,
+     * or empty if we can't easily find one. anything we don't understand,
+     * including (?x) extended mode, \Q...\E quoting and escapes that take
+     * arguments, means we give up and the caller scans everything. */
+    std::string regex_required_substring(const std::string & pattern)
+    {
+        if (std::string::npos != pattern.find('|'))
+            return "";
+
+        /* inline options, named groups, verbs and so on */
+        if (std::string::npos != pattern.find("(?") || std::string::npos != pattern.find("(*"))
+            return "";
+
+        std::string best, current;
+        auto end_run([&] () {
+                if (current.length() > best.length())
+                    best = current;
+                current.clear();
+            });
+
+        int depth(0);
+        for (std::string::size_type i(0) ; i < pattern.length() ; ++i)
+        {
+            char c(pattern[i]);
+            switch (c)
+            {
+                case '(':
+                    ++depth;
+                    end_run();
+                    continue;
+
+                case ')':
+                    --depth;
+                    end_run();
+                    continue;
+
+                case '[':
+                    /* skip the class, including a leading ] or ^] */
+                    if (i + 1 < pattern.length() && '^' == pattern[i + 1])
+                        ++i;
+                    if (i + 1 < pattern.length() && ']' == pattern[i + 1])
+                        ++i;
+                    while (i + 1 < pattern.length() && ']' != pattern[i + 1])
+                        if ('\\' == pattern[++i])
+                            ++i;
+                    ++i;
+                    end_run();
+                    continue;
+
+                case '\\':
+                    if (++i >= pattern.length())
+                        return "";
+
+                    c = pattern[i];
+                    if (std::isalnum(static_cast<unsigned char>(c)))
+                    {
+                        /* classes and assertions that stand alone. anything
+                         * else, such as \x41, \Q or a backreference, is
+                         * more than we want to parse. */
+                        if (std::string::npos == std::string("dDwWsShHvVRbBAzZGX").find(c))
+                            return "";
+                        end_run();
+                        continue;
+                    }
+
+                    /* an escaped punctuation character is itself */
+                    break;
+
+                case '{':
+                    while (i + 1 < pattern.length() && '}' != pattern[i + 1])
+                        ++i;
+                    ++i;
+                    /* fall through */
+                case '?':
+                case '*':
+                    /* the previous character was optional */
+                    if (! current.empty())
+                        current.erase(current.length() - 1);
+                    end_run();
+                    continue;
+
+                case '+':
+                    /* the previous character is still needed at least once */
+                case '.':
+                case '^':
+                case '$':
+                    end_run();
+                    continue;
+            }
+
+            /* a quantifier would apply to the whole of a multibyte
+             * character, and we don't want to split one */
+            if (c & 0x80)
+                return "";
+
+            if (0 != depth)
+                continue;
+
+            current.append(1, c);
+            /* don't count the last character yet, in case it's quantified */
+            if (current.length() - 1 > best.length())
+                best = current.substr(0, current.length() - 1);
+        }
+
+        end_run();
+        return best;
+    }
+
     void found_match(
             const std::shared_ptr<Environment> & env,
             const std::shared_ptr<Set<QualifiedPackageName> > & result,
@@ -247,6 +356,10 @@ namespace
         void visit(const NotifierCallbackLinkageStepEvent &) const
         {
         }
+
+        void visit(const NotifierCallbackRepositoryInvalidatedEvent &) const
+        {
+        }
     };
 
     void step(DisplayCallback & display_callback, const std::string & s)
@@ -284,16 +397,16 @@ SearchCommand::run(
         if (cmdline.match_options.a_key.specified())
             break;
 
-        if ((cmdline.match_options.a_type.argument() != "text") && (cmdline.match_options.a_type.argument() != "exact"))
-            break;
-
         if (cmdline.match_options.a_not.specified())
             break;
 
         if ((! cmdline.match_options.a_and.specified()) && (1 != capped_distance(cmdline.begin_parameters(), cmdline.end_parameters(), 2)))
             break;
 
-        name_description_substring_hint = *cmdline.begin_parameters();
+        if (cmdline.match_options.a_type.argument() == "regex")
+            name_description_substring_hint = regex_required_substring(*cmdline.begin_parameters());
+        else if ((cmdline.match_options.a_type.argument() == "text") || (cmdline.match_options.a_type.argument() == "exact"))
+            name_description_substring_hint = *cmdline.begin_parameters();
     } while (false);
 
     {
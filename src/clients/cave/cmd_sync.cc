@@ -18,6 +18,7 @@
  */
 
 #include "cmd_sync.hh"
+#include "cmd_manage_search_index.hh"
 #include "exceptions.hh"
 #include "colours.hh"
 #include "format_user_config.hh"
@@ -28,6 +29,7 @@
 #include <paludis/util/timestamp.hh>
 #include <paludis/util/stringify.hh>
 #include <paludis/util/join.hh>
+#include <paludis/util/fs_path.hh>
 #include <paludis/output_manager.hh>
 #include <paludis/standard_output_manager.hh>
 #include <paludis/repository.hh>
@@ -36,6 +38,7 @@
 #include <paludis/syncer.hh>
 #include <paludis/metadata_key.hh>
 #include <paludis/create_output_manager_info.hh>
+#include <paludis/notifier_callback.hh>
 #include <functional>
 #include <cstdlib>
 #include <iostream>
@@ -67,6 +70,9 @@ namespace
         args::AliasArg a_suffix;
         args::StringArg a_revision;
 
+        args::ArgsGroup g_search_index_options;
+        args::StringArg a_update_search_index;
+
         virtual std::string app_name() const
         {
             return "cave sync";
@@ -91,7 +97,12 @@ namespace
             a_source(&g_sync_options, "source", 's', "Use the specified source for syncing."),
             a_suffix(&a_source, "suffix", true),
             a_revision(&g_sync_options, "revision", 'r', "Sync to the specified revision. Not supported by all "
-                    "syncers. Probably doesn't make sense when not specified with a repository parameter.")
+                    "syncers. Probably doesn't make sense when not specified with a repository parameter."),
+
+            g_search_index_options(main_options_section(), "Search Index Options", "Search index options."),
+            a_update_search_index(&g_search_index_options, "update-search-index", '\0', "After syncing, update "
+                    "the specified search index, as if by 'cave manage-search-index --update'. Usually best set in "
+                    "CAVE_SYNC_OPTIONS.")
         {
             add_usage_line("[ --sequential ] [repository ...]");
         }
@@ -405,6 +416,7 @@ SyncCommand::run(
     {
         (*r)->invalidate();
         (*r)->purge_invalid_cache();
+        env->trigger_notifier_callback(NotifierCallbackRepositoryInvalidatedEvent((*r)->name()));
     }
 
     if (0 != env->perform_hook(Hook("sync_all_post")
@@ -412,6 +424,12 @@ SyncCommand::run(
                 nullptr).max_exit_status())
         throw SyncFailedError("Sync aborted by hook");
 
+    if (cmdline.a_update_search_index.specified())
+    {
+        cout << fuc(fs_heading(), fv<'s'>("Updating search index"));
+        ManageSearchIndexCommand().update_hosted(env, FSPath(cmdline.a_update_search_index.argument()));
+    }
+
     return retcode;
 }
 
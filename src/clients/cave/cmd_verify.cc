@@ -33,6 +33,7 @@
 #include <paludis/util/md5.hh>
 #include <paludis/util/fs_stat.hh>
 #include <paludis/util/stringify.hh>
+#include <paludis/util/task_scheduler.hh>
 #include <paludis/environment.hh>
 #include <paludis/repository.hh>
 #include <paludis/user_dep_spec.hh>
@@ -50,6 +51,7 @@
 #include <iostream>
 #include <algorithm>
 #include <set>
+#include <list>
 
 #include "command_command_line.hh"
 
@@ -95,6 +97,7 @@ namespace
 
         int exit_status;
         bool done_heading;
+        std::string output;
 
         Verifier(const std::shared_ptr<const PackageID> & i) :
             id(i),
@@ -108,11 +111,11 @@ namespace
             if (! done_heading)
             {
                 done_heading = true;
-                cout << fuc(fs_package(), fv<'s'>(stringify(*id)));
+                output.append(fuc(fs_package(), fv<'s'>(stringify(*id))));
             }
 
             exit_status |= 1;
-            cout << fuc(fs_error(), fv<'t'>(text), fv<'p'>(stringify(path)));
+            output.append(fuc(fs_error(), fv<'t'>(text), fv<'p'>(stringify(path))));
         }
 
         bool check_mtime(const ContentsEntry & e, const FSPath & p, const FSStat & f)
@@ -232,17 +235,28 @@ VerifyCommand::run(
     if (entries->empty())
         nothing_matching_error(env.get(), *cmdline.begin_parameters(), filter::InstalledAtRoot(env->preferred_root_key()->parse_value()));
 
+    /* verify everything in parallel, but display the results in order */
     int exit_status(0);
-    for (PackageIDSequence::ConstIterator i(entries->begin()), i_end(entries->end()) ;
-            i != i_end ; ++i)
     {
-        auto contents((*i)->contents());
-        if (! contents)
-            continue;
+        TaskScheduler scheduler;
+        std::list<std::pair<std::shared_ptr<Task>, std::shared_ptr<Verifier> > > verifiers;
+        for (PackageIDSequence::ConstIterator i(entries->begin()), i_end(entries->end()) ;
+                i != i_end ; ++i)
+        {
+            auto v(std::make_shared<Verifier>(*i));
+            verifiers.push_back(std::make_pair(scheduler.spawn([v] () {
+                            auto contents(v->id->contents());
+                            if (contents)
+                                std::for_each(indirect_iterator(contents->begin()), indirect_iterator(contents->end()), accept_visitor(*v));
+                            }), v));
+        }
 
-        Verifier v(*i);
-        std::for_each(indirect_iterator(contents->begin()), indirect_iterator(contents->end()), accept_visitor(v));
-        exit_status |= v.exit_status;
+        for (auto & v : verifiers)
+        {
+            v.first->wait();
+            cout << v.second->output;
+            exit_status |= v.second->exit_status;
+        }
     }
 
     return exit_status;
@@ -23,13 +23,38 @@
 
 using namespace paludis;
 
-extern "C" bool
-cave_match_extras_match_regex(const std::string & text, const std::string & pattern_str, bool case_sensitive)
+struct CaveMatchExtrasRegex
 {
-    const pcrecpp::RE pattern(pattern_str, pcrecpp::RE_Options().set_caseless(!case_sensitive));
-    if (! pattern.error().empty())
-        throw args::DoHelp("Pattern '" + pattern_str + "' error: " + pattern.error());
+    pcrecpp::RE pattern;
+
+    CaveMatchExtrasRegex(const std::string & pattern_str, bool case_sensitive) :
+        pattern(pattern_str, pcrecpp::RE_Options().set_caseless(!case_sensitive))
+    {
+    }
+};
+
+extern "C" CaveMatchExtrasRegex *
+cave_match_extras_compile_regex(const std::string & pattern_str, bool case_sensitive)
+{
+    auto result(new CaveMatchExtrasRegex(pattern_str, case_sensitive));
+    if (! result->pattern.error().empty())
+    {
+        std::string error(result->pattern.error());
+        delete result;
+        throw args::DoHelp("Pattern '" + pattern_str + "' error: " + error);
+    }
+
+    return result;
+}
 
-    return pattern.PartialMatch(text);
+extern "C" bool
+cave_match_extras_match_regex(const CaveMatchExtrasRegex * const regex, const std::string & text)
+{
+    return regex->pattern.PartialMatch(text);
 }
 
+extern "C" void
+cave_match_extras_cleanup_regex(CaveMatchExtrasRegex * const regex)
+{
+    delete regex;
+}
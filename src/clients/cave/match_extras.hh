@@ -23,6 +23,12 @@
 #include <paludis/util/attributes.hh>
 #include <string>
 
-extern "C" bool cave_match_extras_match_regex(const std::string &, const std::string &, bool) PALUDIS_VISIBLE PALUDIS_ATTRIBUTE((warn_unused_result));
+struct CaveMatchExtrasRegex;
+
+extern "C" CaveMatchExtrasRegex * cave_match_extras_compile_regex(const std::string &, bool) PALUDIS_VISIBLE PALUDIS_ATTRIBUTE((warn_unused_result));
+
+extern "C" bool cave_match_extras_match_regex(const CaveMatchExtrasRegex * const, const std::string &) PALUDIS_VISIBLE PALUDIS_ATTRIBUTE((warn_unused_result));
+
+extern "C" void cave_match_extras_cleanup_regex(CaveMatchExtrasRegex * const) PALUDIS_VISIBLE;
 
 #endif
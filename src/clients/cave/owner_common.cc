@@ -34,8 +34,10 @@
 #include <paludis/util/wrapped_forward_iterator.hh>
 #include <paludis/util/fs_stat.hh>
 #include <paludis/util/stringify.hh>
+#include <paludis/util/set.hh>
 #include <algorithm>
 #include <functional>
+#include <set>
 
 using namespace paludis;
 
@@ -55,6 +57,11 @@ namespace
     {
         return std::string::npos != stringify(e->location_key()->parse_value()).find(q);
     }
+
+    bool handle_prefix(const std::string & q, const std::shared_ptr<const ContentsEntry> & e)
+    {
+        return 0 == stringify(e->location_key()->parse_value()).compare(0, q.length(), q);
+    }
 }
 
 int
@@ -84,27 +91,69 @@ paludis::cave::owner_common(
     if (query.length() >= 2 && '/' == query.at(query.length() - 1))
         query.erase(query.length() - 1);
 
+    OwnerQueryType query_type;
     if ("full" == type)
-        handler = handle_full;
+        query_type = oqt_full;
     else if ("basename" == type)
-        handler = handle_basename;
+        query_type = oqt_basename;
     else if ("partial" == type)
-        handler = handle_partial;
+        query_type = oqt_partial;
+    else if ("prefix" == type)
+        query_type = oqt_prefix;
     else
     {
         if (! query.empty() && '/' == query.at(0))
-            handler = handle_full;
+            query_type = oqt_full;
         else if (std::string::npos != query.find("/"))
-            handler = handle_partial;
+            query_type = oqt_partial;
         else
-            handler = handle_basename;
+            query_type = oqt_basename;
+    }
+
+    switch (query_type)
+    {
+        case oqt_full:     handler = handle_full;     break;
+        case oqt_basename: handler = handle_basename; break;
+        case oqt_partial:  handler = handle_partial;  break;
+        case oqt_prefix:   handler = handle_prefix;   break;
+        case last_oqt:     break;
+    }
+
+    const FSPath root(env->preferred_root_key()->parse_value());
+
+    /* repositories that keep an owners index can answer for themselves,
+     * without us having to look through every ID's contents */
+    std::set<RepositoryName> indexed_repositories;
+    PackageIDSet indexed_owners;
+    for (auto r(env->begin_repositories()), r_end(env->end_repositories()) ;
+            r != r_end ; ++r)
+    {
+        if ((! (*r)->installed_root_key()) || ! (root == (*r)->installed_root_key()->parse_value()))
+            continue;
+
+        auto owners((*r)->ids_owning_path(query, query_type));
+        if (! owners)
+            continue;
+
+        indexed_repositories.insert((*r)->name());
+        std::copy(owners->begin(), owners->end(), indexed_owners.inserter());
     }
 
     std::shared_ptr<const PackageIDSequence> ids((*env)[selection::AllVersionsSorted(generator::All() |
-                filter::InstalledAtRoot(env->preferred_root_key()->parse_value()) | matching )]);
+                filter::InstalledAtRoot(root) | matching )]);
 
     for (PackageIDSequence::ConstIterator p(ids->begin()), p_end(ids->end()); p != p_end; ++p)
     {
+        if (indexed_repositories.end() != indexed_repositories.find((*p)->repository_name()))
+        {
+            if (indexed_owners.end() != indexed_owners.find(*p))
+            {
+                callback(*p);
+                found = true;
+            }
+            continue;
+        }
+
         std::shared_ptr<const Contents> contents((*p)->contents());
         if (! contents)
             continue;
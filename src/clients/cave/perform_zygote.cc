@@ -0,0 +1,657 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "perform_zygote.hh"
+#include <paludis/util/pimp-impl.hh>
+#include <paludis/util/sequence.hh>
+#include <paludis/util/wrapped_forward_iterator.hh>
+#include <paludis/util/wrapped_output_iterator.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/fs_iterator.hh>
+#include <paludis/util/fs_path.hh>
+#include <paludis/util/fs_error.hh>
+#include <paludis/environment.hh>
+#include <paludis/repository.hh>
+#include <paludis/package_id.hh>
+#include <paludis/name.hh>
+#include <paludis/notifier_callback.hh>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <set>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+using namespace paludis;
+using namespace cave;
+
+namespace
+{
+    /* stdin, stdout, stderr, then the IPC read and write descriptors */
+    const unsigned max_passed_fds(5);
+
+    /* what getdents64 gives us, which not every libc declares */
+    struct LinuxDirent64
+    {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[1];
+    };
+
+    bool only_thread()
+    {
+        try
+        {
+            return 1 == std::distance(FSIterator(FSPath("/proc/self/task"), { }), FSIterator());
+        }
+        catch (const FSError &)
+        {
+            return false;
+        }
+    }
+
+    /* Everything from here to the end of Relay is used by a relay, which is
+     * a fork of a process that may have other threads. Another thread may
+     * have been holding the heap or stdio locks when we were forked, so
+     * these must stick to system calls. */
+
+    void complain(const char * const message)
+    {
+        for (std::size_t done(0), length(std::strlen(message)) ; done < length ; )
+        {
+            ssize_t n(::write(STDERR_FILENO, message + done, length - done));
+            if (-1 == n && EINTR == errno)
+                continue;
+            if (n <= 0)
+                return;
+            done += n;
+        }
+    }
+
+    bool write_all(const int fd, const char * const data, const std::size_t length)
+    {
+        for (std::size_t done(0) ; done < length ; )
+        {
+            ssize_t n(::send(fd, data + done, length - done, MSG_NOSIGNAL));
+            if (-1 == n && EINTR == errno)
+                continue;
+            if (n <= 0)
+                return false;
+            done += n;
+        }
+
+        return true;
+    }
+
+    bool read_all(const int fd, char * const data, const std::size_t length)
+    {
+        for (std::size_t done(0) ; done < length ; )
+        {
+            ssize_t n(::read(fd, data + done, length - done));
+            if (-1 == n && EINTR == errno)
+                continue;
+            if (n <= 0)
+                return false;
+            done += n;
+        }
+
+        return true;
+    }
+
+    /* buffers what we write without using the heap */
+    class RawWriter
+    {
+        private:
+            const int _fd;
+            char _buffer[4096];
+            std::size_t _used;
+            bool _ok;
+
+        public:
+            explicit RawWriter(const int fd) :
+                _fd(fd),
+                _used(0),
+                _ok(true)
+            {
+            }
+
+            void write(const char * data, std::size_t length)
+            {
+                while (_ok && length > 0)
+                {
+                    if (sizeof(_buffer) == _used)
+                        flush();
+
+                    std::size_t n(std::min(length, sizeof(_buffer) - _used));
+                    std::memcpy(_buffer + _used, data, n);
+                    _used += n;
+                    data += n;
+                    length -= n;
+                }
+            }
+
+            void write_length(const std::size_t length)
+            {
+                uint32_t l(length);
+                write(reinterpret_cast<const char *>(&l), sizeof(l));
+            }
+
+            bool flush()
+            {
+                if (_ok && 0 != _used)
+                    _ok = write_all(_fd, _buffer, _used);
+                _used = 0;
+                return _ok;
+            }
+    };
+
+    /* returns -1 unless the whole string is a number */
+    int parse_fd(const char * s)
+    {
+        if (! *s)
+            return -1;
+
+        int result(0);
+        for ( ; *s ; ++s)
+        {
+            if (*s < '0' || *s > '9')
+                return -1;
+            result = result * 10 + (*s - '0');
+        }
+
+        return result;
+    }
+
+    int fd_from_environ(const std::string & prefix)
+    {
+        if (prefix.empty())
+            return -1;
+
+        for (char ** e(environ) ; *e ; ++e)
+            if (0 == std::strncmp(*e, prefix.c_str(), prefix.length()))
+                return parse_fd(*e + prefix.length());
+
+        return -1;
+    }
+
+    void close_fds_except(const int * const keep, const unsigned n_keep, const int max_fd)
+    {
+        int dir(::open("/proc/self/fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+        if (-1 == dir)
+        {
+            for (int fd(0) ; fd < max_fd ; ++fd)
+                if (keep + n_keep == std::find(keep, keep + n_keep, fd))
+                    ::close(fd);
+            return;
+        }
+
+        /* closing what we have already read doesn't upset the kernel's
+         * position in the listing */
+        alignas(LinuxDirent64) char buffer[4096];
+        while (true)
+        {
+            long n(::syscall(SYS_getdents64, dir, buffer, sizeof(buffer)));
+            if (n <= 0)
+                break;
+
+            for (long p(0) ; p < n ; )
+            {
+                const LinuxDirent64 * const d(reinterpret_cast<const LinuxDirent64 *>(buffer + p));
+                p += d->d_reclen;
+
+                int fd(parse_fd(d->d_name));
+                if (-1 != fd && dir != fd && keep + n_keep == std::find(keep, keep + n_keep, fd))
+                    ::close(fd);
+            }
+        }
+
+        ::close(dir);
+    }
+
+    union FdsControl
+    {
+        struct cmsghdr header;
+        char space[CMSG_SPACE(sizeof(int) * max_passed_fds)];
+    };
+
+    bool send_fds(const int fd, const int * const fds, const unsigned count)
+    {
+        char byte(0);
+        struct iovec iov;
+        iov.iov_base = &byte;
+        iov.iov_len = 1;
+
+        FdsControl control;
+        std::memset(&control, 0, sizeof(control));
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.space;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+
+        struct cmsghdr * cmsg(CMSG_FIRSTHDR(&msg));
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * count);
+        std::memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * count);
+
+        while (true)
+        {
+            ssize_t n(::sendmsg(fd, &msg, MSG_NOSIGNAL));
+            if (-1 == n && EINTR == errno)
+                continue;
+            return 1 == n;
+        }
+    }
+
+    /* We are the child of a Process, and so a fork of a process that may have
+     * other threads. Anything we inherited from those threads, including their
+     * pipes, must not be kept open until our job finishes, and any output they
+     * had buffered is theirs to write, not ours. */
+    class Relay
+    {
+        private:
+            const int _control_fd;
+            const int _max_fd;
+            const std::string _read_fd_prefix;
+            const std::string _write_fd_prefix;
+            const std::string _request;
+
+        public:
+            Relay(const int c, const std::string & pipe_command_env_var, const std::string & r) :
+                _control_fd(c),
+                _max_fd(std::max(::sysconf(_SC_OPEN_MAX), 1024L)),
+                _read_fd_prefix(pipe_command_env_var.empty() ? "" : pipe_command_env_var + "_READ_FD="),
+                _write_fd_prefix(pipe_command_env_var.empty() ? "" : pipe_command_env_var + "_WRITE_FD="),
+                _request(r)
+            {
+            }
+
+            int operator() () const
+            {
+                int fds[max_passed_fds] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO, -1, -1 };
+                unsigned n_fds(3);
+
+                fds[3] = fd_from_environ(_read_fd_prefix);
+                fds[4] = fd_from_environ(_write_fd_prefix);
+                if (-1 != fds[3] && -1 != fds[4])
+                    n_fds = max_passed_fds;
+
+                int keep[max_passed_fds + 1];
+                std::copy(fds, fds + n_fds, keep);
+                keep[n_fds] = _control_fd;
+                close_fds_except(keep, n_fds + 1, _max_fd);
+
+                int sockets[2];
+                if (-1 == ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets))
+                {
+                    complain("socketpair() failed\n");
+                    return EXIT_FAILURE;
+                }
+
+                bool sent(send_fds(_control_fd, &sockets[1], 1));
+                ::close(sockets[1]);
+                ::close(_control_fd);
+                if (! sent)
+                {
+                    complain("Couldn't pass a job to the perform zygote\n");
+                    return EXIT_FAILURE;
+                }
+
+                if (! send_fds(sockets[0], fds, n_fds))
+                {
+                    complain("Couldn't pass a job to the perform zygote\n");
+                    return EXIT_FAILURE;
+                }
+
+                RawWriter writer(sockets[0]);
+                std::size_t n_env(0);
+                for (char ** e(environ) ; *e ; ++e)
+                    ++n_env;
+                writer.write_length(n_env);
+                for (char ** e(environ) ; *e ; ++e)
+                {
+                    std::size_t length(std::strlen(*e));
+                    writer.write_length(length);
+                    writer.write(*e, length);
+                }
+                writer.write(_request.data(), _request.length());
+
+                if (! writer.flush())
+                {
+                    complain("Couldn't pass a job to the perform zygote\n");
+                    return EXIT_FAILURE;
+                }
+
+                int32_t exit_status;
+                if (! read_all(sockets[0], reinterpret_cast<char *>(&exit_status), sizeof(exit_status)))
+                    return EXIT_FAILURE;
+
+                return exit_status;
+            }
+    };
+
+    /* from here on, we are the zygote or one of its children, and so the
+     * only thread we have */
+
+    void append_length(std::string & data, const std::size_t length)
+    {
+        uint32_t l(length);
+        data.append(reinterpret_cast<const char *>(&l), sizeof(l));
+    }
+
+    void append_strings(std::string & data, const std::vector<std::string> & strings)
+    {
+        append_length(data, strings.size());
+        for (auto s(strings.begin()), s_end(strings.end()) ; s != s_end ; ++s)
+        {
+            append_length(data, s->length());
+            data.append(*s);
+        }
+    }
+
+    bool read_length(const int fd, std::size_t & length)
+    {
+        uint32_t l;
+        if (! read_all(fd, reinterpret_cast<char *>(&l), sizeof(l)))
+            return false;
+        length = l;
+        return true;
+    }
+
+    bool read_strings(const int fd, std::vector<std::string> & strings)
+    {
+        std::size_t count;
+        if (! read_length(fd, count))
+            return false;
+
+        for ( ; count > 0 ; --count)
+        {
+            std::size_t length;
+            if (! read_length(fd, length))
+                return false;
+
+            std::string s(length, '\0');
+            if (length > 0 && ! read_all(fd, &s[0], length))
+                return false;
+            strings.push_back(s);
+        }
+
+        return true;
+    }
+
+    /* returns false on end of file or error */
+    bool receive_fds(const int fd, std::vector<int> & fds, const int flags)
+    {
+        char byte;
+        struct iovec iov;
+        iov.iov_base = &byte;
+        iov.iov_len = 1;
+
+        FdsControl control;
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.space;
+        msg.msg_controllen = sizeof(control.space);
+
+        ssize_t n;
+        do
+        {
+            n = ::recvmsg(fd, &msg, flags);
+        } while (-1 == n && EINTR == errno);
+
+        if (n <= 0)
+            return false;
+
+        for (struct cmsghdr * cmsg(CMSG_FIRSTHDR(&msg)) ; cmsg ; cmsg = CMSG_NXTHDR(&msg, cmsg))
+            if (SOL_SOCKET == cmsg->cmsg_level && SCM_RIGHTS == cmsg->cmsg_type)
+            {
+                std::size_t count((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+                std::vector<int> received(count);
+                std::memcpy(&received[0], CMSG_DATA(cmsg), sizeof(int) * count);
+                std::copy(received.begin(), received.end(), std::back_inserter(fds));
+            }
+
+        return true;
+    }
+
+    int run_job(
+            const std::shared_ptr<Environment> & env,
+            const PerformZygoteIDs & ids,
+            const PerformZygoteFunction & function,
+            const int request_fd)
+    {
+        std::vector<int> fds;
+        std::vector<std::string> env_vars, args, invalidated, pipe_command_env_var, id_key;
+        if ((! receive_fds(request_fd, fds, 0)) || (fds.size() != 3 && fds.size() != max_passed_fds)
+                || (! read_strings(request_fd, env_vars)) || (! read_strings(request_fd, args))
+                || (! read_strings(request_fd, invalidated)) || (! read_strings(request_fd, pipe_command_env_var))
+                || (! read_strings(request_fd, id_key))
+                || 1 != pipe_command_env_var.size() || 1 != id_key.size())
+            return EXIT_FAILURE;
+
+        for (int fd(0) ; fd < 3 ; ++fd)
+        {
+            if (-1 == ::dup2(fds[fd], fd))
+                return EXIT_FAILURE;
+            ::close(fds[fd]);
+        }
+
+        ::clearenv();
+        for (auto v(env_vars.begin()), v_end(env_vars.end()) ; v != v_end ; ++v)
+        {
+            std::string::size_type p(v->find('='));
+            if (std::string::npos != p)
+                ::setenv(v->substr(0, p).c_str(), v->substr(p + 1).c_str(), 1);
+        }
+
+        /* our copies of the IPC pipe have different numbers to the relay's */
+        if (max_passed_fds == fds.size())
+        {
+            ::setenv((pipe_command_env_var.front() + "_READ_FD").c_str(), stringify(fds[3]).c_str(), 1);
+            ::setenv((pipe_command_env_var.front() + "_WRITE_FD").c_str(), stringify(fds[4]).c_str(), 1);
+        }
+
+        int result(EXIT_FAILURE);
+        try
+        {
+            for (auto r(invalidated.begin()), r_end(invalidated.end()) ; r != r_end ; ++r)
+                if (env->has_repository_named(RepositoryName(*r)))
+                {
+                    env->fetch_repository(RepositoryName(*r))->invalidate();
+                    env->trigger_notifier_callback(NotifierCallbackRepositoryInvalidatedEvent(RepositoryName(*r)));
+                }
+
+            /* anything from a repository that has changed since we were
+             * forked has to be found again */
+            std::shared_ptr<const PackageID> id;
+            auto i(ids.find(id_key.front()));
+            if (ids.end() != i && invalidated.end() == std::find(invalidated.begin(), invalidated.end(),
+                        stringify(i->second->repository_name())))
+                id = i->second;
+
+            auto args_sequence(std::make_shared<Sequence<std::string> >());
+            std::copy(args.begin(), args.end(), args_sequence->back_inserter());
+            result = function(args_sequence, id);
+        }
+        catch (const Exception & e)
+        {
+            std::cerr << "Error: " << e.message() << " (" << e.what() << ")" << std::endl;
+        }
+
+        std::cout.flush();
+        std::cerr.flush();
+
+        int32_t exit_status(result);
+        write_all(request_fd, reinterpret_cast<const char *>(&exit_status), sizeof(exit_status));
+        return result;
+    }
+
+    void run_zygote(
+            const std::shared_ptr<Environment> & env,
+            const PerformZygoteIDs & ids,
+            const PerformZygoteFunction & function,
+            const int control_fd)
+    {
+        while (true)
+        {
+            while (0 < ::waitpid(-1, nullptr, WNOHANG))
+                ;
+
+            std::vector<int> fds;
+            if (! receive_fds(control_fd, fds, MSG_CMSG_CLOEXEC))
+                break;
+
+            if (1 != fds.size())
+            {
+                std::for_each(fds.begin(), fds.end(), ::close);
+                continue;
+            }
+
+            pid_t child(::fork());
+            if (0 == child)
+            {
+                ::close(control_fd);
+                _exit(run_job(env, ids, function, fds[0]));
+            }
+
+            ::close(fds[0]);
+        }
+    }
+}
+
+namespace paludis
+{
+    template <>
+    struct Imp<PerformZygote>
+    {
+        const pid_t pid;
+        const int control_fd;
+
+        mutable std::mutex mutex;
+        std::set<std::string> invalidated;
+
+        Imp(const pid_t p, const int c) :
+            pid(p),
+            control_fd(c)
+        {
+        }
+    };
+}
+
+PerformZygote::PerformZygote(const pid_t p, const int c) :
+    _imp(p, c)
+{
+}
+
+PerformZygote::~PerformZygote()
+{
+    /* the zygote exits when it sees end of file, but leaves any children
+     * it has running alone */
+    ::close(_imp->control_fd);
+    ::waitpid(_imp->pid, nullptr, 0);
+}
+
+std::shared_ptr<PerformZygote>
+PerformZygote::make_if_single_threaded(
+        const std::shared_ptr<Environment> & env,
+        const PerformZygoteIDs & ids,
+        const PerformZygoteFunction & function)
+{
+    /* metadata generation workers leave threads running whilst they wait for
+     * more work */
+    for (Environment::RepositoryConstIterator r(env->begin_repositories()), r_end(env->end_repositories()) ;
+            r != r_end ; ++r)
+        (*r)->stop_idle_workers();
+
+    if (! only_thread())
+        return nullptr;
+
+    int sockets[2];
+    if (-1 == ::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets))
+        return nullptr;
+
+    /* otherwise anything we have buffered gets written out twice */
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(nullptr);
+
+    pid_t child(::fork());
+    if (-1 == child)
+    {
+        ::close(sockets[0]);
+        ::close(sockets[1]);
+        return nullptr;
+    }
+    else if (0 == child)
+    {
+        ::close(sockets[0]);
+        run_zygote(env, ids, function, sockets[1]);
+        _exit(0);
+    }
+
+    ::close(sockets[1]);
+    return std::shared_ptr<PerformZygote>(new PerformZygote(child, sockets[0]));
+}
+
+void
+PerformZygote::repository_invalidated(const RepositoryName & name)
+{
+    std::unique_lock<std::mutex> lock(_imp->mutex);
+    _imp->invalidated.insert(stringify(name));
+}
+
+std::function<int ()>
+PerformZygote::make_relay(
+        const std::shared_ptr<const Sequence<std::string> > & args,
+        const std::string & id_key,
+        const std::string & pipe_command_env_var) const
+{
+    std::string request;
+    append_strings(request, std::vector<std::string>(args->begin(), args->end()));
+    {
+        std::unique_lock<std::mutex> lock(_imp->mutex);
+        append_strings(request, std::vector<std::string>(_imp->invalidated.begin(), _imp->invalidated.end()));
+    }
+    append_strings(request, std::vector<std::string>{ pipe_command_env_var });
+    append_strings(request, std::vector<std::string>{ id_key });
+
+    return Relay(_imp->control_fd, pipe_command_env_var, request);
+}
+
+namespace paludis
+{
+    template class Pimp<PerformZygote>;
+}
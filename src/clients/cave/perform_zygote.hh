@@ -0,0 +1,115 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef PALUDIS_GUARD_SRC_CLIENTS_CAVE_PERFORM_ZYGOTE_HH
+#define PALUDIS_GUARD_SRC_CLIENTS_CAVE_PERFORM_ZYGOTE_HH 1
+
+#include <paludis/util/pimp.hh>
+#include <paludis/util/sequence-fwd.hh>
+#include <paludis/environment-fwd.hh>
+#include <paludis/package_id-fwd.hh>
+#include <paludis/name-fwd.hh>
+#include <functional>
+#include <sys/types.h>
+#include <memory>
+#include <string>
+#include <map>
+
+namespace paludis
+{
+    namespace cave
+    {
+        typedef std::function<int (
+                const std::shared_ptr<const Sequence<std::string> > &,
+                const std::shared_ptr<const PackageID> &)> PerformZygoteFunction;
+
+        /**
+         * IDs that we have already found, keyed by the spec used to find them.
+         */
+        typedef std::map<std::string, std::shared_ptr<const PackageID> > PerformZygoteIDs;
+
+        /**
+         * A copy of ourself, forked with the environment already loaded,
+         * which forks again for every perform job.
+         *
+         * Forking a multithreaded process and then carrying on without
+         * exec()ing is not safe: the child gets copies of locks that other
+         * threads may be holding, and of every pipe they have open. A zygote
+         * is only made whilst we are still single threaded, and so its
+         * children start from a clean state.
+         *
+         * Jobs are started by a Process whose child hands its standard
+         * descriptors, IPC pipe and environment over to the zygote, and
+         * then waits for the zygote's child to report an exit status. That
+         * child is itself a fork of a multithreaded process, so everything
+         * it sends is worked out beforehand, and it only makes system calls.
+         */
+        class PerformZygote
+        {
+            private:
+                Pimp<PerformZygote> _imp;
+
+                PerformZygote(const pid_t, const int);
+
+            public:
+                ~PerformZygote();
+
+                PerformZygote(const PerformZygote &) = delete;
+                PerformZygote & operator= (const PerformZygote &) = delete;
+
+                /**
+                 * Make a zygote, or return a null pointer if we still have
+                 * other threads running after asking every repository to stop
+                 * its idle workers, in which case the caller must exec
+                 * something instead.
+                 *
+                 * A job is given its ID from the supplied IDs, unless its
+                 * repository has been invalidated since, in which case our
+                 * function gets a null pointer and must find it again.
+                 */
+                static std::shared_ptr<PerformZygote> make_if_single_threaded(
+                        const std::shared_ptr<Environment> &,
+                        const PerformZygoteIDs &,
+                        const PerformZygoteFunction &);
+
+                /**
+                 * Tell future children to invalidate a repository that we
+                 * have invalidated.
+                 */
+                void repository_invalidated(const RepositoryName &);
+
+                /**
+                 * Make the function for a Process to call in its child, which
+                 * runs our function with the specified arguments, and the ID
+                 * we have for the specified key if any, in a child of the
+                 * zygote.
+                 *
+                 * The IPC pipe is passed on too, if there is a pipe command
+                 * handler using the specified environment variable prefix.
+                 */
+                std::function<int ()> make_relay(
+                        const std::shared_ptr<const Sequence<std::string> > & args,
+                        const std::string & id_key,
+                        const std::string & pipe_command_env_var) const;
+        };
+    }
+}
+
+#endif
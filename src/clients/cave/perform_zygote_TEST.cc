@@ -0,0 +1,267 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2014 Ciaran McCreesh
+ *
+ * This file is part of the Paludis package manager. Paludis is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * Paludis is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "perform_zygote.hh"
+
+#include <paludis/environments/test/test_environment.hh>
+
+#include <paludis/repositories/fake/fake_repository.hh>
+#include <paludis/repositories/fake/fake_package_id.hh>
+
+#include <paludis/notifier_callback.hh>
+#include <paludis/package_id.hh>
+#include <paludis/name.hh>
+
+#include <paludis/util/process.hh>
+#include <paludis/util/sequence.hh>
+#include <paludis/util/join.hh>
+#include <paludis/util/stringify.hh>
+#include <paludis/util/system.hh>
+#include <paludis/util/make_named_values.hh>
+
+#include <gtest/gtest.h>
+
+#include <future>
+#include <sstream>
+#include <thread>
+#include <iostream>
+#include <unistd.h>
+#include <poll.h>
+
+using namespace paludis;
+using namespace paludis::cave;
+
+namespace
+{
+    /* set in the zygote's children, by the notifier callback */
+    std::string invalidated_in_job;
+
+    struct InvalidationRecorder
+    {
+        void operator() (const NotifierCallbackEvent & event) const
+        {
+            event.accept(*this);
+        }
+
+        void visit(const NotifierCallbackRepositoryInvalidatedEvent & e) const
+        {
+            invalidated_in_job.append(stringify(e.repository()));
+        }
+
+        void visit(const NotifierCallbackGeneratingMetadataEvent &) const
+        {
+        }
+
+        void visit(const NotifierCallbackResolverStepEvent &) const
+        {
+        }
+
+        void visit(const NotifierCallbackResolverStageEvent &) const
+        {
+        }
+
+        void visit(const NotifierCallbackLinkageStepEvent &) const
+        {
+        }
+    };
+
+    int job(const std::shared_ptr<const Sequence<std::string> > & args, const std::shared_ptr<const PackageID> & id)
+    {
+        const std::string what(*args->begin());
+
+        if ("echo" == what)
+        {
+            std::cout << join(std::next(args->begin()), args->end(), " ")
+                << " id=" << (id ? stringify(*id) : "none")
+                << " var=" << getenv_with_default("PERFORM_ZYGOTE_TEST_VAR", "")
+                << " invalidated=" << invalidated_in_job << std::endl;
+            return 3;
+        }
+        else if ("ipc" == what)
+        {
+            int write_fd(std::stoi(getenv_with_default("PALUDIS_IPC_WRITE_FD", "-1")));
+            int read_fd(std::stoi(getenv_with_default("PALUDIS_IPC_READ_FD", "-1")));
+            if (8 != ::write(write_fd, "MONKEYS", 8))
+                return 1;
+
+            std::string response;
+            char c;
+            while (1 == ::read(read_fd, &c, 1) && '\0' != c)
+                response.append(1, c);
+            std::cout << response << std::endl;
+            return 0;
+        }
+        else if ("wait" == what)
+        {
+            char c;
+            return (1 == ::read(STDIN_FILENO, &c, 1) && 'x' == c) ? 0 : 1;
+        }
+
+        return 1;
+    }
+
+    std::string ipc_handler(const std::string & s)
+    {
+        return "got " + s;
+    }
+
+    struct PerformZygoteTest :
+        testing::Test
+    {
+        std::shared_ptr<TestEnvironment> env;
+        std::shared_ptr<FakeRepository> repo;
+        std::shared_ptr<const PackageID> id;
+        PerformZygoteIDs ids;
+        std::shared_ptr<ScopedNotifierCallback> recorder_holder;
+
+        PerformZygoteTest() :
+            env(std::make_shared<TestEnvironment>()),
+            repo(std::make_shared<FakeRepository>(make_named_values<FakeRepositoryParams>(
+                            n::environment() = env.get(),
+                            n::name() = RepositoryName("repo"))))
+        {
+            env->add_repository(1, repo);
+            id = repo->add_version("cat", "pkg", "1");
+            ids.insert(std::make_pair("=cat/pkg-1::repo", id));
+            recorder_holder = std::make_shared<ScopedNotifierCallback>(env.get(), NotifierCallbackFunction(InvalidationRecorder()));
+        }
+
+        const std::shared_ptr<const Sequence<std::string> > args(const std::string & a, const std::string & b = "")
+        {
+            auto result(std::make_shared<Sequence<std::string> >());
+            result->push_back(a);
+            if (! b.empty())
+                result->push_back(b);
+            return result;
+        }
+    };
+}
+
+TEST_F(PerformZygoteTest, Runs)
+{
+    auto zygote(PerformZygote::make_if_single_threaded(env, ids, &job));
+    ASSERT_TRUE(bool(zygote));
+
+    std::stringstream stdout_stream;
+    Process process(ProcessCommand(zygote->make_relay(args("echo", "monkey"), "", "")));
+    process.capture_stdout(stdout_stream);
+    process.setenv("PERFORM_ZYGOTE_TEST_VAR", "in space");
+    EXPECT_EQ(3, process.run().wait());
+    EXPECT_EQ("monkey id=none var=in space invalidated=\n", stdout_stream.str());
+}
+
+TEST_F(PerformZygoteTest, Many)
+{
+    auto zygote(PerformZygote::make_if_single_threaded(env, ids, &job));
+    ASSERT_TRUE(bool(zygote));
+
+    for (int i(0) ; i < 10 ; ++i)
+    {
+        std::stringstream stdout_stream;
+        Process process(ProcessCommand(zygote->make_relay(args("echo", stringify(i)), "", "")));
+        process.capture_stdout(stdout_stream);
+        EXPECT_EQ(3, process.run().wait());
+        EXPECT_EQ(stringify(i) + " id=none var= invalidated=\n", stdout_stream.str());
+    }
+}
+
+TEST_F(PerformZygoteTest, IDs)
+{
+    auto zygote(PerformZygote::make_if_single_threaded(env, ids, &job));
+    ASSERT_TRUE(bool(zygote));
+
+    std::stringstream stdout_stream;
+    Process process(ProcessCommand(zygote->make_relay(args("echo", "monkey"), "=cat/pkg-1::repo", "")));
+    process.capture_stdout(stdout_stream);
+    EXPECT_EQ(3, process.run().wait());
+    EXPECT_EQ("monkey id=" + stringify(*id) + " var= invalidated=\n", stdout_stream.str());
+}
+
+TEST_F(PerformZygoteTest, Invalidated)
+{
+    auto zygote(PerformZygote::make_if_single_threaded(env, ids, &job));
+    ASSERT_TRUE(bool(zygote));
+    zygote->repository_invalidated(RepositoryName("repo"));
+
+    std::stringstream stdout_stream;
+    Process process(ProcessCommand(zygote->make_relay(args("echo", "monkey"), "=cat/pkg-1::repo", "")));
+    process.capture_stdout(stdout_stream);
+    EXPECT_EQ(3, process.run().wait());
+    EXPECT_EQ("monkey id=none var= invalidated=repo\n", stdout_stream.str());
+}
+
+TEST_F(PerformZygoteTest, PipeCommand)
+{
+    auto zygote(PerformZygote::make_if_single_threaded(env, ids, &job));
+    ASSERT_TRUE(bool(zygote));
+
+    std::stringstream stdout_stream;
+    Process process(ProcessCommand(zygote->make_relay(args("ipc"), "", "PALUDIS_IPC")));
+    process.capture_stdout(stdout_stream);
+    process.pipe_command_handler("PALUDIS_IPC", &ipc_handler);
+    EXPECT_EQ(0, process.run().wait());
+    EXPECT_EQ("got MONKEYS\n", stdout_stream.str());
+}
+
+TEST_F(PerformZygoteTest, InheritedDescriptors)
+{
+    auto zygote(PerformZygote::make_if_single_threaded(env, ids, &job));
+    ASSERT_TRUE(bool(zygote));
+
+    int stdin_pipe[2], other_pipe[2];
+    ASSERT_EQ(0, ::pipe(stdin_pipe));
+    ASSERT_EQ(0, ::pipe(other_pipe));
+
+    Process process(ProcessCommand(zygote->make_relay(args("wait"), "", "")));
+    process.set_stdin_fd(stdin_pipe[0]);
+    RunningProcessHandle handle(process.run());
+    ::close(stdin_pipe[0]);
+    ::close(other_pipe[1]);
+
+    /* the job is still waiting for its stdin, so if the relay kept its copy
+     * of the other pipe, we would not see end of file */
+    struct pollfd p;
+    p.fd = other_pipe[0];
+    p.events = POLLIN;
+    p.revents = 0;
+    int polled(::poll(&p, 1, 10000));
+    char c;
+    ssize_t got(1 == polled ? ::read(other_pipe[0], &c, 1) : -1);
+    ::close(other_pipe[0]);
+
+    EXPECT_EQ(1, ::write(stdin_pipe[1], "x", 1));
+    ::close(stdin_pipe[1]);
+    EXPECT_EQ(0, handle.wait());
+
+    EXPECT_EQ(1, polled);
+    EXPECT_EQ(0, got);
+}
+
+TEST_F(PerformZygoteTest, NotWithOtherThreads)
+{
+    std::promise<void> finish;
+    std::future<void> finished(finish.get_future());
+    std::thread other([&] () { finished.wait(); });
+
+    EXPECT_FALSE(bool(PerformZygote::make_if_single_threaded(env, ids, &job)));
+
+    finish.set_value();
+    other.join();
+}
+
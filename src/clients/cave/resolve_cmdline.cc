@@ -93,6 +93,9 @@ ResolveCommandLineResolutionOptions::ResolveCommandLineResolutionOptions(args::A
 
             "never"
             ),
+    a_expansion_threads(&g_resolution_options, "expansion-threads", '\0',
+            "The number of threads to use when working out the dependencies of packages which have been "
+            "decided upon. Defaults to 1."),
 
     g_dependent_options(this, "Dependent Options", "Dependent options. A package is dependent if it "
             "requires (or looks like it might require) a package which is being removed. By default, "
@@ -321,6 +324,7 @@ ResolveCommandLineResolutionOptions::ResolveCommandLineResolutionOptions(args::A
     a_dump(&g_dump_options, "dump", '\0', "Dump debug output", true),
     a_dump_restarts(&g_dump_options, "dump-restarts", '\0', "Dump restarts", true)
 {
+    a_expansion_threads.set_argument(1);
 }
 
 ResolveCommandLineDisplayOptions::ResolveCommandLineDisplayOptions(args::ArgsHandler * const h) :
@@ -397,6 +401,14 @@ ResolveCommandLineExecutionOptions::ResolveCommandLineExecutionOptions(args::Arg
     a_fetch_jobs(&g_jobs_options, "fetch-jobs", 'J', "The number of parallel fetch jobs to launch. If set to 0, fetches "
             "will be carried out sequentially with other jobs. Values higher than 1 are currently treated "
             "as being 1. Defaults to 1, or if --fetch is specified, 0."),
+    a_jobs(&g_jobs_options, "jobs", 'j', "The number of install and uninstall jobs to run in parallel. A job is "
+            "only started once every job it requires has finished, and uninstalls are never run alongside "
+            "other install or uninstall jobs. Defaults to 1."),
+    a_jobs_max_load(&g_jobs_options, "jobs-max-load", '\0', "If --jobs is greater than 1, do not start an additional "
+            "job whilst the system load average is at least this value. Defaults to 0, meaning no limit."),
+    a_jobs_min_free_memory(&g_jobs_options, "jobs-min-free-memory", '\0', "If --jobs is greater than 1, do not "
+            "start an additional job whilst less than this many megabytes of memory are available. Defaults to 0, "
+            "meaning no limit."),
 
     g_phase_options(this, "Phase Options", "Options controlling which phases to execute. No sanity checking "
             "is done, allowing you to shoot as many feet off as you desire. Phase names do not have the "
@@ -417,6 +429,9 @@ ResolveCommandLineExecutionOptions::ResolveCommandLineExecutionOptions(args::Arg
             "all")
 {
     a_fetch_jobs.set_argument(-1);
+    a_jobs.set_argument(1);
+    a_jobs_max_load.set_argument(0);
+    a_jobs_min_free_memory.set_argument(0);
 }
 
 ResolveCommandLineProgramOptions::ResolveCommandLineProgramOptions(args::ArgsHandler * const h) :
@@ -52,6 +52,7 @@ namespace paludis
             args::SwitchArg a_no_override_flags;
             args::StringSetArg a_no_restarts_for;
             args::EnumArg a_promote_binaries;
+            args::IntegerArg a_expansion_threads;
 
             args::ArgsGroup g_dependent_options;
             args::StringSetArg a_uninstalls_may_break;
@@ -138,6 +139,9 @@ namespace paludis
             args::ArgsGroup g_jobs_options;
             args::SwitchArg a_fetch;
             args::IntegerArg a_fetch_jobs;
+            args::IntegerArg a_jobs;
+            args::IntegerArg a_jobs_max_load;
+            args::IntegerArg a_jobs_min_free_memory;
 
             args::ArgsGroup g_phase_options;
             args::StringSetArg a_skip_phase;
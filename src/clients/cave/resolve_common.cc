@@ -92,6 +92,7 @@
 #include <paludis/resolver/remove_if_dependent_helper.hh>
 #include <paludis/resolver/prefer_or_avoid_helper.hh>
 #include <paludis/resolver/promote_binaries_helper.hh>
+#include <paludis/resolver/selection_cache.hh>
 
 #include <paludis/user_dep_spec.hh>
 #include <paludis/notifier_callback.hh>
@@ -233,7 +234,7 @@ namespace
     {
         try
         {
-            Serialiser ser(ser_stream);
+            Serialiser ser(ser_stream, sf_binary);
             resolved.serialise(ser);
             ser_stream.nothing_more_to_write();
         }
@@ -402,7 +403,7 @@ namespace
 
     void serialise_job_lists(StringListStream & ser_stream, const JobLists & job_lists)
     {
-        Serialiser ser(ser_stream);
+        Serialiser ser(ser_stream, sf_binary);
         job_lists.serialise(ser);
         ser_stream.nothing_more_to_write();
     }
@@ -766,6 +767,41 @@ namespace
             return true;
         }
     };
+
+    struct SelectionCacheInvalidator
+    {
+        const Environment * const env;
+        const std::shared_ptr<SelectionCache> selection_cache;
+
+        void operator() (const NotifierCallbackEvent & event) const
+        {
+            event.accept(*this);
+        }
+
+        void visit(const NotifierCallbackRepositoryInvalidatedEvent & e) const
+        {
+            if (env->has_repository_named(e.repository()))
+                selection_cache->invalidate(*env->fetch_repository(e.repository()));
+            else
+                selection_cache->invalidate_all();
+        }
+
+        void visit(const NotifierCallbackGeneratingMetadataEvent &) const
+        {
+        }
+
+        void visit(const NotifierCallbackResolverStepEvent &) const
+        {
+        }
+
+        void visit(const NotifierCallbackResolverStageEvent &) const
+        {
+        }
+
+        void visit(const NotifierCallbackLinkageStepEvent &) const
+        {
+        }
+    };
 }
 
 int
@@ -1147,7 +1183,14 @@ paludis::cave::resolve_common(
                 n::remove_if_dependent_fn() = std::cref(remove_if_dependent_helper)
                 ));
 
-    std::shared_ptr<Resolver> resolver(std::make_shared<Resolver>(env.get(), resolver_functions));
+    if (resolution_options.a_expansion_threads.argument() < 1)
+        throw args::DoHelp("Argument to '--" + resolution_options.a_expansion_threads.long_name() + "' must be at least 1");
+
+    const std::shared_ptr<SelectionCache> selection_cache(std::make_shared<SelectionCache>());
+    ScopedNotifierCallback selection_cache_invalidator_holder(env.get(),
+            NotifierCallbackFunction(SelectionCacheInvalidator{env.get(), selection_cache}));
+    std::shared_ptr<Resolver> resolver(std::make_shared<Resolver>(env.get(), resolver_functions, selection_cache));
+    resolver->set_expansion_threads(resolution_options.a_expansion_threads.argument());
     bool is_set(false);
     std::shared_ptr<const Sequence<std::string> > targets_cleaned_up;
     std::list<SuggestRestart> restarts;
@@ -1159,34 +1202,39 @@ paludis::cave::resolve_common(
             ScopedNotifierCallback display_callback_holder(env.get(),
                     NotifierCallbackFunction(std::cref(display_callback)));
 
-            bool first(true);
+            bool first(true), need_targets(true);
             while (true)
             {
                 try
                 {
-                    if (purge)
-                    {
-                        resolver->purge();
-                        targets_cleaned_up = std::make_shared<Sequence<std::string>>();
-                    } else
-                        targets_cleaned_up = add_resolver_targets(env, resolver, resolution_options, targets_if_not_purge, is_set);
-
-                    if (first)
+                    if (need_targets)
                     {
-                        if (targets_cleaned_up)
-                            for (auto t(targets_cleaned_up->begin()), t_end(targets_cleaned_up->end()) ;
-                                    t != t_end ; ++t)
-                                if ('!' != t->at(0) && std::string::npos != t->find('/'))
-                                {
-                                    PackageDepSpec ts(parse_spec_with_nice_error(*t, env.get(), { }, filter::All()));
-                                    if (ts.version_requirements_ptr() && ! ts.version_requirements_ptr()->empty())
+                        if (purge)
+                        {
+                            resolver->purge();
+                            targets_cleaned_up = std::make_shared<Sequence<std::string>>();
+                        } else
+                            targets_cleaned_up = add_resolver_targets(env, resolver, resolution_options, targets_if_not_purge, is_set);
+
+                        if (first)
+                        {
+                            if (targets_cleaned_up)
+                                for (auto t(targets_cleaned_up->begin()), t_end(targets_cleaned_up->end()) ;
+                                        t != t_end ; ++t)
+                                    if ('!' != t->at(0) && std::string::npos != t->find('/'))
                                     {
-                                        confirm_helper.add_permit_downgrade_spec(ts);
-                                        confirm_helper.add_permit_old_version_spec(ts);
+                                        PackageDepSpec ts(parse_spec_with_nice_error(*t, env.get(), { }, filter::All()));
+                                        if (ts.version_requirements_ptr() && ! ts.version_requirements_ptr()->empty())
+                                        {
+                                            confirm_helper.add_permit_downgrade_spec(ts);
+                                            confirm_helper.add_permit_old_version_spec(ts);
+                                        }
                                     }
-                                }
 
-                        first = false;
+                            first = false;
+                        }
+
+                        need_targets = false;
                     }
 
                     resolver->resolve();
@@ -1197,7 +1245,15 @@ paludis::cave::resolve_common(
                     restarts.push_back(e);
                     display_callback(ResolverRestart());
                     get_initial_constraints_for_helper.add_suggested_restart(e);
-                    resolver = std::make_shared<Resolver>(env.get(), resolver_functions);
+
+                    /* only throw everything away if we can't just undo the
+                     * decisions that the restart affects */
+                    if (! resolver->undo_for_restart(e))
+                    {
+                        resolver = std::make_shared<Resolver>(env.get(), resolver_functions, selection_cache);
+                        resolver->set_expansion_threads(resolution_options.a_expansion_threads.argument());
+                        need_targets = true;
+                    }
 
                     if (restarts.size() > 9000)
                         throw InternalError(PALUDIS_HERE, "Restarted over nine thousand times. Something's "
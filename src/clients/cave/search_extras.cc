@@ -28,8 +28,66 @@ struct CaveSearchExtrasDB
 {
     sqlite3 * db;
     sqlite3_stmt * add_candidate;
+    sqlite3_stmt * add_candidate_text;
+    sqlite3_stmt * find_package;
+    sqlite3_stmt * remove_package_text;
+    sqlite3_stmt * remove_package;
 };
 
+namespace
+{
+    bool has_text_index(CaveSearchExtrasDB * const data)
+    {
+        sqlite3_stmt * find_table;
+        if (SQLITE_OK != sqlite3_prepare_v2(data->db, "select 1 from sqlite_master where name = 'candidates_text'",
+                    -1, &find_table, nullptr))
+            throw InternalError(PALUDIS_HERE, "sqlite3_prepare_v2 select from sqlite_master failed");
+
+        int code(sqlite3_step(find_table));
+        sqlite3_finalize(find_table);
+
+        if (code == SQLITE_ROW)
+            return true;
+        else if (code == SQLITE_DONE)
+            return false;
+        else
+            throw InternalError(PALUDIS_HERE, "sqlite3_step select from sqlite_master failed:" + stringify(code));
+    }
+
+    void prepare(CaveSearchExtrasDB * const data, sqlite3_stmt * & stmt, const std::string & sql)
+    {
+        if (SQLITE_OK != sqlite3_prepare_v2(data->db, sql.c_str(), -1, &stmt, nullptr))
+            throw InternalError(PALUDIS_HERE, "sqlite3_prepare_v2 '" + sql + "' failed");
+    }
+
+    void prepare_updates(CaveSearchExtrasDB * const data)
+    {
+        prepare(data, data->add_candidate, "insert into candidates "
+                "( spec, is_visible, is_best, is_best_visible, name, short_desc, long_desc, marker ) "
+                "values ( ?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8 )");
+
+        prepare(data, data->find_package, "select spec, marker from candidates where name = ?1");
+        prepare(data, data->remove_package, "delete from candidates where name = ?1");
+
+        if (has_text_index(data))
+        {
+            prepare(data, data->add_candidate_text, "insert into candidates_text "
+                    "( rowid, name, short_desc, long_desc ) "
+                    "values ( ?1, ?2, ?3, ?4 )");
+            prepare(data, data->remove_package_text, "delete from candidates_text where rowid in "
+                    "( select rowid from candidates where name = ?1 )");
+        }
+    }
+
+    void bind_name(sqlite3_stmt * const stmt, const std::string & name)
+    {
+        if (SQLITE_OK != sqlite3_reset(stmt))
+            throw InternalError(PALUDIS_HERE, "sqlite3_reset failed");
+        if (SQLITE_OK != sqlite3_bind_text(stmt, 1, name.c_str(), name.length(), SQLITE_TRANSIENT))
+            throw InternalError(PALUDIS_HERE, "sqlite3_bind_text failed");
+    }
+}
+
 extern "C"
 CaveSearchExtrasDB *
 cave_search_extras_create_db(const std::string & file)
@@ -39,6 +97,12 @@ cave_search_extras_create_db(const std::string & file)
     if (SQLITE_OK != sqlite3_exec(data->db, "drop table if exists candidates", nullptr, nullptr, nullptr))
         throw InternalError(PALUDIS_HERE, "sqlite3_exec drop candidates failed");
 
+    if (SQLITE_OK != sqlite3_exec(data->db, "drop table if exists candidates_text", nullptr, nullptr, nullptr))
+        throw InternalError(PALUDIS_HERE, "sqlite3_exec drop candidates_text failed");
+
+    if (SQLITE_OK != sqlite3_exec(data->db, "drop table if exists meta", nullptr, nullptr, nullptr))
+        throw InternalError(PALUDIS_HERE, "sqlite3_exec drop meta failed");
+
     if (SQLITE_OK != sqlite3_exec(data->db, "create table candidates ( "
                 "spec text not null primary key, "
                 "is_visible int not null, "
@@ -46,15 +110,51 @@ cave_search_extras_create_db(const std::string & file)
                 "is_best_visible int not_null, "
                 "name text not null, "
                 "short_desc text not null, "
-                "long_desc text not null"
+                "long_desc text not null, "
+                "marker text not null"
                 ")", nullptr, nullptr, nullptr))
         throw InternalError(PALUDIS_HERE, "sqlite3_exec create candidates failed");
 
-    if (SQLITE_OK != sqlite3_prepare_v2(data->db, "insert into candidates "
-                "( spec, is_visible, is_best, is_best_visible, name, short_desc, long_desc ) "
-                "values ( ?1, ?2, ?3, ?4, ?5, ?6, ?7 )",
-                -1, &data->add_candidate, nullptr))
-        throw InternalError(PALUDIS_HERE, "sqlite3_prepare_v2 insert into candidates failed");
+    if (SQLITE_OK != sqlite3_exec(data->db, "create index candidates_name on candidates ( name )", nullptr, nullptr, nullptr))
+        throw InternalError(PALUDIS_HERE, "sqlite3_exec create index candidates_name failed");
+
+    if (SQLITE_OK != sqlite3_exec(data->db, "create table meta ( "
+                "key text not null primary key, "
+                "value text not null"
+                ")", nullptr, nullptr, nullptr))
+        throw InternalError(PALUDIS_HERE, "sqlite3_exec create meta failed");
+
+    /* a trigram index lets us find substrings without scanning every row. It
+     * needs a reasonably recent sqlite, so carry on without it if we can't
+     * have it */
+    sqlite3_exec(data->db, "create virtual table candidates_text using fts5 ( "
+            "name, "
+            "short_desc, "
+            "long_desc, "
+            "tokenize = 'trigram'"
+            ")", nullptr, nullptr, nullptr);
+
+    prepare_updates(data);
+
+    return data;
+}
+
+extern "C"
+CaveSearchExtrasDB *
+cave_search_extras_open_db_for_update(const std::string & file)
+{
+    auto data(cave_search_extras_open_db(file));
+
+    /* indexes from before we had markers have to be recreated */
+    sqlite3_stmt * check_marker;
+    if (SQLITE_OK != sqlite3_prepare_v2(data->db, "select value from meta where key = 'marker'", -1, &check_marker, nullptr))
+    {
+        cave_search_extras_cleanup(data);
+        return nullptr;
+    }
+    sqlite3_finalize(check_marker);
+
+    prepare_updates(data);
 
     return data;
 }
@@ -67,6 +167,10 @@ cave_search_extras_open_db(const std::string & file)
         throw InternalError(PALUDIS_HERE, "sqlite3_open failed");
 
     data->add_candidate = nullptr;
+    data->add_candidate_text = nullptr;
+    data->find_package = nullptr;
+    data->remove_package_text = nullptr;
+    data->remove_package = nullptr;
 
     return data;
 }
@@ -77,6 +181,14 @@ cave_search_extras_cleanup(CaveSearchExtrasDB * const data)
 {
     if (data->add_candidate)
         sqlite3_finalize(data->add_candidate);
+    if (data->add_candidate_text)
+        sqlite3_finalize(data->add_candidate_text);
+    if (data->find_package)
+        sqlite3_finalize(data->find_package);
+    if (data->remove_package_text)
+        sqlite3_finalize(data->remove_package_text);
+    if (data->remove_package)
+        sqlite3_finalize(data->remove_package);
 
     sqlite3_close(data->db);
     delete data;
@@ -92,7 +204,8 @@ cave_search_extras_add_candidate(
         const bool best_visible,
         const std::string & name,
         const std::string & short_desc,
-        const std::string & long_desc)
+        const std::string & long_desc,
+        const std::string & marker)
 {
     if (SQLITE_OK != sqlite3_reset(data->add_candidate))
         throw InternalError(PALUDIS_HERE, "sqlite3_reset add candidate failed");
@@ -113,10 +226,141 @@ cave_search_extras_add_candidate(
         throw InternalError(PALUDIS_HERE, "sqlite3_bind_text add candidate 6 failed");
     if (SQLITE_OK != sqlite3_bind_text(data->add_candidate, 7, long_desc.c_str(), long_desc.length(), SQLITE_TRANSIENT))
         throw InternalError(PALUDIS_HERE, "sqlite3_bind_text add candidate 7 failed");
+    if (SQLITE_OK != sqlite3_bind_text(data->add_candidate, 8, marker.c_str(), marker.length(), SQLITE_TRANSIENT))
+        throw InternalError(PALUDIS_HERE, "sqlite3_bind_text add candidate 8 failed");
 
     int code;
     if (SQLITE_DONE != (code = sqlite3_step(data->add_candidate)))
         throw InternalError(PALUDIS_HERE, "sqlite3_step failed: " + stringify(code));
+
+    if (! data->add_candidate_text)
+        return;
+
+    if (SQLITE_OK != sqlite3_reset(data->add_candidate_text))
+        throw InternalError(PALUDIS_HERE, "sqlite3_reset add candidate text failed");
+    if (SQLITE_OK != sqlite3_clear_bindings(data->add_candidate_text))
+        throw InternalError(PALUDIS_HERE, "sqlite3_clear_bindings add candidate text failed");
+
+    if (SQLITE_OK != sqlite3_bind_int64(data->add_candidate_text, 1, sqlite3_last_insert_rowid(data->db)))
+        throw InternalError(PALUDIS_HERE, "sqlite3_bind_int64 add candidate text 1 failed");
+    if (SQLITE_OK != sqlite3_bind_text(data->add_candidate_text, 2, name.c_str(), name.length(), SQLITE_TRANSIENT))
+        throw InternalError(PALUDIS_HERE, "sqlite3_bind_text add candidate text 2 failed");
+    if (SQLITE_OK != sqlite3_bind_text(data->add_candidate_text, 3, short_desc.c_str(), short_desc.length(), SQLITE_TRANSIENT))
+        throw InternalError(PALUDIS_HERE, "sqlite3_bind_text add candidate text 3 failed");
+    if (SQLITE_OK != sqlite3_bind_text(data->add_candidate_text, 4, long_desc.c_str(), long_desc.length(), SQLITE_TRANSIENT))
+        throw InternalError(PALUDIS_HERE, "sqlite3_bind_text add candidate text 4 failed");
+
+    if (SQLITE_DONE != (code = sqlite3_step(data->add_candidate_text)))
+        throw InternalError(PALUDIS_HERE, "sqlite3_step failed: " + stringify(code));
+}
+
+extern "C"
+void
+cave_search_extras_find_package(
+        CaveSearchExtrasDB * const data,
+        const std::string & name,
+        std::map<std::string, std::string> & markers)
+{
+    bind_name(data->find_package, name);
+
+    while (true)
+    {
+        int code(sqlite3_step(data->find_package));
+
+        if (code == SQLITE_DONE)
+            break;
+        else if (code == SQLITE_ROW)
+            markers.insert(std::make_pair(
+                        std::string(reinterpret_cast<const char *>(sqlite3_column_text(data->find_package, 0))),
+                        std::string(reinterpret_cast<const char *>(sqlite3_column_text(data->find_package, 1)))));
+        else
+            throw InternalError(PALUDIS_HERE, "sqlite3_step find package failed:" + stringify(code));
+    }
+}
+
+extern "C"
+void
+cave_search_extras_find_package_names(
+        CaveSearchExtrasDB * const data,
+        std::set<std::string> & names)
+{
+    sqlite3_stmt * find_names;
+    prepare(data, find_names, "select distinct name from candidates");
+
+    while (true)
+    {
+        int code(sqlite3_step(find_names));
+
+        if (code == SQLITE_DONE)
+            break;
+        else if (code == SQLITE_ROW)
+            names.insert(reinterpret_cast<const char *>(sqlite3_column_text(find_names, 0)));
+        else
+            throw InternalError(PALUDIS_HERE, "sqlite3_step select names from candidates failed:" + stringify(code));
+    }
+
+    sqlite3_finalize(find_names);
+}
+
+extern "C"
+void
+cave_search_extras_remove_package(
+        CaveSearchExtrasDB * const data,
+        const std::string & name)
+{
+    int code;
+    if (data->remove_package_text)
+    {
+        bind_name(data->remove_package_text, name);
+        if (SQLITE_DONE != (code = sqlite3_step(data->remove_package_text)))
+            throw InternalError(PALUDIS_HERE, "sqlite3_step remove package text failed: " + stringify(code));
+    }
+
+    bind_name(data->remove_package, name);
+    if (SQLITE_DONE != (code = sqlite3_step(data->remove_package)))
+        throw InternalError(PALUDIS_HERE, "sqlite3_step remove package failed: " + stringify(code));
+}
+
+extern "C"
+void
+cave_search_extras_get_marker(
+        CaveSearchExtrasDB * const data,
+        std::string & marker)
+{
+    sqlite3_stmt * get_marker;
+    prepare(data, get_marker, "select value from meta where key = 'marker'");
+
+    int code(sqlite3_step(get_marker));
+    if (code == SQLITE_ROW)
+        marker = reinterpret_cast<const char *>(sqlite3_column_text(get_marker, 0));
+    else if (code != SQLITE_DONE)
+    {
+        sqlite3_finalize(get_marker);
+        throw InternalError(PALUDIS_HERE, "sqlite3_step select marker from meta failed:" + stringify(code));
+    }
+
+    sqlite3_finalize(get_marker);
+}
+
+extern "C"
+void
+cave_search_extras_set_marker(
+        CaveSearchExtrasDB * const data,
+        const std::string & marker)
+{
+    sqlite3_stmt * set_marker;
+    prepare(data, set_marker, "insert or replace into meta ( key, value ) values ( 'marker', ?1 )");
+
+    if (SQLITE_OK != sqlite3_bind_text(set_marker, 1, marker.c_str(), marker.length(), SQLITE_TRANSIENT))
+    {
+        sqlite3_finalize(set_marker);
+        throw InternalError(PALUDIS_HERE, "sqlite3_bind_text set marker failed");
+    }
+
+    int code(sqlite3_step(set_marker));
+    sqlite3_finalize(set_marker);
+    if (SQLITE_DONE != code)
+        throw InternalError(PALUDIS_HERE, "sqlite3_step set marker failed: " + stringify(code));
 }
 
 extern "C"
@@ -140,7 +384,8 @@ void
 cave_search_extras_find_candidates(CaveSearchExtrasDB * const data,
         std::list<std::string> & out,
         const bool all_versions, const bool visible,
-        const std::string & name_description_substring_hint)
+        const std::string & substring_hint,
+        const bool hint_names, const bool hint_descriptions)
 {
     sqlite3_stmt * find_candidates;
 
@@ -154,25 +399,59 @@ cave_search_extras_find_candidates(CaveSearchExtrasDB * const data,
     else
         s = "is_best";
 
+    std::list<std::string> columns;
+    if (hint_names)
+        columns.push_back("name");
+    if (hint_descriptions)
+    {
+        columns.push_back("short_desc");
+        columns.push_back("long_desc");
+    }
+
     std::string h, p1;
-    if (! name_description_substring_hint.empty())
+    if ((! substring_hint.empty()) && (! columns.empty()))
     {
-        h = " and ( name like ?1 escape '\\' or short_desc like ?1 escape '\\' or long_desc like ?1 escape '\\' )";
+        /* trigrams can't find anything shorter than three characters */
+        if (substring_hint.length() >= 3 && has_text_index(data))
+        {
+            h = " and rowid in ( select rowid from candidates_text where candidates_text match ?1 )";
 
-        p1 = "%";
-        for (auto i(name_description_substring_hint.begin()), i_end(name_description_substring_hint.end()) ;
-                i != i_end ; ++i)
-            switch (*i)
+            p1 = "{";
+            for (auto c(columns.begin()), c_end(columns.end()) ;
+                    c != c_end ; ++c)
+                p1.append((c == columns.begin() ? "" : " ") + *c);
+            p1.append("} : \"");
+            for (auto i(substring_hint.begin()), i_end(substring_hint.end()) ;
+                    i != i_end ; ++i)
             {
-                case '%':
-                case '_':
-                case '\\':
-                    p1.append(1, '\\');
-                    /* fall through */
-                default:
-                    p1.append(1, *i);
+                if (*i == '"')
+                    p1.append(1, '"');
+                p1.append(1, *i);
             }
-        p1.append("%");
+            p1.append("\"");
+        }
+        else
+        {
+            for (auto c(columns.begin()), c_end(columns.end()) ;
+                    c != c_end ; ++c)
+                h.append((c == columns.begin() ? " and ( " : " or ") + *c + " like ?1 escape '\\'");
+            h.append(" )");
+
+            p1 = "%";
+            for (auto i(substring_hint.begin()), i_end(substring_hint.end()) ;
+                    i != i_end ; ++i)
+                switch (*i)
+                {
+                    case '%':
+                    case '_':
+                    case '\\':
+                        p1.append(1, '\\');
+                        /* fall through */
+                    default:
+                        p1.append(1, *i);
+                }
+            p1.append("%");
+        }
     }
 
     int code;
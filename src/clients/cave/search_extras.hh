@@ -23,6 +23,8 @@
 #include <paludis/util/attributes.hh>
 #include <string>
 #include <list>
+#include <map>
+#include <set>
 
 struct CaveSearchExtrasDB;
 
@@ -30,16 +32,30 @@ extern "C" CaveSearchExtrasDB * cave_search_extras_create_db(const std::string &
 
 extern "C" CaveSearchExtrasDB * cave_search_extras_open_db(const std::string &) PALUDIS_VISIBLE PALUDIS_ATTRIBUTE((warn_unused_result));
 
+extern "C" CaveSearchExtrasDB * cave_search_extras_open_db_for_update(const std::string &) PALUDIS_VISIBLE PALUDIS_ATTRIBUTE((warn_unused_result));
+
 extern "C" void cave_search_extras_cleanup(CaveSearchExtrasDB * const) PALUDIS_VISIBLE;
 
 extern "C" void cave_search_extras_starting_adds(CaveSearchExtrasDB * const) PALUDIS_VISIBLE;
 
 extern "C" void cave_search_extras_add_candidate(CaveSearchExtrasDB * const, const std::string &,
-        const bool, const bool, const bool, const std::string &, const std::string &, const std::string &) PALUDIS_VISIBLE;
+        const bool, const bool, const bool, const std::string &, const std::string &, const std::string &,
+        const std::string &) PALUDIS_VISIBLE;
+
+extern "C" void cave_search_extras_find_package(CaveSearchExtrasDB * const, const std::string &,
+        std::map<std::string, std::string> &) PALUDIS_VISIBLE;
+
+extern "C" void cave_search_extras_find_package_names(CaveSearchExtrasDB * const, std::set<std::string> &) PALUDIS_VISIBLE;
+
+extern "C" void cave_search_extras_remove_package(CaveSearchExtrasDB * const, const std::string &) PALUDIS_VISIBLE;
+
+extern "C" void cave_search_extras_get_marker(CaveSearchExtrasDB * const, std::string &) PALUDIS_VISIBLE;
+
+extern "C" void cave_search_extras_set_marker(CaveSearchExtrasDB * const, const std::string &) PALUDIS_VISIBLE;
 
 extern "C" void cave_search_extras_done_adds(CaveSearchExtrasDB * const) PALUDIS_VISIBLE;
 
 extern "C" void cave_search_extras_find_candidates(CaveSearchExtrasDB * const, std::list<std::string> &,
-        const bool, const bool, const std::string &) PALUDIS_VISIBLE;
+        const bool, const bool, const std::string &, const bool, const bool) PALUDIS_VISIBLE;
 
 #endif
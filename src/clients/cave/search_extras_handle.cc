@@ -41,10 +41,16 @@ SearchExtrasHandle::SearchExtrasHandle() :
     handle(nullptr),
     create_db_function(nullptr),
     open_db_function(nullptr),
+    open_db_for_update_function(nullptr),
     cleanup_db_function(nullptr),
     starting_adds_function(nullptr),
     add_candidate_function(nullptr),
     done_adds_function(nullptr),
+    find_package_function(nullptr),
+    find_package_names_function(nullptr),
+    remove_package_function(nullptr),
+    get_marker_function(nullptr),
+    set_marker_function(nullptr),
     find_candidates_function(nullptr)
 {
 #ifndef ENABLE_SEARCH_INDEX
@@ -62,6 +68,10 @@ SearchExtrasHandle::SearchExtrasHandle() :
     if (! open_db_function)
         throw args::DoHelp("Search index not available because dlsym said " + stringify(::dlerror()));
 
+    open_db_for_update_function = STUPID_CAST(OpenDBFunction, ::dlsym(handle, "cave_search_extras_open_db_for_update"));
+    if (! open_db_for_update_function)
+        throw args::DoHelp("Search index update not available because dlsym said " + stringify(::dlerror()));
+
     cleanup_db_function = STUPID_CAST(CleanupDBFunction, ::dlsym(handle, "cave_search_extras_cleanup"));
     if (! cleanup_db_function)
         throw args::DoHelp("Search index not available because dlsym said " + stringify(::dlerror()));
@@ -78,6 +88,26 @@ SearchExtrasHandle::SearchExtrasHandle() :
     if (! done_adds_function)
         throw args::DoHelp("Search index creation not available because dlsym said " + stringify(::dlerror()));
 
+    find_package_function = STUPID_CAST(FindPackageFunction, ::dlsym(handle, "cave_search_extras_find_package"));
+    if (! find_package_function)
+        throw args::DoHelp("Search index update not available because dlsym said " + stringify(::dlerror()));
+
+    find_package_names_function = STUPID_CAST(FindPackageNamesFunction, ::dlsym(handle, "cave_search_extras_find_package_names"));
+    if (! find_package_names_function)
+        throw args::DoHelp("Search index update not available because dlsym said " + stringify(::dlerror()));
+
+    remove_package_function = STUPID_CAST(RemovePackageFunction, ::dlsym(handle, "cave_search_extras_remove_package"));
+    if (! remove_package_function)
+        throw args::DoHelp("Search index update not available because dlsym said " + stringify(::dlerror()));
+
+    get_marker_function = STUPID_CAST(GetMarkerFunction, ::dlsym(handle, "cave_search_extras_get_marker"));
+    if (! get_marker_function)
+        throw args::DoHelp("Search index update not available because dlsym said " + stringify(::dlerror()));
+
+    set_marker_function = STUPID_CAST(SetMarkerFunction, ::dlsym(handle, "cave_search_extras_set_marker"));
+    if (! set_marker_function)
+        throw args::DoHelp("Search index creation not available because dlsym said " + stringify(::dlerror()));
+
     find_candidates_function = STUPID_CAST(FindCandidatesFunction, ::dlsym(handle, "cave_search_extras_find_candidates"));
     if (! find_candidates_function)
         throw args::DoHelp("Search index not available because dlsym said " + stringify(::dlerror()));
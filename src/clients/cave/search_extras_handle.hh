@@ -22,6 +22,8 @@
 
 #include <paludis/util/singleton.hh>
 #include <list>
+#include <map>
+#include <set>
 #include <string>
 
 struct CaveSearchExtrasDB;
@@ -39,17 +41,25 @@ namespace paludis
             typedef void (* CleanupDBFunction)(CaveSearchExtrasDB * const);
 
             typedef void (* AddCandidateFunction)(CaveSearchExtrasDB * const, const std::string &,
-                    const bool, const bool, const bool, const std::string &, const std::string &, const std::string &);
+                    const bool, const bool, const bool, const std::string &, const std::string &, const std::string &,
+                    const std::string &);
+            typedef void (* FindPackageFunction)(CaveSearchExtrasDB * const, const std::string &,
+                    std::map<std::string, std::string> &);
+            typedef void (* FindPackageNamesFunction)(CaveSearchExtrasDB * const, std::set<std::string> &);
+            typedef void (* RemovePackageFunction)(CaveSearchExtrasDB * const, const std::string &);
+            typedef void (* GetMarkerFunction)(CaveSearchExtrasDB * const, std::string &);
+            typedef void (* SetMarkerFunction)(CaveSearchExtrasDB * const, const std::string &);
             typedef void (* StartingAddsFunction)(CaveSearchExtrasDB * const);
             typedef void (* DoneAddsFunction)(CaveSearchExtrasDB * const);
 
             typedef void (* FindCandidatesFunction)(CaveSearchExtrasDB * const, std::list<std::string> &,
-                    const bool, const bool, const std::string &);
+                    const bool, const bool, const std::string &, const bool, const bool);
 
             void * handle;
 
             CreateDBFunction create_db_function;
             OpenDBFunction open_db_function;
+            OpenDBFunction open_db_for_update_function;
 
             CleanupDBFunction cleanup_db_function;
 
@@ -57,6 +67,12 @@ namespace paludis
             AddCandidateFunction add_candidate_function;
             DoneAddsFunction done_adds_function;
 
+            FindPackageFunction find_package_function;
+            FindPackageNamesFunction find_package_names_function;
+            RemovePackageFunction remove_package_function;
+            GetMarkerFunction get_marker_function;
+            SetMarkerFunction set_marker_function;
+
             FindCandidatesFunction find_candidates_function;
 
             SearchExtrasHandle()
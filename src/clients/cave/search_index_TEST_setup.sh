@@ -0,0 +1,98 @@
+#!/usr/bin/env bash
+# vim: set ft=sh sw=4 sts=4 et :
+
+mkdir search_index_TEST_dir || exit 1
+cd search_index_TEST_dir || exit 1
+mkdir -p build
+
+mkdir -p config/.paludis-search-index-test/repositories
+cat <<END > config/.paludis-search-index-test/specpath.conf
+config-suffix =
+END
+
+cat <<END > config/.paludis-search-index-test/use.conf
+*/* foo
+END
+
+cat <<END > config/.paludis-search-index-test/licenses.conf
+*/* *
+END
+
+cat <<END > config/.paludis-search-index-test/keywords.conf
+*/* test
+END
+
+cat <<END > config/.paludis-search-index-test/general.conf
+world = `pwd`/root/world
+END
+
+cat <<END > config/.paludis-search-index-test/bashrc
+export CHOST="my-chost"
+END
+
+cat <<END > config/.paludis-search-index-test/repositories/repo1.conf
+location = `pwd`/repo1
+cache = /var/empty
+format = e
+names_cache = /var/empty
+profiles = \${location}/profiles/testprofile
+builddir = `pwd`/build
+END
+
+cat <<END > config/.paludis-search-index-test/repositories/installed.conf
+location = `pwd`/root/var/db/pkg
+format = vdb
+names_cache = /var/empty
+builddir = `pwd`/build
+END
+
+mkdir -p root/tmp
+mkdir -p root/var/db/pkg
+mkdir -p root/${SYSCONFDIR}
+touch root/${SYSCONFDIR}/ld.so.conf
+
+mkdir -p repo1/{eclass,distfiles,profiles/testprofile,cat/{monkey,letters,other}} || exit 1
+
+cd repo1 || exit 1
+echo "test-repo-1" > profiles/repo_name || exit 1
+cat <<END > profiles/categories || exit 1
+cat
+END
+cat <<END > profiles/testprofile/make.defaults
+ARCH=test
+USERLAND=test
+KERNEL=test
+USE_EXPAND="USERLAND KERNEL"
+END
+
+cat <<"END" > cat/monkey/monkey-1.ebuild || exit 1
+DESCRIPTION="A giant space monkeybar"
+HOMEPAGE="http://paludis.exherbo.org/"
+SRC_URI=""
+SLOT="0"
+IUSE=""
+LICENSE="GPL-2"
+KEYWORDS="test"
+END
+
+cat <<"END" > cat/letters/letters-1.ebuild || exit 1
+DESCRIPTION="ABCD things"
+HOMEPAGE="http://paludis.exherbo.org/"
+SRC_URI=""
+SLOT="0"
+IUSE=""
+LICENSE="GPL-2"
+KEYWORDS="test"
+END
+
+cat <<"END" > cat/other/other-1.ebuild || exit 1
+DESCRIPTION="Nothing to see here"
+HOMEPAGE="http://paludis.exherbo.org/"
+SRC_URI=""
+SLOT="0"
+IUSE=""
+LICENSE="GPL-2"
+KEYWORDS="test"
+END
+
+cd ..